@@ -1,5 +1,5 @@
 macro ( ADD_FLUID_TEST _test )
-    ADD_EXECUTABLE(${_test} ${_test}.c $<TARGET_OBJECTS:libfluidsynth-OBJ> )
+    ADD_EXECUTABLE(${_test} ${_test}.c test_sfont_builder.c $<TARGET_OBJECTS:libfluidsynth-OBJ> )
     
     # only build this unit test when explicitly requested by "make check"
     set_target_properties(${_test} PROPERTIES EXCLUDE_FROM_ALL TRUE)
@@ -26,3 +26,29 @@ macro ( ADD_FLUID_TEST _test )
     add_dependencies(check ${_test})
 
 endmacro ( ADD_FLUID_TEST )
+
+macro ( ADD_FLUID_BENCHMARK _bench )
+    ADD_EXECUTABLE(${_bench} ${_bench}.c test_sfont_builder.c $<TARGET_OBJECTS:libfluidsynth-OBJ> )
+
+    # only build this benchmark when explicitly requested by "make bench"
+    set_target_properties(${_bench} PROPERTIES EXCLUDE_FROM_ALL TRUE)
+
+    # import necessary compile flags and dependency libraries
+    if ( FLUID_CPPFLAGS )
+        set_target_properties ( ${_bench} PROPERTIES COMPILE_FLAGS ${FLUID_CPPFLAGS} )
+    endif ( FLUID_CPPFLAGS )
+    TARGET_LINK_LIBRARIES(${_bench} $<TARGET_PROPERTY:libfluidsynth,INTERFACE_LINK_LIBRARIES>)
+
+    target_include_directories(${_bench}
+    PUBLIC
+    $<BUILD_INTERFACE:${CMAKE_BINARY_DIR}/include> # include auto generated headers
+    $<BUILD_INTERFACE:${CMAKE_SOURCE_DIR}/include> # include "normal" public (sub-)headers
+    $<BUILD_INTERFACE:${CMAKE_SOURCE_DIR}/src> # include private headers
+    $<TARGET_PROPERTY:libfluidsynth,INCLUDE_DIRECTORIES> # include all other header search paths needed by libfluidsynth (esp. glib)
+    )
+
+    # benchmarks are not part of ctest, the bench target runs them one after the other
+    add_custom_command(TARGET bench POST_BUILD COMMAND ${_bench} WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+    add_dependencies(bench ${_bench})
+
+endmacro ( ADD_FLUID_BENCHMARK )
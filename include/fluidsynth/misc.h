@@ -63,6 +63,8 @@ extern "C" {
 FLUIDSYNTH_API int fluid_is_soundfont(const char *filename);
 FLUIDSYNTH_API int fluid_is_midifile(const char *filename);
 
+FLUIDSYNTH_API int fluid_get_huge_page_stats(size_t *hugetlb_bytes, size_t *thp_bytes);
+
 
 #ifdef __cplusplus
 }
@@ -68,7 +68,8 @@ enum
 {
     FLUID_PRESET_SELECTED,                /**< Preset selected notify */
     FLUID_PRESET_UNSELECTED,              /**< Preset unselected notify */
-    FLUID_SAMPLE_DONE                     /**< Sample no longer needed notify */
+    FLUID_SAMPLE_DONE,                    /**< Sample no longer needed notify */
+    FLUID_PRESET_PRELOAD                  /**< Preset is likely to be selected soon, chan is -1 (@since 2.1.0) */
 };
 
 /**
@@ -133,6 +134,12 @@ typedef int (* fluid_sfloader_callback_read_t)(void *buf, int count, void *handl
  */
 typedef int (* fluid_sfloader_callback_seek_t)(void *handle, long offset, int origin);
 
+/**
+ * Same as #fluid_sfloader_callback_seek_t, with a 64 bit offset to allow for files larger than 2 GiB.
+ * @since 2.1.0
+ */
+typedef int (* fluid_sfloader_callback_seek64_t)(void *handle, fluid_long_long_t offset, int origin);
+
 /**
  * Closes the handle returned by #fluid_sfloader_callback_open_t and frees used ressources.
  *
@@ -143,6 +150,12 @@ typedef int (* fluid_sfloader_callback_close_t)(void *handle);
 /** @return returns current file offset or #FLUID_FAILED on error */
 typedef long (* fluid_sfloader_callback_tell_t)(void *handle);
 
+/**
+ * Same as #fluid_sfloader_callback_tell_t, with a 64 bit file offset.
+ * @since 2.1.0
+ */
+typedef fluid_long_long_t (* fluid_sfloader_callback_tell64_t)(void *handle);
+
 
 FLUIDSYNTH_API int fluid_sfloader_set_callbacks(fluid_sfloader_t *loader,
         fluid_sfloader_callback_open_t open,
@@ -151,6 +164,13 @@ FLUIDSYNTH_API int fluid_sfloader_set_callbacks(fluid_sfloader_t *loader,
         fluid_sfloader_callback_tell_t tell,
         fluid_sfloader_callback_close_t close);
 
+FLUIDSYNTH_API int fluid_sfloader_set_callbacks64(fluid_sfloader_t *loader,
+        fluid_sfloader_callback_open_t open,
+        fluid_sfloader_callback_read_t read,
+        fluid_sfloader_callback_seek64_t seek,
+        fluid_sfloader_callback_tell64_t tell,
+        fluid_sfloader_callback_close_t close);
+
 FLUIDSYNTH_API int fluid_sfloader_set_data(fluid_sfloader_t *loader, void *data);
 FLUIDSYNTH_API void *fluid_sfloader_get_data(fluid_sfloader_t *loader);
 
@@ -307,6 +327,12 @@ FLUIDSYNTH_API int fluid_sample_set_sound_data(fluid_sample_t *sample,
 FLUIDSYNTH_API int fluid_sample_set_loop(fluid_sample_t *sample, unsigned int loop_start, unsigned int loop_end);
 FLUIDSYNTH_API int fluid_sample_set_pitch(fluid_sample_t *sample, int root_key, int fine_tune);
 
+FLUIDSYNTH_API int fluid_samplecache_get_stats(unsigned int *hits, unsigned int *misses,
+        unsigned int *evictions, size_t *resident_bytes, size_t *unused_bytes);
+FLUIDSYNTH_API int fluid_samplecache_get_dedup_stats(unsigned int *shared_samples, size_t *saved_bytes);
+FLUIDSYNTH_API int fluid_get_sample_compression_stats(size_t *plain_bytes, size_t *compressed_bytes);
+FLUIDSYNTH_API int fluid_get_sample_loop_expansion_stats(unsigned int *samples, size_t *bytes);
+
 #ifdef __cplusplus
 }
 #endif
@@ -108,6 +108,7 @@ FLUIDSYNTH_API int fluid_synth_stop(fluid_synth_t *synth, unsigned int id);
 
 FLUIDSYNTH_API
 int fluid_synth_sfload(fluid_synth_t *synth, const char *filename, int reset_presets);
+FLUIDSYNTH_API int fluid_synth_sfload_shared(fluid_synth_t *synth, fluid_sfont_t *sfont, int reset_presets);
 FLUIDSYNTH_API int fluid_synth_sfreload(fluid_synth_t *synth, int id);
 FLUIDSYNTH_API int fluid_synth_sfunload(fluid_synth_t *synth, int id, int reset_presets);
 FLUIDSYNTH_API int fluid_synth_add_sfont(fluid_synth_t *synth, fluid_sfont_t *sfont);
@@ -119,6 +120,25 @@ FLUIDSYNTH_API fluid_sfont_t *fluid_synth_get_sfont_by_name(fluid_synth_t *synth
         const char *name);
 FLUIDSYNTH_API int fluid_synth_set_bank_offset(fluid_synth_t *synth, int sfont_id, int offset);
 FLUIDSYNTH_API int fluid_synth_get_bank_offset(fluid_synth_t *synth, int sfont_id);
+FLUIDSYNTH_API int fluid_synth_preload_preset(fluid_synth_t *synth, int sfont_id,
+        int bank_num, int preset_num);
+
+/**
+ * Callback to report the progress of a SoundFont load started by fluid_synth_sfload_async().
+ * It is called from the loader thread.
+ * @param data User defined data pointer passed to fluid_synth_sfload_async()
+ * @param sfont_id The ID the SoundFont will receive once loaded
+ * @param done Number of bytes of sample data loaded so far
+ * @param total Total number of bytes of sample data to load
+ * @return Should return #FLUID_OK to continue loading, #FLUID_FAILED cancels the load
+ */
+typedef int (*fluid_synth_sfload_progress_t)(void *data, int sfont_id, fluid_long_long_t done,
+        fluid_long_long_t total);
+
+FLUIDSYNTH_API int fluid_synth_sfload_async(fluid_synth_t *synth, const char *filename, int reset_presets,
+        fluid_synth_sfload_progress_t progress, void *data);
+FLUIDSYNTH_API int fluid_synth_sfload_cancel(fluid_synth_t *synth, int id);
+FLUIDSYNTH_API int fluid_synth_sfload_wait(fluid_synth_t *synth, int id);
 
 
 /* Reverb  */
@@ -233,6 +253,10 @@ FLUIDSYNTH_API int fluid_synth_tuning_dump(fluid_synth_t *synth, int bank, int p
 /* Misc */
 
 FLUIDSYNTH_API double fluid_synth_get_cpu_load(fluid_synth_t *synth);
+FLUIDSYNTH_API int fluid_synth_get_sample_decode_stats(fluid_synth_t *synth, unsigned int *voices,
+        double *blocks_per_voice, double *usec_per_voice);
+FLUIDSYNTH_API int fluid_synth_get_polyphony_governor_stats(fluid_synth_t *synth, int *voice_limit,
+        unsigned int *lowered, unsigned int *raised, unsigned int *stolen);
 FLUID_DEPRECATED FLUIDSYNTH_API const char *fluid_synth_error(fluid_synth_t *synth);
 
 
@@ -273,6 +297,20 @@ FLUIDSYNTH_API int fluid_synth_process(fluid_synth_t *synth, int len,
                                        int nout, float *out[]);
 
 
+/* Sharded rendering */
+
+FLUIDSYNTH_API fluid_sharded_synth_t *new_fluid_sharded_synth(fluid_settings_t *settings, int shards);
+FLUIDSYNTH_API void delete_fluid_sharded_synth(fluid_sharded_synth_t *ss);
+FLUIDSYNTH_API int fluid_sharded_synth_count_shards(fluid_sharded_synth_t *ss);
+FLUIDSYNTH_API fluid_synth_t *fluid_sharded_synth_get_shard(fluid_sharded_synth_t *ss, int shard);
+FLUIDSYNTH_API fluid_synth_t *fluid_sharded_synth_get_channel_shard(fluid_sharded_synth_t *ss, int chan);
+FLUIDSYNTH_API int fluid_sharded_synth_sfload(fluid_sharded_synth_t *ss, const char *filename, int reset_presets);
+FLUIDSYNTH_API int fluid_sharded_synth_handle_midi_event(void *data, fluid_midi_event_t *event);
+FLUIDSYNTH_API int fluid_sharded_synth_process(fluid_sharded_synth_t *ss, int len,
+        int nfx, float *fx[],
+        int nout, float *out[]);
+
+
 /* Synthesizer's interface to handle SoundFont loaders */
 
 FLUIDSYNTH_API void fluid_synth_add_sfloader(fluid_synth_t *synth, fluid_sfloader_t *loader);
@@ -35,6 +35,7 @@ extern "C" {
 
 typedef struct _fluid_hashtable_t fluid_settings_t;             /**< Configuration settings instance */
 typedef struct _fluid_synth_t fluid_synth_t;                    /**< Synthesizer instance */
+typedef struct _fluid_sharded_synth_t fluid_sharded_synth_t;    /**< Synthesizer instance sharded across threads */
 typedef struct _fluid_voice_t fluid_voice_t;                    /**< Synthesis voice instance */
 typedef struct _fluid_sfloader_t fluid_sfloader_t;              /**< SoundFont loader plugin */
 typedef struct _fluid_sfont_t fluid_sfont_t;                    /**< SoundFont */
@@ -64,6 +65,17 @@ typedef int fluid_ostream_t;    /**< Output stream descriptor */
 
 typedef short fluid_seq_id_t; /**< Unique client IDs used by the sequencer and #fluid_event_t, obtained by fluid_sequencer_register_client() and fluid_sequencer_register_fluidsynth() */
 
+#if defined(_MSC_VER) && (_MSC_VER < 1800)
+typedef __int64 fluid_long_long_t; /* even on 32 bit windows */
+#else
+/**
+ * A typedef for C99's type long long, which is at least 64 bit wide, used for file
+ * offsets and sizes. @c __int64 is used as replacement for Visual Studio 2012 and older.
+ * @since 2.1.0
+ */
+typedef long long fluid_long_long_t;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
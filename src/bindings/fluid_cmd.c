@@ -931,9 +931,24 @@ fluid_handle_load(void *data, int ac, char **av, fluid_ostream_t out)
         offset = atoi(av[2]);
     }
 
+    fluid_expand_path(av[0], buf, 1024);
+
     /* Load the SoundFont without resetting the programs. The reset will
-     * be done later (if requested). */
-    id = fluid_synth_sfload(handler->synth, fluid_expand_path(av[0], buf, 1024), 0);
+     * be done later (if requested). If the synth is thread safe, load it
+     * on a background thread, so that it keeps playing in the meantime. */
+    if(handler->synth->use_mutex)
+    {
+        id = fluid_synth_sfload_async(handler->synth, buf, 0, NULL, NULL);
+
+        if(id != FLUID_FAILED)
+        {
+            id = fluid_synth_sfload_wait(handler->synth, id);
+        }
+    }
+    else
+    {
+        id = fluid_synth_sfload(handler->synth, buf, 0);
+    }
 
     if(id == -1)
     {
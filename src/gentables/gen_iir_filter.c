@@ -0,0 +1,30 @@
+#include "rvoice/fluid_iir_filter_tables.h"
+#include "make_tables.h"
+
+/* sine and cosine of the cutoff as angular frequency */
+static double fluid_iir_sincos_tab[FLUID_IIR_SINCOS_SIZE][2];
+
+static double cb_fluid_iir_sincos_tab(int y, int x) { return fluid_iir_sincos_tab[y][x]; }
+
+static void fluid_iir_filter_config(void)
+{
+    int i;
+
+    for(i = 0; i < FLUID_IIR_SINCOS_SIZE; i++)
+    {
+        double cents = FLUID_IIR_CENTS_MIN + (i - 1) * FLUID_IIR_CENTS_STEP;
+        double omega = 2.0 * M_PI * pow(2.0, cents / 1200.0);
+
+        fluid_iir_sincos_tab[i][0] = sin(omega);
+        fluid_iir_sincos_tab[i][1] = cos(omega);
+    }
+}
+
+
+void gen_iir_filter_table(FILE *fp)
+{
+    /* Calculate the values */
+    fluid_iir_filter_config();
+
+    emit_matrix(fp, "fluid_iir_sincos_tab", cb_fluid_iir_sincos_tab, FLUID_IIR_SINCOS_SIZE, 2);
+}
@@ -80,5 +80,9 @@ int main (int argc, char *argv[])
     gen_rvoice_table_dsp(fp);
     fclose(fp);
 
+    open_table(&fp, argv[1], "fluid_iir_filter_tables.c");
+    gen_iir_filter_table(fp);
+    fclose(fp);
+
     return 0;
 }
@@ -12,6 +12,7 @@ typedef double (*emit_matrix_cb)(int y, int x);
 /* Generators */
 void gen_rvoice_table_dsp(FILE *fp);
 void gen_conv_table(FILE *fp);
+void gen_iir_filter_table(FILE *fp);
 
 /* Emit an array of real numbers */
 void emit_array(FILE *fp, const char *tblname, const double *tbl, int size);
@@ -55,6 +55,8 @@ static int fluid_track_send_events(fluid_track_t *track,
 
 static int fluid_player_add_track(fluid_player_t *player, fluid_track_t *track);
 static int fluid_player_callback(void *data, unsigned int msec);
+static void fluid_player_prefetch(fluid_player_t *player);
+static void fluid_player_reset_prefetch(fluid_player_t *player);
 static int fluid_player_reset(fluid_player_t *player);
 static int fluid_player_load(fluid_player_t *player, fluid_playlist_item *item);
 static void fluid_player_advancefile(fluid_player_t *player);
@@ -1434,6 +1436,8 @@ new_fluid_track(int num)
     track->cur = NULL;
     track->last = NULL;
     track->ticks = 0;
+    track->prefetch_cur = NULL;
+    track->prefetch_ticks = 0;
     return track;
 }
 
@@ -1513,6 +1517,7 @@ fluid_track_add_event(fluid_track_t *track, fluid_midi_event_t *evt)
         track->first = evt;
         track->cur = evt;
         track->last = evt;
+        track->prefetch_cur = evt;
     }
     else
     {
@@ -1545,6 +1550,8 @@ fluid_track_reset(fluid_track_t *track)
 {
     track->ticks = 0;
     track->cur = track->first;
+    track->prefetch_ticks = 0;
+    track->prefetch_cur = track->first;
     return FLUID_OK;
 }
 
@@ -1674,6 +1681,9 @@ new_fluid_player(fluid_synth_t *synth)
     player->cur_msec = 0;
     player->cur_ticks = 0;
     player->seek_ticks = -1;
+
+    fluid_player_reset_prefetch(player);
+
     fluid_player_set_playback_callback(player, fluid_synth_handle_midi_event, synth);
     player->use_system_timer = fluid_settings_str_equal(synth->settings,
                                "player.timing-source", "system");
@@ -1755,6 +1765,9 @@ fluid_player_reset(fluid_player_t *player)
     player->send_program_change = 1;
     player->miditempo = 480000;
     player->deltatime = 4.0;
+
+    fluid_player_reset_prefetch(player);
+
     return 0;
 }
 
@@ -2073,6 +2086,12 @@ fluid_player_callback(void *data, unsigned int msec)
             player->begin_msec = msec;      /* only used to calculate the duration of playing */
             player->start_msec = msec;      /* should be the (synth)-time of the last tempo change */
             player->seek_ticks = -1;        /* clear seek_ticks */
+            fluid_player_reset_prefetch(player);
+        }
+
+        if(status == FLUID_PLAYER_PLAYING && synth->prefetch_window > 0)
+        {
+            fluid_player_prefetch(player);
         }
 
         if(status == FLUID_PLAYER_DONE)
@@ -2089,6 +2108,87 @@ fluid_player_callback(void *data, unsigned int msec)
     return 1;
 }
 
+/*
+ * fluid_player_prefetch
+ * Look ahead synth.prefetch-window msec in all tracks and let the synth load
+ * the samples of upcoming program changes.
+ */
+static void
+fluid_player_prefetch(fluid_player_t *player)
+{
+    int i, chan;
+    unsigned int ticks;
+    fluid_track_t *track;
+    fluid_midi_event_t *event;
+
+    ticks = player->cur_ticks + (unsigned int)(player->synth->prefetch_window / player->deltatime);
+
+    for(i = 0; i < player->ntracks; i++)
+    {
+        track = player->track[i];
+
+        /* the lookahead fell behind playback, e.g. after seeking */
+        if(track->prefetch_ticks < track->ticks)
+        {
+            track->prefetch_cur = track->cur;
+            track->prefetch_ticks = track->ticks;
+        }
+
+        while((event = track->prefetch_cur) != NULL
+                && track->prefetch_ticks + event->dtime <= ticks)
+        {
+            track->prefetch_ticks += event->dtime;
+            track->prefetch_cur = event->next;
+            chan = event->channel;
+
+            if(chan >= 16)
+            {
+                continue;
+            }
+
+            if(event->type == CONTROL_CHANGE && event->param1 == BANK_SELECT_MSB)
+            {
+                player->prefetch_bank_msb[chan] = event->param2;
+            }
+            else if(event->type == CONTROL_CHANGE && event->param1 == BANK_SELECT_LSB)
+            {
+                player->prefetch_bank_lsb[chan] = event->param2;
+            }
+            else if(event->type == PROGRAM_CHANGE)
+            {
+                fluid_synth_prefetch_program(player->synth, chan, player->prefetch_bank_msb[chan],
+                                             player->prefetch_bank_lsb[chan], event->param1);
+            }
+        }
+    }
+}
+
+/*
+ * fluid_player_reset_prefetch
+ * Restart the lookahead of fluid_player_prefetch() at the playback position of each
+ * track and forget the bank selects it has seen, as playback jumped (e.g. seeking).
+ */
+static void
+fluid_player_reset_prefetch(fluid_player_t *player)
+{
+    int i;
+
+    for(i = 0; i < player->ntracks; i++)
+    {
+        if(player->track[i] != NULL)
+        {
+            player->track[i]->prefetch_cur = player->track[i]->cur;
+            player->track[i]->prefetch_ticks = player->track[i]->ticks;
+        }
+    }
+
+    for(i = 0; i < 16; i++)
+    {
+        player->prefetch_bank_msb[i] = -1;
+        player->prefetch_bank_lsb[i] = -1;
+    }
+}
+
 /**
  * Activates play mode for a MIDI player if not already playing.
  * @param player MIDI player instance
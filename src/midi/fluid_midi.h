@@ -247,6 +247,8 @@ struct _fluid_track_t
     fluid_midi_event_t *cur;
     fluid_midi_event_t *last;
     unsigned int ticks;
+    fluid_midi_event_t *prefetch_cur;   /* next event to look at for sample prefetching */
+    unsigned int prefetch_ticks;        /* the ticks of the event before prefetch_cur */
 };
 
 typedef struct _fluid_track_t fluid_track_t;
@@ -298,6 +300,9 @@ struct _fluid_player_t
 
     handle_midi_event_func_t playback_callback; /* function fired on each midi event as it is played */
     void *playback_userdata; /* pointer to user-defined data passed to playback_callback function */
+
+    int prefetch_bank_msb[16]; /* bank select MSB per channel seen by the prefetch lookahead, -1 if none */
+    int prefetch_bank_lsb[16]; /* bank select LSB per channel seen by the prefetch lookahead, -1 if none */
 };
 
 void fluid_player_settings(fluid_settings_t *settings);
@@ -47,6 +47,8 @@ struct _fluid_sequencer_t
     double scale; // ticks per second
     fluid_list_t *clients;
     fluid_seq_id_t clientsID;
+    struct _fluid_sequencer_client_t *prefetch_client; /* destination of the last prefetched event, NULL if unknown */
+    fluid_list_t *prefetch_events; /* copies of queued events still too far ahead for their destination to prefetch */
     /* for queue + heap */
     fluid_evt_entry *preQueue;
     fluid_evt_entry *preQueueLast;
@@ -77,13 +79,16 @@ typedef struct _fluid_sequencer_client_t
 /* prototypes */
 static short _fluid_seq_queue_init(fluid_sequencer_t *seq, int nbEvents);
 static void _fluid_seq_queue_end(fluid_sequencer_t *seq);
-static short _fluid_seq_queue_pre_insert(fluid_sequencer_t *seq, fluid_event_t *evt);
+static short _fluid_seq_queue_pre_insert(fluid_sequencer_t *seq, fluid_event_t *evt, int prefetch);
 static void _fluid_seq_queue_pre_remove(fluid_sequencer_t *seq, fluid_seq_id_t src, fluid_seq_id_t dest, int type);
 static int _fluid_seq_queue_process(void *data, unsigned int msec); // callback from timer
 static void _fluid_seq_queue_insert_entry(fluid_sequencer_t *seq, fluid_evt_entry *evtentry);
 static void _fluid_seq_queue_remove_entries_matching(fluid_sequencer_t *seq, fluid_evt_entry *temp);
 static void _fluid_seq_queue_send_queued_events(fluid_sequencer_t *seq);
 static void _fluid_free_evt_queue(fluid_evt_entry **first, fluid_evt_entry **last);
+static int _fluid_seq_prefetch(fluid_sequencer_t *seq, fluid_event_t *evt, unsigned int ticks);
+static void _fluid_seq_prefetch_queued(fluid_sequencer_t *seq);
+static void _fluid_seq_queue_prefetch_later(fluid_sequencer_t *seq, fluid_event_t *evt);
 
 
 /* API implementation */
@@ -173,6 +178,12 @@ delete_fluid_sequencer(fluid_sequencer_t *seq)
 
     _fluid_seq_queue_end(seq);
 
+    while(seq->prefetch_events)
+    {
+        FLUID_FREE(fluid_list_get(seq->prefetch_events));
+        seq->prefetch_events = fluid_list_remove_link(seq->prefetch_events, seq->prefetch_events);
+    }
+
     /*	if (seq->clients) {
     		fluid_list_t *tmp = seq->clients;
     		while (tmp != NULL) {
@@ -350,6 +361,11 @@ fluid_sequencer_unregister_client(fluid_sequencer_t *seq, fluid_seq_id_t id)
                 FLUID_FREE(client->name);
             }
 
+            if(seq->prefetch_client == client)
+            {
+                seq->prefetch_client = NULL;
+            }
+
             seq->clients = fluid_list_remove_link(seq->clients, tmp);
             delete1_fluid_list(tmp);
             FLUID_FREE(client);
@@ -512,6 +528,7 @@ fluid_sequencer_send_at(fluid_sequencer_t *seq, fluid_event_t *evt,
                         unsigned int time, int absolute)
 {
     unsigned int now = fluid_sequencer_get_tick(seq);
+    int prefetch;
 
     /* set absolute */
     if(!absolute)
@@ -522,8 +539,78 @@ fluid_sequencer_send_at(fluid_sequencer_t *seq, fluid_event_t *evt,
     /* time stamp event */
     fluid_event_set_time(evt, time);
 
+    /* events too far ahead are looked at again as time advances */
+    prefetch = !_fluid_seq_prefetch(seq, evt, time > now ? time - now : 0);
+
     /* queue for processing later */
-    return _fluid_seq_queue_pre_insert(seq, evt);
+    return _fluid_seq_queue_pre_insert(seq, evt, prefetch);
+}
+
+/* Give the destination of an event that is due in 'ticks' the chance to
+ * prepare for it, used by synths to prefetch samples of program changes.
+ * The destination is remembered, as events are usually sent to the same synth.
+ * Returns FALSE if the event is too far ahead for the destination yet. */
+static int
+_fluid_seq_prefetch(fluid_sequencer_t *seq, fluid_event_t *evt, unsigned int ticks)
+{
+    fluid_seq_id_t destID = fluid_event_get_dest(evt);
+    fluid_sequencer_client_t *dest = seq->prefetch_client;
+    fluid_list_t *tmp;
+    int type = fluid_event_get_type(evt);
+
+    if(type != FLUID_SEQ_PROGRAMCHANGE && type != FLUID_SEQ_PROGRAMSELECT)
+    {
+        return TRUE;
+    }
+
+    if(dest == NULL || dest->id != destID)
+    {
+        for(tmp = seq->clients, dest = NULL; tmp; tmp = tmp->next)
+        {
+            if(((fluid_sequencer_client_t *)tmp->data)->id == destID)
+            {
+                dest = (fluid_sequencer_client_t *)tmp->data;
+                seq->prefetch_client = dest;
+                break;
+            }
+        }
+
+        if(dest == NULL)
+        {
+            return TRUE;
+        }
+    }
+
+    return fluid_seqbind_prefetch(dest->callback, dest->data, evt,
+                                  (unsigned int)(ticks * 1000.0 / seq->scale));
+}
+
+/* Called from the sequencer thread as time advances: prefetch for the queued
+ * events that have come near enough for their destination since the last call. */
+static void
+_fluid_seq_prefetch_queued(fluid_sequencer_t *seq)
+{
+    unsigned int now = fluid_sequencer_get_tick(seq);
+    fluid_list_t *tmp = seq->prefetch_events;
+    fluid_list_t *next;
+    fluid_event_t *evt;
+
+    while(tmp)
+    {
+        next = fluid_list_next(tmp);
+        evt = fluid_list_get(tmp);
+
+        /* events due now are sent right away, nothing to prepare for */
+        if(fluid_event_get_time(evt) <= now
+                || _fluid_seq_prefetch(seq, evt, fluid_event_get_time(evt) - now))
+        {
+            seq->prefetch_events = fluid_list_remove_link(seq->prefetch_events, tmp);
+            delete1_fluid_list(tmp);
+            FLUID_FREE(evt);
+        }
+
+        tmp = next;
+    }
 }
 
 /**
@@ -793,8 +880,25 @@ _fluid_seq_queue_end(fluid_sequencer_t *seq)
 /* Create event_entry and append to the preQueue.
  * May be called from the main thread (usually) but also recursively
  * from the queue thread, when a callback itself does an insert... */
+/* Remember a copy of a queued event to prefetch for it once it is near enough.
+ * Called from the sequencer thread only. */
+static void
+_fluid_seq_queue_prefetch_later(fluid_sequencer_t *seq, fluid_event_t *evt)
+{
+    fluid_event_t *copy = FLUID_NEW(fluid_event_t);
+
+    if(copy == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return;
+    }
+
+    FLUID_MEMCPY(copy, evt, sizeof(fluid_event_t));
+    seq->prefetch_events = fluid_list_prepend(seq->prefetch_events, copy);
+}
+
 static short
-_fluid_seq_queue_pre_insert(fluid_sequencer_t *seq, fluid_event_t *evt)
+_fluid_seq_queue_pre_insert(fluid_sequencer_t *seq, fluid_event_t *evt, int prefetch)
 {
     fluid_evt_entry *evtentry = _fluid_seq_heap_get_free(seq->heap);
 
@@ -807,6 +911,7 @@ _fluid_seq_queue_pre_insert(fluid_sequencer_t *seq, fluid_event_t *evt)
 
     evtentry->next = NULL;
     evtentry->entryType = FLUID_EVT_ENTRY_INSERT;
+    evtentry->prefetch = prefetch;
     FLUID_MEMCPY(&(evtentry->evt), evt, sizeof(fluid_event_t));
 
     fluid_mutex_lock(seq->mutex);
@@ -845,6 +950,7 @@ _fluid_seq_queue_pre_remove(fluid_sequencer_t *seq, fluid_seq_id_t src, fluid_se
 
     evtentry->next = NULL;
     evtentry->entryType = FLUID_EVT_ENTRY_REMOVE;
+    evtentry->prefetch = FALSE;
     {
         fluid_event_t *evt = &(evtentry->evt);
         fluid_event_set_source(evt, src);
@@ -936,6 +1042,11 @@ fluid_sequencer_process(fluid_sequencer_t *seq, unsigned int msec)
         }
         else
         {
+            if(tmp->prefetch)
+            {
+                _fluid_seq_queue_prefetch_later(seq, &tmp->evt);
+            }
+
             _fluid_seq_queue_insert_entry(seq, tmp);
         }
 
@@ -944,6 +1055,7 @@ fluid_sequencer_process(fluid_sequencer_t *seq, unsigned int msec)
 
     /* send queued events */
     fluid_atomic_int_set(&seq->currentMs, msec);
+    _fluid_seq_prefetch_queued(seq);
     _fluid_seq_queue_send_queued_events(seq);
 
 }
@@ -1161,6 +1273,26 @@ _fluid_seq_queue_remove_entries_matching(fluid_sequencer_t *seq, fluid_evt_entry
     /* we can set it free now */
     _fluid_seq_heap_set_free(seq->heap, templ);
 
+    /* removed events don't need to be prepared for */
+    {
+        fluid_list_t *tmp = seq->prefetch_events;
+        fluid_list_t *next;
+
+        while(tmp)
+        {
+            next = fluid_list_next(tmp);
+
+            if(_fluid_seq_queue_matchevent(fluid_list_get(tmp), type, src, dest))
+            {
+                FLUID_FREE(fluid_list_get(tmp));
+                seq->prefetch_events = fluid_list_remove_link(seq->prefetch_events, tmp);
+                delete1_fluid_list(tmp);
+            }
+
+            tmp = next;
+        }
+    }
+
     /* queue0 */
     for(i = 0 ; i < 256 ; i++)
     {
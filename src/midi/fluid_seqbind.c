@@ -153,6 +153,52 @@ fluid_seqbind_timer_callback(void *data, unsigned int msec)
     return 1;
 }
 
+/* Called when an event is due msec ahead for the client with the given
+ * callback. Lets a synth load the samples of program changes that are due
+ * within synth.prefetch-window. Returns FALSE if the event is too far ahead
+ * yet, TRUE if there is nothing (more) to do for it. */
+int
+fluid_seqbind_prefetch(fluid_event_callback_t callback, void *data,
+                       fluid_event_t *evt, unsigned int msec)
+{
+    fluid_synth_t *synth;
+
+    if(callback != fluid_seq_fluidsynth_callback)
+    {
+        return TRUE;
+    }
+
+    synth = ((fluid_seqbind_t *) data)->synth;
+
+    if(synth->prefetch_window <= 0)
+    {
+        return TRUE;
+    }
+
+    if(msec > (unsigned int) synth->prefetch_window)
+    {
+        return FALSE;
+    }
+
+    switch(fluid_event_get_type(evt))
+    {
+    case FLUID_SEQ_PROGRAMCHANGE:
+        fluid_synth_prefetch_program(synth, fluid_event_get_channel(evt), -1, -1,
+                                     fluid_event_get_program(evt));
+        break;
+
+    case FLUID_SEQ_PROGRAMSELECT:
+        fluid_synth_prefetch_preset(synth, fluid_event_get_sfont_id(evt),
+                                    fluid_event_get_bank(evt), fluid_event_get_program(evt));
+        break;
+
+    default:
+        break;
+    }
+
+    return TRUE;
+}
+
 /* Callback for midi events */
 void
 fluid_seq_fluidsynth_callback(unsigned int time, fluid_event_t *evt, fluid_sequencer_t *seq, void *data)
@@ -89,11 +89,11 @@
 /* Length of one delay line in samples:
  * Set through MAX_SAMPLES_LN2.
  * For example:
- * MAX_SAMPLES_LN2=12
- * => MAX_SAMPLES=pow(2,12-1)=2048
- * => MAX_SAMPLES_ANDMASK=2047
+ * MAX_SAMPLES_LN2=13
+ * => MAX_SAMPLES=pow(2,13-1)=4096
+ * => MAX_SAMPLES_ANDMASK=4095
  */
-#define MAX_SAMPLES_LN2 12
+#define MAX_SAMPLES_LN2 13
 
 #define MAX_SAMPLES (1 << (MAX_SAMPLES_LN2-1))
 #define MAX_SAMPLES_ANDMASK (MAX_SAMPLES-1)
@@ -114,6 +114,34 @@
 */
 #define INTERPOLATION_SAMPLES 5
 
+/* Length of the delay line buffer:
+   The first INTERPOLATION_SAMPLES - 1 samples of the delay line are mirrored
+   behind its end, so the samples used to interpolate one position can be
+   read without wrapping around.
+*/
+#define CHORUS_BUF_SAMPLES (MAX_SAMPLES + INTERPOLATION_SAMPLES - 1)
+
+/* Maximum modulation depth in samples:
+   A whole block of FLUID_BUFSIZE input samples is written to the delay line
+   before the block is processed, so the oldest sample read during a block
+   must not have been overwritten yet.
+*/
+#define MAX_DEPTH_SAMPLES (MAX_SAMPLES - FLUID_BUFSIZE - INTERPOLATION_SAMPLES)
+
+/* Offset subtracted from the modulation waveforms:
+   A number of full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES, which
+   keeps the read position in the delay line positive at all times.
+*/
+#define LOOKUP_OFFSET (3 * MAX_SAMPLES * INTERPOLATION_SUBSAMPLES)
+
+/* Origin of the triangle ramp:
+   The ramp is accumulated in floating point from a fixed origin, which
+   doesn't depend on MAX_SAMPLES, so that the rounding of the waveform (and
+   thus the output of the chorus) doesn't change with the length of the
+   delay line. It is the offset of a delay line of 2048 samples.
+*/
+#define TRIANGLE_ORIGIN (3 * 2048 * INTERPOLATION_SUBSAMPLES)
+
 /* Private data for SKEL file */
 struct _fluid_chorus_t
 {
@@ -197,7 +225,7 @@ new_fluid_chorus(fluid_real_t sample_rate)
 
     /* allocate sample buffer */
 
-    chorus->chorusbuf = FLUID_ARRAY(fluid_real_t, MAX_SAMPLES);
+    chorus->chorusbuf = FLUID_ARRAY(fluid_real_t, CHORUS_BUF_SAMPLES);
 
     if(chorus->chorusbuf == NULL)
     {
@@ -233,7 +261,7 @@ fluid_chorus_init(fluid_chorus_t *chorus)
 {
     int i;
 
-    for(i = 0; i < MAX_SAMPLES; i++)
+    for(i = 0; i < CHORUS_BUF_SAMPLES; i++)
     {
         chorus->chorusbuf[i] = 0.0;
     }
@@ -344,10 +372,10 @@ fluid_chorus_set(fluid_chorus_t *chorus, int set, int nr, fluid_real_t level,
                                (chorus->depth_ms / 1000.0  /* convert modulation depth in ms to s*/
                                 * chorus->sample_rate);
 
-    if(modulation_depth_samples > MAX_SAMPLES)
+    if(modulation_depth_samples > MAX_DEPTH_SAMPLES)
     {
-        FLUID_LOG(FLUID_WARN, "chorus: Too high depth. Setting it to max (%d).", MAX_SAMPLES);
-        modulation_depth_samples = MAX_SAMPLES;
+        FLUID_LOG(FLUID_WARN, "chorus: Too high depth. Setting it to max (%d).", MAX_DEPTH_SAMPLES);
+        modulation_depth_samples = MAX_DEPTH_SAMPLES;
         // set depth to maximum to avoid spamming console with above warning
         chorus->depth_ms = (modulation_depth_samples * 1000) / chorus->sample_rate;
     }
@@ -383,149 +411,172 @@ fluid_chorus_set(fluid_chorus_t *chorus, int set, int nr, fluid_real_t level,
 }
 
 
-void fluid_chorus_processmix(fluid_chorus_t *chorus, const fluid_real_t *in,
-                             fluid_real_t *left_out, fluid_real_t *right_out)
+/*
+ * Processes count samples, a multiple of FLUID_BUFSIZE.
+ *
+ * The samples are processed block by block, so that the delay line never
+ * holds more than one block ahead of the oldest sample still to be read. The
+ * buffer position and the LFO phases are kept in locals across the blocks.
+ *
+ * The input block is written to the delay line first. Then, for each chorus
+ * block, the read positions of the whole block are computed up front from a
+ * contiguous run of the modulation waveform (split at most where the LFO
+ * period wraps around). The interpolation is done tap by tap for all samples
+ * at once, a loop without any modulo that can be vectorized. For every
+ * sample the taps and chorus blocks are still summed in the same order as
+ * when processing sample by sample.
+ */
+static FLUID_INLINE void
+fluid_chorus_process(fluid_chorus_t *chorus, const fluid_real_t *in,
+                     fluid_real_t *left_out, fluid_real_t *right_out,
+                     int count, int mix)
 {
-    int sample_index;
-    int i;
-    fluid_real_t d_in, d_out;
+    fluid_real_t d_out[FLUID_BUFSIZE];
+    int pos_samples[FLUID_BUFSIZE];    /* newest sample to interpolate from */
+    int pos_subsamples[FLUID_BUFSIZE]; /* fractional position */
+    long phase[MAX_CHORUS];
+    fluid_real_t *chorusbuf = chorus->chorusbuf;
+    const int number_blocks = chorus->number_blocks;
+    const int period = chorus->modulation_period_samples;
+    const fluid_real_t level = chorus->level;
+    int counter = chorus->counter;
+    int sample_index, run, k;
+    int i, ii;
+
+    FLUID_MEMCPY(phase, chorus->phase, number_blocks * sizeof(long));
 
-    for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
+    for(k = 0; k < count; k += FLUID_BUFSIZE)
     {
+        /* Write the current block into the circular buffer */
+        for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
+        {
+            int pos = (counter + sample_index) & MAX_SAMPLES_ANDMASK;
 
-        d_in = in[sample_index];
-        d_out = 0.0f;
+            chorusbuf[pos] = in[k + sample_index];
 
-# if 0
-        /* Debug: Listen to the chorus signal only */
-        left_out[sample_index] = 0;
-        right_out[sample_index] = 0;
-#endif
+            if(pos < INTERPOLATION_SAMPLES - 1)
+            {
+                chorusbuf[pos + MAX_SAMPLES] = in[k + sample_index];
+            }
 
-        /* Write the current sample into the circular buffer */
-        chorus->chorusbuf[chorus->counter] = d_in;
+            d_out[sample_index] = 0.0f;
+        }
 
-        for(i = 0; i < chorus->number_blocks; i++)
+        for(i = 0; i < number_blocks; i++)
         {
-            int ii;
-            /* Calculate the delay in subsamples for the delay line of chorus block nr. */
-
-            /* The value in the lookup table is so, that this expression
-             * will always be positive.  It will always include a number of
-             * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
-             * remain positive at all times. */
-            int pos_subsamples = (INTERPOLATION_SUBSAMPLES * chorus->counter
-                                  - chorus->lookup_tab[chorus->phase[i]]);
-
-            int pos_samples = pos_subsamples / INTERPOLATION_SUBSAMPLES;
+            const fluid_real_t *FLUID_RESTRICT buf = chorusbuf;
 
-            /* modulo divide by INTERPOLATION_SUBSAMPLES */
-            pos_subsamples &= INTERPOLATION_SUBSAMPLES_ANDMASK;
+            for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index += run)
+            {
+                /* current run of the modulation waveform */
+                const int *FLUID_RESTRICT lookup_tab = &chorus->lookup_tab[phase[i]];
+                int block_counter = counter + sample_index;
+
+                run = FLUID_BUFSIZE - sample_index;
+
+                if(run > period - phase[i])
+                {
+                    run = period - phase[i];
+                }
+
+                #pragma omp simd
+
+                for(ii = 0; ii < run; ii++)
+                {
+                    /* Calculate the delay in subsamples for the delay line of chorus block nr. */
+
+                    /* The value in the lookup table is so, that this expression
+                     * will always be positive.  It will always include a number of
+                     * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
+                     * remain positive at all times. */
+                    int pos = (INTERPOLATION_SUBSAMPLES * (block_counter + ii) - lookup_tab[ii]);
+
+                    /* The & is equivalent to a division modulo MAX_SAMPLES, only
+                       faster. Thanks to the mirrored samples, the older samples
+                       used for interpolation can be read without wrapping around. */
+                    pos_samples[sample_index + ii] =
+                        ((pos / INTERPOLATION_SUBSAMPLES - (INTERPOLATION_SAMPLES - 1)) & MAX_SAMPLES_ANDMASK)
+                        + INTERPOLATION_SAMPLES - 1;
+
+                    /* modulo divide by INTERPOLATION_SUBSAMPLES */
+                    pos_subsamples[sample_index + ii] = pos & INTERPOLATION_SUBSAMPLES_ANDMASK;
+                }
+
+                /* Cycle the phase of the modulating LFO */
+                phase[i] += run;
+
+                if(phase[i] >= period)
+                {
+                    phase[i] = 0;
+                }
+            }
 
             for(ii = 0; ii < INTERPOLATION_SAMPLES; ii++)
             {
-                /* Add the delayed signal to the chorus sum d_out Note: The
-                 * delay in the delay line moves backwards for increasing
-                 * delay!*/
-
-                /* The & in chorusbuf[...] is equivalent to a division modulo
-                   MAX_SAMPLES, only faster. */
-                d_out += chorus->chorusbuf[pos_samples & MAX_SAMPLES_ANDMASK]
-                         * chorus->sinc_table[ii][pos_subsamples];
-
-                pos_samples--;
-            };
-
-            /* Cycle the phase of the modulating LFO */
-            chorus->phase[i]++;
-
-            chorus->phase[i] %= (chorus->modulation_period_samples);
+                const fluid_real_t *FLUID_RESTRICT sinc_table = chorus->sinc_table[ii];
+
+                #pragma omp simd
+
+                for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
+                {
+                    /* Add the delayed signal to the chorus sum d_out Note: The
+                     * delay in the delay line moves backwards for increasing
+                     * delay!*/
+                    d_out[sample_index] += buf[pos_samples[sample_index] - ii]
+                                           * sinc_table[pos_subsamples[sample_index]];
+                }
+            }
         } /* foreach chorus block */
 
-        d_out *= chorus->level;
-
-        /* Add the chorus sum d_out to output */
-        left_out[sample_index] += d_out;
-        right_out[sample_index] += d_out;
-
-        /* Move forward in circular buffer */
-        chorus->counter++;
-        chorus->counter %= MAX_SAMPLES;
-
-    } /* foreach sample */
-}
-
-/* Duplication of code ... (replaces sample data instead of mixing) */
-void fluid_chorus_processreplace(fluid_chorus_t *chorus, const fluid_real_t *in,
-                                 fluid_real_t *left_out, fluid_real_t *right_out)
-{
-    int sample_index;
-    int i;
-    fluid_real_t d_in, d_out;
-
-    for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
-    {
-
-        d_in = in[sample_index];
-        d_out = 0.0f;
-
-# if 0
-        /* Debug: Listen to the chorus signal only */
-        left_out[sample_index] = 0;
-        right_out[sample_index] = 0;
-#endif
-
-        /* Write the current sample into the circular buffer */
-        chorus->chorusbuf[chorus->counter] = d_in;
-
-        for(i = 0; i < chorus->number_blocks; i++)
+        if(mix)
         {
-            int ii;
-            /* Calculate the delay in subsamples for the delay line of chorus block nr. */
+            /* Add the chorus sum d_out to output */
+            #pragma omp simd
 
-            /* The value in the lookup table is so, that this expression
-             * will always be positive.  It will always include a number of
-             * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
-             * remain positive at all times. */
-            int pos_subsamples = (INTERPOLATION_SUBSAMPLES * chorus->counter
-                                  - chorus->lookup_tab[chorus->phase[i]]);
-
-            int pos_samples = pos_subsamples / INTERPOLATION_SUBSAMPLES;
-
-            /* modulo divide by INTERPOLATION_SUBSAMPLES */
-            pos_subsamples &= INTERPOLATION_SUBSAMPLES_ANDMASK;
-
-            for(ii = 0; ii < INTERPOLATION_SAMPLES; ii++)
+            for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
             {
-                /* Add the delayed signal to the chorus sum d_out Note: The
-                 * delay in the delay line moves backwards for increasing
-                 * delay!*/
-
-                /* The & in chorusbuf[...] is equivalent to a division modulo
-                   MAX_SAMPLES, only faster. */
-                d_out += chorus->chorusbuf[pos_samples & MAX_SAMPLES_ANDMASK]
-                         * chorus->sinc_table[ii][pos_subsamples];
-
-                pos_samples--;
-            };
-
-            /* Cycle the phase of the modulating LFO */
-            chorus->phase[i]++;
+                left_out[k + sample_index] += d_out[sample_index] * level;
+                right_out[k + sample_index] += d_out[sample_index] * level;
+            }
+        }
+        else
+        {
+            /* Store the chorus sum d_out to output */
+            #pragma omp simd
 
-            chorus->phase[i] %= (chorus->modulation_period_samples);
-        } /* foreach chorus block */
+            for(sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++)
+            {
+                left_out[k + sample_index] = d_out[sample_index] * level;
+                right_out[k + sample_index] = d_out[sample_index] * level;
+            }
+        }
 
-        d_out *= chorus->level;
+        /* Move forward in circular buffer */
+        counter = (counter + FLUID_BUFSIZE) & MAX_SAMPLES_ANDMASK;
+    }
 
-        /* Store the chorus sum d_out to output */
-        left_out[sample_index] = d_out;
-        right_out[sample_index] = d_out;
+    FLUID_MEMCPY(chorus->phase, phase, number_blocks * sizeof(long));
+    chorus->counter = counter;
+}
 
-        /* Move forward in circular buffer */
-        chorus->counter++;
-        chorus->counter %= MAX_SAMPLES;
+/*
+ * Process count samples (a multiple of FLUID_BUFSIZE), adding the chorus to
+ * the samples already in left_out and right_out.
+ */
+void fluid_chorus_processmix(fluid_chorus_t *chorus, const fluid_real_t *in,
+                             fluid_real_t *left_out, fluid_real_t *right_out, int count)
+{
+    fluid_chorus_process(chorus, in, left_out, right_out, count, TRUE);
+}
 
-    } /* foreach sample */
+/*
+ * Process count samples (a multiple of FLUID_BUFSIZE), replacing the samples
+ * in left_out and right_out by the chorus.
+ */
+void fluid_chorus_processreplace(fluid_chorus_t *chorus, const fluid_real_t *in,
+                                 fluid_real_t *left_out, fluid_real_t *right_out, int count)
+{
+    fluid_chorus_process(chorus, in, left_out, right_out, count, FALSE);
 }
 
 /* Purpose:
@@ -555,7 +606,7 @@ fluid_chorus_sine(int *buf, int len, int depth)
     /* Build sine modulation waveform */
     for(i = 0; i < len; i++)
     {
-        buf[i] = (int)((1. + sin(angle)) * mult) - 3 * MAX_SAMPLES * INTERPOLATION_SUBSAMPLES;
+        buf[i] = (int)((1. + sin(angle)) * mult) - LOOKUP_OFFSET;
 
         angle += incr;
     }
@@ -577,13 +628,13 @@ fluid_chorus_triangle(int *buf, int len, int depth)
     incr = 2.0 / len * (double)depth * (double) INTERPOLATION_SUBSAMPLES;
 
     /* Initialize first value */
-    val = 0. - 3. * MAX_SAMPLES * INTERPOLATION_SUBSAMPLES;
+    val = 0. - TRIANGLE_ORIGIN;
 
     /* Build triangular modulation waveform */
     while(il <= ir)
     {
         /* Assume 'val' to be always negative for rounding mode */
-        ival = (int)(val - 0.5);
+        ival = (int)(val - 0.5) + TRIANGLE_ORIGIN - LOOKUP_OFFSET;
 
         *il++ = ival;
         *ir-- = ival;
@@ -21,6 +21,18 @@
 #include "fluid_iir_filter.h"
 #include "fluid_sys.h"
 #include "fluid_conv.h"
+#include "fluid_iir_filter_tables.h"
+#include "fluid_iir_filter_tables.c"
+
+/* Cutoff frequency limit of 0.45 * sample_rate, in cents relative to the
+ * sample rate: 1200 * log2(0.45) */
+#define FLUID_IIR_CENTS_LIMIT ((fluid_real_t) -1382.40371213406)
+
+/* Changes of the cutoff by more than 0.01 Hz recalculate the coefficients. Below
+ * the 0.45 * sample_rate limit, the cutoff is in whole cents, whose steps are
+ * larger than that. In cents relative to the sample rate, 0.01 Hz at the 20 kHz
+ * limit of the cutoff is 1200 * log2(1 + 0.01 / 20000). */
+#define FLUID_IIR_CENTS_EPSILON ((fluid_real_t) 8.656e-4)
 
 /**
  * Applies a low- or high-pass filter with variable cutoff frequency and quality factor
@@ -254,10 +266,41 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_iir_filter_set_q)
     iir_filter->last_fres = -1.;
 }
 
+/*
+ * Sine and cosine of the angular frequency of a cutoff given in cents relative
+ * to the sample rate, interpolated from fluid_iir_sincos_tab by a cubic Lagrange
+ * polynomial. Over the whole table, the result deviates from the exact sin() and
+ * cos() by less than 1e-10, see test_iir_filter_table.
+ */
+void
+fluid_iir_filter_sincos(fluid_real_t cents, fluid_real_t *sin_coeff, fluid_real_t *cos_coeff)
+{
+    fluid_real_t pos = (cents - FLUID_IIR_CENTS_MIN) * (fluid_real_t)(1.0 / FLUID_IIR_CENTS_STEP);
+    int i = (int) pos;
+    fluid_real_t x = pos - i;
+    const fluid_real_t *y0, *y1, *y2, *y3;
+    fluid_real_t c0, c1, c2, c3;
+
+    /* the points at x = -1, 0, 1 and 2 */
+    y0 = fluid_iir_sincos_tab[i];
+    y1 = fluid_iir_sincos_tab[i + 1];
+    y2 = fluid_iir_sincos_tab[i + 2];
+    y3 = fluid_iir_sincos_tab[i + 3];
+
+    /* cos() is close to 1 for low cutoffs, and the lowpass coefficients only depend
+     * on the difference, so the weights need the full precision of fluid_real_t */
+    c0 = x * (x - 1) * (x - 2) * (fluid_real_t)(-1.0 / 6.0);
+    c1 = (x + 1) * (x - 1) * (x - 2) * (fluid_real_t) 0.5;
+    c2 = (x + 1) * x * (x - 2) * (fluid_real_t) -0.5;
+    c3 = (x + 1) * x * (x - 1) * (fluid_real_t)(1.0 / 6.0);
+
+    *sin_coeff = c0 * y0[0] + c1 * y1[0] + c2 * y2[0] + c3 * y3[0];
+    *cos_coeff = c0 * y0[1] + c1 * y1[1] + c2 * y2[1] + c3 * y3[1];
+}
+
 static FLUID_INLINE void
 fluid_iir_filter_calculate_coefficients(fluid_iir_filter_t *iir_filter,
-                                        int transition_samples,
-                                        fluid_real_t output_rate)
+                                        int transition_samples)
 {
     /* FLUID_IIR_Q_LINEAR may switch the filter off by setting Q==0 */
     if(iir_filter->q_lin == 0)
@@ -275,12 +318,14 @@ fluid_iir_filter_calculate_coefficients(fluid_iir_filter_t *iir_filter,
          * into account for both significant frequency relocation and for
          * bandwidth readjustment'. */
 
-        fluid_real_t omega = (fluid_real_t)(2.0 * M_PI) *
-                                            (iir_filter->last_fres / output_rate);
-        fluid_real_t sin_coeff = (fluid_real_t) sin(omega);
-        fluid_real_t cos_coeff = (fluid_real_t) cos(omega);
-        fluid_real_t alpha_coeff = sin_coeff / (2.0f * iir_filter->q_lin);
-        fluid_real_t a0_inv = 1.0f / (1.0f + alpha_coeff);
+        fluid_real_t sin_coeff, cos_coeff, alpha_coeff, a0_inv;
+        fluid_real_t a1_temp, a2_temp, b02_temp, b1_temp;
+
+        /* sin and cos of omega = 2 * pi * fres / output_rate */
+        fluid_iir_filter_sincos(iir_filter->last_fres, &sin_coeff, &cos_coeff);
+
+        alpha_coeff = sin_coeff / (2.0f * iir_filter->q_lin);
+        a0_inv = 1.0f / (1.0f + alpha_coeff);
 
         /* Calculate the filter coefficients. All coefficients are
          * normalized by a0. Think of `a1' as `a1/a0'.
@@ -292,10 +337,8 @@ fluid_iir_filter_calculate_coefficients(fluid_iir_filter_t *iir_filter,
          *  iir_filter->b2=(1.-cos_coeff)*a0_inv*0.5*iir_filter->filter_gain; */
 
         /* "a" coeffs are same for all 3 available filter types */
-        fluid_real_t a1_temp = -2.0f * cos_coeff * a0_inv;
-        fluid_real_t a2_temp = (1.0f - alpha_coeff) * a0_inv;
-
-        fluid_real_t b02_temp, b1_temp;
+        a1_temp = -2.0f * cos_coeff * a0_inv;
+        a2_temp = (1.0f - alpha_coeff) * a0_inv;
 
         switch(iir_filter->type)
         {
@@ -373,8 +416,21 @@ void fluid_iir_filter_calc(fluid_iir_filter_t *iir_filter,
 {
     fluid_real_t fres;
 
-    /* calculate the frequency of the resonant filter in Hz */
-    fres = fluid_ct2hz(iir_filter->fres + fres_mod);
+    /* The frequency of the resonant filter is kept in cents relative to the
+     * sample rate, to look up the coefficients without any transcendental
+     * math. Only a sample rate change costs a logarithm. */
+    if(iir_filter->output_rate != output_rate)
+    {
+        iir_filter->output_rate = output_rate;
+        iir_filter->rate_cents = (fluid_real_t)(1200.0 * log(output_rate / fluid_ct2hz_real(0)) / M_LN2);
+    }
+
+    /* Filter fc limit: SF2.01 page 48 # 8, 20 Hz to 20 kHz. Like fluid_ct2hz(),
+     * the cutoff is rounded down to whole cents. */
+    fres = iir_filter->fres + fres_mod;
+    fluid_clip(fres, 1500, 13500);
+
+    fres = (int) fres - iir_filter->rate_cents;
 
     /* FIXME - Still potential for a click during turn on, can we interpolate
        between 20khz cutoff and 0 Q? */
@@ -389,17 +445,17 @@ void fluid_iir_filter_calc(fluid_iir_filter_t *iir_filter,
      * clipping the maximum filter frequency at 0.45*srate, the filter
      * is used as an anti-aliasing filter. */
 
-    if(fres > 0.45f * output_rate)
+    if(fres > FLUID_IIR_CENTS_LIMIT)
     {
-        fres = 0.45f * output_rate;
+        fres = FLUID_IIR_CENTS_LIMIT;
     }
-    else if(fres < 5)
+    else if(fres < FLUID_IIR_CENTS_MIN)
     {
-        fres = 5;
+        fres = FLUID_IIR_CENTS_MIN;
     }
 
     /* if filter enabled and there is a significant frequency change.. */
-    if(iir_filter->type != FLUID_IIR_DISABLED && fabs(fres - iir_filter->last_fres) > 0.01)
+    if(iir_filter->type != FLUID_IIR_DISABLED && fabs(fres - iir_filter->last_fres) > FLUID_IIR_CENTS_EPSILON)
     {
         /* The filter coefficients have to be recalculated (filter
          * parameters have changed). Recalculation for various reasons is
@@ -408,12 +464,10 @@ void fluid_iir_filter_calc(fluid_iir_filter_t *iir_filter,
          * case, the filter is set directly, instead of smoothly fading
          * between old and new settings. */
         iir_filter->last_fres = fres;
-        fluid_iir_filter_calculate_coefficients(iir_filter, FLUID_BUFSIZE,
-                                                output_rate);
+        fluid_iir_filter_calculate_coefficients(iir_filter, FLUID_BUFSIZE);
     }
 
 
     fluid_check_fpe("voice_write DSP coefficients");
 
 }
-
@@ -38,6 +38,8 @@ void fluid_iir_filter_calc(fluid_iir_filter_t *iir_filter,
                            fluid_real_t output_rate,
                            fluid_real_t fres_mod);
 
+void fluid_iir_filter_sincos(fluid_real_t cents, fluid_real_t *sin_coeff, fluid_real_t *cos_coeff);
+
 /* We can't do information hiding here, as fluid_voice_t includes the struct
    without a pointer. */
 struct _fluid_iir_filter_t
@@ -64,9 +66,12 @@ struct _fluid_iir_filter_t
 					   Else it changes smoothly. */
 
     fluid_real_t fres;              /* the resonance frequency, in cents (not absolute cents) */
-    fluid_real_t last_fres;         /* Current resonance frequency of the IIR filter */
+    fluid_real_t last_fres;         /* Current resonance frequency of the IIR filter, in cents
+                                       relative to the sample rate (see fluid_iir_filter_calc()) */
     /* Serves as a flag: A deviation between fres and last_fres */
     /* indicates, that the filter has to be recalculated. */
+    fluid_real_t output_rate;       /* sample rate rate_cents was calculated for */
+    fluid_real_t rate_cents;        /* the sample rate in absolute cents */
     fluid_real_t q_lin;             /* the q-factor on a linear scale */
     fluid_real_t filter_gain;       /* Gain correction factor, depends on q */
 };
@@ -0,0 +1,21 @@
+#ifndef _FLUID_IIR_FILTER_TABLES_H
+#define _FLUID_IIR_FILTER_TABLES_H
+
+/*
+ The sine and cosine of the filter cutoff as angular frequency are tabulated
+ over the cutoff in cents relative to the sample rate, i.e.
+ 1200 * log2(fc / sample_rate). This makes the table independent of the sample
+ rate. It covers 20 Hz at 200 kHz up to the cutoff limit of 0.45 * sample_rate.
+ */
+#define FLUID_IIR_CENTS_MIN     (-16000)
+#define FLUID_IIR_CENTS_MAX     (-1380)
+#define FLUID_IIR_CENTS_STEP    4
+
+/*
+ The table is interpolated with a cubic polynomial through four points, so it
+ has one extra point below FLUID_IIR_CENTS_MIN and two above FLUID_IIR_CENTS_MAX.
+ Entry i is at FLUID_IIR_CENTS_MIN + (i - 1) * FLUID_IIR_CENTS_STEP.
+ */
+#define FLUID_IIR_SINCOS_SIZE   ((FLUID_IIR_CENTS_MAX - FLUID_IIR_CENTS_MIN) / FLUID_IIR_CENTS_STEP + 4)
+
+#endif
@@ -0,0 +1,328 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include "fluid_render_pool.h"
+#include "fluid_sys.h"
+
+struct _fluid_render_pool_t
+{
+    int refcount;                   /* protected by render_pool_mutex */
+
+    fluid_cond_mutex_t *mutex;      /* protects everything below */
+    fluid_cond_t *work_cond;        /* signalled when a job got queued or the pool quits */
+    fluid_cond_t *done_cond;        /* signalled when the last helper left a job */
+    fluid_render_job_t *jobs;       /* queued jobs */
+    int quit;
+
+    int thread_count;
+    fluid_thread_t **threads;
+};
+
+/* The single pool shared by all synths of the process */
+static fluid_mutex_t render_pool_mutex = FLUID_MUTEX_INIT;
+static fluid_render_pool_t *render_pool = NULL;
+
+static fluid_thread_return_t fluid_render_pool_thread(void *data);
+static int fluid_render_pool_add_threads(fluid_render_pool_t *pool, int thread_count, int prio_level);
+static void delete_fluid_render_pool(fluid_render_pool_t *pool);
+
+
+/**
+ * Get a reference to the process-wide render pool, creating it if necessary.
+ * @param thread_count Number of pool threads the caller wants to be helped by, the pool
+ *   grows to the largest number any caller asked for
+ * @param prio_level Real-time priority of the pool threads, only used when creating threads
+ * @return The render pool or NULL on error
+ */
+fluid_render_pool_t *fluid_render_pool_acquire(int thread_count, int prio_level)
+{
+    fluid_render_pool_t *pool;
+
+    fluid_return_val_if_fail(thread_count > 0, NULL);
+
+    fluid_mutex_lock(render_pool_mutex);
+
+    if(render_pool != NULL)
+    {
+        pool = render_pool;
+
+        /* a pool that could not grow still works, with fewer threads */
+        if(thread_count > pool->thread_count
+                && fluid_render_pool_add_threads(pool, thread_count, prio_level) == FLUID_FAILED)
+        {
+            FLUID_LOG(FLUID_WARN, "Failed to grow the render pool to %d threads, keeping %d",
+                      thread_count, pool->thread_count);
+        }
+
+        pool->refcount++;
+        fluid_mutex_unlock(render_pool_mutex);
+        return pool;
+    }
+
+    pool = FLUID_NEW(fluid_render_pool_t);
+
+    if(pool == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_recovery;
+    }
+
+    FLUID_MEMSET(pool, 0, sizeof(*pool));
+    pool->refcount = 1;
+    pool->mutex = new_fluid_cond_mutex();
+    pool->work_cond = new_fluid_cond();
+    pool->done_cond = new_fluid_cond();
+
+    if(pool->mutex == NULL || pool->work_cond == NULL || pool->done_cond == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_recovery;
+    }
+
+    if(fluid_render_pool_add_threads(pool, thread_count, prio_level) == FLUID_FAILED)
+    {
+        goto error_recovery;
+    }
+
+    render_pool = pool;
+    fluid_mutex_unlock(render_pool_mutex);
+    return pool;
+
+error_recovery:
+    fluid_mutex_unlock(render_pool_mutex);
+    delete_fluid_render_pool(pool);
+    return NULL;
+}
+
+/**
+ * Drop a reference to the render pool, the threads are stopped when the last one is gone.
+ * @param pool The render pool as returned by fluid_render_pool_acquire()
+ */
+void fluid_render_pool_release(fluid_render_pool_t *pool)
+{
+    fluid_return_if_fail(pool != NULL);
+
+    fluid_mutex_lock(render_pool_mutex);
+
+    if(--pool->refcount > 0)
+    {
+        fluid_mutex_unlock(render_pool_mutex);
+        return;
+    }
+
+    render_pool = NULL;
+    fluid_mutex_unlock(render_pool_mutex);
+
+    delete_fluid_render_pool(pool);
+}
+
+/**
+ * Queue a job for the pool threads to help with.
+ * @param pool The render pool
+ * @param job Job with func, data, deadline and helpers set, must stay valid
+ *   until withdrawn with fluid_render_pool_withdraw()
+ */
+void fluid_render_pool_submit(fluid_render_pool_t *pool, fluid_render_job_t *job)
+{
+    fluid_cond_mutex_lock(pool->mutex);
+
+    job->queued = TRUE;
+    job->running = 0;
+    job->next = pool->jobs;
+    pool->jobs = job;
+
+    fluid_cond_broadcast(pool->work_cond);
+    fluid_cond_mutex_unlock(pool->mutex);
+}
+
+/* Take a job off the queue, must be called with pool->mutex held */
+static void fluid_render_pool_unqueue(fluid_render_pool_t *pool, fluid_render_job_t *job)
+{
+    fluid_render_job_t **prev;
+
+    if(!job->queued)
+    {
+        return;
+    }
+
+    for(prev = &pool->jobs; *prev != NULL; prev = &(*prev)->next)
+    {
+        if(*prev == job)
+        {
+            *prev = job->next;
+            break;
+        }
+    }
+
+    job->queued = FALSE;
+}
+
+/**
+ * Take a job off the queue and wait for the pool threads still helping with it.
+ * @param pool The render pool
+ * @param job Job previously passed to fluid_render_pool_submit()
+ */
+void fluid_render_pool_withdraw(fluid_render_pool_t *pool, fluid_render_job_t *job)
+{
+    fluid_cond_mutex_lock(pool->mutex);
+
+    fluid_render_pool_unqueue(pool, job);
+
+    while(job->running > 0)
+    {
+        fluid_cond_wait(pool->done_cond, pool->mutex);
+    }
+
+    fluid_cond_mutex_unlock(pool->mutex);
+}
+
+
+/* Private functions */
+
+/* Find the queued job with the earliest deadline that can take another helper,
+ * must be called with pool->mutex held */
+static fluid_render_job_t *fluid_render_pool_next_job(fluid_render_pool_t *pool)
+{
+    fluid_render_job_t *job, *best = NULL;
+
+    for(job = pool->jobs; job != NULL; job = job->next)
+    {
+        if(job->running < job->helpers && (best == NULL || job->deadline < best->deadline))
+        {
+            best = job;
+        }
+    }
+
+    return best;
+}
+
+static fluid_thread_return_t fluid_render_pool_thread(void *data)
+{
+    fluid_render_pool_t *pool = data;
+    fluid_render_job_t *job;
+
+    fluid_cond_mutex_lock(pool->mutex);
+
+    while(!pool->quit)
+    {
+        job = fluid_render_pool_next_job(pool);
+
+        if(job == NULL)
+        {
+            fluid_cond_wait(pool->work_cond, pool->mutex);
+            continue;
+        }
+
+        job->running++;
+        fluid_cond_mutex_unlock(pool->mutex);
+
+        job->func(job->data);
+
+        fluid_cond_mutex_lock(pool->mutex);
+        job->running--;
+
+        /* once a helper is done there is nothing left to share */
+        fluid_render_pool_unqueue(pool, job);
+
+        if(job->running == 0)
+        {
+            fluid_cond_broadcast(pool->done_cond);
+        }
+    }
+
+    fluid_cond_mutex_unlock(pool->mutex);
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
+
+/* Start pool threads until there are thread_count of them,
+ * must be called with render_pool_mutex held */
+static int fluid_render_pool_add_threads(fluid_render_pool_t *pool, int thread_count, int prio_level)
+{
+    fluid_thread_t **threads;
+    char name[16];
+
+    /* the pool threads never access the array */
+    threads = FLUID_REALLOC(pool->threads, thread_count * sizeof(fluid_thread_t *));
+
+    if(threads == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return FLUID_FAILED;
+    }
+
+    pool->threads = threads;
+
+    while(pool->thread_count < thread_count)
+    {
+        FLUID_SNPRINTF(name, sizeof(name), "pool%d", pool->thread_count);
+        pool->threads[pool->thread_count] = new_fluid_thread(name, fluid_render_pool_thread, pool, prio_level, 0);
+
+        if(pool->threads[pool->thread_count] == NULL)
+        {
+            return FLUID_FAILED;
+        }
+
+        pool->thread_count++;
+    }
+
+    FLUID_LOG(FLUID_DBG, "Render pool has %d threads", pool->thread_count);
+
+    return FLUID_OK;
+}
+
+static void delete_fluid_render_pool(fluid_render_pool_t *pool)
+{
+    int i;
+
+    fluid_return_if_fail(pool != NULL);
+
+    if(pool->thread_count > 0)
+    {
+        fluid_cond_mutex_lock(pool->mutex);
+        pool->quit = TRUE;
+        fluid_cond_broadcast(pool->work_cond);
+        fluid_cond_mutex_unlock(pool->mutex);
+    }
+
+    for(i = 0; i < pool->thread_count; i++)
+    {
+        fluid_thread_join(pool->threads[i]);
+        delete_fluid_thread(pool->threads[i]);
+    }
+
+    if(pool->mutex != NULL)
+    {
+        delete_fluid_cond_mutex(pool->mutex);
+    }
+
+    if(pool->work_cond != NULL)
+    {
+        delete_fluid_cond(pool->work_cond);
+    }
+
+    if(pool->done_cond != NULL)
+    {
+        delete_fluid_cond(pool->done_cond);
+    }
+
+    FLUID_FREE(pool->threads);
+    FLUID_FREE(pool);
+}
@@ -0,0 +1,65 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+
+#ifndef _FLUID_RENDER_POOL_H
+#define _FLUID_RENDER_POOL_H
+
+#include "fluidsynth_priv.h"
+
+/*
+ * Process-wide pool of render threads (synth.render-pool).
+ *
+ * Instead of each mixer running its own extra threads, mixers submit a job
+ * whenever they render in parallel. Idle pool threads help with the queued job
+ * that has the earliest deadline, each job being helped by at most
+ * job->helpers threads at once. A job is taken off the queue as soon as one of
+ * its helpers returns, as that means there is nothing left to share.
+ *
+ * The submitting thread keeps working on the job itself and must not rely on
+ * any pool thread picking it up.
+ */
+
+typedef struct _fluid_render_pool_t fluid_render_pool_t;
+typedef struct _fluid_render_job_t fluid_render_job_t;
+
+/* Called by a pool thread to help with a job, returns once the thread can't contribute anymore */
+typedef void (*fluid_render_job_func_t)(void *data);
+
+struct _fluid_render_job_t
+{
+    fluid_render_job_func_t func;
+    void *data;
+    double deadline;            /* fluid_utime() by which the job should be done */
+    int helpers;                /* maximum number of pool threads working on the job */
+
+    /* Owned by the pool */
+    int queued;
+    int running;                /* pool threads currently in func */
+    fluid_render_job_t *next;
+};
+
+fluid_render_pool_t *fluid_render_pool_acquire(int thread_count, int prio_level);
+void fluid_render_pool_release(fluid_render_pool_t *pool);
+
+void fluid_render_pool_submit(fluid_render_pool_t *pool, fluid_render_job_t *job);
+void fluid_render_pool_withdraw(fluid_render_pool_t *pool, fluid_render_job_t *job);
+
+#endif /* _FLUID_RENDER_POOL_H */
@@ -167,11 +167,12 @@
 /*----------------------------------------------------------------------------
                         Configuration macros at compiler time.
 
- 3 macros are usable at compiler time:
+ 4 macros are usable at compiler time:
   - NBR_DELAYs: number of delay lines. 8 (default) or 12.
   - ROOMSIZE_RESPONSE_LINEAR: allows to choose an alternate response for
     roomsize parameter.
   - DENORMALISING enable denormalising handling.
+  - FDN_SCALAR_REFERENCE: processes the delay lines one after another.
 -----------------------------------------------------------------------------*/
 /* Number of delay lines (must be only 8 or 12)
   8 is the default.
@@ -198,6 +199,14 @@
 #define DC_OFFSET  0.0
 #endif
 
+/* By default a block is processed in segments of MOD_RATE samples, with
+   loops the compiler can vectorize (see fluid_revmodel_process_lanes()).
+   When FDN_SCALAR_REFERENCE is defined, the reverb is processed sample by
+   sample and line by line. This is the reference implementation, both
+   produce the same output.
+*/
+//#define FDN_SCALAR_REFERENCE
+
 /*----------------------------------------------------------------------------
  Initial internal reverb settings (at reverb creation time)
 -----------------------------------------------------------------------------*/
@@ -322,6 +331,36 @@ static const int delay_length[NBR_DELAYS] =
 */
 #define FDN_MATRIX_FACTOR (fluid_real_t)(-2.0 / NBR_DELAYS)
 
+/*----------------------------------------------------------------------------
+ Internal lite late reverb settings (FLUID_REVMODEL_LITE)
+
+ The lite engine is a smaller FDN: LITE_NBR_DELAYS unmodulated delay lines
+ with the same feedback matrix structure, damping filters, tone corrector and
+ stereo output gains as the FDN above. From LITE_HALF_RATE_MIN sample rate on
+ it runs at half the sample rate: pairs of input samples are averaged and the
+ output is linearly interpolated. The reverb tail holds little energy up
+ there anyway.
+-----------------------------------------------------------------------------*/
+#define LITE_NBR_DELAYS 4
+#define LITE_HALF_RATE_MIN 32000.0f
+
+/* Delay lines length tables (in samples at the full and at half rate) */
+static const int lite_delay_length[LITE_NBR_DELAYS] =
+{
+    587, 769, 919, 1129
+};
+
+static const int lite_delay_length_half[LITE_NBR_DELAYS] =
+{
+    293, 383, 461, 563
+};
+
+#define LITE_MATRIX_FACTOR (fluid_real_t)(-2.0 / LITE_NBR_DELAYS)
+
+/* Half as many lines sum up to a 3 dB lower output than the 8 lines of the fdn,
+   LITE_SCALE_WET = sqrt(8 / LITE_NBR_DELAYS) compensates for that. */
+#define LITE_SCALE_WET 1.4142f
+
 /*----------------------------------------------------------------------------
              Internal FDN late structures and static functions
 -----------------------------------------------------------------------------*/
@@ -608,6 +647,53 @@ static int set_mod_delay_line(mod_delay_line *mdl,
     return FLUID_OK;
 }
 
+/*-----------------------------------------------------------------------------
+ Moves the read position of the modulated delay line to the next position
+ given by the modulator.
+ @param mdl, pointer on modulated delay line.
+-----------------------------------------------------------------------------*/
+static FLUID_INLINE void update_mod_delay_out_pos(mod_delay_line *mdl)
+{
+    fluid_real_t out_index;  /* new modulated index position */
+    int int_out_index; /* integer part of out_index */
+
+    /* out_index = center position (center_pos_mod) + sinus waweform */
+    out_index = mdl->center_pos_mod +
+                get_mod_sinus(&mdl->mod) * mdl->mod_depth;
+
+    /* extracts integer part in int_out_index */
+    if(out_index >= 0.0f)
+    {
+        int_out_index = (int)out_index; /* current integer part */
+
+        /* forces read index (line_out)  with integer modulation value  */
+        /* Boundary check and circular motion as needed */
+        if((mdl->dl.line_out = int_out_index) >= mdl->dl.size)
+        {
+            mdl->dl.line_out -= mdl->dl.size;
+        }
+    }
+    else /* negative */
+    {
+        int_out_index = (int)(out_index - 1); /* previous integer part */
+        /* forces read index (line_out) with integer modulation value  */
+        /* circular motion as needed */
+        mdl->dl.line_out   = int_out_index + mdl->dl.size;
+    }
+
+    /* extracts fractionnal part. (it will be used when interpolating
+      between line_out and line_out +1) and memorize it.
+      Memorizing is necessary for modulation rate above 1 */
+    mdl->frac_pos_mod = out_index - int_out_index;
+
+    /* updates center position (center_pos_mod) to the next position
+       specified by modulation rate */
+    if((mdl->center_pos_mod += mdl->mod_rate) >= mdl->dl.size)
+    {
+        mdl->center_pos_mod -= mdl->dl.size;
+    }
+}
+
 /*-----------------------------------------------------------------------------
  Reads the sample value out of the modulated delay line.
  @param mdl, pointer on modulated delay line.
@@ -615,8 +701,6 @@ static int set_mod_delay_line(mod_delay_line *mdl,
 -----------------------------------------------------------------------------*/
 static FLUID_INLINE fluid_real_t get_mod_delay(mod_delay_line *mdl)
 {
-    fluid_real_t out_index;  /* new modulated index position */
-    int int_out_index; /* integer part of out_index */
     fluid_real_t out; /* value to return */
 
     /* Checks if the modulator must be updated (every mod_rate samples). */
@@ -627,42 +711,7 @@ static FLUID_INLINE fluid_real_t get_mod_delay(mod_delay_line *mdl)
     if(++mdl->index_rate >= mdl->mod_rate)
     {
         mdl->index_rate = 0;
-
-        /* out_index = center position (center_pos_mod) + sinus waweform */
-        out_index = mdl->center_pos_mod +
-                    get_mod_sinus(&mdl->mod) * mdl->mod_depth;
-
-        /* extracts integer part in int_out_index */
-        if(out_index >= 0.0f)
-        {
-            int_out_index = (int)out_index; /* current integer part */
-
-            /* forces read index (line_out)  with integer modulation value  */
-            /* Boundary check and circular motion as needed */
-            if((mdl->dl.line_out = int_out_index) >= mdl->dl.size)
-            {
-                mdl->dl.line_out -= mdl->dl.size;
-            }
-        }
-        else /* negative */
-        {
-            int_out_index = (int)(out_index - 1); /* previous integer part */
-            /* forces read index (line_out) with integer modulation value  */
-            /* circular motion as needed */
-            mdl->dl.line_out   = int_out_index + mdl->dl.size;
-        }
-
-        /* extracts fractionnal part. (it will be used when interpolating
-          between line_out and line_out +1) and memorize it.
-          Memorizing is necessary for modulation rate above 1 */
-        mdl->frac_pos_mod = out_index - int_out_index;
-
-        /* updates center position (center_pos_mod) to the next position
-           specified by modulation rate */
-        if((mdl->center_pos_mod += mdl->mod_rate) >= mdl->dl.size)
-        {
-            mdl->center_pos_mod -= mdl->dl.size;
-        }
+        update_mod_delay_out_pos(mdl);
     }
 
     /*  First order all-pass interpolation ----------------------------------*/
@@ -700,6 +749,12 @@ struct _fluid_late
     /* Output coefficients for separate Left and right stereo outputs */
     fluid_real_t out_left_gain[NBR_DELAYS]; /* Left delay lines' output gains */
     fluid_real_t out_right_gain[NBR_DELAYS];/* Right delay lines' output gains*/
+    /*----- Lite engine only ---------------------------------------------*/
+    /* The modulated delay lines above are not allocated then, the tone
+       corrector and the first LITE_NBR_DELAYS output gains are shared. */
+    int lite_decimation;           /* 0: fdn engine, else 1 or 2 (half rate) */
+    delay_line lite_lines[LITE_NBR_DELAYS];
+    fluid_real_t lite_left, lite_right; /* previous half rate output */
 };
 
 typedef struct _fluid_late   fluid_late;
@@ -714,6 +769,8 @@ struct _fluid_revmodel_t
     fluid_real_t level, wet1, wet2; /* output level */
     fluid_real_t width; /* width stereo separation */
 
+    int engine; /* fluid_revmodel_engine_t */
+
     /* fdn reverberation structure */
     fluid_late  late;
 };
@@ -812,6 +869,19 @@ static void update_rev_time_damping(fluid_late *late,
         set_fdn_delay_lpf(&late->mod_delay_lines[i].dl.damping,
                           gi * (1 - ai), -ai);
     }
+
+    /* same for the lite engine lines, their length is given at the lite rate */
+    for(i = 0; i < LITE_NBR_DELAYS && late->lite_decimation; i++)
+    {
+        fluid_real_t gi = (fluid_real_t)pow(10, -3 * late->lite_lines[i].size *
+                                            late->lite_decimation *
+                                            sample_period / dc_rev_time);
+
+        fluid_real_t ai = (fluid_real_t)(20 * log10(gi) * log(10) / 80 *
+                                         (1 -  1 / pow(alpha, 2)));
+
+        set_fdn_delay_lpf(&late->lite_lines[i].damping, gi * (1 - ai), -ai);
+    }
 }
 
 /*-----------------------------------------------------------------------------
@@ -881,6 +951,11 @@ static void delete_fluid_rev_late(fluid_late *late)
     {
         FLUID_FREE(late->mod_delay_lines[i].dl.line);
     }
+
+    for(i = 0; i < LITE_NBR_DELAYS; i++)
+    {
+        FLUID_FREE(late->lite_lines[i].line);
+    }
 }
 
 /*-----------------------------------------------------------------------------
@@ -927,6 +1002,40 @@ static int create_fluid_rev_late(fluid_late *late, fluid_real_t sample_rate)
     return FLUID_OK;
 }
 
+/*-----------------------------------------------------------------------------
+ Creates the lite reverb.
+ @param late, pointer on the late reverb to initialize.
+ @param sample_rate the sample rate.
+ @return FLUID_OK if success, FLUID_FAILED otherwise.
+-----------------------------------------------------------------------------*/
+static int create_fluid_rev_lite(fluid_late *late, fluid_real_t sample_rate)
+{
+    int i;
+
+    FLUID_MEMSET(late, 0,  sizeof(fluid_late));
+
+    late->samplerate = sample_rate;
+    late->lite_decimation = (sample_rate >= LITE_HALF_RATE_MIN) ? 2 : 1;
+
+    for(i = 0; i < LITE_NBR_DELAYS; i++)
+    {
+        delay_line *dl = &late->lite_lines[i];
+
+        dl->size = (late->lite_decimation == 2) ? lite_delay_length_half[i] : lite_delay_length[i];
+        dl->line = FLUID_ARRAY(fluid_real_t, dl->size);
+
+        if(dl->line == NULL)
+        {
+            return FLUID_FAILED;
+        }
+
+        clear_delay_line(dl);
+    }
+
+    update_stereo_coefficient(late, 1.0f);
+    return FLUID_OK;
+}
+
 /*
  Clears the delay lines.
 
@@ -937,6 +1046,17 @@ fluid_revmodel_init(fluid_revmodel_t *rev)
 {
     int i;
 
+    if(rev->engine == FLUID_REVMODEL_LITE)
+    {
+        for(i = 0; i < LITE_NBR_DELAYS; i ++)
+        {
+            clear_delay_line(&rev->late.lite_lines[i]);
+        }
+
+        rev->late.lite_left = rev->late.lite_right = 0;
+        return;
+    }
+
     /* clears all the delay lines */
     for(i = 0; i < NBR_DELAYS; i ++)
     {
@@ -990,13 +1110,17 @@ fluid_revmodel_update(fluid_revmodel_t *rev)
 /*
 * Creates a reverb.
 * @param sample_rate sample rate in Hz.
+* @param engine the reverb engine, see #fluid_revmodel_engine_t. The lite engine
+*   decides whether to run at half rate once, a later sample rate change
+*   keeps that.
 * @return pointer on the new reverb or NULL if memory error.
 * Reverb API.
 */
 fluid_revmodel_t *
-new_fluid_revmodel(fluid_real_t sample_rate)
+new_fluid_revmodel(fluid_real_t sample_rate, int engine)
 {
     fluid_revmodel_t *rev;
+    int result;
     rev = FLUID_NEW(fluid_revmodel_t);
 
     if(rev == NULL)
@@ -1004,8 +1128,19 @@ new_fluid_revmodel(fluid_real_t sample_rate)
         return NULL;
     }
 
-    /* create fdn reverb */
-    if(create_fluid_rev_late(&rev->late, sample_rate) != FLUID_OK)
+    rev->engine = engine;
+
+    /* create fdn or lite reverb */
+    if(engine == FLUID_REVMODEL_LITE)
+    {
+        result = create_fluid_rev_lite(&rev->late, sample_rate);
+    }
+    else
+    {
+        result = create_fluid_rev_late(&rev->late, sample_rate);
+    }
+
+    if(result != FLUID_OK)
     {
         delete_fluid_revmodel(rev);
         return NULL;
@@ -1115,20 +1250,371 @@ fluid_revmodel_reset(fluid_revmodel_t *rev)
     fluid_revmodel_init(rev);
 }
 
+/*-----------------------------------------------------------------------------
+* lite reverb processing of count samples.
+*
+* Sample by sample like the fdn reference. As the lines aren't modulated, the
+* sample read from a line is the oldest one, right where the new one is
+* written. At half rate, an output sample is produced for every pair of input
+* samples and linearly interpolated with the previous one in between.
+*
+* @param rev pointer on reverb.
+* @param in monophonic buffer input (count samples).
+* @param left_out stereo left processed output (count samples).
+* @param right_out stereo right processed output (count samples).
+* @param count number of samples to process, a multiple of FLUID_BUFSIZE.
+* @param mix TRUE to mix the processed reverb with samples already there in out,
+*   FALSE to replace them.
+-----------------------------------------------------------------------------*/
+static void
+fluid_revmodel_process_lite(fluid_revmodel_t *rev, const fluid_real_t *in,
+                            fluid_real_t *left_out, fluid_real_t *right_out,
+                            int count, int mix)
+{
+    fluid_late *late = &rev->late;
+    const int decimation = late->lite_decimation;
+    fluid_real_t tone_buffer = late->tone_buffer;
+    fluid_real_t prev_left = late->lite_left;
+    fluid_real_t prev_right = late->lite_right;
+    int i, k;
+
+    for(k = 0; k < count; k += decimation)
+    {
+        fluid_real_t xn, out_tone_filter, matrix_factor, left, right;
+        fluid_real_t out_left, out_right;
+        fluid_real_t delay_out[LITE_NBR_DELAYS];
+
+        xn = (decimation == 2) ? (in[k] + in[k + 1]) * 0.5f : in[k];
+
+#ifdef DENORMALISING
+        xn = xn * FIXED_GAIN + DC_OFFSET;
+#else
+        xn = xn * FIXED_GAIN;
+#endif
+
+        /* tone correction */
+        out_tone_filter = xn * late->b1 - late->b2 * tone_buffer;
+        tone_buffer = xn;
+        xn = out_tone_filter;
+
+        /* delay lines output + damping filter */
+        matrix_factor = left = right = 0;
+
+        for(i = 0; i < LITE_NBR_DELAYS; i++)
+        {
+            delay_line *dl = &late->lite_lines[i];
+            fluid_real_t out = dl->line[dl->line_in] * dl->damping.b0
+                               - dl->damping.buffer * dl->damping.a1;
+
+            dl->damping.buffer = out;
+            delay_out[i] = out;
+            matrix_factor += out;
+            left += late->out_left_gain[i] * out;
+            right += late->out_right_gain[i] * out;
+        }
+
+        matrix_factor = matrix_factor * LITE_MATRIX_FACTOR + xn;
+
+        /* delay_in[i] = delay_out[i + 1] + matrix_factor */
+        for(i = 0; i < LITE_NBR_DELAYS; i++)
+        {
+            delay_line *dl = &late->lite_lines[i];
+            push_in_delay_line(dl, delay_out[(i + 1) % LITE_NBR_DELAYS] + matrix_factor);
+        }
+
+#ifdef DENORMALISING
+        /* Removes the DC offset */
+        left -= DC_OFFSET;
+        right -= DC_OFFSET;
+#endif
+        left *= LITE_SCALE_WET;
+        right *= LITE_SCALE_WET;
+
+        /* stereo output, see fluid_revmodel_processreplace() */
+        out_left = left + right * rev->wet2;
+        out_right = right + left * rev->wet2;
+
+        if(decimation == 2)
+        {
+            fluid_real_t mid_left = (prev_left + out_left) * 0.5f;
+            fluid_real_t mid_right = (prev_right + out_right) * 0.5f;
+
+            if(mix)
+            {
+                left_out[k] += mid_left;
+                right_out[k] += mid_right;
+                left_out[k + 1] += out_left;
+                right_out[k + 1] += out_right;
+            }
+            else
+            {
+                left_out[k] = mid_left;
+                right_out[k] = mid_right;
+                left_out[k + 1] = out_left;
+                right_out[k + 1] = out_right;
+            }
+
+            prev_left = out_left;
+            prev_right = out_right;
+        }
+        else if(mix)
+        {
+            left_out[k] += out_left;
+            right_out[k] += out_right;
+        }
+        else
+        {
+            left_out[k] = out_left;
+            right_out[k] = out_right;
+        }
+    }
+
+    late->tone_buffer = tone_buffer;
+    late->lite_left = prev_left;
+    late->lite_right = prev_right;
+}
+
+#ifndef FDN_SCALAR_REFERENCE
+/*-----------------------------------------------------------------------------
+* fdn reverb processing of count samples in segments.
+*
+* All delay lines share the same modulation rate, so their read positions are
+* only moved by the modulators at the same samples. A segment is the run of
+* samples in between, at most MOD_RATE samples. This is far less than the
+* shortest delay line, so the samples read from the lines during a segment
+* never depend on the samples written during the same segment. Thus a segment
+* is processed in passes, each one being a loop free of circular buffer
+* wrapping that the compiler can vectorize:
+*  - the modulated delay interpolation and damping filter of each line.
+*  - the tone corrector, feedback matrix factor and stereo output of all
+*    samples, in parallel lanes.
+*  - the feedback matrix input of each line, in parallel lanes.
+*
+* @param rev pointer on reverb.
+* @param in monophonic buffer input (count samples).
+* @param left_out stereo left processed output (count samples).
+* @param right_out stereo right processed output (count samples).
+* @param count number of samples to process.
+* @param mix TRUE to mix the processed reverb with samples already there in out,
+*   FALSE to replace them.
+-----------------------------------------------------------------------------*/
+static FLUID_INLINE void
+fluid_revmodel_process_lanes(fluid_revmodel_t *rev, const fluid_real_t *in,
+                             fluid_real_t *left_out, fluid_real_t *right_out,
+                             int count, int mix)
+{
+    fluid_late *late = &rev->late;
+    int i, j, k, seg, len;
+
+    /* lines output for the segment (plus one sample for interpolation),
+       only used when the line wraps around during the segment */
+    fluid_real_t window[NBR_DELAYS][MOD_RATE + 1];
+    /* damped lines output, then lines input for the segment */
+    fluid_real_t delay_out[NBR_DELAYS][MOD_RATE];
+    fluid_real_t matrix_factor[MOD_RATE];  /* partial matrix computation */
+    fluid_real_t out_left[MOD_RATE];       /* output stereo Left */
+    fluid_real_t out_right[MOD_RATE];      /* output stereo Right */
+
+    /* previous input of the tone corrector. in may be the same buffer as left_out,
+       so it is taken from in before the segment output overwrites it */
+    fluid_real_t tone_prev = late->tone_buffer;
+
+    int index_rate = late->mod_delay_lines[0].index_rate;
+    int mod_rate = late->mod_delay_lines[0].mod_rate;
+
+    for(k = 0; k < count; k += seg)
+    {
+        /* moves the read positions of all lines (every mod_rate samples) */
+        if(++index_rate >= mod_rate)
+        {
+            index_rate = 0;
+
+            for(i = 0; i < NBR_DELAYS; i++)
+            {
+                update_mod_delay_out_pos(&late->mod_delay_lines[i]);
+            }
+        }
+
+        /* samples until the next modulator update */
+        seg = mod_rate - index_rate;
+
+        if(seg > count - k)
+        {
+            seg = count - k;
+        }
+
+        index_rate += seg - 1;
+
+        /* modulated output of the delay lines + damping filters */
+        for(i = 0; i < NBR_DELAYS; i++)
+        {
+            mod_delay_line *mdl = &late->mod_delay_lines[i];
+            const fluid_real_t *line_out = &mdl->dl.line[mdl->dl.line_out];
+            fluid_real_t frac_pos_mod = mdl->frac_pos_mod;
+            fluid_real_t b0 = mdl->dl.damping.b0;
+            fluid_real_t a1 = mdl->dl.damping.a1;
+            fluid_real_t interp = mdl->buffer;
+            fluid_real_t damping = mdl->dl.damping.buffer;
+
+            len = mdl->dl.size - mdl->dl.line_out;
+
+            if(len <= seg)
+            {
+                /* the line wraps around */
+                FLUID_MEMCPY(window[i], line_out, len * sizeof(fluid_real_t));
+                FLUID_MEMCPY(&window[i][len], mdl->dl.line, (seg + 1 - len) * sizeof(fluid_real_t));
+                line_out = window[i];
+                mdl->dl.line_out = seg - len;
+            }
+            else
+            {
+                mdl->dl.line_out += seg;
+            }
+
+            for(j = 0; j < seg; j++)
+            {
+                /* first order all-pass interpolation */
+                fluid_real_t out = line_out[j] + frac_pos_mod * (line_out[j + 1] - interp);
+                interp = out;
+
+                /* low pass damping filter */
+                out = out * b0 - damping * a1;
+                damping = out;
+
+                delay_out[i][j] = out;
+            }
+
+            mdl->buffer = interp;
+            mdl->dl.damping.buffer = damping;
+        }
+
+        /* tone correction, feedback matrix factor and stereo output */
+        #pragma omp simd
+
+        for(j = 0; j < seg; j++)
+        {
+            fluid_real_t xn, xn_prev, factor, left, right;
+
+#ifdef DENORMALISING
+            /* Input is adjusted by DC_OFFSET. */
+            xn = (in[k + j]) * FIXED_GAIN + DC_OFFSET;
+            xn_prev = (j > 0) ? (in[k + j - 1]) * FIXED_GAIN + DC_OFFSET : tone_prev;
+#else
+            xn = (in[k + j]) * FIXED_GAIN;
+            xn_prev = (j > 0) ? (in[k + j - 1]) * FIXED_GAIN : tone_prev;
+#endif
+            xn = xn * late->b1 - late->b2 * xn_prev;
+
+            factor = left = right = 0;
+
+            for(i = 0; i < NBR_DELAYS; i++)
+            {
+                factor += delay_out[i][j];
+                left += late->out_left_gain[i] * delay_out[i][j];
+                right += late->out_right_gain[i] * delay_out[i][j];
+            }
+
+            /* matrix_factor = output sum * (-2.0)/N + input signal */
+            matrix_factor[j] = factor * FDN_MATRIX_FACTOR + xn;
+
+#ifdef DENORMALISING
+            /* Removes the DC offset */
+            left -= DC_OFFSET;
+            right -= DC_OFFSET;
+#endif
+            out_left[j] = left;
+            out_right[j] = right;
+        }
+
+#ifdef DENORMALISING
+        tone_prev = (in[k + seg - 1]) * FIXED_GAIN + DC_OFFSET;
+#else
+        tone_prev = (in[k + seg - 1]) * FIXED_GAIN;
+#endif
+
+        /* delay_in[i - 1] = delay_out[i] + matrix_factor */
+        for(i = 0; i < NBR_DELAYS; i++)
+        {
+            delay_line *dl = &late->mod_delay_lines[i].dl;
+            const fluid_real_t *src = delay_out[(i + 1 < NBR_DELAYS) ? i + 1 : 0];
+            fluid_real_t *dst = &dl->line[dl->line_in];
+
+            len = dl->size - dl->line_in;
+
+            if(len > seg)
+            {
+                len = seg;
+            }
+
+            #pragma omp simd
+
+            for(j = 0; j < len; j++)
+            {
+                dst[j] = src[j] + matrix_factor[j];
+            }
+
+            dst = dl->line - len;
+
+            #pragma omp simd
+
+            for(j = len; j < seg; j++)
+            {
+                dst[j] = src[j] + matrix_factor[j];
+            }
+
+            if((dl->line_in += seg) >= dl->size)
+            {
+                dl->line_in -= dl->size;
+            }
+        }
+
+        if(mix)
+        {
+            #pragma omp simd
+
+            for(j = 0; j < seg; j++)
+            {
+                left_out[k + j]  += out_left[j]  + out_right[j] * rev->wet2;
+                right_out[k + j] += out_right[j] + out_left[j] * rev->wet2;
+            }
+        }
+        else
+        {
+            #pragma omp simd
+
+            for(j = 0; j < seg; j++)
+            {
+                left_out[k + j]  = out_left[j]  + out_right[j] * rev->wet2;
+                right_out[k + j] = out_right[j] + out_left[j] * rev->wet2;
+            }
+        }
+    }
+
+    late->tone_buffer = tone_prev;
+
+    for(i = 0; i < NBR_DELAYS; i++)
+    {
+        late->mod_delay_lines[i].index_rate = index_rate;
+    }
+}
+#endif /* FDN_SCALAR_REFERENCE */
+
 /*-----------------------------------------------------------------------------
 * fdn reverb process replace.
 * @param rev pointer on reverb.
-* @param in monophonic buffer input (FLUID_BUFSIZE sample).
-* @param left_out stereo left processed output (FLUID_BUFSIZE sample).
-* @param right_out stereo right processed output (FLUID_BUFSIZE sample).
+* @param in monophonic buffer input (count samples).
+* @param left_out stereo left processed output (count samples).
+* @param right_out stereo right processed output (count samples).
+* @param count number of samples to process, usually a multiple of FLUID_BUFSIZE.
 *
 * The processed reverb is replacing anything there in out.
 * Reverb API.
 -----------------------------------------------------------------------------*/
 void
 fluid_revmodel_processreplace(fluid_revmodel_t *rev, const fluid_real_t *in,
-                              fluid_real_t *left_out, fluid_real_t *right_out)
+                              fluid_real_t *left_out, fluid_real_t *right_out, int count)
 {
+#ifdef FDN_SCALAR_REFERENCE
     int i, k;
 
     fluid_real_t xn;                   /* mono input x(n) */
@@ -1137,8 +1623,16 @@ fluid_revmodel_processreplace(fluid_revmodel_t *rev, const fluid_real_t *in,
     fluid_real_t matrix_factor;        /* partial matrix computation */
     fluid_real_t delay_out_s;          /* sample */
     fluid_real_t delay_out[NBR_DELAYS]; /* Line output + damper output */
+#endif
 
-    for(k = 0; k < FLUID_BUFSIZE; k++)
+    if(rev->engine == FLUID_REVMODEL_LITE)
+    {
+        fluid_revmodel_process_lite(rev, in, left_out, right_out, count, FALSE);
+        return;
+    }
+
+#ifdef FDN_SCALAR_REFERENCE
+    for(k = 0; k < count; k++)
     {
         /* stereo output */
         out_left = out_right = 0;
@@ -1235,22 +1729,27 @@ fluid_revmodel_processreplace(fluid_revmodel_t *rev, const fluid_real_t *in,
         left_out[k]  = out_left  + out_right * rev->wet2;
         right_out[k] = out_right + out_left * rev->wet2;
     }
+#else
+    fluid_revmodel_process_lanes(rev, in, left_out, right_out, count, FALSE);
+#endif
 }
 
 
 /*-----------------------------------------------------------------------------
 * fdn reverb process mix.
 * @param rev pointer on reverb.
-* @param in monophonic buffer input (FLUID_BUFSIZE samples).
-* @param left_out stereo left processed output (FLUID_BUFSIZE samples).
-* @param right_out stereo right processed output (FLUID_BUFSIZE samples).
+* @param in monophonic buffer input (count samples).
+* @param left_out stereo left processed output (count samples).
+* @param right_out stereo right processed output (count samples).
+* @param count number of samples to process, usually a multiple of FLUID_BUFSIZE.
 *
 * The processed reverb is mixed in out with samples already there in out.
 * Reverb API.
 -----------------------------------------------------------------------------*/
 void fluid_revmodel_processmix(fluid_revmodel_t *rev, const fluid_real_t *in,
-                               fluid_real_t *left_out, fluid_real_t *right_out)
+                               fluid_real_t *left_out, fluid_real_t *right_out, int count)
 {
+#ifdef FDN_SCALAR_REFERENCE
     int i, k;
 
     fluid_real_t xn;                   /* mono input x(n) */
@@ -1259,8 +1758,16 @@ void fluid_revmodel_processmix(fluid_revmodel_t *rev, const fluid_real_t *in,
     fluid_real_t matrix_factor;        /* partial matrix term */
     fluid_real_t delay_out_s;          /* sample */
     fluid_real_t delay_out[NBR_DELAYS]; /* Line output + damper output */
+#endif
 
-    for(k = 0; k < FLUID_BUFSIZE; k++)
+    if(rev->engine == FLUID_REVMODEL_LITE)
+    {
+        fluid_revmodel_process_lite(rev, in, left_out, right_out, count, TRUE);
+        return;
+    }
+
+#ifdef FDN_SCALAR_REFERENCE
+    for(k = 0; k < count; k++)
     {
         /* stereo output */
         out_left = out_right = 0;
@@ -1355,4 +1862,7 @@ void fluid_revmodel_processmix(fluid_revmodel_t *rev, const fluid_real_t *in,
         left_out[k]  += out_left  + out_right * rev->wet2;
         right_out[k] += out_right + out_left * rev->wet2;
     }
+#else
+    fluid_revmodel_process_lanes(rev, in, left_out, right_out, count, TRUE);
+#endif
 }
@@ -42,6 +42,13 @@ typedef enum
                                           | FLUID_REVMODEL_SET_ROOMSIZE,
 } fluid_revmodel_set_t;
 
+/** Reverb engines for new_fluid_revmodel() */
+typedef enum
+{
+    FLUID_REVMODEL_FDN,   /**< FDN reverb with modulated delay lines */
+    FLUID_REVMODEL_LITE   /**< Cheaper reverb with fewer unmodulated delay lines */
+} fluid_revmodel_engine_t;
+
 /*
  * reverb preset
  */
@@ -58,14 +65,14 @@ typedef struct _fluid_revmodel_presets_t
 /*
  * reverb
  */
-fluid_revmodel_t *new_fluid_revmodel(fluid_real_t sample_rate);
+fluid_revmodel_t *new_fluid_revmodel(fluid_real_t sample_rate, int engine);
 void delete_fluid_revmodel(fluid_revmodel_t *rev);
 
 void fluid_revmodel_processmix(fluid_revmodel_t *rev, const fluid_real_t *in,
-                               fluid_real_t *left_out, fluid_real_t *right_out);
+                               fluid_real_t *left_out, fluid_real_t *right_out, int count);
 
 void fluid_revmodel_processreplace(fluid_revmodel_t *rev, const fluid_real_t *in,
-                                   fluid_real_t *left_out, fluid_real_t *right_out);
+                                   fluid_real_t *left_out, fluid_real_t *right_out, int count);
 
 void fluid_revmodel_reset(fluid_revmodel_t *rev);
 
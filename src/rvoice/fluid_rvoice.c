@@ -117,6 +117,86 @@ fluid_rvoice_calc_amp(fluid_rvoice_t *voice)
 #define FLUID_SAMPLESANITY_CHECK (1 << 0)
 #define FLUID_SAMPLESANITY_STARTUP (1 << 1)
 
+/*
+ * Samples with a short loop come with a copy of their loop in which it is repeated
+ * (see expand_short_loop() in fluid_defsfont.c). As long as a voice is looping over
+ * the unmodified loop, it plays that copy and wraps around less often.
+ * When it stops doing so, its phase is moved back to the same position within the
+ * original loop.
+ */
+static void
+fluid_rvoice_leave_expanded_loop(fluid_rvoice_t *voice)
+{
+    fluid_sample_t *sample = voice->dsp.sample;
+    unsigned int index = fluid_phase_index(voice->dsp.phase);
+    unsigned int loop_length;
+
+    if(index >= sample->loopend)
+    {
+        loop_length = sample->loopend - sample->loopstart;
+        fluid_phase_sub_int(voice->dsp.phase, (index - sample->loopstart) / loop_length * loop_length);
+        voice->dsp.has_looped = 1;
+    }
+
+    voice->dsp.expanded_loop = 0;
+}
+
+/* Select the sample data to interpolate from, see fluid_rvoice_leave_expanded_loop() */
+static FLUID_INLINE void
+fluid_rvoice_select_sample_data(fluid_rvoice_t *voice, int is_looping)
+{
+    fluid_sample_t *sample = voice->dsp.sample;
+
+    /* the copy starts at the loop start, which the interpolation only
+     * stops reading before once the voice has looped */
+    if(is_looping
+            && sample->loop_data != NULL
+            && voice->dsp.loopstart == (int)sample->loopstart
+            && voice->dsp.loopend == (int)sample->loopend
+            && voice->dsp.has_looped
+            && fluid_phase_index(voice->dsp.phase) >= sample->loopstart)
+    {
+        voice->dsp.expanded_loop = 1;
+        voice->dsp.data = sample->loop_data;
+        voice->dsp.data24 = sample->loop_data24;
+        return;
+    }
+
+    if(voice->dsp.expanded_loop)
+    {
+        fluid_rvoice_leave_expanded_loop(voice);
+    }
+
+    voice->dsp.data = sample->data;
+    voice->dsp.data24 = sample->data24;
+}
+
+/* Move the positions of a voice playing the expanded loop into the index space of
+ * the copy, for the interpolation to play it, and back again afterwards */
+static FLUID_INLINE void
+fluid_rvoice_enter_loop_data(fluid_rvoice_dsp_t *dsp)
+{
+    int offset = (int)dsp->sample->loopstart;
+
+    fluid_phase_sub_int(dsp->phase, offset);
+    dsp->start -= offset;
+    dsp->end -= offset;
+    dsp->loopstart -= offset;
+    dsp->loopend += (int)dsp->sample->loop_expansion - offset;
+}
+
+static FLUID_INLINE void
+fluid_rvoice_leave_loop_data(fluid_rvoice_dsp_t *dsp)
+{
+    int offset = (int)dsp->sample->loopstart;
+
+    fluid_phase_incr(dsp->phase, (fluid_phase_t)offset << 32);
+    dsp->start += offset;
+    dsp->end += offset;
+    dsp->loopstart += offset;
+    dsp->loopend -= (int)dsp->sample->loop_expansion - offset;
+}
+
 /* Purpose:
  *
  * Make sure, that sample start / end point and loop points are in
@@ -134,6 +214,12 @@ fluid_rvoice_check_sample_sanity(fluid_rvoice_t *voice)
     int max_index_loop = (int) voice->dsp.sample->end - FLUID_MIN_LOOP_PAD + 1;	/* 'end' is last valid sample, loopend can be + 1 */
     fluid_check_fpe("voice_check_sample_sanity start");
 
+    /* the checks below refer to the original loop */
+    if(voice->dsp.expanded_loop)
+    {
+        fluid_rvoice_leave_expanded_loop(voice);
+    }
+
 #if 0
     printf("Sample from %i to %i\n", voice->dsp.sample->start, voice->dsp.sample->end);
     printf("Sample loop from %i %i\n", voice->dsp.sample->loopstart, voice->dsp.sample->loopend);
@@ -306,6 +392,8 @@ fluid_rvoice_write(fluid_rvoice_t *voice, fluid_real_t *dsp_buf)
     int ticks = voice->envlfo.ticks;
     int count, is_looping;
     fluid_real_t modenv_val;
+    fluid_rvoice_dsp_interp_func_t interpolate = voice->dsp.interpolate;
+    unsigned int index, points;
 
     /******************* sample sanity check **********/
 
@@ -425,30 +513,45 @@ fluid_rvoice_write(fluid_rvoice_t *voice, fluid_real_t *dsp_buf)
                  || (voice->dsp.samplemode == FLUID_LOOP_UNTIL_RELEASE
                      && fluid_adsr_env_get_section(&voice->envlfo.volenv) < FLUID_VOICE_ENVRELEASE);
 
+    /* Compressed sample data is decoded ahead of the playback position, so that the
+     * interpolation below mostly reads from the voice's decode cache */
+    if(voice->dsp.sample->compressed != NULL)
+    {
+        if(voice->dsp.decoder == NULL)
+        {
+            return 0;
+        }
+
+        index = fluid_phase_index(voice->dsp.phase);
+        points = (unsigned int)(voice->dsp.phase_incr * FLUID_BUFSIZE) + 1;
+
+        /* Unless the voice gets near the points it reads when wrapping around the loop,
+         * it only reads the points prefetched, without checking whether they are cached */
+        if(fluid_sample_decoder_prefetch(voice->dsp.decoder, index, points)
+                && (!is_looping || index + points + 3 < (unsigned int)voice->dsp.loopend)
+                && (!voice->dsp.has_looped || index > (unsigned int)voice->dsp.loopstart + 3))
+        {
+            interpolate = voice->dsp.interpolate_cached;
+        }
+    }
+
     /*********************** run the dsp chain ************************
      * The sample is mixed with the output buffer.
      * The buffer has to be filled from 0 to FLUID_BUFSIZE-1.
      * Depending on the position in the loop and the loop size, this
      * may require several runs. */
 
-    switch(voice->dsp.interp_method)
-    {
-    case FLUID_INTERP_NONE:
-        count = fluid_rvoice_dsp_interpolate_none(&voice->dsp, dsp_buf, is_looping);
-        break;
+    fluid_rvoice_select_sample_data(voice, is_looping);
 
-    case FLUID_INTERP_LINEAR:
-        count = fluid_rvoice_dsp_interpolate_linear(&voice->dsp, dsp_buf, is_looping);
-        break;
-
-    case FLUID_INTERP_4THORDER:
-    default:
-        count = fluid_rvoice_dsp_interpolate_4th_order(&voice->dsp, dsp_buf, is_looping);
-        break;
-
-    case FLUID_INTERP_7THORDER:
-        count = fluid_rvoice_dsp_interpolate_7th_order(&voice->dsp, dsp_buf, is_looping);
-        break;
+    if(voice->dsp.expanded_loop)
+    {
+        fluid_rvoice_enter_loop_data(&voice->dsp);
+        count = voice->dsp.interpolate(&voice->dsp, dsp_buf, is_looping);
+        fluid_rvoice_leave_loop_data(&voice->dsp);
+    }
+    else
+    {
+        count = interpolate(&voice->dsp, dsp_buf, is_looping);
     }
 
     fluid_check_fpe("voice_write interpolation");
@@ -535,6 +638,7 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_reset)
     fluid_rvoice_t *voice = obj;
 
     voice->dsp.has_looped = 0;
+    voice->dsp.expanded_loop = 0;
     voice->envlfo.ticks = 0;
     voice->envlfo.noteoff_ticks = 0;
     voice->dsp.amp = 0.0f; /* The last value of the volume envelope, used to
@@ -766,6 +870,7 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_interp_method)
     int value = param[0].i;
 
     voice->dsp.interp_method = value;
+    fluid_rvoice_dsp_select_interpolation(&voice->dsp);
 }
 
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_root_pitch_hz)
@@ -911,6 +1016,13 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_samplemode)
     voice->dsp.check_sample_sanity_flag |= FLUID_SAMPLESANITY_CHECK;
 }
 
+/* Hands a decode cache to an rvoice that had none, the next sample set decides what it decodes */
+DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_decoder)
+{
+    fluid_rvoice_t *voice = obj;
+
+    voice->dsp.decoder = param[0].ptr;
+}
 
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_sample)
 {
@@ -918,11 +1030,17 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_sample)
     fluid_sample_t *value = param[0].ptr;
 
     voice->dsp.sample = value;
+    fluid_rvoice_dsp_select_interpolation(&voice->dsp);
 
     if(value)
     {
         voice->dsp.check_sample_sanity_flag |= FLUID_SAMPLESANITY_STARTUP;
     }
+
+    if(voice->dsp.decoder != NULL)
+    {
+        fluid_sample_decoder_set_sample(voice->dsp.decoder, value ? value->compressed : NULL);
+    }
 }
 
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_voiceoff)
@@ -34,6 +34,10 @@ typedef struct _fluid_rvoice_dsp_t fluid_rvoice_dsp_t;
 typedef struct _fluid_rvoice_buffers_t fluid_rvoice_buffers_t;
 typedef struct _fluid_rvoice_t fluid_rvoice_t;
 
+/* Interpolation routine, returns the number of samples written to dsp_buf */
+typedef int (*fluid_rvoice_dsp_interp_func_t)(fluid_rvoice_dsp_t *voice,
+        fluid_real_t *FLUID_RESTRICT dsp_buf, int is_looping);
+
 /* Smallest amplitude that can be perceived (full scale is +/- 0.5)
  * 16 bits => 96+4=100 dB dynamic range => 0.00001
  * 24 bits => 144-4 = 140 dB dynamic range => 1.e-7
@@ -87,14 +91,29 @@ struct _fluid_rvoice_dsp_t
     enum fluid_interp interp_method;
     enum fluid_loop samplemode;
 
+    /* specialisation of interp_method for the format of the sample data,
+     * see fluid_rvoice_dsp_select_interpolation() */
+    fluid_rvoice_dsp_interp_func_t interpolate;
+    fluid_rvoice_dsp_interp_func_t interpolate_cached;        /* compressed samples only, see fluid_rvoice_render() */
+
     /* Flag that is set as soon as the first loop is completed. */
     char has_looped;
 
+    /* Flag that is set while the expanded loop of the sample is played. */
+    char expanded_loop;
+
     /* Flag that initiates, that sample-related parameters have to be checked. */
     char check_sample_sanity_flag;
 
     fluid_sample_t *sample;
 
+    /* sample data read by the interpolation, see fluid_rvoice_select_sample_data() */
+    short *data;
+    char *data24;
+
+    /* cache of decoded blocks of compressed samples, NULL if compressed samples can't be played */
+    fluid_sample_decoder_t *decoder;
+
     /* sample and loop start and end points (offset in sample memory).  */
     int start;
     int end;
@@ -191,13 +210,11 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_loopstart);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_loopend);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_samplemode);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_sample);
+DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_set_decoder);
 
 /* defined in fluid_rvoice_dsp.c */
 void fluid_rvoice_dsp_config(void);
-int fluid_rvoice_dsp_interpolate_none(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int is_looping);
-int fluid_rvoice_dsp_interpolate_linear(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int is_looping);
-int fluid_rvoice_dsp_interpolate_4th_order(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int is_looping);
-int fluid_rvoice_dsp_interpolate_7th_order(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int is_looping);
+void fluid_rvoice_dsp_select_interpolation(fluid_rvoice_dsp_t *voice);
 
 
 /*
@@ -48,590 +48,124 @@
 
 /* Interpolation (find a value between two samples of the original waveform) */
 
+/* Plain sample data, with or without a least sig. 8 bit part */
 static FLUID_INLINE fluid_real_t
-fluid_rvoice_get_float_sample(const short int *dsp_msb, const char *dsp_lsb, unsigned int idx)
+fluid_rvoice_get_float_sample_plain(const short int *dsp_msb, const char *dsp_lsb,
+                                    fluid_sample_decoder_t *decoder, unsigned int idx)
 {
     int32_t sample = fluid_rvoice_get_sample(dsp_msb, dsp_lsb, idx);
     return (fluid_real_t)sample;
 }
 
-/* No interpolation. Just take the sample, which is closest to
-  * the playback pointer.  Questionable quality, but very
-  * efficient. */
-int
-fluid_rvoice_dsp_interpolate_none(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int looping)
+/* Compressed samples have no plain data, they are read from the voice's decode cache */
+static FLUID_INLINE fluid_real_t
+fluid_rvoice_get_float_sample_compressed(const short int *dsp_msb, const char *dsp_lsb,
+        fluid_sample_decoder_t *decoder, unsigned int idx)
 {
-    fluid_phase_t dsp_phase = voice->phase;
-    fluid_phase_t dsp_phase_incr;
-    short int *dsp_data = voice->sample->data;
-    char *dsp_data24 = voice->sample->data24;
-    fluid_real_t dsp_amp = voice->amp;
-    fluid_real_t dsp_amp_incr = voice->amp_incr;
-    unsigned int dsp_i = 0;
-    unsigned int dsp_phase_index;
-    unsigned int end_index;
-
-    /* Convert playback "speed" floating point value to phase index/fract */
-    fluid_phase_set_float(dsp_phase_incr, voice->phase_incr);
-
-    end_index = looping ? voice->loopend - 1 : voice->end;
-
-    while(1)
-    {
-        dsp_phase_index = fluid_phase_index_round(dsp_phase);	/* round to nearest point */
-
-        /* interpolate sequence of sample points */
-        for(; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
-        {
-            dsp_buf[dsp_i] = dsp_amp * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index_round(dsp_phase);	/* round to nearest point */
-            dsp_amp += dsp_amp_incr;
-        }
-
-        /* break out if not looping (buffer may not be full) */
-        if(!looping)
-        {
-            break;
-        }
-
-        /* go back to loop start */
-        if(dsp_phase_index > end_index)
-        {
-            fluid_phase_sub_int(dsp_phase, voice->loopend - voice->loopstart);
-            voice->has_looped = 1;
-        }
-
-        /* break out if filled buffer */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-    }
-
-    voice->phase = dsp_phase;
-    voice->amp = dsp_amp;
-
-    return (dsp_i);
+    return (fluid_real_t)((int32_t)fluid_sample_decoder_get(decoder, idx) * 256);
 }
 
-/* Straight line interpolation.
- * Returns number of samples processed (usually FLUID_BUFSIZE but could be
- * smaller if end of sample occurs).
- */
-int
-fluid_rvoice_dsp_interpolate_linear(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int looping)
+/* Compressed samples whose points read are all cached, see fluid_rvoice_render() */
+static FLUID_INLINE fluid_real_t
+fluid_rvoice_get_float_sample_cached(const short int *dsp_msb, const char *dsp_lsb,
+                                     fluid_sample_decoder_t *decoder, unsigned int idx)
 {
-    fluid_phase_t dsp_phase = voice->phase;
-    fluid_phase_t dsp_phase_incr;
-    short int *dsp_data = voice->sample->data;
-    char *dsp_data24 = voice->sample->data24;
-    fluid_real_t dsp_amp = voice->amp;
-    fluid_real_t dsp_amp_incr = voice->amp_incr;
-    unsigned int dsp_i = 0;
-    unsigned int dsp_phase_index;
-    unsigned int end_index;
-    fluid_real_t point;
-    const fluid_real_t *FLUID_RESTRICT coeffs;
-
-    /* Convert playback "speed" floating point value to phase index/fract */
-    fluid_phase_set_float(dsp_phase_incr, voice->phase_incr);
-
-    /* last index before 2nd interpolation point must be specially handled */
-    end_index = (looping ? voice->loopend - 1 : voice->end) - 1;
-
-    /* 2nd interpolation point to use at end of loop or sample */
-    if(looping)
-    {
-        point = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart);    /* loop start */
-    }
-    else
-    {
-        point = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->end);    /* duplicate end for samples no longer looping */
-    }
-
-    while(1)
-    {
-        dsp_phase_index = fluid_phase_index(dsp_phase);
-
-        /* interpolate the sequence of sample points */
-        for(; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
-        {
-            coeffs = interp_coeff_linear[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                        + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        /* break out if buffer filled */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-
-        end_index++;	/* we're now interpolating the last point */
-
-        /* interpolate within last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = interp_coeff_linear[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                        + coeffs[1] * point);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;	/* increment amplitude */
-        }
-
-        if(!looping)
-        {
-            break;    /* break out if not looping (end of sample) */
-        }
-
-        /* go back to loop start (if past */
-        if(dsp_phase_index > end_index)
-        {
-            fluid_phase_sub_int(dsp_phase, voice->loopend - voice->loopstart);
-            voice->has_looped = 1;
-        }
+    return (fluid_real_t)((int32_t)fluid_sample_decoder_get_cached(decoder, idx) * 256);
+}
 
-        /* break out if filled buffer */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
+#define FLUID_INTERP_CONCAT(a, b) FLUID_INTERP_CONCAT2(a, b)
+#define FLUID_INTERP_CONCAT2(a, b) a ## b
+#define FLUID_INTERP_NAME(name) \
+    FLUID_INTERP_CONCAT(fluid_rvoice_dsp_interpolate_ ## name ## _, FLUID_INTERP_FORMAT)
+#define FLUID_INTERP_GET_SAMPLE \
+    FLUID_INTERP_CONCAT(fluid_rvoice_get_float_sample_, FLUID_INTERP_FORMAT)
 
-        end_index--;	/* set end back to second to last sample point */
-    }
+#define FLUID_INTERP_FORMAT plain
+#include "fluid_rvoice_dsp_interp.h"
+#undef FLUID_INTERP_FORMAT
 
-    voice->phase = dsp_phase;
-    voice->amp = dsp_amp;
+#define FLUID_INTERP_FORMAT compressed
+#include "fluid_rvoice_dsp_interp.h"
+#undef FLUID_INTERP_FORMAT
 
-    return (dsp_i);
-}
+#define FLUID_INTERP_FORMAT cached
+#include "fluid_rvoice_dsp_interp.h"
+#undef FLUID_INTERP_FORMAT
 
-/* 4th order (cubic) interpolation.
- * Returns number of samples processed (usually FLUID_BUFSIZE but could be
- * smaller if end of sample occurs).
- */
-int
-fluid_rvoice_dsp_interpolate_4th_order(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int looping)
+enum
+{
+    FLUID_INTERP_FORMAT_PLAIN,
+    FLUID_INTERP_FORMAT_COMPRESSED,
+    FLUID_INTERP_FORMAT_CACHED,
+    FLUID_INTERP_FORMAT_COUNT
+};
+
+/* The interpolation routines by sample format, in the order none, linear, 4th order and 7th order */
+static const fluid_rvoice_dsp_interp_func_t interp_funcs[FLUID_INTERP_FORMAT_COUNT][4] =
 {
-    fluid_phase_t dsp_phase = voice->phase;
-    fluid_phase_t dsp_phase_incr;
-    short int *dsp_data = voice->sample->data;
-    char *dsp_data24 = voice->sample->data24;
-    fluid_real_t dsp_amp = voice->amp;
-    fluid_real_t dsp_amp_incr = voice->amp_incr;
-    unsigned int dsp_i = 0;
-    unsigned int dsp_phase_index;
-    unsigned int start_index, end_index;
-    fluid_real_t start_point, end_point1, end_point2;
-    const fluid_real_t *FLUID_RESTRICT coeffs;
-
-    /* Convert playback "speed" floating point value to phase index/fract */
-    fluid_phase_set_float(dsp_phase_incr, voice->phase_incr);
-
-    /* last index before 4th interpolation point must be specially handled */
-    end_index = (looping ? voice->loopend - 1 : voice->end) - 2;
-
-    if(voice->has_looped)	/* set start_index and start point if looped or not */
     {
-        start_index = voice->loopstart;
-        start_point = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 1);	/* last point in loop (wrap around) */
-    }
-    else
+        fluid_rvoice_dsp_interpolate_none_plain,
+        fluid_rvoice_dsp_interpolate_linear_plain,
+        fluid_rvoice_dsp_interpolate_4th_order_plain,
+        fluid_rvoice_dsp_interpolate_7th_order_plain
+    },
     {
-        start_index = voice->start;
-        start_point = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->start);	/* just duplicate the point */
-    }
-
-    /* get points off the end (loop start if looping, duplicate point if end) */
-    if(looping)
-    {
-        end_point1 = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart);
-        end_point2 = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart + 1);
-    }
-    else
+        fluid_rvoice_dsp_interpolate_none_compressed,
+        fluid_rvoice_dsp_interpolate_linear_compressed,
+        fluid_rvoice_dsp_interpolate_4th_order_compressed,
+        fluid_rvoice_dsp_interpolate_7th_order_compressed
+    },
     {
-        end_point1 = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->end);
-        end_point2 = end_point1;
+        fluid_rvoice_dsp_interpolate_none_cached,
+        fluid_rvoice_dsp_interpolate_linear_cached,
+        fluid_rvoice_dsp_interpolate_4th_order_cached,
+        fluid_rvoice_dsp_interpolate_7th_order_cached
     }
+};
 
-    while(1)
-    {
-        dsp_phase_index = fluid_phase_index(dsp_phase);
-
-        /* interpolate first sample point (start or loop start) if needed */
-        for(; dsp_phase_index == start_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = interp_coeff[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp *
-                             (coeffs[0] * start_point
-                              + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                              + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                              + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        /* interpolate the sequence of sample points */
-        for(; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
-        {
-            coeffs = interp_coeff[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp *
-                             (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                              + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                              + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                              + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        /* break out if buffer filled */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-
-        end_index++;	/* we're now interpolating the 2nd to last point */
-
-        /* interpolate within 2nd to last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = interp_coeff[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp *
-                             (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                              + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                              + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                              + coeffs[3] * end_point1);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        end_index++;	/* we're now interpolating the last point */
-
-        /* interpolate within the last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = interp_coeff[fluid_phase_fract_to_tablerow(dsp_phase)];
-            dsp_buf[dsp_i] = dsp_amp *
-                             (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                              + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                              + coeffs[2] * end_point1
-                              + coeffs[3] * end_point2);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        if(!looping)
-        {
-            break;    /* break out if not looping (end of sample) */
-        }
-
-        /* go back to loop start */
-        if(dsp_phase_index > end_index)
-        {
-            fluid_phase_sub_int(dsp_phase, voice->loopend - voice->loopstart);
-
-            if(!voice->has_looped)
-            {
-                voice->has_looped = 1;
-                start_index = voice->loopstart;
-                start_point = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 1);
-            }
-        }
-
-        /* break out if filled buffer */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-
-        end_index -= 2;	/* set end back to third to last sample point */
-    }
-
-    voice->phase = dsp_phase;
-    voice->amp = dsp_amp;
-
-    return (dsp_i);
-}
-
-/* 7th order interpolation.
- * Returns number of samples processed (usually FLUID_BUFSIZE but could be
- * smaller if end of sample occurs).
+/*
+ * Select the interpolation routine matching the voice's interpolation method
+ * and the format of its sample data. Must be called whenever one of them changes.
  */
-int
-fluid_rvoice_dsp_interpolate_7th_order(fluid_rvoice_dsp_t *voice, fluid_real_t *FLUID_RESTRICT dsp_buf, int looping)
+void
+fluid_rvoice_dsp_select_interpolation(fluid_rvoice_dsp_t *voice)
 {
-    fluid_phase_t dsp_phase = voice->phase;
-    fluid_phase_t dsp_phase_incr;
-    short int *dsp_data = voice->sample->data;
-    char *dsp_data24 = voice->sample->data24;
-    fluid_real_t dsp_amp = voice->amp;
-    fluid_real_t dsp_amp_incr = voice->amp_incr;
-    unsigned int dsp_i = 0;
-    unsigned int dsp_phase_index;
-    unsigned int start_index, end_index;
-    fluid_real_t start_points[3], end_points[3];
-    const fluid_real_t *FLUID_RESTRICT coeffs;
-
-    /* Convert playback "speed" floating point value to phase index/fract */
-    fluid_phase_set_float(dsp_phase_incr, voice->phase_incr);
-
-    /* add 1/2 sample to dsp_phase since 7th order interpolation is centered on
-     * the 4th sample point */
-    fluid_phase_incr(dsp_phase, (fluid_phase_t)0x80000000);
-
-    /* last index before 7th interpolation point must be specially handled */
-    end_index = (looping ? voice->loopend - 1 : voice->end) - 3;
+    int format, method;
 
-    if(voice->has_looped)	/* set start_index and start point if looped or not */
+    /* Only compressed samples get routines of their own: their points are read
+     * from the decode cache, which doesn't pay off to check for on every point.
+     * For plain data, checking for a 24 bit part on every point costs nothing
+     * measurable, see test/bench_voice_render.c. */
+    if(voice->sample != NULL && voice->sample->data == NULL)
     {
-        start_index = voice->loopstart;
-        start_points[0] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 1);
-        start_points[1] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 2);
-        start_points[2] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 3);
+        format = FLUID_INTERP_FORMAT_COMPRESSED;
     }
     else
     {
-        start_index = voice->start;
-        start_points[0] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->start);	/* just duplicate the start point */
-        start_points[1] = start_points[0];
-        start_points[2] = start_points[0];
+        format = FLUID_INTERP_FORMAT_PLAIN;
     }
 
-    /* get the 3 points off the end (loop start if looping, duplicate point if end) */
-    if(looping)
+    switch(voice->interp_method)
     {
-        end_points[0] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart);
-        end_points[1] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart + 1);
-        end_points[2] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopstart + 2);
+    case FLUID_INTERP_NONE:
+        method = 0;
+        break;
+
+    case FLUID_INTERP_LINEAR:
+        method = 1;
+        break;
+
+    case FLUID_INTERP_4THORDER:
+    default:
+        method = 2;
+        break;
+
+    case FLUID_INTERP_7THORDER:
+        method = 3;
+        break;
     }
-    else
-    {
-        end_points[0] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->end);
-        end_points[1] = end_points[0];
-        end_points[2] = end_points[0];
-    }
-
-    while(1)
-    {
-        dsp_phase_index = fluid_phase_index(dsp_phase);
-
-        /* interpolate first sample point (start or loop start) if needed */
-        for(; dsp_phase_index == start_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * start_points[2]
-                                + coeffs[1] * start_points[1]
-                                + coeffs[2] * start_points[0]
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2)
-                                + coeffs[6] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 3));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        start_index++;
-
-        /* interpolate 2nd to first sample point (start or loop start) if needed */
-        for(; dsp_phase_index == start_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * start_points[1]
-                                + coeffs[1] * start_points[0]
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2)
-                                + coeffs[6] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 3));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        start_index++;
-
-        /* interpolate 3rd to first sample point (start or loop start) if needed */
-        for(; dsp_phase_index == start_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * start_points[0]
-                                + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 2)
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2)
-                                + coeffs[6] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 3));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        start_index -= 2;	/* set back to original start index */
-
-
-        /* interpolate the sequence of sample points */
-        for(; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 3)
-                                + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 2)
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2)
-                                + coeffs[6] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 3));
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        /* break out if buffer filled */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-
-        end_index++;	/* we're now interpolating the 3rd to last point */
-
-        /* interpolate within 3rd to last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 3)
-                                + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 2)
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 2)
-                                + coeffs[6] * end_points[0]);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        end_index++;	/* we're now interpolating the 2nd to last point */
-
-        /* interpolate within 2nd to last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 3)
-                                + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 2)
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index + 1)
-                                + coeffs[5] * end_points[0]
-                                + coeffs[6] * end_points[1]);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        end_index++;	/* we're now interpolating the last point */
-
-        /* interpolate within last point */
-        for(; dsp_phase_index <= end_index && dsp_i < FLUID_BUFSIZE; dsp_i++)
-        {
-            coeffs = sinc_table7[fluid_phase_fract_to_tablerow(dsp_phase)];
-
-            dsp_buf[dsp_i] = dsp_amp
-                             * (coeffs[0] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 3)
-                                + coeffs[1] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 2)
-                                + coeffs[2] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index - 1)
-                                + coeffs[3] * fluid_rvoice_get_float_sample(dsp_data, dsp_data24, dsp_phase_index)
-                                + coeffs[4] * end_points[0]
-                                + coeffs[5] * end_points[1]
-                                + coeffs[6] * end_points[2]);
-
-            /* increment phase and amplitude */
-            fluid_phase_incr(dsp_phase, dsp_phase_incr);
-            dsp_phase_index = fluid_phase_index(dsp_phase);
-            dsp_amp += dsp_amp_incr;
-        }
-
-        if(!looping)
-        {
-            break;    /* break out if not looping (end of sample) */
-        }
-
-        /* go back to loop start */
-        if(dsp_phase_index > end_index)
-        {
-            fluid_phase_sub_int(dsp_phase, voice->loopend - voice->loopstart);
-
-            if(!voice->has_looped)
-            {
-                voice->has_looped = 1;
-                start_index = voice->loopstart;
-                start_points[0] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 1);
-                start_points[1] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 2);
-                start_points[2] = fluid_rvoice_get_float_sample(dsp_data, dsp_data24, voice->loopend - 3);
-            }
-        }
-
-        /* break out if filled buffer */
-        if(dsp_i >= FLUID_BUFSIZE)
-        {
-            break;
-        }
-
-        end_index -= 3;	/* set end back to 4th to last sample point */
-    }
-
-    /* sub 1/2 sample from dsp_phase since 7th order interpolation is centered on
-     * the 4th sample point (correct back to real value) */
-    fluid_phase_decr(dsp_phase, (fluid_phase_t)0x80000000);
-
-    voice->phase = dsp_phase;
-    voice->amp = dsp_amp;
 
-    return (dsp_i);
+    voice->interpolate = interp_funcs[format][method];
+    voice->interpolate_cached = (format == FLUID_INTERP_FORMAT_COMPRESSED)
+                                ? interp_funcs[FLUID_INTERP_FORMAT_CACHED][method] : NULL;
 }
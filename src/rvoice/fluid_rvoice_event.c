@@ -114,7 +114,9 @@ fluid_rvoice_eventhandler_finished_voice_callback(fluid_rvoice_eventhandler_t *e
 
 fluid_rvoice_eventhandler_t *
 new_fluid_rvoice_eventhandler(int queuesize,
-                              int finished_voices_size, int bufs, int fx_bufs, int fx_units, fluid_real_t sample_rate, int extra_threads, int prio)
+                              int finished_voices_size, int bufs, int fx_bufs, int fx_units, int buf_blocks, int lazy_fx,
+                              int reverb_engine, fluid_real_t sample_rate, int extra_threads, int prio, int render_pool,
+                              int huge_pages)
 {
     fluid_rvoice_eventhandler_t *eventhandler = FLUID_NEW(fluid_rvoice_eventhandler_t);
 
@@ -145,7 +147,9 @@ new_fluid_rvoice_eventhandler(int queuesize,
         goto error_recovery;
     }
 
-    eventhandler->mixer = new_fluid_rvoice_mixer(bufs, fx_bufs, fx_units, sample_rate, eventhandler, extra_threads, prio);
+    eventhandler->mixer = new_fluid_rvoice_mixer(bufs, fx_bufs, fx_units, buf_blocks, lazy_fx,
+                          reverb_engine, sample_rate, eventhandler, extra_threads, prio, render_pool,
+                          huge_pages);
 
     if(eventhandler->mixer == NULL)
     {
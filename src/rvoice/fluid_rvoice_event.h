@@ -50,7 +50,8 @@ struct _fluid_rvoice_eventhandler_t
 
 fluid_rvoice_eventhandler_t *new_fluid_rvoice_eventhandler(
     int queuesize, int finished_voices_size, int bufs,
-    int fx_bufs, int fx_units, fluid_real_t sample_rate, int, int);
+    int fx_bufs, int fx_units, int buf_blocks, int lazy_fx, int reverb_engine, fluid_real_t sample_rate,
+    int, int, int, int);
 
 void delete_fluid_rvoice_eventhandler(fluid_rvoice_eventhandler_t *);
 
@@ -26,12 +26,22 @@
 #include "fluidsynth_priv.h"
 #include "fluid_ladspa.h"
 #include "fluid_synth.h"
+#include "fluid_hugemem.h"
+#include "fluid_render_pool.h"
 
 
 // If less than x voices, the thread overhead is larger than the gain,
 // so don't activate the thread(s).
 #define VOICES_PER_THREAD 8
 
+// Peak level (-120 dB) below which an effects send or output counts as silent.
+#define FX_SILENCE_LEVEL ((fluid_real_t)1e-6)
+
+// Number of samples an effects unit must have had silent input and output
+// before it goes to sleep. Longer than the longest reverb delay line and the
+// maximum chorus delay, so that no tail can still be hidden in the delay lines.
+#define FX_SLEEP_SAMPLES 8192
+
 typedef struct _fluid_mixer_buffers_t fluid_mixer_buffers_t;
 
 struct _fluid_mixer_buffers_t
@@ -53,7 +63,7 @@ struct _fluid_mixer_buffers_t
     /** buffer to store the left part of a stereo channel to.
      * Specifically a two dimensional array, containing \c buf_count sample buffers
      * (i.e. for each synth.audio-channels), of which each contains
-     * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT audio items (=samples)
+     * FLUID_BUFSIZE * mixer->buf_blocks audio items (=samples)
      * @note Each sample buffer is aligned to the FLUID_DEFAULT_ALIGNMENT
      * boundary provided that this pointer points to an aligned buffer.
      * So make sure to access the sample buffer by first aligning this
@@ -67,7 +77,7 @@ struct _fluid_mixer_buffers_t
     /** buffer to store the left part of a stereo effects channel to.
      * Specifically a two dimensional array, containing \c fx_buf_count buffers
      * (i.e. for each synth.effects-channels), of which each buffer contains
-     * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT audio items (=samples)
+     * FLUID_BUFSIZE * mixer->buf_blocks audio items (=samples)
      */
     fluid_real_t *fx_left_buf;
     fluid_real_t *fx_right_buf;
@@ -79,11 +89,18 @@ struct _fluid_mixer_fx_t
 {
     fluid_revmodel_t *reverb; /**< Reverb unit */
     fluid_chorus_t *chorus; /**< Chorus unit */
+
+    /* Number of samples the input and output of the unit has been silent for.
+     * The unit sleeps, i.e. is not processed, once this reaches FX_SLEEP_SAMPLES. */
+    int reverb_silent_samples;
+    int chorus_silent_samples;
 };
 
 struct _fluid_rvoice_mixer_t
 {
     fluid_mixer_fx_t *fx;
+    fluid_real_t *fx_mix_buf; /**< Left and right output of an effects unit to be mixed to the
+                                   primary output, buf_blocks * FLUID_BUFSIZE each. Created with the units */
 
     fluid_mixer_buffers_t buffers; /**< Used by mixer only: own buffers */
     fluid_rvoice_eventhandler_t *eventhandler;
@@ -92,6 +109,10 @@ struct _fluid_rvoice_mixer_t
     int polyphony; /**< Read-only: Length of voices array */
     int active_voices; /**< Read-only: Number of non-null voices */
     int current_blockcount;      /**< Read-only: how many blocks to process this time */
+    int buf_blocks;         /**< Read-only: length of each sample buffer in blocks of FLUID_BUFSIZE */
+    fluid_real_t sample_rate;   /**< Sample rate for effects units created later on */
+    int reverb_engine;          /**< Engine of the reverb units, see #fluid_revmodel_engine_t */
+    int huge_pages;             /**< Allocate the buffers from huge pages? */
     int fx_units;
     int with_reverb;        /**< Should the synth use the built-in reverb unit? */
     int with_chorus;        /**< Should the synth use the built-in chorus unit? */
@@ -113,25 +134,152 @@ struct _fluid_rvoice_mixer_t
 
     int thread_count;            /**< Number of extra mixer threads for multi-core rendering */
     fluid_mixer_buffers_t *threads;    /**< Array of mixer threads (thread_count in length) */
+    fluid_render_pool_t *render_pool;  /**< Process-wide threads rendering into the buffers of threads instead, or NULL */
+    fluid_render_job_t render_job;     /**< Job submitted to render_pool while rendering */
 #endif
 };
 
 #if ENABLE_MIXER_THREADS
 static void delete_rvoice_mixer_threads(fluid_rvoice_mixer_t *mixer);
-static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int thread_count, int prio_level);
+static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int thread_count, int prio_level,
+                                          int render_pool);
 #endif
 
+/* Peak level of one block of samples */
+static FLUID_INLINE fluid_real_t
+fluid_mixer_block_peak(const fluid_real_t *buf)
+{
+    fluid_real_t peak = 0;
+    int i;
+
+    #pragma omp simd reduction(max:peak)
+    for(i = 0; i < FLUID_BUFSIZE; i++)
+    {
+        fluid_real_t v = fabs(buf[i]);
+        peak = (v > peak) ? v : peak;
+    }
+
+    return peak;
+}
+
+/* Number of samples in the silent blocks at the end of buf */
+static FLUID_INLINE int
+fluid_mixer_silent_tail(const fluid_real_t *buf, int count)
+{
+    int i;
+
+    for(i = count; i > 0; i -= FLUID_BUFSIZE)
+    {
+        if(fluid_mixer_block_peak(&buf[i - FLUID_BUFSIZE]) > FX_SILENCE_LEVEL)
+        {
+            break;
+        }
+    }
+
+    return count - i;
+}
+
+/*
+ * Returns the number of leading samples an effects unit doesn't need to
+ * process: none if the unit is awake, else the silent input blocks up to the
+ * first audible one. That block wakes the unit up, as its delay lines have
+ * been cleared when it went to sleep, it resumes right away from the state it
+ * would have decayed to anyway. When not mixing, the skipped output is cleared.
+ */
+static FLUID_INLINE int
+fluid_mixer_fx_skip(int *silent_samples, const fluid_real_t *in,
+                    fluid_real_t *out_l, fluid_real_t *out_r, int count, int mix)
+{
+    int start = 0;
+
+    if(*silent_samples < FX_SLEEP_SAMPLES)
+    {
+        return 0;
+    }
+
+    while(start < count && fluid_mixer_block_peak(&in[start]) <= FX_SILENCE_LEVEL)
+    {
+        start += FLUID_BUFSIZE;
+    }
+
+    if(!mix)
+    {
+        FLUID_MEMSET(out_l, 0, start * sizeof(fluid_real_t));
+        FLUID_MEMSET(out_r, 0, start * sizeof(fluid_real_t));
+    }
+
+    if(start < count)
+    {
+        *silent_samples = 0;
+    }
+
+    return start;
+}
+
+/*
+ * Track how long input and output of an effects unit have been silent, given
+ * the silent tail of the input (measured before processing, as the output
+ * may replace it). Returns TRUE if the unit should go to sleep now, i.e. be reset.
+ */
+static FLUID_INLINE int
+fluid_mixer_fx_update_silence(int *silent_samples, int in_tail,
+                              const fluid_real_t *out_l, const fluid_real_t *out_r, int count)
+{
+    int tail = in_tail;
+
+    if(tail > 0)
+    {
+        int out_tail = fluid_mixer_silent_tail(out_l, count);
+        tail = (out_tail < tail) ? out_tail : tail;
+    }
+
+    if(tail > 0)
+    {
+        int out_tail = fluid_mixer_silent_tail(out_r, count);
+        tail = (out_tail < tail) ? out_tail : tail;
+    }
+
+    *silent_samples = (tail == count) ? *silent_samples + count : tail;
+
+    return (*silent_samples >= FX_SLEEP_SAMPLES);
+}
+
+/* Add the output of an effects unit to the dry output */
+static FLUID_INLINE void
+fluid_mixer_fx_mix(fluid_real_t *out_l, fluid_real_t *out_r,
+                   const fluid_real_t *fx_l, const fluid_real_t *fx_r, int count)
+{
+    int i;
+
+    #pragma omp simd aligned(out_l,out_r:FLUID_DEFAULT_ALIGNMENT)
+    for(i = 0; i < count; i++)
+    {
+        out_l[i] += fx_l[i];
+        out_r[i] += fx_r[i];
+    }
+}
+
+/*
+ * Runs the effects units over all blocks rendered this time. Each unit
+ * processes the whole span in one call, only skipping leading blocks while it
+ * is asleep.
+ */
 static FLUID_INLINE void
 fluid_rvoice_mixer_process_fx(fluid_rvoice_mixer_t *mixer, int current_blockcount)
 {
     const int fx_channels_per_unit = mixer->buffers.fx_buf_count / mixer->fx_units;
-    int i, f;
-
-    void (*reverb_process_func)(fluid_revmodel_t *rev, const fluid_real_t *in, fluid_real_t *left_out, fluid_real_t *right_out);
-    void (*chorus_process_func)(fluid_chorus_t *chorus, const fluid_real_t *in, fluid_real_t *left_out, fluid_real_t *right_out);
+    const int buf_size = mixer->buf_blocks * FLUID_BUFSIZE;
+    const int count = current_blockcount * FLUID_BUFSIZE;
+    const int mix = mixer->mix_fx_to_out;
+    int f, start;
 
     fluid_real_t *out_rev_l, *out_rev_r, *out_ch_l, *out_ch_r;
 
+    /* The units always replace into their output, so that their tail level can
+     * be measured. When mixing to the dry output they render to fx_mix_buf first. */
+    fluid_real_t *mix_l = mixer->fx_mix_buf;
+    fluid_real_t *mix_r = mixer->fx_mix_buf + buf_size;
+
     // all dry unprocessed mono input is stored in the left channel
     fluid_real_t *in_rev = fluid_align_ptr(mixer->buffers.fx_left_buf, FLUID_DEFAULT_ALIGNMENT);
     fluid_real_t *in_ch = in_rev;
@@ -139,24 +287,17 @@ fluid_rvoice_mixer_process_fx(fluid_rvoice_mixer_t *mixer, int current_blockcoun
     fluid_profile_ref_var(prof_ref);
 
 
-    if(mixer->mix_fx_to_out)
+    if(mix)
     {
         // mix effects to first stereo channel
         out_ch_l = out_rev_l = fluid_align_ptr(mixer->buffers.left_buf, FLUID_DEFAULT_ALIGNMENT);
         out_ch_r = out_rev_r = fluid_align_ptr(mixer->buffers.right_buf, FLUID_DEFAULT_ALIGNMENT);
-
-        reverb_process_func = fluid_revmodel_processmix;
-        chorus_process_func = fluid_chorus_processmix;
-
     }
     else
     {
         // replace effects into respective stereo effects channel
         out_ch_l = out_rev_l = fluid_align_ptr(mixer->buffers.fx_left_buf, FLUID_DEFAULT_ALIGNMENT);
         out_ch_r = out_rev_r = fluid_align_ptr(mixer->buffers.fx_right_buf, FLUID_DEFAULT_ALIGNMENT);
-
-        reverb_process_func = fluid_revmodel_processreplace;
-        chorus_process_func = fluid_chorus_processreplace;
     }
 
 
@@ -164,42 +305,86 @@ fluid_rvoice_mixer_process_fx(fluid_rvoice_mixer_t *mixer, int current_blockcoun
     {
         for(f = 0; f < mixer->fx_units; f++)
         {
-            int buf_idx = f * fx_channels_per_unit + SYNTH_REVERB_CHANNEL;
-            
-            for(i = 0; i < current_blockcount * FLUID_BUFSIZE; i += FLUID_BUFSIZE)
+            fluid_mixer_fx_t *fx = &mixer->fx[f];
+            int samp_idx = (f * fx_channels_per_unit + SYNTH_REVERB_CHANNEL) * buf_size;
+            const fluid_real_t *in = &in_rev[samp_idx];
+            fluid_real_t *l = mix ? mix_l : &out_rev_l[samp_idx];
+            fluid_real_t *r = mix ? mix_r : &out_rev_r[samp_idx];
+            int in_tail;
+
+            /* not created yet, no voice has been played so far */
+            if(fx->reverb == NULL)
+            {
+                continue;
+            }
+
+            start = fluid_mixer_fx_skip(&fx->reverb_silent_samples, in, l, r, count, mix);
+
+            if(start == count)
+            {
+                continue;
+            }
+
+            in_tail = fluid_mixer_silent_tail(&in[start], count - start);
+
+            fluid_revmodel_processreplace(fx->reverb, &in[start], &l[start], &r[start], count - start);
+
+            if(fluid_mixer_fx_update_silence(&fx->reverb_silent_samples, in_tail,
+                                             &l[start], &r[start], count - start))
+            {
+                fluid_revmodel_reset(fx->reverb);
+            }
+
+            if(mix)
             {
-                int samp_idx = buf_idx * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + i;
-                
-                reverb_process_func(mixer->fx[f].reverb,
-                                    &in_rev[samp_idx],
-                                    mixer->mix_fx_to_out ? &out_rev_l[i] : &out_rev_l[samp_idx],
-                                    mixer->mix_fx_to_out ? &out_rev_r[i] : &out_rev_r[samp_idx]);
+                fluid_mixer_fx_mix(&out_rev_l[start], &out_rev_r[start], &l[start], &r[start], count - start);
             }
         }
 
-        fluid_profile(FLUID_PROF_ONE_BLOCK_REVERB, prof_ref, 0,
-                      current_blockcount * FLUID_BUFSIZE);
+        fluid_profile(FLUID_PROF_ONE_BLOCK_REVERB, prof_ref, 0, count);
     }
 
     if(mixer->with_chorus)
     {
         for(f = 0; f < mixer->fx_units; f++)
         {
-            int buf_idx = f * fx_channels_per_unit + SYNTH_CHORUS_CHANNEL;
-            
-            for(i = 0; i < current_blockcount * FLUID_BUFSIZE; i += FLUID_BUFSIZE)
+            fluid_mixer_fx_t *fx = &mixer->fx[f];
+            int samp_idx = (f * fx_channels_per_unit + SYNTH_CHORUS_CHANNEL) * buf_size;
+            const fluid_real_t *in = &in_ch[samp_idx];
+            fluid_real_t *l = mix ? mix_l : &out_ch_l[samp_idx];
+            fluid_real_t *r = mix ? mix_r : &out_ch_r[samp_idx];
+            int in_tail;
+
+            /* not created yet, no voice has been played so far */
+            if(fx->chorus == NULL)
+            {
+                continue;
+            }
+
+            start = fluid_mixer_fx_skip(&fx->chorus_silent_samples, in, l, r, count, mix);
+
+            if(start == count)
+            {
+                continue;
+            }
+
+            in_tail = fluid_mixer_silent_tail(&in[start], count - start);
+
+            fluid_chorus_processreplace(fx->chorus, &in[start], &l[start], &r[start], count - start);
+
+            if(fluid_mixer_fx_update_silence(&fx->chorus_silent_samples, in_tail,
+                                             &l[start], &r[start], count - start))
+            {
+                fluid_chorus_reset(fx->chorus);
+            }
+
+            if(mix)
             {
-                int samp_idx = buf_idx * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + i;
-                
-                chorus_process_func(mixer->fx[f].chorus,
-                                    &in_ch [samp_idx],
-                                    mixer->mix_fx_to_out ? &out_ch_l[i] : &out_ch_l[samp_idx],
-                                    mixer->mix_fx_to_out ? &out_ch_r[i] : &out_ch_r[samp_idx]);
+                fluid_mixer_fx_mix(&out_ch_l[start], &out_ch_r[start], &l[start], &r[start], count - start);
             }
         }
 
-        fluid_profile(FLUID_PROF_ONE_BLOCK_CHORUS, prof_ref, 0,
-                      current_blockcount * FLUID_BUFSIZE);
+        fluid_profile(FLUID_PROF_ONE_BLOCK_CHORUS, prof_ref, 0, count);
     }
 
 #ifdef LADSPA
@@ -226,6 +411,7 @@ fluid_mixer_buffers_prepare(fluid_mixer_buffers_t *buffers, fluid_real_t **outbu
     int i;
     const int fx_channels_per_unit = buffers->fx_buf_count / buffers->mixer->fx_units;
     const int offset = buffers->buf_count * 2;
+    const int buf_size = buffers->mixer->buf_blocks * FLUID_BUFSIZE;
     int with_reverb = buffers->mixer->with_reverb;
     int with_chorus = buffers->mixer->with_chorus;
 
@@ -247,12 +433,12 @@ fluid_mixer_buffers_prepare(fluid_mixer_buffers_t *buffers, fluid_real_t **outbu
         
         outbufs[offset + fx_idx + SYNTH_REVERB_CHANNEL] =
             (with_reverb)
-            ? &base_ptr[(fx_idx + SYNTH_REVERB_CHANNEL) * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT]
+            ? &base_ptr[(fx_idx + SYNTH_REVERB_CHANNEL) * buf_size]
             : NULL;
             
         outbufs[offset + fx_idx + SYNTH_CHORUS_CHANNEL] =
             (with_chorus)
-            ? &base_ptr[(fx_idx + SYNTH_CHORUS_CHANNEL) * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT]
+            ? &base_ptr[(fx_idx + SYNTH_CHORUS_CHANNEL) * buf_size]
             : NULL;
     }
     
@@ -272,14 +458,14 @@ fluid_mixer_buffers_prepare(fluid_mixer_buffers_t *buffers, fluid_real_t **outbu
 
     for(i = 0; i < buffers->buf_count; i++)
     {
-        outbufs[i * 2] = &base_ptr[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT];
+        outbufs[i * 2] = &base_ptr[i * buf_size];
     }
 
     base_ptr = fluid_align_ptr(buffers->right_buf, FLUID_DEFAULT_ALIGNMENT);
 
     for(i = 0; i < buffers->buf_count; i++)
     {
-        outbufs[i * 2 + 1] = &base_ptr[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT];
+        outbufs[i * 2 + 1] = &base_ptr[i * buf_size];
     }
 
     return offset + buffers->fx_buf_count;
@@ -577,6 +763,7 @@ static FLUID_INLINE void
 fluid_mixer_buffers_zero(fluid_mixer_buffers_t *buffers, int current_blockcount)
 {
     int i, size = current_blockcount * FLUID_BUFSIZE * sizeof(fluid_real_t);
+    const int buf_size = buffers->mixer->buf_blocks * FLUID_BUFSIZE;
 
     /* TODO: Optimize by only zero out the buffers we actually use later on. */
     int buf_count = buffers->buf_count, fx_buf_count = buffers->fx_buf_count;
@@ -586,8 +773,8 @@ fluid_mixer_buffers_zero(fluid_mixer_buffers_t *buffers, int current_blockcount)
 
     for(i = 0; i < buf_count; i++)
     {
-        FLUID_MEMSET(&buf_l[i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE], 0, size);
-        FLUID_MEMSET(&buf_r[i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE], 0, size);
+        FLUID_MEMSET(&buf_l[i * buf_size], 0, size);
+        FLUID_MEMSET(&buf_r[i * buf_size], 0, size);
     }
 
     buf_l = fluid_align_ptr(buffers->fx_left_buf, FLUID_DEFAULT_ALIGNMENT);
@@ -595,44 +782,36 @@ fluid_mixer_buffers_zero(fluid_mixer_buffers_t *buffers, int current_blockcount)
 
     for(i = 0; i < fx_buf_count; i++)
     {
-        FLUID_MEMSET(&buf_l[i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE], 0, size);
-        FLUID_MEMSET(&buf_r[i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE], 0, size);
+        FLUID_MEMSET(&buf_l[i * buf_size], 0, size);
+        FLUID_MEMSET(&buf_r[i * buf_size], 0, size);
     }
 }
 
 static int
 fluid_mixer_buffers_init(fluid_mixer_buffers_t *buffers, fluid_rvoice_mixer_t *mixer)
 {
-    const int samplecount = FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT;
+    const int samplecount = FLUID_BUFSIZE * mixer->buf_blocks;
 
     buffers->mixer = mixer;
     buffers->buf_count = mixer->buffers.buf_count;
     buffers->fx_buf_count = mixer->buffers.fx_buf_count;
 
-    /* Local mono voice buf */
-    buffers->local_buf = FLUID_ARRAY_ALIGNED(fluid_real_t, samplecount, FLUID_DEFAULT_ALIGNMENT);
+    /* Local mono voice buf, left and right audio buffers and effects audio buffers, all
+     * sharing one block of memory that is aligned and, if enabled, backed by huge pages.
+     * Each buffer is a multiple of FLUID_DEFAULT_ALIGNMENT in size, so they stay aligned. */
+    buffers->local_buf = fluid_huge_alloc((1 + 2 * buffers->buf_count + 2 * buffers->fx_buf_count)
+                                          * samplecount * sizeof(fluid_real_t), 0, mixer->huge_pages);
 
-    /* Left and right audio buffers */
-
-    buffers->left_buf = FLUID_ARRAY_ALIGNED(fluid_real_t, buffers->buf_count * samplecount, FLUID_DEFAULT_ALIGNMENT);
-    buffers->right_buf = FLUID_ARRAY_ALIGNED(fluid_real_t, buffers->buf_count * samplecount, FLUID_DEFAULT_ALIGNMENT);
-
-    if((buffers->local_buf == NULL) || (buffers->left_buf == NULL) || (buffers->right_buf == NULL))
+    if(buffers->local_buf == NULL)
     {
         FLUID_LOG(FLUID_ERR, "Out of memory");
         return 0;
     }
 
-    /* Effects audio buffers */
-
-    buffers->fx_left_buf = FLUID_ARRAY_ALIGNED(fluid_real_t, buffers->fx_buf_count * samplecount, FLUID_DEFAULT_ALIGNMENT);
-    buffers->fx_right_buf = FLUID_ARRAY_ALIGNED(fluid_real_t, buffers->fx_buf_count * samplecount, FLUID_DEFAULT_ALIGNMENT);
-
-    if((buffers->fx_left_buf == NULL) || (buffers->fx_right_buf == NULL))
-    {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        return 0;
-    }
+    buffers->left_buf = buffers->local_buf + samplecount;
+    buffers->right_buf = buffers->left_buf + buffers->buf_count * samplecount;
+    buffers->fx_left_buf = buffers->right_buf + buffers->buf_count * samplecount;
+    buffers->fx_right_buf = buffers->fx_left_buf + buffers->fx_buf_count * samplecount;
 
     buffers->finished_voices = NULL;
 
@@ -655,15 +834,17 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_samplerate)
     fluid_real_t samplerate = param[1].real; // becausee fluid_synth_update_mixer() puts real into arg2
 
     int i;
+
+    mixer->sample_rate = samplerate;
+
     for(i = 0; i < mixer->fx_units; i++)
     {
         if(mixer->fx[i].chorus)
         {
             delete_fluid_chorus(mixer->fx[i].chorus);
+            mixer->fx[i].chorus = new_fluid_chorus(samplerate);
         }
 
-        mixer->fx[i].chorus = new_fluid_chorus(samplerate);
-
         if(mixer->fx[i].reverb)
         {
             fluid_revmodel_samplerate_change(mixer->fx[i].reverb, samplerate);
@@ -681,12 +862,60 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_samplerate)
 }
 
 
+/**
+ * Create the effects units that have not been created yet
+ * (NOTE: not hard real-time capable)
+ */
+DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_alloc_fx)
+{
+    fluid_rvoice_mixer_t *mixer = obj;
+    int i;
+
+    if(mixer->fx_mix_buf == NULL)
+    {
+        mixer->fx_mix_buf = FLUID_ARRAY(fluid_real_t, 2 * mixer->buf_blocks * FLUID_BUFSIZE);
+
+        if(mixer->fx_mix_buf == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            return;
+        }
+    }
+
+    for(i = 0; i < mixer->fx_units; i++)
+    {
+        if(mixer->fx[i].reverb == NULL)
+        {
+            mixer->fx[i].reverb = new_fluid_revmodel(mixer->sample_rate, mixer->reverb_engine);
+        }
+
+        if(mixer->fx[i].chorus == NULL)
+        {
+            mixer->fx[i].chorus = new_fluid_chorus(mixer->sample_rate);
+        }
+
+        if(mixer->fx[i].reverb == NULL || mixer->fx[i].chorus == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+        }
+    }
+}
+
+
 /**
  * @param buf_count number of primary stereo buffers
  * @param fx_buf_count number of stereo effect buffers
+ * @param buf_blocks length of each buffer in blocks of FLUID_BUFSIZE, i.e. the
+ *   maximum number of blocks rendered at once
+ * @param lazy_fx TRUE to not create the effects units until fluid_rvoice_mixer_alloc_fx()
+ * @param reverb_engine engine of the reverb units, see #fluid_revmodel_engine_t
+ * @param render_pool TRUE to render with the process-wide render pool instead of own threads
+ * @param huge_pages TRUE to allocate the buffers from huge pages when possible
  */
 fluid_rvoice_mixer_t *
-new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units, fluid_real_t sample_rate, fluid_rvoice_eventhandler_t *evthandler, int extra_threads, int prio)
+new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units, int buf_blocks, int lazy_fx,
+                       int reverb_engine, fluid_real_t sample_rate, fluid_rvoice_eventhandler_t *evthandler,
+                       int extra_threads, int prio, int render_pool, int huge_pages)
 {
     int i;
     fluid_rvoice_mixer_t *mixer = FLUID_NEW(fluid_rvoice_mixer_t);
@@ -702,6 +931,10 @@ new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units, fluid_real
     mixer->fx_units = fx_units;
     mixer->buffers.buf_count = buf_count;
     mixer->buffers.fx_buf_count = fx_buf_count * fx_units;
+    mixer->buf_blocks = buf_blocks;
+    mixer->sample_rate = sample_rate;
+    mixer->reverb_engine = reverb_engine;
+    mixer->huge_pages = huge_pages;
 
     /* allocate the reverb module */
     mixer->fx = FLUID_ARRAY(fluid_mixer_fx_t, fx_units);
@@ -712,10 +945,21 @@ new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units, fluid_real
     }
     
     FLUID_MEMSET(mixer->fx, 0, fx_units * sizeof(*mixer->fx));
+
+    if(!lazy_fx)
+    {
+        mixer->fx_mix_buf = FLUID_ARRAY(fluid_real_t, 2 * buf_blocks * FLUID_BUFSIZE);
+
+        if(mixer->fx_mix_buf == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            goto error_recovery;
+        }
+    }
     
-    for(i = 0; i < fx_units; i++)
+    for(i = 0; i < fx_units && !lazy_fx; i++)
     {
-        mixer->fx[i].reverb = new_fluid_revmodel(sample_rate);
+        mixer->fx[i].reverb = new_fluid_revmodel(sample_rate, reverb_engine);
         mixer->fx[i].chorus = new_fluid_chorus(sample_rate);
 
         if(mixer->fx[i].reverb == NULL || mixer->fx[i].chorus == NULL)
@@ -742,7 +986,7 @@ new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units, fluid_real
         goto error_recovery;
     }
 
-    if(fluid_rvoice_mixer_set_threads(mixer, extra_threads, prio) != FLUID_OK)
+    if(fluid_rvoice_mixer_set_threads(mixer, extra_threads, prio, render_pool) != FLUID_OK)
     {
         goto error_recovery;
     }
@@ -761,12 +1005,8 @@ fluid_mixer_buffers_free(fluid_mixer_buffers_t *buffers)
 {
     FLUID_FREE(buffers->finished_voices);
 
-    /* free all the sample buffers */
-    FLUID_FREE(buffers->local_buf);
-    FLUID_FREE(buffers->left_buf);
-    FLUID_FREE(buffers->right_buf);
-    FLUID_FREE(buffers->fx_left_buf);
-    FLUID_FREE(buffers->fx_right_buf);
+    /* free all the sample buffers, they are allocated in one block */
+    fluid_huge_free(buffers->local_buf);
 }
 
 void delete_fluid_rvoice_mixer(fluid_rvoice_mixer_t *mixer)
@@ -816,6 +1056,7 @@ void delete_fluid_rvoice_mixer(fluid_rvoice_mixer_t *mixer)
     }
 
     FLUID_FREE(mixer->fx);
+    FLUID_FREE(mixer->fx_mix_buf);
     FLUID_FREE(mixer->rvoices);
     FLUID_FREE(mixer);
 }
@@ -841,25 +1082,26 @@ void fluid_rvoice_mixer_set_ladspa(fluid_rvoice_mixer_t *mixer,
 
         fluid_real_t *rev = fluid_align_ptr(mixer->buffers.fx_left_buf, FLUID_DEFAULT_ALIGNMENT);
         fluid_real_t *chor = rev;
+        const int buf_size = FLUID_BUFSIZE * mixer->buf_blocks;
 
-        rev = &rev[SYNTH_REVERB_CHANNEL * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT];
-        chor = &chor[SYNTH_CHORUS_CHANNEL * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT];
+        rev = &rev[SYNTH_REVERB_CHANNEL * buf_size];
+        chor = &chor[SYNTH_CHORUS_CHANNEL * buf_size];
 
         fluid_ladspa_add_host_ports(ladspa_fx, "Main:L", audio_groups,
                                     main_l,
-                                    FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT);
+                                    buf_size);
 
         fluid_ladspa_add_host_ports(ladspa_fx, "Main:R", audio_groups,
                                     main_r,
-                                    FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT);
+                                    buf_size);
 
         fluid_ladspa_add_host_ports(ladspa_fx, "Reverb:Send", 1,
                                     rev,
-                                    FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT);
+                                    buf_size);
 
         fluid_ladspa_add_host_ports(ladspa_fx, "Chorus:Send", 1,
                                     chor,
-                                    FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT);
+                                    buf_size);
     }
 }
 #endif
@@ -897,7 +1139,10 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_chorus_params)
     int i;
     for(i = 0; i < mixer->fx_units; i++)
     {
-        fluid_chorus_set(mixer->fx[i].chorus, set, nr, level, speed, depth_ms, type);
+        if(mixer->fx[i].chorus != NULL)
+        {
+            fluid_chorus_set(mixer->fx[i].chorus, set, nr, level, speed, depth_ms, type);
+        }
     }
 }
 
@@ -913,7 +1158,10 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_reverb_params)
     int i;
     for(i = 0; i < mixer->fx_units; i++)
     {
-        fluid_revmodel_set(mixer->fx[i].reverb, set, roomsize, damping, width, level);
+        if(mixer->fx[i].reverb != NULL)
+        {
+            fluid_revmodel_set(mixer->fx[i].reverb, set, roomsize, damping, width, level);
+        }
     }
 }
 
@@ -923,7 +1171,10 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_reset_reverb)
     int i;
     for(i = 0; i < mixer->fx_units; i++)
     {
-        fluid_revmodel_reset(mixer->fx[i].reverb);
+        if(mixer->fx[i].reverb != NULL)
+        {
+            fluid_revmodel_reset(mixer->fx[i].reverb);
+        }
     }
 }
 
@@ -933,7 +1184,10 @@ DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_reset_chorus)
     int i;
     for(i = 0; i < mixer->fx_units; i++)
     {
-        fluid_chorus_reset(mixer->fx[i].chorus);
+        if(mixer->fx[i].chorus != NULL)
+        {
+            fluid_chorus_reset(mixer->fx[i].chorus);
+        }
     }
 }
 
@@ -955,7 +1209,7 @@ int fluid_rvoice_mixer_get_fx_bufs(fluid_rvoice_mixer_t *mixer,
 
 int fluid_rvoice_mixer_get_bufcount(fluid_rvoice_mixer_t *mixer)
 {
-    return FLUID_MIXER_MAX_BUFFERS_DEFAULT;
+    return mixer->buf_blocks;
 }
 
 #if WITH_PROFILING
@@ -984,6 +1238,7 @@ fluid_mixer_get_mt_rvoice(fluid_rvoice_mixer_t *mixer)
 #define THREAD_BUF_VALID 1
 #define THREAD_BUF_NODATA 2
 #define THREAD_BUF_TERMINATE 3
+#define THREAD_BUF_QUEUED 4         /* waiting for a render pool thread */
 
 /* Core thread function (processes voices in parallel to primary synthesis thread) */
 static fluid_thread_return_t
@@ -1047,11 +1302,59 @@ fluid_mixer_thread_func(void *data)
     return FLUID_THREAD_RETURN_VALUE;
 }
 
+/* Called by a render pool thread: take over one of the queued buffers and render
+ * voices into it until there are none left */
+static void
+fluid_mixer_render_pool_help(void *data)
+{
+    fluid_rvoice_mixer_t *mixer = data;
+    fluid_mixer_buffers_t *buffers = NULL;
+    fluid_rvoice_t *rvoice;
+    FLUID_DECLARE_VLA(fluid_real_t *, bufs, mixer->buffers.buf_count * 2 + mixer->buffers.fx_buf_count * 2);
+    int i, bufcount = 0, hasValidData = 0;
+    fluid_real_t *local_buf;
+
+    for(i = 0; i < mixer->thread_count; i++)
+    {
+        if(fluid_atomic_int_compare_and_exchange(&mixer->threads[i].ready,
+                THREAD_BUF_QUEUED, THREAD_BUF_PROCESSING))
+        {
+            buffers = &mixer->threads[i];
+            break;
+        }
+    }
+
+    if(buffers == NULL)
+    {
+        return;
+    }
+
+    local_buf = fluid_align_ptr(buffers->local_buf, FLUID_DEFAULT_ALIGNMENT);
+
+    while((rvoice = fluid_mixer_get_mt_rvoice(mixer)) != NULL)
+    {
+        if(!hasValidData)
+        {
+            fluid_mixer_buffers_zero(buffers, mixer->current_blockcount);
+            bufcount = fluid_mixer_buffers_prepare(buffers, bufs);
+            hasValidData = 1;
+        }
+
+        fluid_mixer_buffers_render_one(buffers, rvoice, bufs, bufcount, local_buf, mixer->current_blockcount);
+    }
+
+    fluid_atomic_int_set(&buffers->ready, hasValidData ? THREAD_BUF_VALID : THREAD_BUF_NODATA);
+    fluid_cond_mutex_lock(mixer->thread_ready_m);
+    fluid_cond_signal(mixer->thread_ready);
+    fluid_cond_mutex_unlock(mixer->thread_ready_m);
+}
+
 static void
 fluid_mixer_buffers_mix(fluid_mixer_buffers_t *dst, fluid_mixer_buffers_t *src, int current_blockcount)
 {
     int i, j;
     int scount = current_blockcount * FLUID_BUFSIZE;
+    const int buf_size = dst->mixer->buf_blocks * FLUID_BUFSIZE;
     int minbuf;
     fluid_real_t *FLUID_RESTRICT base_src;
     fluid_real_t *FLUID_RESTRICT base_dst;
@@ -1072,7 +1375,7 @@ fluid_mixer_buffers_mix(fluid_mixer_buffers_t *dst, fluid_mixer_buffers_t *src,
 
         for(j = 0; j < scount; j++)
         {
-            int dsp_i = i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + j;
+            int dsp_i = i * buf_size + j;
             base_dst[dsp_i] += base_src[dsp_i];
         }
     }
@@ -1086,7 +1389,7 @@ fluid_mixer_buffers_mix(fluid_mixer_buffers_t *dst, fluid_mixer_buffers_t *src,
 
         for(j = 0; j < scount; j++)
         {
-            int dsp_i = i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + j;
+            int dsp_i = i * buf_size + j;
             base_dst[dsp_i] += base_src[dsp_i];
         }
     }
@@ -1107,7 +1410,7 @@ fluid_mixer_buffers_mix(fluid_mixer_buffers_t *dst, fluid_mixer_buffers_t *src,
 
         for(j = 0; j < scount; j++)
         {
-            int dsp_i = i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + j;
+            int dsp_i = i * buf_size + j;
             base_dst[dsp_i] += base_src[dsp_i];
         }
     }
@@ -1121,7 +1424,7 @@ fluid_mixer_buffers_mix(fluid_mixer_buffers_t *dst, fluid_mixer_buffers_t *src,
 
         for(j = 0; j < scount; j++)
         {
-            int dsp_i = i * FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE + j;
+            int dsp_i = i * buf_size + j;
             base_dst[dsp_i] += base_src[dsp_i];
         }
     }
@@ -1148,6 +1451,7 @@ fluid_mixer_mix_in(fluid_rvoice_mixer_t *mixer, int extra_threads, int current_b
             switch(j)
             {
             case THREAD_BUF_PROCESSING:
+            case THREAD_BUF_QUEUED:
                 result = 1;
                 break;
 
@@ -1190,17 +1494,34 @@ fluid_render_loop_multithread(fluid_rvoice_mixer_t *mixer, int current_blockcoun
     bufcount = fluid_mixer_buffers_prepare(&mixer->buffers, bufs);
 
     // Prepare voice list
-    fluid_cond_mutex_lock(mixer->wakeup_threads_m);
     fluid_atomic_int_set(&mixer->current_rvoice, 0);
 
-    for(i = 0; i < extra_threads; i++)
+    if(mixer->render_pool != NULL)
     {
-        fluid_atomic_int_set(&mixer->threads[i].ready, THREAD_BUF_PROCESSING);
+        // Offer the buffers to the pool threads, due by the end of this period
+        for(i = 0; i < extra_threads; i++)
+        {
+            fluid_atomic_int_set(&mixer->threads[i].ready, THREAD_BUF_QUEUED);
+        }
+
+        mixer->render_job.helpers = extra_threads;
+        mixer->render_job.deadline = fluid_utime()
+                                     + current_blockcount * FLUID_BUFSIZE * 1000000.0 / mixer->sample_rate;
+        fluid_render_pool_submit(mixer->render_pool, &mixer->render_job);
     }
+    else
+    {
+        fluid_cond_mutex_lock(mixer->wakeup_threads_m);
 
-    // Signal threads to wake up
-    fluid_cond_broadcast(mixer->wakeup_threads);
-    fluid_cond_mutex_unlock(mixer->wakeup_threads_m);
+        for(i = 0; i < extra_threads; i++)
+        {
+            fluid_atomic_int_set(&mixer->threads[i].ready, THREAD_BUF_PROCESSING);
+        }
+
+        // Signal threads to wake up
+        fluid_cond_broadcast(mixer->wakeup_threads);
+        fluid_cond_mutex_unlock(mixer->wakeup_threads_m);
+    }
 
     // If thread is finished, mix it in
     while(fluid_mixer_mix_in(mixer, extra_threads, current_blockcount))
@@ -1220,6 +1541,14 @@ fluid_render_loop_multithread(fluid_rvoice_mixer_t *mixer, int current_blockcoun
         {
             // If no voices, wait for mixes. Make sure one is still processing to avoid deadlock
             int is_processing = 0;
+
+            // All voices have been taken, buffers no pool thread picked up stay empty
+            for(i = 0; i < extra_threads; i++)
+            {
+                fluid_atomic_int_compare_and_exchange(&mixer->threads[i].ready,
+                                                      THREAD_BUF_QUEUED, THREAD_BUF_NODATA);
+            }
+
             //waits++;
             fluid_cond_mutex_lock(mixer->thread_ready_m);
 
@@ -1241,6 +1570,11 @@ fluid_render_loop_multithread(fluid_rvoice_mixer_t *mixer, int current_blockcoun
         }
     }
 
+    if(mixer->render_pool != NULL)
+    {
+        fluid_render_pool_withdraw(mixer->render_pool, &mixer->render_job);
+    }
+
     //FLUID_LOG(FLUID_DBG, "Blockcount: %d, mixed %d of %d voices myself, waits = %d",
     //	    current_blockcount, test, mixer->active_voices, waits);
 }
@@ -1274,14 +1608,23 @@ static void delete_rvoice_mixer_threads(fluid_rvoice_mixer_t *mixer)
     FLUID_FREE(mixer->threads);
     mixer->thread_count = 0;
     mixer->threads = NULL;
+
+    if(mixer->render_pool != NULL)
+    {
+        fluid_render_pool_release(mixer->render_pool);
+        mixer->render_pool = NULL;
+    }
 }
 
 /**
  * Update amount of extra mixer threads.
  * @param thread_count Number of extra mixer threads for multi-core rendering
  * @param prio_level real-time prio level for the extra mixer threads
+ * @param render_pool TRUE to have the process-wide render pool render into the
+ *   buffers of the extra threads, rather than starting threads of our own
  */
-static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int thread_count, int prio_level)
+static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int thread_count, int prio_level,
+                                          int render_pool)
 {
     char name[16];
     int i;
@@ -1310,6 +1653,19 @@ static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int threa
     FLUID_MEMSET(mixer->threads, 0, thread_count * sizeof(fluid_mixer_buffers_t));
     mixer->thread_count = thread_count;
 
+    if(render_pool)
+    {
+        mixer->render_pool = fluid_render_pool_acquire(thread_count, prio_level);
+
+        if(mixer->render_pool == NULL)
+        {
+            return FLUID_FAILED;
+        }
+
+        mixer->render_job.func = fluid_mixer_render_pool_help;
+        mixer->render_job.data = mixer;
+    }
+
     for(i = 0; i < thread_count; i++)
     {
         fluid_mixer_buffers_t *b = &mixer->threads[i];
@@ -1320,6 +1676,12 @@ static int fluid_rvoice_mixer_set_threads(fluid_rvoice_mixer_t *mixer, int threa
         }
 
         fluid_atomic_int_set(&b->ready, THREAD_BUF_NODATA);
+
+        if(mixer->render_pool != NULL)
+        {
+            continue;
+        }
+
         FLUID_SNPRINTF(name, sizeof(name), "mixer%d", i);
         b->thread = new_fluid_thread(name, fluid_mixer_thread_func, b, prio_level, 0);
 
@@ -38,7 +38,8 @@ int fluid_rvoice_mixer_get_bufcount(fluid_rvoice_mixer_t *mixer);
 int fluid_rvoice_mixer_get_active_voices(fluid_rvoice_mixer_t *mixer);
 #endif
 fluid_rvoice_mixer_t *new_fluid_rvoice_mixer(int buf_count, int fx_buf_count, int fx_units,
-        fluid_real_t sample_rate, fluid_rvoice_eventhandler_t *, int, int);
+        int buf_blocks, int lazy_fx, int reverb_engine, fluid_real_t sample_rate,
+        fluid_rvoice_eventhandler_t *, int, int, int, int);
 
 void delete_fluid_rvoice_mixer(fluid_rvoice_mixer_t *);
 
@@ -46,6 +47,7 @@ void delete_fluid_rvoice_mixer(fluid_rvoice_mixer_t *);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_add_voice);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_samplerate);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_polyphony);
+DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_alloc_fx);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_chorus_enabled);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_reverb_enabled);
 DECLARE_FLUID_RVOICE_FUNCTION(fluid_rvoice_mixer_set_chorus_params);
@@ -27,20 +27,68 @@
 #include "fluid_sys.h"
 #include "fluid_synth.h"
 #include "fluid_samplecache.h"
+#include "fluid_sfindex.h"
 
 /* EMU8k/10k hardware applies this factor to initial attenuation generator values set at preset and
  * instrument level in a soundfont. We apply this factor when loading the generator values to stay
  * compatible as most existing soundfonts expect exactly this (strange, non-standard) behaviour. */
 #define EMU_ATTENUATION_FACTOR (0.4f)
 
+/* Size of the memory blocks the metadata of a soundfont is allocated from */
+#define FLUID_DEFSFONT_ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Loops shorter than this are repeated after loading, so that playing them up to
+ * 8 times faster than recorded wraps around the loop at most once per block */
+#define SHORT_LOOP_MIN_LENGTH (8 * FLUID_BUFSIZE)
+
+/* The 7th order interpolation looks 3 points behind the loop end, shorter loops are
+ * left alone so that the expansion doesn't change what it reads there */
+#define SHORT_LOOP_MIN_SIZE 4
+
+/* Protects the statistics of the expanded loops, see fluid_get_sample_loop_expansion_stats() */
+static fluid_mutex_t loop_expansion_mutex = FLUID_MUTEX_INIT;
+static unsigned int loop_expansion_samples = 0;
+static size_t loop_expansion_bytes = 0;
+
 /* Dynamic sample loading functions */
-static int load_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset);
-static int unload_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset);
-static void unload_sample(fluid_sample_t *sample);
+static fluid_list_t *claim_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset);
+static int load_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset, fluid_list_t *load);
+static fluid_list_t *unclaim_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset,
+        fluid_list_t *unload);
+static fluid_list_t *sweep_orphaned_samples(fluid_defsfont_t *defsfont, fluid_list_t *unload);
+static fluid_list_t *detach_sample_data(fluid_sample_t *sample, fluid_list_t *unload);
+static void unload_sample_data(fluid_list_t *unload);
 static int dynamic_samples_preset_notify(fluid_preset_t *preset, int reason, int chan);
 static int dynamic_samples_sample_notify(fluid_sample_t *sample, int reason);
-static int fluid_preset_zone_create_voice_zones(fluid_preset_zone_t *preset_zone);
+static void acquire_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset);
+static void release_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset);
+static void evict_retained_presets(fluid_defsfont_t *defsfont);
+static fluid_thread_return_t evict_thread_func(void *data);
 static fluid_inst_t *find_inst_by_idx(fluid_defsfont_t *defsfont, int idx);
+static int compress_all_sampledata(fluid_defsfont_t *defsfont, int sf3_file);
+static int expand_short_loops(fluid_defsfont_t *defsfont);
+static int release_defsfont(fluid_defsfont_t *defsfont, fluid_sfont_t *sfont);
+
+/* Shared SoundFont functions */
+static const char *shared_sfont_get_name(fluid_sfont_t *sfont);
+static fluid_preset_t *shared_sfont_get_preset(fluid_sfont_t *sfont, int bank, int prenum);
+static void shared_sfont_iteration_start(fluid_sfont_t *sfont);
+static fluid_preset_t *shared_sfont_iteration_next(fluid_sfont_t *sfont);
+static int shared_sfont_delete(fluid_sfont_t *sfont);
+
+/* Protects the reference counts of defsfonts shared by several sfonts */
+static fluid_mutex_t shared_sfont_mutex = FLUID_MUTEX_INIT;
+
+/* A SoundFont shared with another synth by fluid_defsfont_share(). It refers to the
+ * defsfont of the originally loaded SoundFont and only owns presets, because presets
+ * refer to their parent sfont. */
+typedef struct
+{
+    fluid_defsfont_t *defsfont;
+    fluid_preset_t **preset;    /* one for each preset of defsfont, in the same order */
+    int preset_count;
+    int iter_cur;               /* index of the next preset of the iteration */
+} fluid_shared_sfont_t;
 
 
 /***************************************************************
@@ -120,11 +168,204 @@ fluid_sfont_t *fluid_defsfloader_load(fluid_sfloader_t *loader, const char *file
 
 int fluid_defsfont_sfont_delete(fluid_sfont_t *sfont)
 {
-    if(delete_fluid_defsfont(fluid_sfont_get_data(sfont)) != FLUID_OK)
+    if(release_defsfont(fluid_sfont_get_data(sfont), sfont) != FLUID_OK)
+    {
+        return -1;
+    }
+
+    delete_fluid_sfont(sfont);
+    return 0;
+}
+
+/*
+ * Whether the sample data of a SoundFont loaded by the default loader (or shared
+ * from one) is kept compressed, which voices can only play with a decode cache.
+ */
+int fluid_defsfont_is_compressed(fluid_sfont_t *sfont)
+{
+    fluid_return_val_if_fail(sfont != NULL, FALSE);
+
+    if(sfont->free == fluid_defsfont_sfont_delete)
+    {
+        return ((fluid_defsfont_t *)fluid_sfont_get_data(sfont))->compress_samples;
+    }
+
+    if(sfont->free == shared_sfont_delete)
+    {
+        return ((fluid_shared_sfont_t *)fluid_sfont_get_data(sfont))->defsfont->compress_samples;
+    }
+
+    return FALSE;
+}
+
+/*
+ * Create a new sfont that shares the presets, instruments and sample data of a
+ * SoundFont loaded by the default loader, to be used by another synth. The shared
+ * data is immutable after loading, which is why SoundFonts using dynamic sample
+ * loading can't be shared. Returns NULL on error.
+ */
+fluid_sfont_t *fluid_defsfont_share(fluid_sfont_t *sfont)
+{
+    fluid_defsfont_t *defsfont;
+    fluid_shared_sfont_t *share;
+    fluid_sfont_t *shared = NULL;
+    fluid_preset_t *preset;
+    fluid_list_t *list;
+    int i = 0;
+
+    fluid_return_val_if_fail(sfont != NULL, NULL);
+
+    if(sfont->free == fluid_defsfont_sfont_delete)
+    {
+        defsfont = fluid_sfont_get_data(sfont);
+    }
+    else if(sfont->free == shared_sfont_delete)
+    {
+        defsfont = ((fluid_shared_sfont_t *)fluid_sfont_get_data(sfont))->defsfont;
+    }
+    else
+    {
+        FLUID_LOG(FLUID_ERR, "Only SoundFonts loaded by the default SoundFont loader can be shared");
+        return NULL;
+    }
+
+    if(defsfont->dynamic_samples)
+    {
+        FLUID_LOG(FLUID_ERR, "SoundFonts using dynamic sample loading can't be shared");
+        return NULL;
+    }
+
+    share = FLUID_NEW(fluid_shared_sfont_t);
+
+    if(share == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_MEMSET(share, 0, sizeof(*share));
+    share->defsfont = defsfont;
+    share->preset_count = fluid_list_size(defsfont->preset);
+    share->preset = FLUID_ARRAY(fluid_preset_t *, share->preset_count + 1);
+
+    if(share->preset == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_recovery;
+    }
+
+    shared = new_fluid_sfont(shared_sfont_get_name,
+                             shared_sfont_get_preset,
+                             shared_sfont_iteration_start,
+                             shared_sfont_iteration_next,
+                             shared_sfont_delete);
+
+    if(shared == NULL)
+    {
+        goto error_recovery;
+    }
+
+    fluid_sfont_set_data(shared, share);
+
+    for(list = defsfont->preset; list; list = fluid_list_next(list), i++)
+    {
+        preset = new_fluid_preset(shared,
+                                  fluid_defpreset_preset_get_name,
+                                  fluid_defpreset_preset_get_banknum,
+                                  fluid_defpreset_preset_get_num,
+                                  fluid_defpreset_preset_noteon,
+                                  delete_fluid_preset);
+
+        if(preset == NULL)
+        {
+            goto error_recovery;
+        }
+
+        fluid_preset_set_data(preset, fluid_preset_get_data(fluid_list_get(list)));
+        share->preset[i] = preset;
+    }
+
+    fluid_mutex_lock(shared_sfont_mutex);
+    defsfont->refcount++;
+    fluid_mutex_unlock(shared_sfont_mutex);
+
+    return shared;
+
+error_recovery:
+
+    while(--i >= 0)
+    {
+        delete_fluid_preset(share->preset[i]);
+    }
+
+    FLUID_FREE(share->preset);
+    FLUID_FREE(share);
+    delete_fluid_sfont(shared);
+    return NULL;
+}
+
+static const char *shared_sfont_get_name(fluid_sfont_t *sfont)
+{
+    fluid_shared_sfont_t *share = fluid_sfont_get_data(sfont);
+
+    return fluid_defsfont_get_name(share->defsfont);
+}
+
+static fluid_preset_t *shared_sfont_get_preset(fluid_sfont_t *sfont, int bank, int prenum)
+{
+    fluid_shared_sfont_t *share = fluid_sfont_get_data(sfont);
+    fluid_preset_t *preset;
+    int i;
+
+    for(i = 0; i < share->preset_count; i++)
+    {
+        preset = share->preset[i];
+
+        if((fluid_preset_get_banknum(preset) == bank) && (fluid_preset_get_num(preset) == prenum))
+        {
+            return preset;
+        }
+    }
+
+    return NULL;
+}
+
+static void shared_sfont_iteration_start(fluid_sfont_t *sfont)
+{
+    fluid_shared_sfont_t *share = fluid_sfont_get_data(sfont);
+
+    share->iter_cur = 0;
+}
+
+static fluid_preset_t *shared_sfont_iteration_next(fluid_sfont_t *sfont)
+{
+    fluid_shared_sfont_t *share = fluid_sfont_get_data(sfont);
+
+    if(share->iter_cur >= share->preset_count)
+    {
+        return NULL;
+    }
+
+    return share->preset[share->iter_cur++];
+}
+
+static int shared_sfont_delete(fluid_sfont_t *sfont)
+{
+    fluid_shared_sfont_t *share = fluid_sfont_get_data(sfont);
+    int i;
+
+    if(release_defsfont(share->defsfont, sfont) != FLUID_OK)
     {
         return -1;
     }
 
+    for(i = 0; i < share->preset_count; i++)
+    {
+        delete_fluid_preset(share->preset[i]);
+    }
+
+    FLUID_FREE(share->preset);
+    FLUID_FREE(share);
     delete_fluid_sfont(sfont);
     return 0;
 }
@@ -158,12 +399,13 @@ void fluid_defpreset_preset_delete(fluid_preset_t *preset)
     defsfont = fluid_sfont_get_data(preset->sfont);
     defpreset = fluid_preset_get_data(preset);
 
+    /* the preset data itself is released with the arena of the soundfont */
     if(defsfont)
     {
         defsfont->preset = fluid_list_remove(defsfont->preset, defpreset);
+        defsfont->preset_last = fluid_list_last(defsfont->preset);
     }
 
-    delete_fluid_defpreset(defpreset);
     delete_fluid_preset(preset);
 }
 
@@ -200,6 +442,7 @@ int fluid_defpreset_preset_noteon(fluid_preset_t *preset, fluid_synth_t *synth,
 fluid_defsfont_t *new_fluid_defsfont(fluid_settings_t *settings)
 {
     fluid_defsfont_t *defsfont;
+    int retention;
 
     defsfont = FLUID_NEW(fluid_defsfont_t);
 
@@ -210,9 +453,53 @@ fluid_defsfont_t *new_fluid_defsfont(fluid_settings_t *settings)
     }
 
     FLUID_MEMSET(defsfont, 0, sizeof(*defsfont));
+    defsfont->refcount = 1;
+
+    defsfont->arena = new_fluid_arena(FLUID_DEFSFONT_ARENA_BLOCK_SIZE);
+
+    if(defsfont->arena == NULL)
+    {
+        FLUID_FREE(defsfont);
+        return NULL;
+    }
+
+    fluid_mutex_init(defsfont->load_mutex);
+    fluid_mutex_init(defsfont->dynamic_mutex);
 
     fluid_settings_getint(settings, "synth.lock-memory", &defsfont->mlock);
+    fluid_settings_getint(settings, "synth.huge-pages", &defsfont->huge_pages);
     fluid_settings_getint(settings, "synth.dynamic-sample-loading", &defsfont->dynamic_samples);
+    fluid_settings_getint(settings, "synth.soundfont-index", &defsfont->use_index);
+    defsfont->compress_samples = fluid_settings_str_equal(settings, "synth.sample-storage", "compressed");
+
+    if(defsfont->compress_samples && defsfont->dynamic_samples)
+    {
+        FLUID_LOG(FLUID_WARN, "Compressed sample storage is not supported with dynamic sample loading, "
+                  "keeping sample data uncompressed");
+        defsfont->compress_samples = FALSE;
+    }
+
+    fluid_samplecache_apply_settings(settings);
+
+    if(defsfont->dynamic_samples)
+    {
+        if(fluid_settings_getint(settings, "synth.dynamic-sample-retention", &retention) == FLUID_OK
+                && retention > 0)
+        {
+            defsfont->retention_budget = (size_t)retention * 1024 * 1024;
+        }
+
+        defsfont->evict_mutex = new_fluid_cond_mutex();
+        defsfont->evict_cond = new_fluid_cond();
+        defsfont->evict_thread = new_fluid_thread("sample-evict", evict_thread_func, defsfont, 0, FALSE);
+
+        /* Without the thread, retained presets are evicted right when they exceed the budget,
+         * and orphaned samples are unloaded by the next preset notification */
+        if(defsfont->evict_thread == NULL)
+        {
+            FLUID_LOG(FLUID_WARN, "Failed to create the sample eviction thread");
+        }
+    }
 
     return defsfont;
 }
@@ -239,18 +526,71 @@ int delete_fluid_defsfont(fluid_defsfont_t *defsfont)
         }
     }
 
-    if(defsfont->filename != NULL)
+    if(defsfont->evict_thread != NULL)
     {
-        FLUID_FREE(defsfont->filename);
+        fluid_cond_mutex_lock(defsfont->evict_mutex);
+        defsfont->evict_quit = TRUE;
+        fluid_cond_signal(defsfont->evict_cond);
+        fluid_cond_mutex_unlock(defsfont->evict_mutex);
+
+        fluid_thread_join(defsfont->evict_thread);
+        delete_fluid_thread(defsfont->evict_thread);
+        defsfont->evict_thread = NULL;
     }
 
-    for(list = defsfont->sample; list; list = fluid_list_next(list))
+    delete_fluid_cond(defsfont->evict_cond);
+    delete_fluid_cond_mutex(defsfont->evict_mutex);
+
+    /* Release the sample data still held by retained or selected presets, or orphaned
+     * by presets released while their samples were playing */
+    if(defsfont->dynamic_samples)
+    {
+        fluid_list_t *unload = NULL;
+
+        for(list = defsfont->preset; list; list = fluid_list_next(list))
+        {
+            preset = (fluid_preset_t *)fluid_list_get(list);
+
+            if(((fluid_defpreset_t *)fluid_preset_get_data(preset))->loaded)
+            {
+                unload = unclaim_preset_samples(defsfont, preset, unload);
+            }
+        }
+
+        unload = sweep_orphaned_samples(defsfont, unload);
+        unload_sample_data(unload);
+
+        delete_fluid_list(defsfont->retained);
+        delete_fluid_list(defsfont->orphans);
+    }
+
+    fluid_mutex_destroy(defsfont->dynamic_mutex);
+    fluid_mutex_destroy(defsfont->load_mutex);
+
+    if(defsfont->filename != NULL)
     {
-        delete_fluid_sample((fluid_sample_t *) fluid_list_get(list));
+        FLUID_FREE(defsfont->filename);
     }
 
     if(defsfont->sample)
     {
+        for(list = defsfont->sample; list; list = fluid_list_next(list))
+        {
+            sample = (fluid_sample_t *) fluid_list_get(list);
+            delete_fluid_compressed_sample(sample->compressed);
+
+            if(sample->loop_data != NULL)
+            {
+                fluid_mutex_lock(loop_expansion_mutex);
+                loop_expansion_samples--;
+                loop_expansion_bytes -= sample->loop_data_size;
+                fluid_mutex_unlock(loop_expansion_mutex);
+            }
+
+            FLUID_FREE(sample->loop_data);
+            FLUID_FREE(sample->loop_data24);
+        }
+
         delete_fluid_list(defsfont->sample);
     }
 
@@ -262,20 +602,47 @@ int delete_fluid_defsfont(fluid_defsfont_t *defsfont)
     for(list = defsfont->preset; list; list = fluid_list_next(list))
     {
         preset = (fluid_preset_t *)fluid_list_get(list);
-        fluid_defpreset_preset_delete(preset);
+        delete_fluid_preset(preset);
     }
 
     delete_fluid_list(defsfont->preset);
 
-    for(list = defsfont->inst; list; list = fluid_list_next(list))
+    /* samples, presets, instruments and their zones all live in the arena */
+    delete_fluid_arena(defsfont->arena);
+
+    FLUID_FREE(defsfont);
+    return FLUID_OK;
+}
+
+/* Drop the reference of sfont to defsfont and delete it if it was the last one.
+ * Returns FLUID_FAILED if defsfont can't be deleted yet because its samples are
+ * still in use, the reference is kept then. */
+static int release_defsfont(fluid_defsfont_t *defsfont, fluid_sfont_t *sfont)
+{
+    int shared;
+
+    fluid_mutex_lock(shared_sfont_mutex);
+    shared = (defsfont->refcount > 1);
+
+    if(shared)
     {
-        delete_fluid_inst(fluid_list_get(list));
+        defsfont->refcount--;
+
+        /* the presets of the original sfont stay with the defsfont, unused */
+        if(defsfont->sfont == sfont)
+        {
+            defsfont->sfont = NULL;
+        }
     }
 
-    delete_fluid_list(defsfont->inst);
+    fluid_mutex_unlock(shared_sfont_mutex);
 
-    FLUID_FREE(defsfont);
-    return FLUID_OK;
+    if(shared)
+    {
+        return FLUID_OK;
+    }
+
+    return delete_fluid_defsfont(defsfont);
 }
 
 /*
@@ -383,6 +750,13 @@ int fluid_defsfont_load_all_sampledata(fluid_defsfont_t *defsfont, SFData *sfdat
             }
 
             fluid_sample_sanitize_loop(sample, (sample->end + 1) * sizeof(short));
+
+            /* source_end is the byte offset of the compressed data within the sample chunk */
+            if(fluid_sfloader_progress(sample->source_end, sfdata->samplesize) == FLUID_FAILED)
+            {
+                FLUID_LOG(FLUID_DBG, "Sample data loading cancelled");
+                return FLUID_FAILED;
+            }
         }
         else
         {
@@ -395,99 +769,344 @@ int fluid_defsfont_load_all_sampledata(fluid_defsfont_t *defsfont, SFData *sfdat
         fluid_voice_optimize_sample(sample);
     }
 
-    return FLUID_OK;
-}
-
-/*
- * fluid_defsfont_load
- */
-int fluid_defsfont_load(fluid_defsfont_t *defsfont, const fluid_file_callbacks_t *fcbs, const char *file)
-{
-    SFData *sfdata;
-    fluid_list_t *p;
-    SFPreset *sfpreset;
-    SFSample *sfsample;
-    fluid_sample_t *sample;
-    fluid_defpreset_t *defpreset = NULL;
-
-    defsfont->filename = FLUID_STRDUP(file);
-
-    if(defsfont->filename == NULL)
+    if(defsfont->compress_samples)
     {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        return FLUID_FAILED;
+        return compress_all_sampledata(defsfont, sf3_file);
     }
 
-    defsfont->fcbs = fcbs;
+    return expand_short_loops(defsfont);
+}
 
-    /* The actual loading is done in the sfont and sffile files */
-    sfdata = fluid_sffile_open(file, fcbs);
+/* Rebase a sample pointer to a sample data buffer starting at start */
+static unsigned int rebase_sample_pointer(unsigned int pointer, unsigned int start)
+{
+    return (pointer >= start) ? pointer - start : 0;
+}
 
-    if(sfdata == NULL)
-    {
-        FLUID_LOG(FLUID_ERR, "Couldn't load soundfont file");
-        return FLUID_FAILED;
-    }
+/* Replace the loaded sample data of all samples by compressed copies and release the
+ * uncompressed data. It is discarded from the sample cache rather than kept for reuse,
+ * so it doesn't take up the cache budget. Samples with 24-bit data are kept uncompressed.
+ * Returns FLUID_OK on success, otherwise FLUID_FAILED
+ */
+static int compress_all_sampledata(fluid_defsfont_t *defsfont, int sf3_file)
+{
+    fluid_list_t *list;
+    fluid_sample_t *sample;
 
-    if(fluid_sffile_parse_presets(sfdata) == FLUID_FAILED)
+    if(defsfont->sample24data != NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Couldn't parse presets from soundfont file");
-        goto err_exit;
+        FLUID_LOG(FLUID_INFO, "SoundFont has 24-bit sample data, keeping it uncompressed");
+        return FLUID_OK;
     }
 
-    /* Keep track of the position and size of the sample data because
-       it's loaded separately (and might be unoaded/reloaded in future) */
-    defsfont->samplepos = sfdata->samplepos;
-    defsfont->samplesize = sfdata->samplesize;
-    defsfont->sample24pos = sfdata->sample24pos;
-    defsfont->sample24size = sfdata->sample24size;
-
-    /* Create all samples from sample headers */
-    p = sfdata->sample;
-
-    while(p != NULL)
+    for(list = defsfont->sample; list; list = fluid_list_next(list))
     {
-        sfsample = (SFSample *)fluid_list_get(p);
-
-        sample = new_fluid_sample();
+        sample = fluid_list_get(list);
 
-        if(sample == NULL)
+        if(sample->data == NULL)
         {
-            goto err_exit;
+            continue;
         }
 
-        if(fluid_sample_import_sfont(sample, sfsample, defsfont) == FLUID_OK)
+        sample->compressed = new_fluid_compressed_sample(&sample->data[sample->start],
+                             sample->end - sample->start + 1);
+
+        if(sample->compressed == NULL)
         {
-            fluid_defsfont_add_sample(defsfont, sample);
+            return FLUID_FAILED;
         }
-        else
+
+        /* SF3 samples have their own buffers, SF2 samples share the one released below */
+        if(sf3_file)
         {
-            delete_fluid_sample(sample);
-            sample = NULL;
+            fluid_samplecache_discard(sample->data);
         }
 
-        /* Store reference to FluidSynth sample in SFSample for later IZone fixups */
-        sfsample->fluid_sample = sample;
-
-        p = fluid_list_next(p);
+        sample->data = NULL;
+        sample->loopstart = rebase_sample_pointer(sample->loopstart, sample->start);
+        sample->loopend = rebase_sample_pointer(sample->loopend, sample->start);
+        sample->end -= sample->start;
+        sample->start = 0;
     }
 
-    /* If dynamic sample loading is disabled, load all samples in the Soundfont */
-    if(!defsfont->dynamic_samples)
+    if(defsfont->sampledata != NULL)
     {
-        if(fluid_defsfont_load_all_sampledata(defsfont, sfdata) == FLUID_FAILED)
-        {
-            FLUID_LOG(FLUID_ERR, "Unable to load all sample data");
-            goto err_exit;
-        }
+        fluid_samplecache_discard(defsfont->sampledata);
+        defsfont->sampledata = NULL;
     }
 
-    /* Load all the presets */
-    p = sfdata->preset;
+    return FLUID_OK;
+}
 
-    while(p != NULL)
+/* Make a copy of the loop of a sample with a short loop, in which the loop is repeated
+ * until it is at least SHORT_LOOP_MIN_LENGTH sample points long. Voices looping over it
+ * wrap around at most once per block then, instead of many times. Voices only switch
+ * to the copy after they have looped once, from then on the interpolation reads no
+ * points before the loop start, so only the loop itself is copied.
+ * Returns the number of bytes allocated for the copy, 0 if the loop is not expanded
+ * or -1 on error.
+ */
+static int expand_short_loop(fluid_sample_t *sample)
+{
+    unsigned int loop_length = sample->loopend - sample->loopstart;
+    unsigned int expansion, length, i;
+    short *loop_data;
+    char *loop_data24 = NULL;
+
+    if(sample->data == NULL
+            || (sample->sampletype & FLUID_SAMPLETYPE_ROM)
+            || sample->loopstart < sample->start
+            || sample->loopend > sample->end
+            || loop_length < SHORT_LOOP_MIN_SIZE
+            || loop_length >= SHORT_LOOP_MIN_LENGTH)
+    {
+        return 0;
+    }
+
+    /* repeat the loop as often as needed to reach the minimum length */
+    expansion = ((SHORT_LOOP_MIN_LENGTH + loop_length - 1) / loop_length - 1) * loop_length;
+
+    length = loop_length + expansion;
+
+    loop_data = FLUID_ARRAY(short, length);
+
+    if(loop_data == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return -1;
+    }
+
+    for(i = 0; i < length; i += loop_length)
+    {
+        FLUID_MEMCPY(&loop_data[i], &sample->data[sample->loopstart], loop_length * sizeof(short));
+    }
+
+    if(sample->data24 != NULL)
+    {
+        loop_data24 = FLUID_ARRAY(char, length);
+
+        if(loop_data24 == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            FLUID_FREE(loop_data);
+            return -1;
+        }
+
+        for(i = 0; i < length; i += loop_length)
+        {
+            FLUID_MEMCPY(&loop_data24[i], &sample->data24[sample->loopstart], loop_length);
+        }
+    }
+
+    sample->loop_data = loop_data;
+    sample->loop_data24 = loop_data24;
+    sample->loop_expansion = expansion;
+    sample->loop_data_size = length * (sizeof(short) + (loop_data24 != NULL ? sizeof(char) : 0));
+
+    fluid_mutex_lock(loop_expansion_mutex);
+    loop_expansion_samples++;
+    loop_expansion_bytes += sample->loop_data_size;
+    fluid_mutex_unlock(loop_expansion_mutex);
+
+    FLUID_LOG(FLUID_DBG, "Expanded the loop of sample '%s' from %u to %u points using %u bytes",
+              sample->name, loop_length, loop_length + expansion, (unsigned int)sample->loop_data_size);
+
+    return (int)sample->loop_data_size;
+}
+
+/* Expand the short loops of all samples, see expand_short_loop().
+ * Returns FLUID_OK on success, otherwise FLUID_FAILED
+ */
+static int expand_short_loops(fluid_defsfont_t *defsfont)
+{
+    fluid_list_t *list;
+    int count = 0, bytes;
+    size_t total = 0;
+
+    for(list = defsfont->sample; list; list = fluid_list_next(list))
+    {
+        bytes = expand_short_loop(fluid_list_get(list));
+
+        if(bytes < 0)
+        {
+            return FLUID_FAILED;
+        }
+
+        if(bytes > 0)
+        {
+            count++;
+            total += bytes;
+        }
+    }
+
+    if(count > 0)
+    {
+        FLUID_LOG(FLUID_DBG, "Expanded the loops of %d samples using %u bytes", count, (unsigned int)total);
+    }
+
+    return FLUID_OK;
+}
+
+/**
+ * Get the memory taken by the expanded copies of short sample loops.
+ *
+ * Samples of SoundFonts loaded by the default SoundFont loader, whose loops are shorter
+ * than a few blocks, get a copy of their loop in which it is repeated, so that playing
+ * them wraps around less often. The numbers cover all currently loaded SoundFonts of the
+ * process, \c bytes / \c samples is the average overhead per expanded sample.
+ *
+ * @param samples Location to store the number of samples with an expanded loop (can be NULL)
+ * @param bytes Location to store the number of bytes allocated for their copies (can be NULL)
+ * @return #FLUID_OK
+ * @since 2.1.0
+ */
+int fluid_get_sample_loop_expansion_stats(unsigned int *samples, size_t *bytes)
+{
+    fluid_mutex_lock(loop_expansion_mutex);
+
+    if(samples != NULL)
+    {
+        *samples = loop_expansion_samples;
+    }
+
+    if(bytes != NULL)
+    {
+        *bytes = loop_expansion_bytes;
+    }
+
+    fluid_mutex_unlock(loop_expansion_mutex);
+    return FLUID_OK;
+}
+
+/*
+ * fluid_defsfont_load
+ */
+int fluid_defsfont_load(fluid_defsfont_t *defsfont, const fluid_file_callbacks_t *fcbs, const char *file)
+{
+    SFData *sfdata;
+    SFPreset *sfpreset;
+    SFSample *sfsample;
+    fluid_sample_t *sample;
+    fluid_defpreset_t *defpreset;
+    fluid_sfindex_t *sfindex = NULL;
+    int i;
+
+    defsfont->filename = FLUID_STRDUP(file);
+
+    if(defsfont->filename == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return FLUID_FAILED;
+    }
+
+    defsfont->fcbs = fcbs;
+
+    /* The actual loading is done in the sfont and sffile files */
+    sfdata = fluid_sffile_open(file, fcbs);
+
+    if(sfdata == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Couldn't load soundfont file");
+        return FLUID_FAILED;
+    }
+
+    sfdata->huge_pages = defsfont->huge_pages;
+
+    /* An up-to-date compiled index makes parsing the presets unnecessary */
+    if(defsfont->use_index)
+    {
+        sfindex = fluid_sfindex_open(file, sfdata);
+    }
+
+    if(sfindex == NULL && fluid_sffile_parse_presets(sfdata) == FLUID_FAILED)
+    {
+        FLUID_LOG(FLUID_ERR, "Couldn't parse presets from soundfont file");
+        goto err_exit;
+    }
+
+    /* Keep track of the position and size of the sample data because
+       it's loaded separately (and might be unoaded/reloaded in future) */
+    defsfont->samplepos = sfdata->samplepos;
+    defsfont->samplesize = sfdata->samplesize;
+    defsfont->sample24pos = sfdata->sample24pos;
+    defsfont->sample24size = sfdata->sample24size;
+
+    /* Give asynchronous loads a chance to cancel before any sample data is read */
+    if(fluid_sfloader_progress(0, (fluid_long_long_t)sfdata->samplesize + sfdata->sample24size) == FLUID_FAILED)
+    {
+        goto err_exit;
+    }
+
+    if(sfindex != NULL)
+    {
+        /* Samples, instruments and presets are all restored from the index */
+        if(fluid_sfindex_import(sfindex, defsfont) == FLUID_FAILED)
+        {
+            goto err_exit;
+        }
+    }
+    else
+    {
+        /* Create all samples from sample headers */
+        for(i = 0; i < sfdata->sample_count; i++)
+        {
+            sfsample = &sfdata->sample[i];
+
+            sample = FLUID_ARENA_NEW(defsfont->arena, fluid_sample_t);
+
+            if(sample == NULL)
+            {
+                goto err_exit;
+            }
+
+            if(fluid_sample_import_sfont(sample, sfsample, defsfont) == FLUID_OK)
+            {
+                fluid_defsfont_add_sample(defsfont, sample);
+            }
+            else
+            {
+                sample = NULL;
+            }
+
+            /* Store reference to FluidSynth sample in SFSample for later IZone fixups */
+            sfsample->fluid_sample = sample;
+        }
+    }
+
+    /* If dynamic sample loading is disabled, load all samples in the Soundfont */
+    if(!defsfont->dynamic_samples)
+    {
+        if(fluid_defsfont_load_all_sampledata(defsfont, sfdata) == FLUID_FAILED)
+        {
+            FLUID_LOG(FLUID_ERR, "Unable to load all sample data");
+            goto err_exit;
+        }
+    }
+
+    if(sfindex != NULL)
+    {
+        delete_fluid_sfindex(sfindex);
+        fluid_sffile_close(sfdata);
+        return FLUID_OK;
+    }
+
+    /* Instruments are imported on first use by a preset zone */
+    if(sfdata->inst_count > 0)
+    {
+        defsfont->inst = FLUID_ARENA_ARRAY(defsfont->arena, fluid_inst_t *, sfdata->inst_count);
+
+        if(defsfont->inst == NULL)
+        {
+            goto err_exit;
+        }
+
+        defsfont->inst_count = sfdata->inst_count;
+    }
+
+    /* Load all the presets */
+    for(i = 0; i < sfdata->preset_count; i++)
     {
-        sfpreset = (SFPreset *)fluid_list_get(p);
+        sfpreset = &sfdata->preset[i];
         defpreset = new_fluid_defpreset(defsfont);
 
         if(defpreset == NULL)
@@ -504,8 +1123,12 @@ int fluid_defsfont_load(fluid_defsfont_t *defsfont, const fluid_file_callbacks_t
         {
             goto err_exit;
         }
+    }
 
-        p = fluid_list_next(p);
+    /* Compile the index for the next time this soundfont gets loaded */
+    if(defsfont->use_index)
+    {
+        fluid_sfindex_write(defsfont, sfdata);
     }
 
     fluid_sffile_close(sfdata);
@@ -513,8 +1136,8 @@ int fluid_defsfont_load(fluid_defsfont_t *defsfont, const fluid_file_callbacks_t
     return FLUID_OK;
 
 err_exit:
+    delete_fluid_sfindex(sfindex);
     fluid_sffile_close(sfdata);
-    delete_fluid_defpreset(defpreset);
     return FLUID_FAILED;
 }
 
@@ -524,7 +1147,18 @@ err_exit:
  */
 int fluid_defsfont_add_sample(fluid_defsfont_t *defsfont, fluid_sample_t *sample)
 {
-    defsfont->sample = fluid_list_append(defsfont->sample, sample);
+    /* append behind the last sample, so filling the list doesn't get quadratic */
+    if(defsfont->sample_last == NULL)
+    {
+        defsfont->sample = fluid_list_append(defsfont->sample, sample);
+        defsfont->sample_last = fluid_list_last(defsfont->sample);
+    }
+    else
+    {
+        fluid_list_append(defsfont->sample_last, sample);
+        defsfont->sample_last = fluid_list_next(defsfont->sample_last);
+    }
+
     return FLUID_OK;
 }
 
@@ -555,7 +1189,17 @@ int fluid_defsfont_add_preset(fluid_defsfont_t *defsfont, fluid_defpreset_t *def
 
     fluid_preset_set_data(preset, defpreset);
 
-    defsfont->preset = fluid_list_append(defsfont->preset, preset);
+    /* append behind the last preset, so filling the list doesn't get quadratic */
+    if(defsfont->preset_last == NULL)
+    {
+        defsfont->preset = fluid_list_append(defsfont->preset, preset);
+        defsfont->preset_last = fluid_list_last(defsfont->preset);
+    }
+    else
+    {
+        fluid_list_append(defsfont->preset_last, preset);
+        defsfont->preset_last = fluid_list_next(defsfont->preset_last);
+    }
 
     return FLUID_OK;
 }
@@ -612,11 +1256,10 @@ fluid_preset_t *fluid_defsfont_iteration_next(fluid_defsfont_t *defsfont)
 fluid_defpreset_t *
 new_fluid_defpreset(fluid_defsfont_t *defsfont)
 {
-    fluid_defpreset_t *defpreset = FLUID_NEW(fluid_defpreset_t);
+    fluid_defpreset_t *defpreset = FLUID_ARENA_NEW(defsfont->arena, fluid_defpreset_t);
 
     if(defpreset == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
         return NULL;
     }
 
@@ -627,34 +1270,10 @@ new_fluid_defpreset(fluid_defsfont_t *defsfont)
     defpreset->num = 0;
     defpreset->global_zone = NULL;
     defpreset->zone = NULL;
+    defpreset->zone_count = 0;
     return defpreset;
 }
 
-/*
- * delete_fluid_defpreset
- */
-void
-delete_fluid_defpreset(fluid_defpreset_t *defpreset)
-{
-    fluid_preset_zone_t *zone;
-
-    fluid_return_if_fail(defpreset != NULL);
-
-    delete_fluid_preset_zone(defpreset->global_zone);
-    defpreset->global_zone = NULL;
-
-    zone = defpreset->zone;
-
-    while(zone != NULL)
-    {
-        defpreset->zone = zone->next;
-        delete_fluid_preset_zone(zone);
-        zone = defpreset->zone;
-    }
-
-    FLUID_FREE(defpreset);
-}
-
 int
 fluid_defpreset_get_banknum(fluid_defpreset_t *defpreset)
 {
@@ -827,17 +1446,15 @@ fluid_defpreset_noteon(fluid_defpreset_t *defpreset, fluid_synth_t *synth, int c
     fluid_inst_t *inst;
     fluid_inst_zone_t *inst_zone, *global_inst_zone;
     fluid_voice_zone_t *voice_zone;
-    fluid_list_t *list;
     fluid_voice_t *voice;
-    int i;
+    int i, z, v;
 
     global_preset_zone = fluid_defpreset_get_global_zone(defpreset);
 
     /* run thru all the zones of this preset */
-    preset_zone = fluid_defpreset_get_zone(defpreset);
-
-    while(preset_zone != NULL)
+    for(z = 0; z < defpreset->zone_count; z++)
     {
+        preset_zone = &defpreset->zone[z];
 
         /* check if the note falls into the key and velocity range of this
            preset */
@@ -848,9 +1465,9 @@ fluid_defpreset_noteon(fluid_defpreset_t *defpreset, fluid_synth_t *synth, int c
             global_inst_zone = fluid_inst_get_global_zone(inst);
 
             /* run thru all the zones of this instrument that could start a voice */
-            for(list = preset_zone->voice_zone; list != NULL; list = fluid_list_next(list))
+            for(v = 0; v < preset_zone->voice_zone_count; v++)
             {
-                voice_zone = fluid_list_get(list);
+                voice_zone = &preset_zone->voice_zone[v];
 
                 /* check if the instrument zone is ignored and the note falls into
                    the key and velocity range of this  instrument zone.
@@ -967,23 +1584,11 @@ fluid_defpreset_noteon(fluid_defpreset_t *defpreset, fluid_synth_t *synth, int c
                 }
             }
         }
-
-        preset_zone = fluid_preset_zone_next(preset_zone);
     }
 
     return FLUID_OK;
 }
 
-/*
- * fluid_defpreset_set_global_zone
- */
-int
-fluid_defpreset_set_global_zone(fluid_defpreset_t *defpreset, fluid_preset_zone_t *zone)
-{
-    defpreset->global_zone = zone;
-    return FLUID_OK;
-}
-
 /*
  * fluid_defpreset_import_sfont
  */
@@ -992,10 +1597,9 @@ fluid_defpreset_import_sfont(fluid_defpreset_t *defpreset,
                              SFPreset *sfpreset,
                              fluid_defsfont_t *defsfont)
 {
-    fluid_list_t *p;
     SFZone *sfzone;
     fluid_preset_zone_t *zone;
-    int count;
+    int count, zone_count;
     char zone_name[256];
 
     if(FLUID_STRLEN(sfpreset->name) > 0)
@@ -1009,71 +1613,65 @@ fluid_defpreset_import_sfont(fluid_defpreset_t *defpreset,
 
     defpreset->bank = sfpreset->bank;
     defpreset->num = sfpreset->prenum;
-    p = sfpreset->zone;
-    count = 0;
 
-    while(p != NULL)
+    /* only the first zone can be a global zone, it has no instrument */
+    zone_count = sfpreset->zone_count;
+
+    if(zone_count > 0 && sfpreset->zone[0].inst == NULL)
     {
-        sfzone = (SFZone *)fluid_list_get(p);
-        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "pz:%s/%d", defpreset->name, count);
-        zone = new_fluid_preset_zone(zone_name);
+        defpreset->global_zone = FLUID_ARENA_NEW(defsfont->arena, fluid_preset_zone_t);
 
-        if(zone == NULL)
+        if(defpreset->global_zone == NULL)
         {
             return FLUID_FAILED;
         }
 
-        if(fluid_preset_zone_import_sfont(zone, sfzone, defsfont) != FLUID_OK)
+        zone_count--;
+    }
+
+    if(zone_count > 0)
+    {
+        defpreset->zone = FLUID_ARENA_ARRAY(defsfont->arena, fluid_preset_zone_t, zone_count);
+
+        if(defpreset->zone == NULL)
         {
-            delete_fluid_preset_zone(zone);
             return FLUID_FAILED;
         }
 
-        if((count == 0) && (fluid_preset_zone_get_inst(zone) == NULL))
+        defpreset->zone_count = zone_count;
+    }
+
+    for(count = 0; count < sfpreset->zone_count; count++)
+    {
+        sfzone = &sfpreset->zone[count];
+
+        /* local zones are stored last to first, the order in which noteon has always
+         * visited them */
+        if(count == 0 && defpreset->global_zone != NULL)
         {
-            fluid_defpreset_set_global_zone(defpreset, zone);
+            zone = defpreset->global_zone;
         }
-        else if(fluid_defpreset_add_zone(defpreset, zone) != FLUID_OK)
+        else
         {
-            return FLUID_FAILED;
+            zone = &defpreset->zone[sfpreset->zone_count - 1 - count];
         }
 
-        p = fluid_list_next(p);
-        count++;
-    }
+        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "pz:%s/%d", defpreset->name, count);
 
-    return FLUID_OK;
-}
+        if(fluid_preset_zone_init(zone, zone_name, defsfont) != FLUID_OK)
+        {
+            return FLUID_FAILED;
+        }
 
-/*
- * fluid_defpreset_add_zone
- */
-int
-fluid_defpreset_add_zone(fluid_defpreset_t *defpreset, fluid_preset_zone_t *zone)
-{
-    if(defpreset->zone == NULL)
-    {
-        zone->next = NULL;
-        defpreset->zone = zone;
-    }
-    else
-    {
-        zone->next = defpreset->zone;
-        defpreset->zone = zone;
+        if(fluid_preset_zone_import_sfont(zone, sfzone, defsfont) != FLUID_OK)
+        {
+            return FLUID_FAILED;
+        }
     }
 
     return FLUID_OK;
 }
 
-/*
- * fluid_defpreset_get_zone
- */
-fluid_preset_zone_t *
-fluid_defpreset_get_zone(fluid_defpreset_t *defpreset)
-{
-    return defpreset->zone;
-}
-
 /*
  * fluid_defpreset_get_global_zone
  */
@@ -1089,38 +1687,18 @@ fluid_defpreset_get_global_zone(fluid_defpreset_t *defpreset)
  */
 
 /*
- * fluid_preset_zone_next
- */
-fluid_preset_zone_t *
-fluid_preset_zone_next(fluid_preset_zone_t *zone)
-{
-    return zone->next;
-}
-
-/*
- * new_fluid_preset_zone
+ * fluid_preset_zone_init
  */
-fluid_preset_zone_t *
-new_fluid_preset_zone(char *name)
+int
+fluid_preset_zone_init(fluid_preset_zone_t *zone, char *name, fluid_defsfont_t *defsfont)
 {
-    fluid_preset_zone_t *zone = NULL;
-    zone = FLUID_NEW(fluid_preset_zone_t);
+    zone->voice_zone = NULL;
+    zone->voice_zone_count = 0;
+    zone->name = fluid_arena_strdup(defsfont->arena, name);
 
-    if(zone == NULL)
+    if(zone->name == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        return NULL;
-    }
-
-    zone->next = NULL;
-    zone->voice_zone = NULL;
-    zone->name = FLUID_STRDUP(name);
-
-    if(zone->name == NULL)
-    {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        FLUID_FREE(zone);
-        return NULL;
+        return FLUID_FAILED;
     }
 
     zone->inst = NULL;
@@ -1135,79 +1713,58 @@ new_fluid_preset_zone(char *name)
      * This also sets the generator values to default, but that is of no concern here.*/
     fluid_gen_set_default_values(&zone->gen[0]);
     zone->mod = NULL; /* list of modulators */
-    return zone;
-}
-
-/*
- * delete list of modulators.
- */
-static void delete_fluid_list_mod(fluid_mod_t *mod)
-{
-    fluid_mod_t *tmp;
-
-    while(mod)	/* delete the modulators */
-    {
-        tmp = mod;
-        mod = mod->next;
-        delete_fluid_mod(tmp);
-    }
+    return FLUID_OK;
 }
 
 /*
- * delete_fluid_preset_zone
+ * fluid_preset_zone_create_voice_zones
  */
-void
-delete_fluid_preset_zone(fluid_preset_zone_t *zone)
-{
-    fluid_list_t *list;
-
-    fluid_return_if_fail(zone != NULL);
-
-    delete_fluid_list_mod(zone->mod);
-
-    for(list = zone->voice_zone; list != NULL; list = fluid_list_next(list))
-    {
-        FLUID_FREE(fluid_list_get(list));
-    }
-
-    delete_fluid_list(zone->voice_zone);
-
-    FLUID_FREE(zone->name);
-    FLUID_FREE(zone);
-}
-
-static int fluid_preset_zone_create_voice_zones(fluid_preset_zone_t *preset_zone)
+int fluid_preset_zone_create_voice_zones(fluid_preset_zone_t *preset_zone, fluid_defsfont_t *defsfont)
 {
     fluid_inst_zone_t *inst_zone;
     fluid_sample_t *sample;
     fluid_voice_zone_t *voice_zone;
     fluid_zone_range_t *irange;
     fluid_zone_range_t *prange = &preset_zone->range;
+    int i, count;
 
     fluid_return_val_if_fail(preset_zone->inst != NULL, FLUID_FAILED);
 
-    inst_zone = fluid_inst_get_zone(preset_zone->inst);
+    /* We only create voice ranges for zones that could actually start a voice,
+     * i.e. that have a sample and don't point to ROM */
+    for(i = 0, count = 0; i < preset_zone->inst->zone_count; i++)
+    {
+        sample = fluid_inst_zone_get_sample(&preset_zone->inst->zone[i]);
+
+        if((sample != NULL) && !fluid_sample_in_rom(sample))
+        {
+            count++;
+        }
+    }
+
+    if(count == 0)
+    {
+        return FLUID_OK;
+    }
+
+    preset_zone->voice_zone = FLUID_ARENA_ARRAY(defsfont->arena, fluid_voice_zone_t, count);
 
-    while(inst_zone != NULL)
+    if(preset_zone->voice_zone == NULL)
     {
+        return FLUID_FAILED;
+    }
 
-        /* We only create voice ranges for zones that could actually start a voice,
-         * i.e. that have a sample and don't point to ROM */
+    for(i = 0; i < preset_zone->inst->zone_count; i++)
+    {
+        inst_zone = &preset_zone->inst->zone[i];
         sample = fluid_inst_zone_get_sample(inst_zone);
 
         if((sample == NULL) || fluid_sample_in_rom(sample))
         {
-            inst_zone = fluid_inst_zone_next(inst_zone);
             continue;
         }
 
-        voice_zone = FLUID_NEW(fluid_voice_zone_t);
-
-        if(voice_zone == NULL)
-        {
-            FLUID_LOG(FLUID_ERR, "Out of memory");
-            return FLUID_FAILED;
-        }
+        voice_zone = &preset_zone->voice_zone[preset_zone->voice_zone_count++];
 
         voice_zone->inst_zone = inst_zone;
 
@@ -1218,10 +1775,6 @@ static int fluid_preset_zone_create_voice_zones(fluid_preset_zone_t *preset_zone
         voice_zone->range.vello = (prange->vello > irange->vello) ? prange->vello : irange->vello;
         voice_zone->range.velhi = (prange->velhi < irange->velhi) ? prange->velhi : irange->velhi;
         voice_zone->range.ignore = FALSE;
-
-        preset_zone->voice_zone = fluid_list_append(preset_zone->voice_zone, voice_zone);
-
-        inst_zone = fluid_inst_zone_next(inst_zone);
     }
 
     return FLUID_OK;
@@ -1286,7 +1839,6 @@ static void fluid_limit_mod_list(char *zone_name, fluid_mod_t **list_mod)
                 *list_mod = NULL;
             }
 
-            delete_fluid_list_mod(mod);
             FLUID_LOG(FLUID_WARN, "%s, modulators count limited to %d", zone_name,
                       FLUID_NUM_MOD);
             break;
@@ -1334,8 +1886,6 @@ fluid_zone_check_mod(char *zone_name, fluid_mod_t **list_mod)
             {
                 *list_mod = next;
             }
-
-            delete_fluid_mod(mod); /* freeing */
         }
         else
         {
@@ -1360,12 +1910,12 @@ fluid_zone_check_mod(char *zone_name, fluid_mod_t **list_mod)
 static void
 fluid_zone_gen_import_sfont(fluid_gen_t *gen, fluid_zone_range_t *range, SFZone *sfzone)
 {
-    fluid_list_t *r;
+    int i;
     SFGen *sfgen;
 
-    for(r = sfzone->gen; r != NULL;)
+    for(i = 0; i < sfzone->gen_count; i++)
     {
-        sfgen = (SFGen *)fluid_list_get(r);
+        sfgen = &sfzone->gen[i];
 
         switch(sfgen->id)
         {
@@ -1392,8 +1942,6 @@ fluid_zone_gen_import_sfont(fluid_gen_t *gen, fluid_zone_range_t *range, SFZone
             gen[sfgen->id].flags = GEN_SET;
             break;
         }
-
-        r = fluid_list_next(r);
     }
 }
 
@@ -1486,22 +2034,29 @@ fluid_zone_mod_source_import_sfont(unsigned char *src, unsigned char *flags, uns
  * @return FLUID_OK if success, FLUID_FAILED otherwise.
  */
 static int
-fluid_zone_mod_import_sfont(char *zone_name, fluid_mod_t **mod, SFZone *sfzone)
+fluid_zone_mod_import_sfont(char *zone_name, fluid_mod_t **mod, SFZone *sfzone, fluid_defsfont_t *defsfont)
 {
-    fluid_list_t *r;
+    fluid_mod_t *mods;
     int count;
 
-    /* Import the modulators (only SF2.1 and higher) */
-    for(count = 0, r = sfzone->mod; r != NULL; count++)
+    if(sfzone->mod_count == 0)
+    {
+        return FLUID_OK;
+    }
+
+    mods = FLUID_ARENA_ARRAY(defsfont->arena, fluid_mod_t, sfzone->mod_count);
+
+    if(mods == NULL)
     {
+        return FLUID_FAILED;
+    }
 
-        SFMod *mod_src = (SFMod *)fluid_list_get(r);
-        fluid_mod_t *mod_dest = new_fluid_mod();
+    /* Import the modulators (only SF2.1 and higher) */
+    for(count = 0; count < sfzone->mod_count; count++)
+    {
 
-        if(mod_dest == NULL)
-        {
-            return FLUID_FAILED;
-        }
+        SFMod *mod_src = &sfzone->mod[count];
+        fluid_mod_t *mod_dest = &mods[count];
 
         mod_dest->next = NULL; /* pointer to next modulator, this is the end of the list now.*/
 
@@ -1569,18 +2124,8 @@ fluid_zone_mod_import_sfont(char *zone_name, fluid_mod_t **mod, SFZone *sfzone)
         }
         else
         {
-            fluid_mod_t *last_mod = *mod;
-
-            /* Find the end of the list */
-            while(last_mod->next != NULL)
-            {
-                last_mod = last_mod->next;
-            }
-
-            last_mod->next = mod_dest;
+            mods[count - 1].next = mod_dest;
         }
-
-        r = fluid_list_next(r);
     } /* foreach modulator */
 
     /* checks and removes invalid modulators in modulators list*/
@@ -1597,9 +2142,9 @@ fluid_preset_zone_import_sfont(fluid_preset_zone_t *zone, SFZone *sfzone, fluid_
     /* import the generators */
     fluid_zone_gen_import_sfont(zone->gen, &zone->range, sfzone);
 
-    if((sfzone->instsamp != NULL) && (sfzone->instsamp->data != NULL))
+    if(sfzone->inst != NULL)
     {
-        SFInst *sfinst = sfzone->instsamp->data;
+        SFInst *sfinst = sfzone->inst;
 
         zone->inst = find_inst_by_idx(defsfont, sfinst->idx);
 
@@ -1613,14 +2158,14 @@ fluid_preset_zone_import_sfont(fluid_preset_zone_t *zone, SFZone *sfzone, fluid_
             return FLUID_FAILED;
         }
 
-        if(fluid_preset_zone_create_voice_zones(zone) == FLUID_FAILED)
+        if(fluid_preset_zone_create_voice_zones(zone, defsfont) == FLUID_FAILED)
         {
             return FLUID_FAILED;
         }
     }
 
     /* Import the modulators (only SF2.1 and higher) */
-    return fluid_zone_mod_import_sfont(zone->name, &zone->mod, sfzone);
+    return fluid_zone_mod_import_sfont(zone->name, &zone->mod, sfzone, defsfont);
 }
 
 /*
@@ -1638,86 +2183,27 @@ fluid_preset_zone_get_inst(fluid_preset_zone_t *zone)
  *                           INST
  */
 
-/*
- * new_fluid_inst
- */
-fluid_inst_t *
-new_fluid_inst()
-{
-    fluid_inst_t *inst = FLUID_NEW(fluid_inst_t);
-
-    if(inst == NULL)
-    {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        return NULL;
-    }
-
-    inst->name[0] = 0;
-    inst->global_zone = NULL;
-    inst->zone = NULL;
-    return inst;
-}
-
-/*
- * delete_fluid_inst
- */
-void
-delete_fluid_inst(fluid_inst_t *inst)
-{
-    fluid_inst_zone_t *zone;
-
-    fluid_return_if_fail(inst != NULL);
-
-    delete_fluid_inst_zone(inst->global_zone);
-    inst->global_zone = NULL;
-
-    zone = inst->zone;
-
-    while(zone != NULL)
-    {
-        inst->zone = zone->next;
-        delete_fluid_inst_zone(zone);
-        zone = inst->zone;
-    }
-
-    FLUID_FREE(inst);
-}
-
-/*
- * fluid_inst_set_global_zone
- */
-int
-fluid_inst_set_global_zone(fluid_inst_t *inst, fluid_inst_zone_t *zone)
-{
-    inst->global_zone = zone;
-    return FLUID_OK;
-}
-
 /*
  * fluid_inst_import_sfont
  */
 fluid_inst_t *
 fluid_inst_import_sfont(SFInst *sfinst, fluid_defsfont_t *defsfont)
 {
-    fluid_list_t *p;
     fluid_inst_t *inst;
     SFZone *sfzone;
     fluid_inst_zone_t *inst_zone;
     char zone_name[256];
-    int count;
+    int count, zone_count;
 
-    inst = (fluid_inst_t *) new_fluid_inst();
+    inst = FLUID_ARENA_NEW(defsfont->arena, fluid_inst_t);
 
     if(inst == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
         return NULL;
     }
 
     inst->source_idx = sfinst->idx;
 
-    p = sfinst->zone;
-
     if(FLUID_STRLEN(sfinst->name) > 0)
     {
         FLUID_STRCPY(inst->name, sfinst->name);
@@ -1727,73 +2213,64 @@ fluid_inst_import_sfont(SFInst *sfinst, fluid_defsfont_t *defsfont)
         FLUID_STRCPY(inst->name, "<untitled>");
     }
 
-    count = 0;
+    /* only the first zone can be a global zone, it has no (valid) sample */
+    zone_count = sfinst->zone_count;
 
-    while(p != NULL)
+    if(zone_count > 0 && (sfinst->zone[0].sample == NULL || sfinst->zone[0].sample->fluid_sample == NULL))
     {
+        inst->global_zone = FLUID_ARENA_NEW(defsfont->arena, fluid_inst_zone_t);
 
-        sfzone = (SFZone *)fluid_list_get(p);
-        /* instrument zone name */
-        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "iz:%s/%d", inst->name, count);
-
-        inst_zone = new_fluid_inst_zone(zone_name);
-
-        if(inst_zone == NULL)
+        if(inst->global_zone == NULL)
         {
             return NULL;
         }
 
-        if(fluid_inst_zone_import_sfont(inst_zone, sfzone, defsfont) != FLUID_OK)
+        zone_count--;
+    }
+
+    if(zone_count > 0)
+    {
+        inst->zone = FLUID_ARENA_ARRAY(defsfont->arena, fluid_inst_zone_t, zone_count);
+
+        if(inst->zone == NULL)
         {
-            delete_fluid_inst_zone(inst_zone);
             return NULL;
         }
 
-        if((count == 0) && (fluid_inst_zone_get_sample(inst_zone) == NULL))
-        {
-            fluid_inst_set_global_zone(inst, inst_zone);
+        inst->zone_count = zone_count;
+    }
+
+    for(count = 0; count < sfinst->zone_count; count++)
+    {
+
+        sfzone = &sfinst->zone[count];
 
+        /* local zones are stored last to first, like the preset zones */
+        if(count == 0 && inst->global_zone != NULL)
+        {
+            inst_zone = inst->global_zone;
         }
-        else if(fluid_inst_add_zone(inst, inst_zone) != FLUID_OK)
+        else
         {
-            return NULL;
+            inst_zone = &inst->zone[sfinst->zone_count - 1 - count];
         }
 
-        p = fluid_list_next(p);
-        count++;
-    }
+        /* instrument zone name */
+        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "iz:%s/%d", inst->name, count);
 
-    defsfont->inst = fluid_list_append(defsfont->inst, inst);
-    return inst;
-}
+        if(fluid_inst_zone_init(inst_zone, zone_name, defsfont) != FLUID_OK)
+        {
+            return NULL;
+        }
 
-/*
- * fluid_inst_add_zone
- */
-int
-fluid_inst_add_zone(fluid_inst_t *inst, fluid_inst_zone_t *zone)
-{
-    if(inst->zone == NULL)
-    {
-        zone->next = NULL;
-        inst->zone = zone;
-    }
-    else
-    {
-        zone->next = inst->zone;
-        inst->zone = zone;
+        if(fluid_inst_zone_import_sfont(inst_zone, sfzone, defsfont) != FLUID_OK)
+        {
+            return NULL;
+        }
     }
 
-    return FLUID_OK;
-}
-
-/*
- * fluid_inst_get_zone
- */
-fluid_inst_zone_t *
-fluid_inst_get_zone(fluid_inst_t *inst)
-{
-    return inst->zone;
+    defsfont->inst[sfinst->idx] = inst;
+    return inst;
 }
 
 /*
@@ -1811,28 +2288,16 @@ fluid_inst_get_global_zone(fluid_inst_t *inst)
  */
 
 /*
- * new_fluid_inst_zone
+ * fluid_inst_zone_init
  */
-fluid_inst_zone_t *
-new_fluid_inst_zone(char *name)
+int
+fluid_inst_zone_init(fluid_inst_zone_t *zone, char *name, fluid_defsfont_t *defsfont)
 {
-    fluid_inst_zone_t *zone = NULL;
-    zone = FLUID_NEW(fluid_inst_zone_t);
-
-    if(zone == NULL)
-    {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        return NULL;
-    }
-
-    zone->next = NULL;
-    zone->name = FLUID_STRDUP(name);
+    zone->name = fluid_arena_strdup(defsfont->arena, name);
 
     if(zone->name == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Out of memory");
-        FLUID_FREE(zone);
-        return NULL;
+        return FLUID_FAILED;
     }
 
     zone->sample = NULL;
@@ -1845,30 +2310,7 @@ new_fluid_inst_zone(char *name)
      * This also sets the generator values to default, but they will be overwritten anyway, if used.*/
     fluid_gen_set_default_values(&zone->gen[0]);
     zone->mod = NULL; /* list of modulators */
-    return zone;
-}
-
-/*
- * delete_fluid_inst_zone
- */
-void
-delete_fluid_inst_zone(fluid_inst_zone_t *zone)
-{
-    fluid_return_if_fail(zone != NULL);
-
-    delete_fluid_list_mod(zone->mod);
-
-    FLUID_FREE(zone->name);
-    FLUID_FREE(zone);
-}
-
-/*
- * fluid_inst_zone_next
- */
-fluid_inst_zone_t *
-fluid_inst_zone_next(fluid_inst_zone_t *zone)
-{
-    return zone->next;
+    return FLUID_OK;
 }
 
 /*
@@ -1886,13 +2328,13 @@ fluid_inst_zone_import_sfont(fluid_inst_zone_t *inst_zone, SFZone *sfzone, fluid
     /*    } */
 
     /* fixup sample pointer */
-    if((sfzone->instsamp != NULL) && (sfzone->instsamp->data != NULL))
+    if(sfzone->sample != NULL)
     {
-        inst_zone->sample = ((SFSample *)(sfzone->instsamp->data))->fluid_sample;
+        inst_zone->sample = sfzone->sample->fluid_sample;
     }
 
     /* Import the modulators (only SF2.1 and higher) */
-    return fluid_zone_mod_import_sfont(inst_zone->name, &inst_zone->mod, sfzone);
+    return fluid_zone_mod_import_sfont(inst_zone->name, &inst_zone->mod, sfzone, defsfont);
 }
 
 /*
@@ -1960,6 +2402,7 @@ fluid_sample_import_sfont(fluid_sample_t *sample, SFSample *sfsample, fluid_defs
     if(defsfont->dynamic_samples)
     {
         sample->notify = dynamic_samples_sample_notify;
+        sample->notify_data = defsfont;
     }
 
     if(fluid_sample_validate(sample, defsfont->samplesize) == FLUID_FAILED)
@@ -1970,104 +2413,301 @@ fluid_sample_import_sfont(fluid_sample_t *sample, SFSample *sfsample, fluid_defs
     return FLUID_OK;
 }
 
-/* Called if a sample is no longer used by a voice. Used by dynamic sample loading
- * to unload a sample that is not used by any loaded presets anymore but couldn't
- * be unloaded straight away because it was still in use by a voice. */
+/* Called if a sample is no longer played by any voice, possibly in the synthesis thread.
+ * If no preset uses the sample anymore either, it is an orphan whose data can go now:
+ * have the eviction thread unload it. Only evict_mutex is taken here, which is never
+ * held for long, not the locks held while loading or unloading. */
 static int dynamic_samples_sample_notify(fluid_sample_t *sample, int reason)
 {
-    if(reason == FLUID_SAMPLE_DONE && sample->preset_count == 0)
+    fluid_defsfont_t *defsfont = sample->notify_data;
+
+    if(reason == FLUID_SAMPLE_DONE && sample->preset_count == 0 && defsfont->evict_thread != NULL)
     {
-        unload_sample(sample);
+        fluid_cond_mutex_lock(defsfont->evict_mutex);
+        defsfont->evict_pending = TRUE;
+        fluid_cond_signal(defsfont->evict_cond);
+        fluid_cond_mutex_unlock(defsfont->evict_mutex);
     }
 
     return FLUID_OK;
 }
 
-/* Called if a preset has been selected for or unselected from a channel. Used by
- * dynamic sample loading to load and unload samples on demand. */
+/* Called if a preset has been selected for or unselected from a channel, or should
+ * be preloaded. Used by dynamic sample loading to load and unload samples on demand.
+ *
+ * The notifications of a SoundFont are serialized by its load_mutex, which is held
+ * while loading sample data from disk. This only holds up preset changes and
+ * preloads of the same SoundFont. The state shared with the eviction thread is
+ * protected by dynamic_mutex, which is never held while loading or unloading. */
 static int dynamic_samples_preset_notify(fluid_preset_t *preset, int reason, int chan)
 {
-    fluid_defsfont_t *defsfont;
+    fluid_defsfont_t *defsfont = fluid_sfont_get_data(preset->sfont);
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
+    fluid_list_t *unload;
+
+    fluid_mutex_lock(defsfont->load_mutex);
 
     if(reason == FLUID_PRESET_SELECTED)
     {
         FLUID_LOG(FLUID_DBG, "Selected preset '%s' on channel %d", fluid_preset_get_name(preset), chan);
-        defsfont = fluid_sfont_get_data(preset->sfont);
-        load_preset_samples(defsfont, preset);
+        defpreset->selected++;
+        acquire_preset_samples(defsfont, preset);
     }
     else if(reason == FLUID_PRESET_UNSELECTED)
     {
         FLUID_LOG(FLUID_DBG, "Deselected preset '%s' from channel %d", fluid_preset_get_name(preset), chan);
-        defsfont = fluid_sfont_get_data(preset->sfont);
-        unload_preset_samples(defsfont, preset);
+
+        if(defpreset->selected > 0)
+        {
+            defpreset->selected--;
+        }
+
+        if(defpreset->selected == 0)
+        {
+            release_preset_samples(defsfont, preset);
+        }
+    }
+    else if(reason == FLUID_PRESET_PRELOAD && defpreset->selected == 0)
+    {
+        /* Load the samples and keep them like those of a preset that has just been deselected */
+        FLUID_LOG(FLUID_DBG, "Preloading preset '%s'", fluid_preset_get_name(preset));
+        acquire_preset_samples(defsfont, preset);
+        release_preset_samples(defsfont, preset);
     }
 
+    /* samples that were still playing when their presets were released may be done by now */
+    fluid_mutex_lock(defsfont->dynamic_mutex);
+    unload = sweep_orphaned_samples(defsfont, NULL);
+    fluid_mutex_unlock(defsfont->dynamic_mutex);
+
+    unload_sample_data(unload);
+
+    fluid_mutex_unlock(defsfont->load_mutex);
+
     return FLUID_OK;
 }
 
+/* Make sure that the samples of a preset are loaded. A retained preset only has
+ * to be taken off the list of retained presets. Called with load_mutex held. */
+static void acquire_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset)
+{
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
+    fluid_list_t *load = NULL;
+    int claimed = FALSE;
+
+    fluid_mutex_lock(defsfont->dynamic_mutex);
+
+    if(defpreset->retained)
+    {
+        defsfont->retained = fluid_list_remove(defsfont->retained, preset);
+        defsfont->retained_bytes -= defpreset->sample_bytes;
+        defpreset->retained = FALSE;
+    }
+    else if(!defpreset->loaded)
+    {
+        load = claim_preset_samples(defsfont, preset);
+        claimed = TRUE;
+    }
+
+    fluid_mutex_unlock(defsfont->dynamic_mutex);
 
-/* Walk through all samples used by the passed in preset and make sure that the
- * sample data is loaded for each sample. Used by dynamic sample loading. */
-static int load_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset)
+    if(claimed)
+    {
+        load_preset_samples(defsfont, preset, load);
+        delete_fluid_list(load);
+    }
+}
+
+/* Called when a preset is not selected on any channel anymore. If retention is
+ * enabled its samples stay loaded until the retained presets exceed the budget,
+ * otherwise they are unloaded right away. Called with load_mutex held. */
+static void release_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset)
 {
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
+    fluid_list_t *unload = NULL;
+    int evict = FALSE;
+
+    fluid_mutex_lock(defsfont->dynamic_mutex);
+
+    if(defpreset->loaded && !defpreset->retained)
+    {
+        if(defsfont->retention_budget == 0)
+        {
+            unload = unclaim_preset_samples(defsfont, preset, NULL);
+        }
+        else
+        {
+            /* most recently used presets go to the end of the list */
+            defsfont->retained = fluid_list_append(defsfont->retained, preset);
+            defsfont->retained_bytes += defpreset->sample_bytes;
+            defpreset->retained = TRUE;
+            evict = (defsfont->retained_bytes > defsfont->retention_budget);
+        }
+    }
+
+    fluid_mutex_unlock(defsfont->dynamic_mutex);
+
+    unload_sample_data(unload);
+
+    if(!evict)
+    {
+        return;
+    }
+
+    /* Unloading may have to free a lot of memory, keep that out of the caller's way */
+    if(defsfont->evict_thread != NULL)
+    {
+        fluid_cond_mutex_lock(defsfont->evict_mutex);
+        defsfont->evict_pending = TRUE;
+        fluid_cond_signal(defsfont->evict_cond);
+        fluid_cond_mutex_unlock(defsfont->evict_mutex);
+    }
+    else
+    {
+        evict_retained_presets(defsfont);
+    }
+}
+
+/* Unload the least recently used retained presets until the rest fits into the budget,
+ * and the orphaned samples no voice plays anymore */
+static void evict_retained_presets(fluid_defsfont_t *defsfont)
+{
+    fluid_preset_t *preset;
     fluid_defpreset_t *defpreset;
-    fluid_preset_zone_t *preset_zone;
+    fluid_list_t *unload = NULL;
+
+    fluid_mutex_lock(defsfont->dynamic_mutex);
+
+    while(defsfont->retained != NULL && defsfont->retained_bytes > defsfont->retention_budget)
+    {
+        preset = fluid_list_get(defsfont->retained);
+        defpreset = fluid_preset_get_data(preset);
+
+        FLUID_LOG(FLUID_DBG, "Evicting samples of preset '%s'", fluid_preset_get_name(preset));
+
+        defsfont->retained = fluid_list_remove(defsfont->retained, preset);
+        defsfont->retained_bytes -= defpreset->sample_bytes;
+        defpreset->retained = FALSE;
+
+        unload = unclaim_preset_samples(defsfont, preset, unload);
+    }
+
+    unload = sweep_orphaned_samples(defsfont, unload);
+
+    fluid_mutex_unlock(defsfont->dynamic_mutex);
+
+    unload_sample_data(unload);
+}
+
+static fluid_thread_return_t evict_thread_func(void *data)
+{
+    fluid_defsfont_t *defsfont = data;
+
+    fluid_cond_mutex_lock(defsfont->evict_mutex);
+
+    while(!defsfont->evict_quit)
+    {
+        if(!defsfont->evict_pending)
+        {
+            fluid_cond_wait(defsfont->evict_cond, defsfont->evict_mutex);
+            continue;
+        }
+
+        defsfont->evict_pending = FALSE;
+        fluid_cond_mutex_unlock(defsfont->evict_mutex);
+
+        evict_retained_presets(defsfont);
+
+        fluid_cond_mutex_lock(defsfont->evict_mutex);
+    }
+
+    fluid_cond_mutex_unlock(defsfont->evict_mutex);
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
+
+
+/* Count the preset as a user of each of its samples and mark it loaded. Returns the
+ * samples whose data has to be loaded by load_preset_samples(). Called with
+ * dynamic_mutex held. */
+static fluid_list_t *claim_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset)
+{
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
     fluid_inst_t *inst;
-    fluid_inst_zone_t *inst_zone;
     fluid_sample_t *sample;
-    SFData *sffile = NULL;
+    fluid_list_t *load = NULL;
+    int i, k;
 
-    defpreset = fluid_preset_get_data(preset);
-    preset_zone = fluid_defpreset_get_zone(defpreset);
-
-    while(preset_zone != NULL)
+    for(i = 0; i < defpreset->zone_count; i++)
     {
-        inst = fluid_preset_zone_get_inst(preset_zone);
-        inst_zone = fluid_inst_get_zone(inst);
+        inst = fluid_preset_zone_get_inst(&defpreset->zone[i]);
 
-        while(inst_zone != NULL)
+        for(k = 0; k < inst->zone_count; k++)
         {
-            sample = fluid_inst_zone_get_sample(inst_zone);
+            sample = fluid_inst_zone_get_sample(&inst->zone[k]);
 
-            if((sample != NULL) && (sample->start != sample->end))
+            if((sample != NULL) && (sample->start != sample->end) && (++sample->preset_count == 1))
             {
-                sample->preset_count++;
-
-                /* If this is the first time this sample has been selected,
-                 * load the sampledata */
-                if(sample->preset_count == 1)
+                if(sample->data != NULL)
                 {
-                    /* Make sure we have an open Soundfont file. Do this here
-                     * to avoid having to open the file if no loading is necessary
-                     * for a preset */
-                    if(sffile == NULL)
-                    {
-                        sffile = fluid_sffile_open(defsfont->filename, defsfont->fcbs);
+                    /* still loaded for a voice that played it */
+                    defsfont->orphans = fluid_list_remove(defsfont->orphans, sample);
+                }
+                else
+                {
+                    load = fluid_list_prepend(load, sample);
+                }
+            }
+        }
+    }
 
-                        if(sffile == NULL)
-                        {
-                            FLUID_LOG(FLUID_ERR, "Unable to open Soundfont file");
-                            return FLUID_FAILED;
-                        }
-                    }
+    defpreset->loaded = TRUE;
 
-                    if(fluid_defsfont_load_sampledata(defsfont, sffile, sample) == FLUID_OK)
-                    {
-                        fluid_sample_sanitize_loop(sample, (sample->end + 1) * sizeof(short));
-                        fluid_voice_optimize_sample(sample);
-                    }
-                    else
-                    {
-                        FLUID_LOG(FLUID_ERR, "Unable to load sample '%s', disabling", sample->name);
-                        sample->start = sample->end = 0;
-                    }
-                }
+    return load;
+}
+
+/* Load the data of the samples claimed by claim_preset_samples() and determine the
+ * size of all sample data used by the preset. Only called with load_mutex held, the
+ * claimed samples can't be unloaded in the meantime. */
+static int load_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset, fluid_list_t *load)
+{
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
+    fluid_inst_t *inst;
+    fluid_sample_t *sample;
+    SFData *sffile = NULL;
+    size_t sample_bytes = 0;
+    int i, k;
+
+    for(; load != NULL; load = fluid_list_next(load))
+    {
+        sample = fluid_list_get(load);
+
+        /* Make sure we have an open Soundfont file. Do this here
+         * to avoid having to open the file if no loading is necessary
+         * for a preset */
+        if(sffile == NULL)
+        {
+            sffile = fluid_sffile_open(defsfont->filename, defsfont->fcbs);
+
+            if(sffile == NULL)
+            {
+                FLUID_LOG(FLUID_ERR, "Unable to open Soundfont file");
+                return FLUID_FAILED;
             }
 
-            inst_zone = fluid_inst_zone_next(inst_zone);
+            sffile->huge_pages = defsfont->huge_pages;
         }
 
-        preset_zone = fluid_preset_zone_next(preset_zone);
+        if(fluid_defsfont_load_sampledata(defsfont, sffile, sample) == FLUID_OK)
+        {
+            fluid_sample_sanitize_loop(sample, (sample->end + 1) * sizeof(short));
+            fluid_voice_optimize_sample(sample);
+        }
+        else
+        {
+            FLUID_LOG(FLUID_ERR, "Unable to load sample '%s', disabling", sample->name);
+            sample->start = sample->end = 0;
+        }
     }
 
     if(sffile != NULL)
@@ -2075,91 +2715,131 @@ static int load_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *prese
         fluid_sffile_close(sffile);
     }
 
+    for(i = 0; i < defpreset->zone_count; i++)
+    {
+        inst = fluid_preset_zone_get_inst(&defpreset->zone[i]);
+
+        for(k = 0; k < inst->zone_count; k++)
+        {
+            sample = fluid_inst_zone_get_sample(&inst->zone[k]);
+
+            if((sample != NULL) && (sample->start != sample->end) && (sample->data != NULL))
+            {
+                sample_bytes += (sample->end + 1) * sizeof(short);
+
+                if(sample->data24 != NULL)
+                {
+                    sample_bytes += sample->end + 1;
+                }
+            }
+        }
+    }
+
+    defpreset->sample_bytes = sample_bytes;
+
     return FLUID_OK;
 }
 
-/* Walk through all samples used by the passed in preset and unload the sample data
- * of each sample that is not used by any selected preset anymore. Used by dynamic
- * sample loading. */
-static int unload_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset)
+/* Drop the preset as a user of its samples and mark it unloaded. The data of samples
+ * that are not used by any selected preset anymore is detached and prepended to
+ * unload, to be released by unload_sample_data() once dynamic_mutex has been
+ * released. Samples still used by a voice are remembered as orphans instead, see
+ * sweep_orphaned_samples(). Called with dynamic_mutex held. */
+static fluid_list_t *unclaim_preset_samples(fluid_defsfont_t *defsfont, fluid_preset_t *preset,
+        fluid_list_t *unload)
 {
-    fluid_defpreset_t *defpreset;
-    fluid_preset_zone_t *preset_zone;
+    fluid_defpreset_t *defpreset = fluid_preset_get_data(preset);
     fluid_inst_t *inst;
-    fluid_inst_zone_t *inst_zone;
     fluid_sample_t *sample;
+    int i, k;
 
-    defpreset = fluid_preset_get_data(preset);
-    preset_zone = fluid_defpreset_get_zone(defpreset);
-
-    while(preset_zone != NULL)
+    for(i = 0; i < defpreset->zone_count; i++)
     {
-        inst = fluid_preset_zone_get_inst(preset_zone);
-        inst_zone = fluid_inst_get_zone(inst);
+        inst = fluid_preset_zone_get_inst(&defpreset->zone[i]);
 
-        while(inst_zone != NULL)
+        for(k = 0; k < inst->zone_count; k++)
         {
-            sample = fluid_inst_zone_get_sample(inst_zone);
+            sample = fluid_inst_zone_get_sample(&inst->zone[k]);
 
-            if((sample != NULL) && (sample->preset_count > 0))
+            if((sample != NULL) && (sample->preset_count > 0) && (--sample->preset_count == 0)
+                    && (sample->data != NULL))
             {
-                sample->preset_count--;
-
-                /* If the sample is not used by any preset or used by a
-                 * sounding voice, unload it from the sample cache. If it's
-                 * still in use by a voice, dynamic_samples_sample_notify will
-                 * take care of unloading the sample as soon as the voice is
-                 * finished with it (but only on the next API call). */
-                if(sample->preset_count == 0 && sample->refcount == 0)
+                if(fluid_atomic_int_get(&sample->refcount) == 0)
+                {
+                    unload = detach_sample_data(sample, unload);
+                }
+                else
                 {
-                    unload_sample(sample);
+                    defsfont->orphans = fluid_list_prepend(defsfont->orphans, sample);
                 }
             }
-
-            inst_zone = fluid_inst_zone_next(inst_zone);
         }
-
-        preset_zone = fluid_preset_zone_next(preset_zone);
     }
 
-    return FLUID_OK;
+    defpreset->loaded = FALSE;
+
+    return unload;
 }
 
-/* Unload an unused sample from the samplecache */
-static void unload_sample(fluid_sample_t *sample)
+/* Detach the data of the orphaned samples that are not played by any voice anymore.
+ * Voices release samples in the synthesis thread, which therefore doesn't have to take
+ * any lock of the SoundFont. Called with dynamic_mutex held. */
+static fluid_list_t *sweep_orphaned_samples(fluid_defsfont_t *defsfont, fluid_list_t *unload)
 {
-    fluid_return_if_fail(sample != NULL);
-    fluid_return_if_fail(sample->data != NULL);
-    fluid_return_if_fail(sample->preset_count == 0);
-    fluid_return_if_fail(sample->refcount == 0);
-
-    FLUID_LOG(FLUID_DBG, "Unloading sample '%s'", sample->name);
+    fluid_list_t *list, *next;
+    fluid_sample_t *sample;
 
-    if(fluid_samplecache_unload(sample->data) == FLUID_FAILED)
+    for(list = defsfont->orphans; list; list = next)
     {
-        FLUID_LOG(FLUID_ERR, "Unable to unload sample '%s'", sample->name);
-    }
-    else
-    {
-        sample->data = NULL;
-        sample->data24 = NULL;
+        next = fluid_list_next(list);
+        sample = fluid_list_get(list);
+
+        if(fluid_atomic_int_get(&sample->refcount) == 0)
+        {
+            defsfont->orphans = fluid_list_remove_link(defsfont->orphans, list);
+            delete1_fluid_list(list);
+            unload = detach_sample_data(sample, unload);
+        }
     }
+
+    return unload;
 }
 
-static fluid_inst_t *find_inst_by_idx(fluid_defsfont_t *defsfont, int idx)
+/* Take the data off an unused sample, so that it can be unloaded without holding
+ * dynamic_mutex */
+static fluid_list_t *detach_sample_data(fluid_sample_t *sample, fluid_list_t *unload)
+{
+    FLUID_LOG(FLUID_DBG, "Unloading sample '%s'", sample->name);
+
+    unload = fluid_list_prepend(unload, sample->data);
+    sample->data = NULL;
+    sample->data24 = NULL;
+
+    return unload;
+}
+
+/* Unload the sample data detached by detach_sample_data() from the samplecache */
+static void unload_sample_data(fluid_list_t *unload)
 {
     fluid_list_t *list;
-    fluid_inst_t *inst;
 
-    for(list = defsfont->inst; list != NULL; list = fluid_list_next(list))
+    for(list = unload; list; list = fluid_list_next(list))
     {
-        inst = fluid_list_get(list);
-
-        if(inst->source_idx == idx)
+        if(fluid_samplecache_unload(fluid_list_get(list)) == FLUID_FAILED)
         {
-            return inst;
+            FLUID_LOG(FLUID_ERR, "Unable to unload sample data");
         }
     }
 
-    return NULL;
+    delete_fluid_list(unload);
+}
+
+static fluid_inst_t *find_inst_by_idx(fluid_defsfont_t *defsfont, int idx)
+{
+    if(idx < 0 || idx >= defsfont->inst_count)
+    {
+        return NULL;
+    }
+
+    return defsfont->inst[idx];
 }
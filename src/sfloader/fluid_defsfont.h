@@ -31,6 +31,8 @@
 #include "fluid_list.h"
 #include "fluid_mod.h"
 #include "fluid_gen.h"
+#include "fluid_arena.h"
+#include "fluid_sys.h"
 
 
 
@@ -83,6 +85,8 @@ fluid_sfont_t *fluid_defsfloader_load(fluid_sfloader_t *loader, const char *file
 
 
 int fluid_defsfont_sfont_delete(fluid_sfont_t *sfont);
+fluid_sfont_t *fluid_defsfont_share(fluid_sfont_t *sfont);
+int fluid_defsfont_is_compressed(fluid_sfont_t *sfont);
 const char *fluid_defsfont_sfont_get_name(fluid_sfont_t *sfont);
 fluid_preset_t *fluid_defsfont_sfont_get_preset(fluid_sfont_t *sfont, int bank, int prenum);
 void fluid_defsfont_sfont_iteration_start(fluid_sfont_t *sfont);
@@ -104,20 +108,44 @@ struct _fluid_defsfont_t
 {
     const fluid_file_callbacks_t *fcbs; /* the file callbacks used to load this Soundfont */
     char *filename;           /* the filename of this soundfont */
-    unsigned int samplepos;   /* the position in the file at which the sample data starts */
+    fluid_long_long_t samplepos;   /* the position in the file at which the sample data starts */
     unsigned int samplesize;  /* the size of the sample data in bytes */
     short *sampledata;        /* the sample data, loaded in ram */
 
-    unsigned int sample24pos;		/* position within sffd of the sm24 chunk, set to zero if no 24 bit sample support */
+    fluid_long_long_t sample24pos;		/* position within sffd of the sm24 chunk, set to zero if no 24 bit sample support */
     unsigned int sample24size;		/* length within sffd of the sm24 chunk */
     char *sample24data;        /* if not NULL, the least significant byte of the 24bit sample data, loaded in ram */
 
-    fluid_sfont_t *sfont;      /* pointer to parent sfont */
+    fluid_sfont_t *sfont;      /* pointer to parent sfont, NULL once unloaded while still shared */
+    int refcount;              /* number of sfonts using this defsfont, see fluid_defsfont_share() */
     fluid_list_t *sample;      /* the samples in this soundfont */
+    fluid_list_t *sample_last; /* the last element of the sample list */
     fluid_list_t *preset;      /* the presets of this soundfont */
-    fluid_list_t *inst;        /* the instruments of this soundfont */
+    fluid_list_t *preset_last; /* the last element of the preset list */
+    fluid_inst_t **inst;       /* the imported instruments, indexed by their source index */
+    int inst_count;            /* size of the instrument index */
+    fluid_arena_t *arena;      /* holds samples, presets, instruments, zones and modulators */
     int mlock;                 /* Should we try memlock (avoid swapping)? */
+    int huge_pages;            /* Should sample data be allocated from huge pages? */
     int dynamic_samples;       /* Enables dynamic sample loading if set */
+    int use_index;             /* Read and write a compiled index next to the soundfont file */
+    int compress_samples;      /* Keep the sample data compressed in memory (synth.sample-storage) */
+
+    /* Dynamic sample loading: presets that are no longer selected keep their samples
+     * loaded until their total size exceeds the retention budget. Eviction and unloading
+     * of orphaned samples once their voices are done run on evict_thread. */
+    fluid_mutex_t load_mutex;            /* serializes the preset notifications, held while loading sample data */
+    fluid_mutex_t dynamic_mutex;         /* protects retained, retained_bytes, orphans, the loaded and retained state of
+                                            presets and the preset counts of samples. Never held while loading or unloading */
+    size_t retention_budget;             /* max. size of sample data kept for retained presets */
+    size_t retained_bytes;               /* size of sample data of the retained presets */
+    fluid_list_t *retained;              /* retained presets, least recently used first */
+    fluid_thread_t *evict_thread;        /* evicts retained presets and sweeps orphans, NULL without dynamic sample loading */
+    fluid_cond_mutex_t *evict_mutex;     /* protects evict_pending and evict_quit */
+    fluid_cond_t *evict_cond;            /* wakes up evict_thread */
+    int evict_pending;                   /* the retained presets exceed the budget or an orphan may be done */
+    int evict_quit;                      /* tells evict_thread to terminate */
+    fluid_list_t *orphans;               /* samples not used by any preset, whose data is still played by a voice */
 
     fluid_list_t *preset_iter_cur;       /* the current preset in the iteration */
 };
@@ -148,16 +176,19 @@ struct _fluid_defpreset_t
     unsigned int bank;                    /* the bank number */
     unsigned int num;                     /* the preset number */
     fluid_preset_zone_t *global_zone;        /* the global zone of the preset */
-    fluid_preset_zone_t *zone;               /* the chained list of preset zones */
+    fluid_preset_zone_t *zone;               /* the array of preset zones */
+    int zone_count;                          /* the number of preset zones */
+
+    /* dynamic sample loading state */
+    int selected;                            /* the number of channels this preset is selected on */
+    int loaded;                              /* TRUE if the samples of this preset are loaded */
+    size_t sample_bytes;                     /* size of the sample data used by this preset */
+    int retained;                            /* TRUE if unselected but kept loaded for reuse */
 };
 
 fluid_defpreset_t *new_fluid_defpreset(fluid_defsfont_t *defsfont);
-void delete_fluid_defpreset(fluid_defpreset_t *defpreset);
 fluid_defpreset_t *fluid_defpreset_next(fluid_defpreset_t *defpreset);
 int fluid_defpreset_import_sfont(fluid_defpreset_t *defpreset, SFPreset *sfpreset, fluid_defsfont_t *defsfont);
-int fluid_defpreset_set_global_zone(fluid_defpreset_t *defpreset, fluid_preset_zone_t *zone);
-int fluid_defpreset_add_zone(fluid_defpreset_t *defpreset, fluid_preset_zone_t *zone);
-fluid_preset_zone_t *fluid_defpreset_get_zone(fluid_defpreset_t *defpreset);
 fluid_preset_zone_t *fluid_defpreset_get_global_zone(fluid_defpreset_t *defpreset);
 int fluid_defpreset_get_banknum(fluid_defpreset_t *defpreset);
 int fluid_defpreset_get_num(fluid_defpreset_t *defpreset);
@@ -169,20 +200,19 @@ int fluid_defpreset_noteon(fluid_defpreset_t *defpreset, fluid_synth_t *synth, i
  */
 struct _fluid_preset_zone_t
 {
-    fluid_preset_zone_t *next;
     char *name;
     fluid_inst_t *inst;
-    fluid_list_t *voice_zone;
+    fluid_voice_zone_t *voice_zone; /* array of instrument zones that could start a voice */
+    int voice_zone_count;
     fluid_zone_range_t range;
     fluid_gen_t gen[GEN_LAST];
     fluid_mod_t *mod;  /* List of modulators */
 };
 
-fluid_preset_zone_t *new_fluid_preset_zone(char *name);
-void delete_fluid_preset_zone(fluid_preset_zone_t *zone);
-fluid_preset_zone_t *fluid_preset_zone_next(fluid_preset_zone_t *zone);
+int fluid_preset_zone_init(fluid_preset_zone_t *zone, char *name, fluid_defsfont_t *defsfont);
 int fluid_preset_zone_import_sfont(fluid_preset_zone_t *zone, SFZone *sfzone, fluid_defsfont_t *defssfont);
 fluid_inst_t *fluid_preset_zone_get_inst(fluid_preset_zone_t *zone);
+int fluid_preset_zone_create_voice_zones(fluid_preset_zone_t *preset_zone, fluid_defsfont_t *defsfont);
 
 /*
  * fluid_inst_t
@@ -192,15 +222,11 @@ struct _fluid_inst_t
     char name[21];
     int source_idx; /* Index of instrument in source Soundfont */
     fluid_inst_zone_t *global_zone;
-    fluid_inst_zone_t *zone;
+    fluid_inst_zone_t *zone;        /* array of instrument zones */
+    int zone_count;                 /* number of instrument zones */
 };
 
-fluid_inst_t *new_fluid_inst(void);
 fluid_inst_t *fluid_inst_import_sfont(SFInst *sfinst, fluid_defsfont_t *defsfont);
-void delete_fluid_inst(fluid_inst_t *inst);
-int fluid_inst_set_global_zone(fluid_inst_t *inst, fluid_inst_zone_t *zone);
-int fluid_inst_add_zone(fluid_inst_t *inst, fluid_inst_zone_t *zone);
-fluid_inst_zone_t *fluid_inst_get_zone(fluid_inst_t *inst);
 fluid_inst_zone_t *fluid_inst_get_global_zone(fluid_inst_t *inst);
 
 /*
@@ -208,7 +234,6 @@ fluid_inst_zone_t *fluid_inst_get_global_zone(fluid_inst_t *inst);
  */
 struct _fluid_inst_zone_t
 {
-    fluid_inst_zone_t *next;
     char *name;
     fluid_sample_t *sample;
     fluid_zone_range_t range;
@@ -217,9 +242,7 @@ struct _fluid_inst_zone_t
 };
 
 
-fluid_inst_zone_t *new_fluid_inst_zone(char *name);
-void delete_fluid_inst_zone(fluid_inst_zone_t *zone);
-fluid_inst_zone_t *fluid_inst_zone_next(fluid_inst_zone_t *zone);
+int fluid_inst_zone_init(fluid_inst_zone_t *zone, char *name, fluid_defsfont_t *defsfont);
 int fluid_inst_zone_import_sfont(fluid_inst_zone_t *inst_zone, SFZone *sfzone, fluid_defsfont_t *defsfont);
 fluid_sample_t *fluid_inst_zone_get_sample(fluid_inst_zone_t *zone);
 
@@ -24,40 +24,92 @@
 /* CACHED SAMPLE DATA LOADER
  *
  * This is a wrapper around fluid_sffile_read_sample_data that attempts to cache the read
- * data across all FluidSynth instances in a global (process-wide) list.
+ * data across all FluidSynth instances in a global (process-wide) hash table.
+ *
+ * Entries that are no longer referenced by any sample are not freed immediately. Instead
+ * they are kept on a LRU list and only evicted once the total size of the cached sample
+ * data exceeds the configured budget (see fluid_samplecache_set_budget()). This allows
+ * presets and soundfonts to be reloaded without touching the disk again.
+ *
+ * Optionally, sample data is deduplicated by content (see fluid_samplecache_set_dedup()).
+ * Cache entries whose data is byte-identical, e.g. the same sample stored in several
+ * soundfonts, then share a single resident copy. The LRU list, the reference counts and
+ * the budget apply to the resident data, not to the entries referring to it.
+ *
+ * Budget and deduplication are process-wide as well. They are taken from the settings of
+ * the first SoundFont loader, see fluid_samplecache_apply_settings().
  */
 
 #include "fluid_samplecache.h"
 #include "fluid_sys.h"
 #include "fluidsynth.h"
-#include "fluid_list.h"
+#include "fluid_hash.h"
+#include "fluid_hugemem.h"
+#include "fluid_settings.h"
 
 
+typedef struct _fluid_samplecache_data_t fluid_samplecache_data_t;
 typedef struct _fluid_samplecache_entry_t fluid_samplecache_entry_t;
 
+/* Sample data resident in the cache, shared by all entries with identical content */
+struct _fluid_samplecache_data_t
+{
+    short *sample_data;
+    char *sample_data24;
+    int sample_count;
+
+    unsigned int content_hash;
+    int deduplicated;           /* TRUE if listed in samplecache_content_table */
+    fluid_list_t *entries;      /* the cache entries referring to this data */
+
+    int num_references;
+    int mlocked;
+
+    /* Links into the LRU list of unreferenced data */
+    fluid_samplecache_data_t *lru_prev;
+    fluid_samplecache_data_t *lru_next;
+};
+
 struct _fluid_samplecache_entry_t
 {
     /* The follwing members all form the cache key */
     char *filename;
     time_t modification_time;
-    unsigned int sf_samplepos;
+    fluid_long_long_t sf_samplepos;
     unsigned int sf_samplesize;
-    unsigned int sf_sample24pos;
+    fluid_long_long_t sf_sample24pos;
     unsigned int sf_sample24size;
     unsigned int sample_start;
     unsigned int sample_end;
     int sample_type;
     /*  End of cache key members */
 
-    short *sample_data;
-    char *sample_data24;
-    int sample_count;
-
-    int num_references;
-    int mlocked;
+    fluid_samplecache_data_t *data;
 };
 
-static fluid_list_t *samplecache_list = NULL;
+/* Cache entries hashed by their key members */
+static fluid_hashtable_t *samplecache_table = NULL;
+/* Resident data hashed by its sample_data pointer, used for unloading */
+static fluid_hashtable_t *samplecache_data_table = NULL;
+/* Resident data hashed by content, used for deduplication */
+static fluid_hashtable_t *samplecache_content_table = NULL;
+
+/* Unreferenced data, most recently used first */
+static fluid_samplecache_data_t *samplecache_lru_head = NULL;
+static fluid_samplecache_data_t *samplecache_lru_tail = NULL;
+
+static size_t samplecache_budget = 0;
+static size_t samplecache_bytes = 0;
+static size_t samplecache_unused_bytes = 0;
+static unsigned int samplecache_hits = 0;
+static unsigned int samplecache_misses = 0;
+static unsigned int samplecache_evictions = 0;
+
+static int samplecache_dedup = FALSE;
+static int samplecache_configured = FALSE;
+static unsigned int samplecache_shared = 0;
+static size_t samplecache_saved_bytes = 0;
+
 static fluid_mutex_t samplecache_mutex = FLUID_MUTEX_INIT;
 
 static fluid_samplecache_entry_t *new_samplecache_entry(SFData *sf, unsigned int sample_start,
@@ -65,6 +117,21 @@ static fluid_samplecache_entry_t *new_samplecache_entry(SFData *sf, unsigned int
 static fluid_samplecache_entry_t *get_samplecache_entry(SFData *sf, unsigned int sample_start,
         unsigned int sample_end, int sample_type, time_t mtime);
 static void delete_samplecache_entry(fluid_samplecache_entry_t *entry);
+static fluid_samplecache_data_t *new_samplecache_data(SFData *sf, unsigned int sample_start,
+        unsigned int sample_end, int sample_type);
+static void delete_samplecache_data(fluid_samplecache_data_t *data);
+static unsigned int samplecache_data_hash(const fluid_samplecache_data_t *data);
+static int samplecache_init_tables(void);
+static size_t samplecache_data_size(const fluid_samplecache_data_t *data);
+static unsigned int samplecache_entry_hash(const void *key);
+static int samplecache_entry_equal(const void *a, const void *b);
+static unsigned int samplecache_content_hash(const void *key);
+static int samplecache_content_equal(const void *a, const void *b);
+static void samplecache_lru_unlink(fluid_samplecache_data_t *data);
+static void samplecache_lru_push(fluid_samplecache_data_t *data);
+static void samplecache_drop(fluid_samplecache_data_t *data);
+static void samplecache_evict(void);
+static int samplecache_unload(const short *sample_data, int keep);
 
 static int fluid_get_file_modification_time(char *filename, time_t *modification_time);
 
@@ -76,7 +143,8 @@ int fluid_samplecache_load(SFData *sf,
                            int try_mlock, short **sample_data, char **sample_data24)
 {
     fluid_samplecache_entry_t *entry;
-    int ret;
+    fluid_samplecache_data_t *data = NULL, *shared;
+    int ret, dedup = FALSE;
     time_t mtime;
 
     fluid_mutex_lock(samplecache_mutex);
@@ -86,48 +154,144 @@ int fluid_samplecache_load(SFData *sf,
         mtime = 0;
     }
 
+    if(samplecache_init_tables() != FLUID_OK)
+    {
+        ret = -1;
+        goto unlock_exit;
+    }
+
     entry = get_samplecache_entry(sf, sample_start, sample_end, sample_type, mtime);
 
+    if(entry == NULL)
+    {
+        data = new_samplecache_data(sf, sample_start, sample_end, sample_type);
+
+        if(data == NULL)
+        {
+            ret = -1;
+            goto unlock_exit;
+        }
+
+        dedup = samplecache_dedup && data->sample_data != NULL;
+
+        if(dedup)
+        {
+            /* Don't hold up other loads while hashing all of the sample data */
+            fluid_mutex_unlock(samplecache_mutex);
+            data->content_hash = samplecache_data_hash(data);
+            fluid_mutex_lock(samplecache_mutex);
+
+            /* The cache may have been emptied or the same sample loaded in the meantime */
+            if(samplecache_init_tables() != FLUID_OK)
+            {
+                delete_samplecache_data(data);
+                ret = -1;
+                goto unlock_exit;
+            }
+
+            entry = get_samplecache_entry(sf, sample_start, sample_end, sample_type, mtime);
+
+            if(entry != NULL)
+            {
+                delete_samplecache_data(data);
+            }
+        }
+    }
+
     if(entry == NULL)
     {
         entry = new_samplecache_entry(sf, sample_start, sample_end, sample_type, mtime);
 
         if(entry == NULL)
         {
+            delete_samplecache_data(data);
             ret = -1;
             goto unlock_exit;
         }
 
-        samplecache_list = fluid_list_prepend(samplecache_list, entry);
+        shared = NULL;
+
+        if(dedup)
+        {
+            shared = fluid_hashtable_lookup(samplecache_content_table, data);
+        }
+
+        if(shared != NULL)
+        {
+            /* Identical data is already resident, drop the copy just read */
+            samplecache_shared++;
+            samplecache_saved_bytes += samplecache_data_size(data);
+            delete_samplecache_data(data);
+            data = shared;
+
+            if(data->num_references == 0)
+            {
+                samplecache_lru_unlink(data);
+                samplecache_unused_bytes -= samplecache_data_size(data);
+            }
+        }
+        else
+        {
+            if(dedup)
+            {
+                fluid_hashtable_insert(samplecache_content_table, data, data);
+                data->deduplicated = TRUE;
+            }
+
+            if(data->sample_data != NULL)
+            {
+                fluid_hashtable_insert(samplecache_data_table, data->sample_data, data);
+            }
+
+            samplecache_bytes += samplecache_data_size(data);
+        }
+
+        entry->data = data;
+        data->entries = fluid_list_prepend(data->entries, entry);
+        fluid_hashtable_insert(samplecache_table, entry, entry);
+        samplecache_misses++;
+    }
+    else
+    {
+        data = entry->data;
+
+        if(data->num_references == 0)
+        {
+            /* revived from the LRU list */
+            samplecache_lru_unlink(data);
+            samplecache_unused_bytes -= samplecache_data_size(data);
+        }
+
+        samplecache_hits++;
     }
 
-    if(try_mlock && !entry->mlocked)
+    if(try_mlock && !data->mlocked)
     {
         /* Lock the memory to disable paging. It's okay if this fails. It
          * probably means that the user doesn't have the required permission. */
-        if(fluid_mlock(entry->sample_data, entry->sample_count * sizeof(short)) == 0)
+        if(fluid_mlock(data->sample_data, data->sample_count * sizeof(short)) == 0)
         {
-            if(entry->sample_data24 != NULL)
+            if(data->sample_data24 != NULL)
             {
-                entry->mlocked = (fluid_mlock(entry->sample_data24, entry->sample_count) == 0);
+                data->mlocked = (fluid_mlock(data->sample_data24, data->sample_count) == 0);
             }
             else
             {
-                entry->mlocked = TRUE;
+                data->mlocked = TRUE;
             }
 
-            if(!entry->mlocked)
+            if(!data->mlocked)
             {
-                fluid_munlock(entry->sample_data, entry->sample_count * sizeof(short));
+                fluid_munlock(data->sample_data, data->sample_count * sizeof(short));
                 FLUID_LOG(FLUID_WARN, "Failed to pin the sample data to RAM; swapping is possible.");
             }
         }
     }
 
-    entry->num_references++;
-    *sample_data = entry->sample_data;
-    *sample_data24 = entry->sample_data24;
-    ret = entry->sample_count;
+    data->num_references++;
+    *sample_data = data->sample_data;
+    *sample_data24 = data->sample_data24;
+    ret = data->sample_count;
 
 unlock_exit:
     fluid_mutex_unlock(samplecache_mutex);
@@ -136,53 +300,203 @@ unlock_exit:
 
 int fluid_samplecache_unload(const short *sample_data)
 {
-    fluid_list_t *entry_list;
-    fluid_samplecache_entry_t *entry;
+    return samplecache_unload(sample_data, TRUE);
+}
+
+/* Like fluid_samplecache_unload(), but frees the data right away once it is no longer
+ * referenced, instead of keeping it for reuse. For data that is only needed once, like
+ * the uncompressed data of compressed samples. */
+int fluid_samplecache_discard(const short *sample_data)
+{
+    return samplecache_unload(sample_data, FALSE);
+}
+
+static int samplecache_unload(const short *sample_data, int keep)
+{
+    fluid_samplecache_data_t *data = NULL;
     int ret;
 
     fluid_mutex_lock(samplecache_mutex);
 
-    entry_list = samplecache_list;
+    if(samplecache_data_table != NULL)
+    {
+        data = fluid_hashtable_lookup(samplecache_data_table, sample_data);
+    }
 
-    while(entry_list)
+    if(data == NULL || data->num_references <= 0)
     {
-        entry = (fluid_samplecache_entry_t *)fluid_list_get(entry_list);
+        FLUID_LOG(FLUID_ERR, "Trying to free sample data not found in cache.");
+        ret = FLUID_FAILED;
+        goto unlock_exit;
+    }
 
-        if(sample_data == entry->sample_data)
-        {
-            entry->num_references--;
+    data->num_references--;
 
-            if(entry->num_references == 0)
-            {
-                if(entry->mlocked)
-                {
-                    fluid_munlock(entry->sample_data, entry->sample_count * sizeof(short));
-
-                    if(entry->sample_data24 != NULL)
-                    {
-                        fluid_munlock(entry->sample_data24, entry->sample_count);
-                    }
-                }
-
-                samplecache_list = fluid_list_remove(samplecache_list, entry);
-                delete_samplecache_entry(entry);
-            }
+    if(data->num_references == 0)
+    {
+        /* Keep the data around for later reuse, until the budget forces it out,
+         * unless it is discarded */
+        samplecache_lru_push(data);
+        samplecache_unused_bytes += samplecache_data_size(data);
 
-            ret = FLUID_OK;
-            goto unlock_exit;
+        if(!keep)
+        {
+            samplecache_drop(data);
         }
 
-        entry_list = fluid_list_next(entry_list);
+        samplecache_evict();
     }
 
-    FLUID_LOG(FLUID_ERR, "Trying to free sample data not found in cache.");
-    ret = FLUID_FAILED;
+    ret = FLUID_OK;
 
 unlock_exit:
     fluid_mutex_unlock(samplecache_mutex);
     return ret;
 }
 
+void fluid_samplecache_set_budget(size_t bytes)
+{
+    fluid_mutex_lock(samplecache_mutex);
+    samplecache_budget = bytes;
+    samplecache_evict();
+    fluid_mutex_unlock(samplecache_mutex);
+}
+
+/* Enable or disable sharing of sample data with identical content. Only affects sample
+ * data loaded afterwards. */
+void fluid_samplecache_set_dedup(int enabled)
+{
+    fluid_mutex_lock(samplecache_mutex);
+    samplecache_dedup = enabled;
+    fluid_mutex_unlock(samplecache_mutex);
+}
+
+static void samplecache_size_changed(void *data, const char *name, int value)
+{
+    fluid_samplecache_set_budget((size_t)value * 1024 * 1024);
+}
+
+static void samplecache_dedup_changed(void *data, const char *name, int value)
+{
+    fluid_samplecache_set_dedup(value);
+}
+
+/* Configure the process-wide cache from the settings of a SoundFont loader.
+ *
+ * The first loader configures the cache. Later loaders only change a setting which they
+ * don't leave at its default value, so that creating another synth with default settings
+ * doesn't undo the configuration of the first one. Changing a setting at runtime through
+ * any of these settings objects is applied right away. */
+void fluid_samplecache_apply_settings(fluid_settings_t *settings)
+{
+    int configured, value, def;
+
+    fluid_mutex_lock(samplecache_mutex);
+    configured = samplecache_configured;
+    samplecache_configured = TRUE;
+    fluid_mutex_unlock(samplecache_mutex);
+
+    if(fluid_settings_getint(settings, "synth.sample-cache-size", &value) == FLUID_OK
+            && fluid_settings_getint_default(settings, "synth.sample-cache-size", &def) == FLUID_OK
+            && (!configured || value != def))
+    {
+        fluid_samplecache_set_budget((size_t)value * 1024 * 1024);
+    }
+
+    if(fluid_settings_getint(settings, "synth.sample-cache-dedup", &value) == FLUID_OK
+            && fluid_settings_getint_default(settings, "synth.sample-cache-dedup", &def) == FLUID_OK
+            && (!configured || value != def))
+    {
+        fluid_samplecache_set_dedup(value);
+    }
+
+    fluid_settings_callback_int(settings, "synth.sample-cache-size", samplecache_size_changed, NULL);
+    fluid_settings_callback_int(settings, "synth.sample-cache-dedup", samplecache_dedup_changed, NULL);
+}
+
+/**
+ * Get statistics of the process-wide sample cache.
+ *
+ * The sample cache is shared by all synthesizer instances. Sample data that is no longer
+ * used is retained in the cache as long as the total size of the cached sample data stays
+ * within the budget given by the <a href="fluidsettings.xml#synth.sample-cache-size">
+ * synth.sample-cache-size</a> setting.
+ *
+ * @param hits Location to store the number of lookups served from the cache (can be NULL)
+ * @param misses Location to store the number of lookups that had to read the soundfont file (can be NULL)
+ * @param evictions Location to store the number of unused entries dropped due to the budget (can be NULL)
+ * @param resident_bytes Location to store the size of all sample data currently in the cache (can be NULL)
+ * @param unused_bytes Location to store the size of cached sample data that is not used by
+ *   any sample, i.e. subject to eviction (can be NULL)
+ * @return #FLUID_OK
+ * @since 2.1.0
+ */
+int fluid_samplecache_get_stats(unsigned int *hits, unsigned int *misses, unsigned int *evictions,
+                                size_t *resident_bytes, size_t *unused_bytes)
+{
+    fluid_mutex_lock(samplecache_mutex);
+
+    if(hits != NULL)
+    {
+        *hits = samplecache_hits;
+    }
+
+    if(misses != NULL)
+    {
+        *misses = samplecache_misses;
+    }
+
+    if(evictions != NULL)
+    {
+        *evictions = samplecache_evictions;
+    }
+
+    if(resident_bytes != NULL)
+    {
+        *resident_bytes = samplecache_bytes;
+    }
+
+    if(unused_bytes != NULL)
+    {
+        *unused_bytes = samplecache_unused_bytes;
+    }
+
+    fluid_mutex_unlock(samplecache_mutex);
+    return FLUID_OK;
+}
+
+/**
+ * Get statistics of the sample data deduplication of the process-wide sample cache.
+ *
+ * When <a href="fluidsettings.xml#synth.sample-cache-dedup">synth.sample-cache-dedup</a>
+ * is enabled, sample data that is byte-identical to data already in the cache is not
+ * kept a second time.
+ *
+ * @param shared_samples Location to store the number of cached samples currently sharing
+ *   the data of another one (can be NULL)
+ * @param saved_bytes Location to store the size of the sample data that is not resident
+ *   because of that (can be NULL)
+ * @return #FLUID_OK
+ * @since 2.1.0
+ */
+int fluid_samplecache_get_dedup_stats(unsigned int *shared_samples, size_t *saved_bytes)
+{
+    fluid_mutex_lock(samplecache_mutex);
+
+    if(shared_samples != NULL)
+    {
+        *shared_samples = samplecache_shared;
+    }
+
+    if(saved_bytes != NULL)
+    {
+        *saved_bytes = samplecache_saved_bytes;
+    }
+
+    fluid_mutex_unlock(samplecache_mutex);
+    return FLUID_OK;
+}
+
 
 /* Private functions */
 static fluid_samplecache_entry_t *new_samplecache_entry(SFData *sf,
@@ -208,7 +522,8 @@ static fluid_samplecache_entry_t *new_samplecache_entry(SFData *sf,
     if(entry->filename == NULL)
     {
         FLUID_LOG(FLUID_ERR, "Out of memory");
-        goto error_exit;
+        delete_samplecache_entry(entry);
+        return NULL;
     }
 
     entry->sf_samplepos = sf->samplepos;
@@ -220,19 +535,7 @@ static fluid_samplecache_entry_t *new_samplecache_entry(SFData *sf,
     entry->sample_type = sample_type;
     entry->modification_time = mtime;
 
-    entry->sample_count = fluid_sffile_read_sample_data(sf, sample_start, sample_end, sample_type,
-                          &entry->sample_data, &entry->sample_data24);
-
-    if(entry->sample_count < 0)
-    {
-        goto error_exit;
-    }
-
     return entry;
-
-error_exit:
-    delete_samplecache_entry(entry);
-    return NULL;
 }
 
 static void delete_samplecache_entry(fluid_samplecache_entry_t *entry)
@@ -240,43 +543,308 @@ static void delete_samplecache_entry(fluid_samplecache_entry_t *entry)
     fluid_return_if_fail(entry != NULL);
 
     FLUID_FREE(entry->filename);
-    FLUID_FREE(entry->sample_data);
-    FLUID_FREE(entry->sample_data24);
     FLUID_FREE(entry);
 }
 
+static fluid_samplecache_data_t *new_samplecache_data(SFData *sf,
+        unsigned int sample_start,
+        unsigned int sample_end,
+        int sample_type)
+{
+    fluid_samplecache_data_t *data;
+
+    data = FLUID_NEW(fluid_samplecache_data_t);
+
+    if(data == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_MEMSET(data, 0, sizeof(*data));
+
+    data->sample_count = fluid_sffile_read_sample_data(sf, sample_start, sample_end, sample_type,
+                         &data->sample_data, &data->sample_data24);
+
+    if(data->sample_count < 0)
+    {
+        delete_samplecache_data(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+/* DJB2-style hash of a block of memory, a machine word at a time */
+static unsigned int samplecache_hash_bytes(unsigned int h, const void *mem, size_t size)
+{
+    const unsigned char *bytes = mem;
+    size_t i, words = size / sizeof(unsigned int);
+    unsigned int word;
+
+    for(i = 0; i < words; i++)
+    {
+        FLUID_MEMCPY(&word, bytes + i * sizeof(unsigned int), sizeof(word));
+        h = (h << 5) + h + word;
+    }
+
+    for(i = words * sizeof(unsigned int); i < size; i++)
+    {
+        h = (h << 5) + h + bytes[i];
+    }
+
+    return h;
+}
+
+/* Hash of the sample data content, used for deduplication */
+static unsigned int samplecache_data_hash(const fluid_samplecache_data_t *data)
+{
+    unsigned int h = samplecache_hash_bytes(5381, data->sample_data, data->sample_count * sizeof(short));
+
+    if(data->sample_data24 != NULL)
+    {
+        h = samplecache_hash_bytes(h, data->sample_data24, data->sample_count);
+    }
+
+    return h;
+}
+
+/* Create the cache hash tables if they don't exist (yet or anymore).
+ * Must be called with samplecache_mutex held. */
+static int samplecache_init_tables(void)
+{
+    if(samplecache_table != NULL)
+    {
+        return FLUID_OK;
+    }
+
+    samplecache_table = new_fluid_hashtable(samplecache_entry_hash, samplecache_entry_equal);
+    samplecache_data_table = new_fluid_hashtable(NULL, NULL);
+    samplecache_content_table = new_fluid_hashtable(samplecache_content_hash, samplecache_content_equal);
+
+    if(samplecache_table == NULL || samplecache_data_table == NULL || samplecache_content_table == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        delete_fluid_hashtable(samplecache_table);
+        delete_fluid_hashtable(samplecache_data_table);
+        delete_fluid_hashtable(samplecache_content_table);
+        samplecache_table = samplecache_data_table = samplecache_content_table = NULL;
+        return FLUID_FAILED;
+    }
+
+    return FLUID_OK;
+}
+
+static void delete_samplecache_data(fluid_samplecache_data_t *data)
+{
+    fluid_return_if_fail(data != NULL);
+
+    if(data->mlocked)
+    {
+        fluid_munlock(data->sample_data, data->sample_count * sizeof(short));
+
+        if(data->sample_data24 != NULL)
+        {
+            fluid_munlock(data->sample_data24, data->sample_count);
+        }
+    }
+
+    delete_fluid_list(data->entries);
+    fluid_huge_free(data->sample_data);
+    fluid_huge_free(data->sample_data24);
+    FLUID_FREE(data);
+}
+
 static fluid_samplecache_entry_t *get_samplecache_entry(SFData *sf,
         unsigned int sample_start,
         unsigned int sample_end,
         int sample_type,
         time_t mtime)
 {
-    fluid_list_t *entry_list;
-    fluid_samplecache_entry_t *entry;
+    fluid_samplecache_entry_t key;
+
+    key.filename = sf->fname;
+    key.modification_time = mtime;
+    key.sf_samplepos = sf->samplepos;
+    key.sf_samplesize = sf->samplesize;
+    key.sf_sample24pos = sf->sample24pos;
+    key.sf_sample24size = sf->sample24size;
+    key.sample_start = sample_start;
+    key.sample_end = sample_end;
+    key.sample_type = sample_type;
+
+    return fluid_hashtable_lookup(samplecache_table, &key);
+}
 
-    entry_list = samplecache_list;
+/* Number of bytes of resident sample data */
+static size_t samplecache_data_size(const fluid_samplecache_data_t *data)
+{
+    size_t size = data->sample_count * sizeof(short);
 
-    while(entry_list)
+    if(data->sample_data24 != NULL)
     {
-        entry = (fluid_samplecache_entry_t *)fluid_list_get(entry_list);
+        size += data->sample_count;
+    }
 
-        if((FLUID_STRCMP(sf->fname, entry->filename) == 0) &&
-                (mtime == entry->modification_time) &&
-                (sf->samplepos == entry->sf_samplepos) &&
-                (sf->samplesize == entry->sf_samplesize) &&
-                (sf->sample24pos == entry->sf_sample24pos) &&
-                (sf->sample24size == entry->sf_sample24size) &&
-                (sample_start == entry->sample_start) &&
-                (sample_end == entry->sample_end) &&
-                (sample_type == entry->sample_type))
-        {
-            return entry;
-        }
+    return size;
+}
+
+static unsigned int samplecache_entry_hash(const void *key)
+{
+    const fluid_samplecache_entry_t *entry = key;
+    unsigned int h = fluid_str_hash(entry->filename);
+
+    h = (h << 5) + h + (unsigned int)entry->modification_time;
+    h = (h << 5) + h + (unsigned int)entry->sf_samplepos;
+    h = (h << 5) + h + entry->sf_samplesize;
+    h = (h << 5) + h + (unsigned int)entry->sf_sample24pos;
+    h = (h << 5) + h + entry->sf_sample24size;
+    h = (h << 5) + h + entry->sample_start;
+    h = (h << 5) + h + entry->sample_end;
+    h = (h << 5) + h + (unsigned int)entry->sample_type;
+
+    return h;
+}
+
+static int samplecache_entry_equal(const void *a, const void *b)
+{
+    const fluid_samplecache_entry_t *e1 = a;
+    const fluid_samplecache_entry_t *e2 = b;
+
+    return (e1->modification_time == e2->modification_time) &&
+           (e1->sf_samplepos == e2->sf_samplepos) &&
+           (e1->sf_samplesize == e2->sf_samplesize) &&
+           (e1->sf_sample24pos == e2->sf_sample24pos) &&
+           (e1->sf_sample24size == e2->sf_sample24size) &&
+           (e1->sample_start == e2->sample_start) &&
+           (e1->sample_end == e2->sample_end) &&
+           (e1->sample_type == e2->sample_type) &&
+           (FLUID_STRCMP(e1->filename, e2->filename) == 0);
+}
+
+static unsigned int samplecache_content_hash(const void *key)
+{
+    return ((const fluid_samplecache_data_t *)key)->content_hash;
+}
+
+static int samplecache_content_equal(const void *a, const void *b)
+{
+    const fluid_samplecache_data_t *d1 = a;
+    const fluid_samplecache_data_t *d2 = b;
+
+    if(d1->content_hash != d2->content_hash ||
+            d1->sample_count != d2->sample_count ||
+            (d1->sample_data24 == NULL) != (d2->sample_data24 == NULL))
+    {
+        return FALSE;
+    }
+
+    if(FLUID_MEMCMP(d1->sample_data, d2->sample_data, d1->sample_count * sizeof(short)) != 0)
+    {
+        return FALSE;
+    }
+
+    return (d1->sample_data24 == NULL) ||
+           (FLUID_MEMCMP(d1->sample_data24, d2->sample_data24, d1->sample_count) == 0);
+}
+
+static void samplecache_lru_unlink(fluid_samplecache_data_t *data)
+{
+    if(data->lru_prev != NULL)
+    {
+        data->lru_prev->lru_next = data->lru_next;
+    }
+    else
+    {
+        samplecache_lru_head = data->lru_next;
+    }
+
+    if(data->lru_next != NULL)
+    {
+        data->lru_next->lru_prev = data->lru_prev;
+    }
+    else
+    {
+        samplecache_lru_tail = data->lru_prev;
+    }
+
+    data->lru_prev = data->lru_next = NULL;
+}
+
+static void samplecache_lru_push(fluid_samplecache_data_t *data)
+{
+    data->lru_prev = NULL;
+    data->lru_next = samplecache_lru_head;
+
+    if(samplecache_lru_head != NULL)
+    {
+        samplecache_lru_head->lru_prev = data;
+    }
+    else
+    {
+        samplecache_lru_tail = data;
+    }
+
+    samplecache_lru_head = data;
+}
+
+/* Drop unreferenced data from the LRU list and all entries referring to it.
+ * Must be called with samplecache_mutex held. */
+static void samplecache_drop(fluid_samplecache_data_t *data)
+{
+    fluid_list_t *list;
+    size_t size = samplecache_data_size(data);
+    int count = 0;
+
+    samplecache_lru_unlink(data);
 
-        entry_list = fluid_list_next(entry_list);
+    if(data->sample_data != NULL)
+    {
+        fluid_hashtable_remove(samplecache_data_table, data->sample_data);
+    }
+
+    if(data->deduplicated)
+    {
+        fluid_hashtable_remove(samplecache_content_table, data);
+    }
+
+    for(list = data->entries; list; list = fluid_list_next(list))
+    {
+        fluid_samplecache_entry_t *entry = fluid_list_get(list);
+
+        fluid_hashtable_remove(samplecache_table, entry);
+        delete_samplecache_entry(entry);
+        count++;
+    }
+
+    /* all but the first entry were sharing the data */
+    samplecache_shared -= count - 1;
+    samplecache_saved_bytes -= (count - 1) * size;
+
+    samplecache_bytes -= size;
+    samplecache_unused_bytes -= size;
+
+    delete_samplecache_data(data);
+}
+
+/* Drop least recently used, unreferenced data until the cache fits into its budget.
+ * Must be called with samplecache_mutex held. */
+static void samplecache_evict(void)
+{
+    while(samplecache_lru_tail != NULL && samplecache_bytes > samplecache_budget)
+    {
+        samplecache_drop(samplecache_lru_tail);
+        samplecache_evictions++;
     }
 
-    return NULL;
+    /* Release the tables once the cache became empty */
+    if(samplecache_table != NULL && fluid_hashtable_size(samplecache_table) == 0)
+    {
+        delete_fluid_hashtable(samplecache_table);
+        delete_fluid_hashtable(samplecache_data_table);
+        delete_fluid_hashtable(samplecache_content_table);
+        samplecache_table = samplecache_data_table = samplecache_content_table = NULL;
+    }
 }
 
 static int fluid_get_file_modification_time(char *filename, time_t *modification_time)
@@ -30,5 +30,10 @@ int fluid_samplecache_load(SFData *sf,
                            int try_mlock, short **data, char **data24);
 
 int fluid_samplecache_unload(const short *sample_data);
+int fluid_samplecache_discard(const short *sample_data);
+
+void fluid_samplecache_set_budget(size_t bytes);
+void fluid_samplecache_set_dedup(int enabled);
+void fluid_samplecache_apply_settings(fluid_settings_t *settings);
 
 #endif /* _FLUID_SAMPLECACHE_H */
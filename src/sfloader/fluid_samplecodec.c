@@ -0,0 +1,510 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include "fluid_samplecodec.h"
+
+
+/* Encoded block layout:
+ *
+ * 1 byte   Rice parameter k, or FLUID_BLOCK_RAW if the block is stored verbatim
+ * 2 bytes  first sample point, little endian
+ * ...      Rice codes of the zigzag encoded differences of the following points,
+ *          least significant bit first, padded to a whole byte
+ *
+ * Raw blocks simply contain all sample points in little endian.
+ */
+#define FLUID_BLOCK_RAW 0xff
+
+/* Quotients this large are escaped, followed by the plain 17 bit value */
+#define FLUID_RICE_ESCAPE 32
+#define FLUID_RICE_VALUE_BITS 17
+#define FLUID_RICE_MAX_K 16
+
+/* Upper bound of the size of a Rice coded block */
+#define FLUID_BLOCK_MAX_CODED_SIZE \
+    (3 + (FLUID_SAMPLE_BLOCK_SIZE * (FLUID_RICE_ESCAPE + FLUID_RICE_VALUE_BITS) + 7) / 8)
+
+/* Size of the sample data that is stored compressed and of its compressed representation */
+static fluid_mutex_t samplecodec_mutex = FLUID_MUTEX_INIT;
+static size_t samplecodec_plain_bytes = 0;
+static size_t samplecodec_compressed_bytes = 0;
+
+typedef struct
+{
+    unsigned char *pos;
+    uint64_t acc;
+    unsigned int bits;
+} fluid_bit_writer_t;
+
+static unsigned int encode_block(const short *data, unsigned int count, unsigned char *out);
+static unsigned int rice_cost(const uint32_t *values, unsigned int count, unsigned int k);
+static void write_bits(fluid_bit_writer_t *writer, uint32_t value, unsigned int bits);
+static size_t compressed_sample_size(const fluid_compressed_sample_t *sample);
+
+
+/**
+ * Compress sample data.
+ * @param data 16 bit sample points
+ * @param count Number of sample points
+ * @return The compressed sample or NULL if out of memory (error message logged)
+ */
+fluid_compressed_sample_t *
+new_fluid_compressed_sample(const short *data, unsigned int count)
+{
+    fluid_compressed_sample_t *sample;
+    unsigned char *scratch = NULL, *encoded;
+    unsigned int i;
+    size_t size = 0;
+
+    fluid_return_val_if_fail(data != NULL, NULL);
+
+    sample = FLUID_NEW(fluid_compressed_sample_t);
+
+    if(sample == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_MEMSET(sample, 0, sizeof(*sample));
+    sample->count = count;
+    sample->block_count = (count + FLUID_SAMPLE_BLOCK_SIZE - 1) / FLUID_SAMPLE_BLOCK_SIZE;
+
+    /* A block never takes more space than when stored verbatim */
+    sample->offsets = FLUID_ARRAY(size_t, sample->block_count + 1);
+    sample->data = FLUID_MALLOC(sample->block_count * (1 + FLUID_SAMPLE_BLOCK_SIZE * sizeof(short)) + 1);
+    scratch = FLUID_MALLOC(FLUID_BLOCK_MAX_CODED_SIZE);
+
+    if(sample->offsets == NULL || sample->data == NULL || scratch == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_recovery;
+    }
+
+    for(i = 0; i < sample->block_count; i++)
+    {
+        unsigned int start = i * FLUID_SAMPLE_BLOCK_SIZE;
+        unsigned int n = (count - start < FLUID_SAMPLE_BLOCK_SIZE) ? count - start : FLUID_SAMPLE_BLOCK_SIZE;
+        unsigned int coded = encode_block(&data[start], n, scratch);
+
+        sample->offsets[i] = size;
+
+        if(coded < 1 + n * sizeof(short))
+        {
+            FLUID_MEMCPY(&sample->data[size], scratch, coded);
+            size += coded;
+        }
+        else
+        {
+            unsigned int k;
+
+            sample->data[size++] = FLUID_BLOCK_RAW;
+
+            for(k = 0; k < n; k++)
+            {
+                uint16_t point = (uint16_t)data[start + k];
+                sample->data[size++] = point & 0xff;
+                sample->data[size++] = point >> 8;
+            }
+        }
+    }
+
+    sample->offsets[sample->block_count] = size;
+    FLUID_FREE(scratch);
+
+    /* give back what compression saved */
+    encoded = FLUID_REALLOC(sample->data, size + 1);
+
+    if(encoded != NULL)
+    {
+        sample->data = encoded;
+    }
+
+    fluid_mutex_lock(samplecodec_mutex);
+    samplecodec_plain_bytes += count * sizeof(short);
+    samplecodec_compressed_bytes += compressed_sample_size(sample);
+    fluid_mutex_unlock(samplecodec_mutex);
+
+    return sample;
+
+error_recovery:
+    FLUID_FREE(scratch);
+    FLUID_FREE(sample->offsets);
+    FLUID_FREE(sample->data);
+    FLUID_FREE(sample);
+    return NULL;
+}
+
+/**
+ * Free a compressed sample.
+ * @param sample The compressed sample
+ */
+void
+delete_fluid_compressed_sample(fluid_compressed_sample_t *sample)
+{
+    fluid_return_if_fail(sample != NULL);
+
+    fluid_mutex_lock(samplecodec_mutex);
+    samplecodec_plain_bytes -= sample->count * sizeof(short);
+    samplecodec_compressed_bytes -= compressed_sample_size(sample);
+    fluid_mutex_unlock(samplecodec_mutex);
+
+    FLUID_FREE(sample->offsets);
+    FLUID_FREE(sample->data);
+    FLUID_FREE(sample);
+}
+
+/**
+ * Decode a block of a compressed sample.
+ * @param sample The compressed sample
+ * @param block Index of the block
+ * @param out Buffer of FLUID_SAMPLE_BLOCK_SIZE points, points past the end of
+ *   the sample are set to 0
+ */
+void
+fluid_compressed_sample_decode_block(const fluid_compressed_sample_t *sample,
+                                     unsigned int block, short *out)
+{
+    const unsigned char *pos = &sample->data[sample->offsets[block]];
+    const unsigned char *end = &sample->data[sample->offsets[block + 1]];
+    unsigned int start = block * FLUID_SAMPLE_BLOCK_SIZE;
+    unsigned int n = (sample->count - start < FLUID_SAMPLE_BLOCK_SIZE) ? sample->count - start : FLUID_SAMPLE_BLOCK_SIZE;
+    unsigned int k = *pos++;
+    unsigned int i;
+
+    if(k == FLUID_BLOCK_RAW)
+    {
+        for(i = 0; i < n; i++, pos += 2)
+        {
+            out[i] = (short)(uint16_t)(pos[0] | (pos[1] << 8));
+        }
+    }
+    else
+    {
+        uint64_t acc = 0;
+        unsigned int bits = 0;
+        int32_t point = (short)(uint16_t)(pos[0] | (pos[1] << 8));
+
+        pos += 2;
+        out[0] = (short)point;
+
+        for(i = 1; i < n; i++)
+        {
+            uint32_t q = 0, value;
+
+            /* a code is at most FLUID_RICE_ESCAPE + FLUID_RICE_VALUE_BITS long */
+            while(bits <= 56)
+            {
+                acc |= (uint64_t)(pos < end ? *pos : 0) << bits;
+                pos++;
+                bits += 8;
+            }
+
+            while(q < FLUID_RICE_ESCAPE && (acc & 1))
+            {
+                q++;
+                acc >>= 1;
+            }
+
+            if(q == FLUID_RICE_ESCAPE)
+            {
+                value = (uint32_t)acc & ((1u << FLUID_RICE_VALUE_BITS) - 1);
+                acc >>= FLUID_RICE_VALUE_BITS;
+                bits -= q + FLUID_RICE_VALUE_BITS;
+            }
+            else
+            {
+                acc >>= 1;
+                value = (q << k) | ((uint32_t)acc & ((1u << k) - 1));
+                acc >>= k;
+                bits -= q + 1 + k;
+            }
+
+            /* undo the zigzag encoding of the difference */
+            point += (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+            out[i] = (short)point;
+        }
+    }
+
+    for(i = n; i < FLUID_SAMPLE_BLOCK_SIZE; i++)
+    {
+        out[i] = 0;
+    }
+}
+
+/**
+ * Create a per-voice cache of decoded sample blocks.
+ * @return New decoder or NULL if out of memory (error message logged)
+ */
+fluid_sample_decoder_t *
+new_fluid_sample_decoder(void)
+{
+    fluid_sample_decoder_t *decoder = FLUID_NEW(fluid_sample_decoder_t);
+
+    if(decoder == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_MEMSET(decoder->data, 0, sizeof(decoder->data));
+    decoder->decoded_blocks = 0;
+    decoder->decode_usec = 0;
+    fluid_sample_decoder_set_sample(decoder, NULL);
+
+    return decoder;
+}
+
+/**
+ * Free a decoder.
+ * @param decoder The decoder
+ */
+void
+delete_fluid_sample_decoder(fluid_sample_decoder_t *decoder)
+{
+    FLUID_FREE(decoder);
+}
+
+/**
+ * Set the sample to decode, invalidating all cached blocks.
+ * @param decoder The decoder
+ * @param sample Compressed sample the voice is going to play, NULL if uncompressed
+ */
+void
+fluid_sample_decoder_set_sample(fluid_sample_decoder_t *decoder,
+                                const fluid_compressed_sample_t *sample)
+{
+    int i;
+
+    decoder->sample = sample;
+
+    for(i = 0; i < FLUID_SAMPLE_DECODER_SLOTS; i++)
+    {
+        decoder->blocks[i] = UINT_MAX;
+    }
+}
+
+/**
+ * Decode a block into its cache slot.
+ * @param decoder The decoder
+ * @param block Index of the block, blocks outside of the sample decode to silence
+ */
+void
+fluid_sample_decoder_fill(fluid_sample_decoder_t *decoder, unsigned int block)
+{
+    unsigned int slot = block & (FLUID_SAMPLE_DECODER_SLOTS - 1);
+    short *data = &decoder->data[slot << FLUID_SAMPLE_BLOCK_SHIFT];
+
+    decoder->blocks[slot] = block;
+
+    if(decoder->sample == NULL || block >= decoder->sample->block_count)
+    {
+        FLUID_MEMSET(data, 0, FLUID_SAMPLE_BLOCK_SIZE * sizeof(short));
+    }
+    else
+    {
+        double start = fluid_utime();
+
+        fluid_compressed_sample_decode_block(decoder->sample, block, data);
+
+        decoder->decode_usec += fluid_utime() - start;
+        decoder->decoded_blocks++;
+    }
+}
+
+/**
+ * Decode the blocks around a range of sample points ahead of rendering, so that
+ * the interpolation loops only read from the cache.
+ * @param decoder The decoder
+ * @param index First sample point that is going to be played
+ * @param count Number of sample points that are going to be played
+ * @return TRUE if all points from 3 before index to 3 after the last one are cached,
+ *   FALSE if they span more blocks than the cache holds
+ */
+int
+fluid_sample_decoder_prefetch(fluid_sample_decoder_t *decoder,
+                              unsigned int index, unsigned int count)
+{
+    /* interpolation reads up to 3 points before and after the playback position */
+    unsigned int first = (index < 3) ? 0 : (index - 3) >> FLUID_SAMPLE_BLOCK_SHIFT;
+    unsigned int last = (index + count + 3) >> FLUID_SAMPLE_BLOCK_SHIFT;
+    unsigned int block;
+    int complete = TRUE;
+
+    if(last - first >= FLUID_SAMPLE_DECODER_SLOTS)
+    {
+        last = first + FLUID_SAMPLE_DECODER_SLOTS - 1;
+        complete = FALSE;
+    }
+
+    for(block = first; block <= last; block++)
+    {
+        if(decoder->blocks[block & (FLUID_SAMPLE_DECODER_SLOTS - 1)] != block)
+        {
+            fluid_sample_decoder_fill(decoder, block);
+        }
+    }
+
+    return complete;
+}
+
+/**
+ * Get the compression ratio of sample data kept compressed in memory.
+ *
+ * Sample data is kept compressed when
+ * <a href="fluidsettings.xml#synth.sample-storage">synth.sample-storage</a> is set
+ * to "compressed". The numbers cover all currently loaded SoundFonts of the process.
+ *
+ * @param plain_bytes Location to store the size the sample data would take
+ *   uncompressed (can be NULL)
+ * @param compressed_bytes Location to store the size it actually takes (can be NULL)
+ * @return #FLUID_OK
+ * @since 2.1.0
+ */
+int fluid_get_sample_compression_stats(size_t *plain_bytes, size_t *compressed_bytes)
+{
+    fluid_mutex_lock(samplecodec_mutex);
+
+    if(plain_bytes != NULL)
+    {
+        *plain_bytes = samplecodec_plain_bytes;
+    }
+
+    if(compressed_bytes != NULL)
+    {
+        *compressed_bytes = samplecodec_compressed_bytes;
+    }
+
+    fluid_mutex_unlock(samplecodec_mutex);
+    return FLUID_OK;
+}
+
+
+/* Private functions */
+
+/* Rice code a block into out, returns the number of bytes written */
+static unsigned int encode_block(const short *data, unsigned int count, unsigned char *out)
+{
+    uint32_t values[FLUID_SAMPLE_BLOCK_SIZE];
+    fluid_bit_writer_t writer;
+    uint64_t sum = 0;
+    unsigned int i, k, best_k, best_cost;
+
+    /* zigzag encode the differences, so that small negative ones become small values */
+    for(i = 1; i < count; i++)
+    {
+        int32_t diff = (int32_t)data[i] - (int32_t)data[i - 1];
+        values[i] = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+        sum += values[i];
+    }
+
+    /* the optimal parameter is close to log2 of the mean value, check its neighbours */
+    k = 0;
+
+    while(k < FLUID_RICE_MAX_K && ((uint64_t)1 << (k + 1)) * (count - 1) <= sum)
+    {
+        k++;
+    }
+
+    best_k = k;
+    best_cost = rice_cost(values, count, k);
+
+    if(k > 0 && rice_cost(values, count, k - 1) < best_cost)
+    {
+        best_k = k - 1;
+        best_cost = rice_cost(values, count, best_k);
+    }
+
+    if(k < FLUID_RICE_MAX_K && rice_cost(values, count, k + 1) < best_cost)
+    {
+        best_k = k + 1;
+    }
+
+    out[0] = (unsigned char)best_k;
+    out[1] = (uint16_t)data[0] & 0xff;
+    out[2] = (uint16_t)data[0] >> 8;
+
+    writer.pos = &out[3];
+    writer.acc = 0;
+    writer.bits = 0;
+
+    for(i = 1; i < count; i++)
+    {
+        uint32_t q = values[i] >> best_k;
+
+        if(q >= FLUID_RICE_ESCAPE)
+        {
+            write_bits(&writer, 0xffffffffu, FLUID_RICE_ESCAPE);
+            write_bits(&writer, values[i], FLUID_RICE_VALUE_BITS);
+        }
+        else
+        {
+            /* q one bits followed by a zero bit */
+            write_bits(&writer, (1u << q) - 1, q + 1);
+            write_bits(&writer, values[i] & ((1u << best_k) - 1), best_k);
+        }
+    }
+
+    /* flush the remaining bits */
+    if(writer.bits > 0)
+    {
+        write_bits(&writer, 0, 8 - (writer.bits & 7));
+    }
+
+    return (unsigned int)(writer.pos - out);
+}
+
+/* Number of bits needed to Rice code the values 1 .. count-1 with parameter k */
+static unsigned int rice_cost(const uint32_t *values, unsigned int count, unsigned int k)
+{
+    unsigned int i, cost = 0;
+
+    for(i = 1; i < count; i++)
+    {
+        uint32_t q = values[i] >> k;
+        cost += (q >= FLUID_RICE_ESCAPE) ? FLUID_RICE_ESCAPE + FLUID_RICE_VALUE_BITS : q + 1 + k;
+    }
+
+    return cost;
+}
+
+/* Append the lower bits (at most 32) of value to the bit stream */
+static void write_bits(fluid_bit_writer_t *writer, uint32_t value, unsigned int bits)
+{
+    if(bits < 32)
+    {
+        value &= (1u << bits) - 1;
+    }
+
+    writer->acc |= (uint64_t)value << writer->bits;
+    writer->bits += bits;
+
+    while(writer->bits >= 8)
+    {
+        *writer->pos++ = (unsigned char)writer->acc;
+        writer->acc >>= 8;
+        writer->bits -= 8;
+    }
+}
+
+static size_t compressed_sample_size(const fluid_compressed_sample_t *sample)
+{
+    return sample->offsets[sample->block_count] + (sample->block_count + 1) * sizeof(size_t);
+}
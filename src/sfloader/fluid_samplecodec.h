@@ -0,0 +1,126 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+
+#ifndef _FLUID_SAMPLECODEC_H
+#define _FLUID_SAMPLECODEC_H
+
+#include "fluid_sys.h"
+
+/*
+ * Lossless compression of 16 bit sample data for compressed residency
+ * (synth.sample-storage == "compressed").
+ *
+ * Sample data is split into blocks of FLUID_SAMPLE_BLOCK_SIZE sample points that
+ * can be decoded independently. Each block stores its first point verbatim, the
+ * differences between successive points are Rice coded with a parameter chosen
+ * per block.
+ *
+ * Voices decode the blocks they play into a small cache of their own, a
+ * fluid_sample_decoder_t, which is filled ahead of the playback position by
+ * fluid_sample_decoder_prefetch() and read by the interpolation routines with
+ * fluid_sample_decoder_get(). When the prefetch covers every point a block of
+ * output is going to read, they use fluid_sample_decoder_get_cached() instead,
+ * which skips the check whether the block of a point is cached.
+ */
+
+#define FLUID_SAMPLE_BLOCK_SHIFT 8
+#define FLUID_SAMPLE_BLOCK_SIZE (1 << FLUID_SAMPLE_BLOCK_SHIFT)
+#define FLUID_SAMPLE_BLOCK_MASK (FLUID_SAMPLE_BLOCK_SIZE - 1)
+
+/* Number of decoded blocks cached per voice, must be a power of 2 */
+#define FLUID_SAMPLE_DECODER_SLOTS 4
+
+#define FLUID_SAMPLE_DECODER_SIZE (FLUID_SAMPLE_DECODER_SLOTS * FLUID_SAMPLE_BLOCK_SIZE)
+#define FLUID_SAMPLE_DECODER_MASK (FLUID_SAMPLE_DECODER_SIZE - 1)
+
+typedef struct _fluid_compressed_sample_t fluid_compressed_sample_t;
+typedef struct _fluid_sample_decoder_t fluid_sample_decoder_t;
+
+struct _fluid_compressed_sample_t
+{
+    unsigned int count;         /* number of sample points */
+    unsigned int block_count;
+    size_t *offsets;            /* byte offset of each block in data, plus the total size */
+    unsigned char *data;        /* encoded blocks */
+};
+
+struct _fluid_sample_decoder_t
+{
+    const fluid_compressed_sample_t *sample;    /* sample being played */
+
+    /* Block b is decoded into slot b % FLUID_SAMPLE_DECODER_SLOTS, the slots follow each
+     * other in data, so the point at index is data[index & FLUID_SAMPLE_DECODER_MASK] */
+    unsigned int blocks[FLUID_SAMPLE_DECODER_SLOTS];    /* index of the block in each slot, UINT_MAX if empty */
+    short data[FLUID_SAMPLE_DECODER_SIZE];
+
+    /* Decoding work since the decoder was last reset, collected by the synth */
+    unsigned int decoded_blocks;
+    double decode_usec;
+};
+
+fluid_compressed_sample_t *new_fluid_compressed_sample(const short *data, unsigned int count);
+void delete_fluid_compressed_sample(fluid_compressed_sample_t *sample);
+
+void fluid_compressed_sample_decode_block(const fluid_compressed_sample_t *sample,
+        unsigned int block, short *out);
+
+fluid_sample_decoder_t *new_fluid_sample_decoder(void);
+void delete_fluid_sample_decoder(fluid_sample_decoder_t *decoder);
+
+void fluid_sample_decoder_set_sample(fluid_sample_decoder_t *decoder,
+                                     const fluid_compressed_sample_t *sample);
+void fluid_sample_decoder_fill(fluid_sample_decoder_t *decoder, unsigned int block);
+int fluid_sample_decoder_prefetch(fluid_sample_decoder_t *decoder,
+                                  unsigned int index, unsigned int count);
+
+/* Get the sample point at index, decoding its block if it isn't cached yet */
+static FLUID_INLINE short
+fluid_sample_decoder_get(fluid_sample_decoder_t *decoder, unsigned int index)
+{
+    unsigned int block = index >> FLUID_SAMPLE_BLOCK_SHIFT;
+
+    if(FLUID_UNLIKELY(decoder->blocks[block & (FLUID_SAMPLE_DECODER_SLOTS - 1)] != block))
+    {
+        fluid_sample_decoder_fill(decoder, block);
+    }
+
+    return decoder->data[index & FLUID_SAMPLE_DECODER_MASK];
+}
+
+/*
+ * Get the sample point at index without checking whether its block is cached.
+ *
+ * The index is masked, so this never reads outside of the cache. If the block isn't
+ * cached, a point of another block is returned. That's why fluid_rvoice_write() only
+ * uses the routines reading this way when fluid_sample_decoder_prefetch() has cached
+ * every point from 3 before to 3 after the points played in a block, and the voice
+ * doesn't get near a loop boundary within the block. The interpolation routines also
+ * read the points at the loop or sample boundaries before playing. Those may be stale,
+ * but are only used once the playback position reaches them, and then they are among
+ * the points prefetched.
+ */
+static FLUID_INLINE short
+fluid_sample_decoder_get_cached(const fluid_sample_decoder_t *decoder, unsigned int index)
+{
+    return decoder->data[index & FLUID_SAMPLE_DECODER_MASK];
+}
+
+#endif /* _FLUID_SAMPLECODEC_H */
@@ -25,6 +25,7 @@
 #include "fluid_sffile.h"
 #include "fluid_sfont.h"
 #include "fluid_sys.h"
+#include "fluid_hugemem.h"
 
 #if LIBSNDFILE_SUPPORT
 #include <sndfile.h>
@@ -67,6 +68,12 @@
 #define SHDR_FCC    FLUID_FOURCC('s','h','d','r') /* sample info */
 #define SM24_FCC    FLUID_FOURCC('s','m','2','4')
 
+/* Sample data is read in pieces of this size, to be able to report loading progress */
+#define SAMPLE_READ_CHUNK_SIZE (1024 * 1024)
+
+/* Sample data smaller than this is not put on huge pages, it would waste more than half of them */
+#define FLUID_SAMPLE_HUGE_MIN_SIZE (FLUID_HUGE_PAGE_SIZE / 2)
+
 /* Set when the FCC code is unknown */
 #define UNKN_ID     FLUID_N_ELEMENTS(idlist)
 
@@ -226,15 +233,6 @@ static const unsigned short invalid_preset_gen[] =
         ((SFChunk *)(var))->size = FLUID_LE32TOH(((SFChunk *)(var))->size); \
     } while (0)
 
-#define READD(sf, var)                                            \
-    do                                                            \
-    {                                                             \
-        uint32_t _temp;                                           \
-        if (sf->fcbs->fread(&_temp, 4, sf->sffd) == FLUID_FAILED) \
-            return FALSE;                                         \
-        var = FLUID_LE32TOH(_temp);                               \
-    } while (0)
-
 #define READW(sf, var)                                            \
     do                                                            \
     {                                                             \
@@ -251,44 +249,24 @@ static const unsigned short invalid_preset_gen[] =
             return FALSE;                                      \
     } while (0)
 
-#define READSTR(sf, var)                                        \
-    do                                                          \
-    {                                                           \
-        if (sf->fcbs->fread(var, 20, sf->sffd) == FLUID_FAILED) \
-            return FALSE;                                       \
-        (*var)[20] = '\0';                                      \
-    } while (0)
-
-#define READB(sf, var)                                          \
-    do                                                          \
-    {                                                           \
-        if (sf->fcbs->fread(&var, 1, sf->sffd) == FLUID_FAILED) \
-            return FALSE;                                       \
-    } while (0)
-
 #define FSKIP(sf, size)                                                \
     do                                                                 \
     {                                                                  \
-        if (sf->fcbs->fseek(sf->sffd, size, SEEK_CUR) == FLUID_FAILED) \
+        if (fluid_file_seek(sf->fcbs, sf->sffd, size, SEEK_CUR) == FLUID_FAILED) \
             return FALSE;                                              \
     } while (0)
 
-#define FSKIPW(sf)                                                  \
-    do                                                              \
-    {                                                               \
-        if (sf->fcbs->fseek(sf->sffd, 2, SEEK_CUR) == FLUID_FAILED) \
-            return FALSE;                                           \
-    } while (0)
+/* read little endian words from the in-memory PDTA chunk */
+#define GETW(p) ((unsigned short)((p)[0] | ((p)[1] << 8)))
+#define GETD(p) ((unsigned int)(p)[0] | ((unsigned int)(p)[1] << 8) \
+                 | ((unsigned int)(p)[2] << 16) | ((unsigned int)(p)[3] << 24))
 
-/* removes and advances a fluid_list_t pointer */
-#define SLADVREM(list, item)                        \
-    do                                              \
-    {                                               \
-        fluid_list_t *_temp = item;                 \
-        item = fluid_list_next(item);               \
-        list = fluid_list_remove_link(list, _temp); \
-        delete1_fluid_list(_temp);                  \
-    } while (0)
+/* records of a PDTA sub-chunk within the in-memory PDTA chunk */
+typedef struct
+{
+    const unsigned char *data;
+    int count;
+} SFRecords;
 
 
 static int load_header(SFData *sf);
@@ -296,33 +274,25 @@ static int load_body(SFData *sf);
 static int process_info(SFData *sf, int size);
 static int process_sdta(SFData *sf, unsigned int size);
 static int process_pdta(SFData *sf, int size);
-static int load_phdr(SFData *sf, int size);
-static int load_pbag(SFData *sf, int size);
-static int load_pmod(SFData *sf, int size);
-static int load_pgen(SFData *sf, int size);
-static int load_ihdr(SFData *sf, int size);
-static int load_ibag(SFData *sf, int size);
-static int load_imod(SFData *sf, int size);
-static int load_igen(SFData *sf, int size);
-static int load_shdr(SFData *sf, unsigned int size);
-static int fixup_pgen(SFData *sf);
-static int fixup_igen(SFData *sf);
+static int load_phdr(SFData *sf, const SFRecords *phdr);
+static int load_ihdr(SFData *sf, const SFRecords *ihdr);
+static int load_zones(SFData *sf, int preset, const SFRecords *hdr, const SFRecords *bag,
+                      const SFRecords *mod, const SFRecords *gen);
+static int load_shdr(SFData *sf, const SFRecords *shdr);
 
 static int chunkid(uint32_t id);
 static int read_listchunk(SFData *sf, SFChunk *chunk);
-static int pdtahelper(SFData *sf, unsigned int expid, unsigned int reclen, SFChunk *chunk, int *size);
-static int preset_compare_func(void *a, void *b);
-static fluid_list_t *find_gen_by_id(int gen, fluid_list_t *genlist);
+static int pdtahelper(const unsigned char **pos, int *size, unsigned int expid, unsigned int reclen, SFRecords *rec);
+static int preset_compare_func(const void *a, const void *b);
+static SFGen *find_gen_by_id(int gen, SFGen *gens, int count);
 static int valid_inst_genid(unsigned short genid);
 static int valid_preset_genid(unsigned short genid);
 
 
-static void delete_preset(SFPreset *preset);
-static void delete_inst(SFInst *inst);
-static void delete_zone(SFZone *zone);
-
 static int fluid_sffile_read_vorbis(SFData *sf, unsigned int start_byte, unsigned int end_byte, short **data);
 static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int end, short **data, char **data24);
+static int fluid_sffile_read_chunked(SFData *sf, void *buf, unsigned int count,
+                                     fluid_long_long_t done, fluid_long_long_t total);
 
 /**
  * Check if a file is a SoundFont file.
@@ -384,7 +354,7 @@ int fluid_is_soundfont(const char *filename)
 SFData *fluid_sffile_open(const char *fname, const fluid_file_callbacks_t *fcbs)
 {
     SFData *sf;
-    int fsize = 0;
+    fluid_long_long_t fsize = 0;
 
     if(!(sf = FLUID_NEW(SFData)))
     {
@@ -411,13 +381,13 @@ SFData *fluid_sffile_open(const char *fname, const fluid_file_callbacks_t *fcbs)
     }
 
     /* get size of file by seeking to end */
-    if(fcbs->fseek(sf->sffd, 0L, SEEK_END) == FLUID_FAILED)
+    if(fluid_file_seek(fcbs, sf->sffd, 0L, SEEK_END) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Seek to end of file failed");
         goto error_exit;
     }
 
-    if((fsize = fcbs->ftell(sf->sffd)) == FLUID_FAILED)
+    if((fsize = fluid_file_tell(fcbs, sf->sffd)) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Get end of file position failed");
         goto error_exit;
@@ -425,7 +395,7 @@ SFData *fluid_sffile_open(const char *fname, const fluid_file_callbacks_t *fcbs)
 
     sf->filesize = fsize;
 
-    if(fcbs->fseek(sf->sffd, 0, SEEK_SET) == FLUID_FAILED)
+    if(fluid_file_seek(fcbs, sf->sffd, 0, SEEK_SET) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Rewind to start of file failed");
         goto error_exit;
@@ -499,8 +469,6 @@ int fluid_sffile_read_sample_data(SFData *sf, unsigned int sample_start, unsigne
 void fluid_sffile_close(SFData *sf)
 {
     fluid_list_t *entry;
-    SFPreset *preset;
-    SFInst *inst;
 
     if(sf->sffd)
     {
@@ -519,37 +487,15 @@ void fluid_sffile_close(SFData *sf)
 
     delete_fluid_list(sf->info);
 
-    entry = sf->preset;
-
-    while(entry)
-    {
-        preset = (SFPreset *)fluid_list_get(entry);
-        delete_preset(preset);
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(sf->preset);
-
-    entry = sf->inst;
-
-    while(entry)
-    {
-        inst = (SFInst *)fluid_list_get(entry);
-        delete_inst(inst);
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(sf->inst);
-
-    entry = sf->sample;
-
-    while(entry)
-    {
-        FLUID_FREE(fluid_list_get(entry));
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(sf->sample);
+    FLUID_FREE(sf->preset);
+    FLUID_FREE(sf->pzone);
+    FLUID_FREE(sf->pgen);
+    FLUID_FREE(sf->pmod);
+    FLUID_FREE(sf->inst);
+    FLUID_FREE(sf->izone);
+    FLUID_FREE(sf->igen);
+    FLUID_FREE(sf->imod);
+    FLUID_FREE(sf->sample);
 
     FLUID_FREE(sf);
 }
@@ -650,7 +596,7 @@ static int load_header(SFData *sf)
         return FALSE;
     }
 
-    sf->hydrapos = sf->fcbs->ftell(sf->sffd);
+    sf->hydrapos = fluid_file_tell(sf->fcbs, sf->sffd);
     sf->hydrasize = chunk.size;
 
     return TRUE;
@@ -658,7 +604,7 @@ static int load_header(SFData *sf)
 
 static int load_body(SFData *sf)
 {
-    if(sf->fcbs->fseek(sf->sffd, sf->hydrapos, SEEK_SET) == FLUID_FAILED)
+    if(fluid_file_seek(sf->fcbs, sf->sffd, sf->hydrapos, SEEK_SET) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Failed to seek to HYDRA position");
         return FALSE;
@@ -669,19 +615,12 @@ static int load_body(SFData *sf)
         return FALSE;
     }
 
-    if(!fixup_pgen(sf))
-    {
-        return FALSE;
-    }
-
-    if(!fixup_igen(sf))
+    /* sort presets by bank, preset # */
+    if(sf->preset_count > 1)
     {
-        return FALSE;
+        qsort(sf->preset, sf->preset_count, sizeof(SFPreset), preset_compare_func);
     }
 
-    /* sort preset list by bank, preset # */
-    sf->preset = fluid_list_sort(sf->preset, (fluid_compare_func_t)preset_compare_func);
-
     return TRUE;
 }
 
@@ -847,7 +786,7 @@ static int process_sdta(SFData *sf, unsigned int size)
     }
 
     /* sample data follows */
-    sf->samplepos = sf->fcbs->ftell(sf->sffd);
+    sf->samplepos = fluid_file_tell(sf->fcbs, sf->sffd);
 
     /* used to check validity of sample headers */
     sf->samplesize = chunk.size;
@@ -866,7 +805,7 @@ static int process_sdta(SFData *sf, unsigned int size)
 
             if(chunk.id == SM24_FCC)
             {
-                int sm24size, sdtahalfsize;
+                unsigned int sm24size, sdtahalfsize;
 
                 FLUID_LOG(FLUID_DBG, "Found SM24 chunk");
 
@@ -890,7 +829,7 @@ static int process_sdta(SFData *sf, unsigned int size)
                 }
 
                 /* sample data24 follows */
-                sf->sample24pos = sf->fcbs->ftell(sf->sffd);
+                sf->sample24pos = fluid_file_tell(sf->fcbs, sf->sffd);
                 sf->sample24size = sm24size;
             }
         }
@@ -902,1420 +841,665 @@ ret:
     return TRUE;
 }
 
-static int pdtahelper(SFData *sf, unsigned int expid, unsigned int reclen, SFChunk *chunk, int *size)
+static int pdtahelper(const unsigned char **pos, int *size, unsigned int expid, unsigned int reclen, SFRecords *rec)
 {
-    READCHUNK(sf, chunk);
-    *size -= 8;
+    SFChunk chunk;
+
+    if((*size -= 8) < 0)
+    {
+        FLUID_LOG(FLUID_ERR, "Expected PDTA sub-chunk '%.4s' found end of PDTA chunk instead", &expid);
+        return FALSE;
+    }
+
+    FLUID_MEMCPY(&chunk, *pos, 8);
+    chunk.size = FLUID_LE32TOH(chunk.size);
+    *pos += 8;
 
-    if(chunk->id != expid)
+    if(chunk.id != expid)
     {
         FLUID_LOG(FLUID_ERR, "Expected PDTA sub-chunk '%.4s' found invalid id instead", &expid);
         return FALSE;
     }
 
-    if(chunk->size % reclen)  /* valid chunk size? */
+    if(chunk.size % reclen)  /* valid chunk size? */
     {
         FLUID_LOG(FLUID_ERR, "'%.4s' chunk size is not a multiple of %d bytes", &expid, reclen);
         return FALSE;
     }
 
-    if((*size -= chunk->size) < 0)
+    if((*size -= chunk.size) < 0)
     {
         FLUID_LOG(FLUID_ERR, "'%.4s' chunk size exceeds remaining PDTA chunk size", &expid);
         return FALSE;
     }
 
+    rec->data = *pos;
+    rec->count = chunk.size / reclen;
+    *pos += chunk.size;
+
     return TRUE;
 }
 
+/* The whole PDTA chunk is read into memory with a single read and then parsed into
+ * arrays. Instruments and samples are parsed before the presets, so that zones can
+ * refer to them directly. */
 static int process_pdta(SFData *sf, int size)
 {
-    SFChunk chunk;
+    unsigned char *buf;
+    const unsigned char *pos;
+    SFRecords phdr, pbag, pmod, pgen, ihdr, ibag, imod, igen, shdr;
+    int ret = FALSE;
 
-    if(!pdtahelper(sf, PHDR_FCC, SF_PHDR_SIZE, &chunk, &size))
+    if(size <= 0)
     {
+        FLUID_LOG(FLUID_ERR, "PDTA chunk size is invalid");
         return FALSE;
     }
 
-    if(!load_phdr(sf, chunk.size))
+    if((buf = FLUID_MALLOC(size)) == NULL)
     {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
         return FALSE;
     }
 
-    if(!pdtahelper(sf, PBAG_FCC, SF_BAG_SIZE, &chunk, &size))
+    if(sf->fcbs->fread(buf, size, sf->sffd) == FLUID_FAILED)
     {
-        return FALSE;
+        goto exit;
     }
 
-    if(!load_pbag(sf, chunk.size))
-    {
-        return FALSE;
-    }
+    pos = buf;
 
-    if(!pdtahelper(sf, PMOD_FCC, SF_MOD_SIZE, &chunk, &size))
+    if(!pdtahelper(&pos, &size, PHDR_FCC, SF_PHDR_SIZE, &phdr)
+            || !pdtahelper(&pos, &size, PBAG_FCC, SF_BAG_SIZE, &pbag)
+            || !pdtahelper(&pos, &size, PMOD_FCC, SF_MOD_SIZE, &pmod)
+            || !pdtahelper(&pos, &size, PGEN_FCC, SF_GEN_SIZE, &pgen)
+            || !pdtahelper(&pos, &size, IHDR_FCC, SF_IHDR_SIZE, &ihdr)
+            || !pdtahelper(&pos, &size, IBAG_FCC, SF_BAG_SIZE, &ibag)
+            || !pdtahelper(&pos, &size, IMOD_FCC, SF_MOD_SIZE, &imod)
+            || !pdtahelper(&pos, &size, IGEN_FCC, SF_GEN_SIZE, &igen)
+            || !pdtahelper(&pos, &size, SHDR_FCC, SF_SHDR_SIZE, &shdr))
     {
-        return FALSE;
+        goto exit;
     }
 
-    if(!load_pmod(sf, chunk.size))
+    if(!load_shdr(sf, &shdr)
+            || !load_ihdr(sf, &ihdr)
+            || !load_zones(sf, FALSE, &ihdr, &ibag, &imod, &igen)
+            || !load_phdr(sf, &phdr)
+            || !load_zones(sf, TRUE, &phdr, &pbag, &pmod, &pgen))
     {
-        return FALSE;
+        goto exit;
     }
 
-    if(!pdtahelper(sf, PGEN_FCC, SF_GEN_SIZE, &chunk, &size))
-    {
-        return FALSE;
-    }
+    ret = TRUE;
 
-    if(!load_pgen(sf, chunk.size))
-    {
-        return FALSE;
-    }
+exit:
+    FLUID_FREE(buf);
+    return ret;
+}
 
-    if(!pdtahelper(sf, IHDR_FCC, SF_IHDR_SIZE, &chunk, &size))
-    {
-        return FALSE;
-    }
+/* preset header loader */
+static int load_phdr(SFData *sf, const SFRecords *phdr)
+{
+    int i;
+    const unsigned char *p;
+    SFPreset *preset;
+    unsigned short pbag_idx, prev_pbag_idx = 0;
 
-    if(!load_ihdr(sf, chunk.size))
+    if(phdr->count == 0)
     {
+        FLUID_LOG(FLUID_ERR, "Preset header chunk size is invalid");
         return FALSE;
     }
 
-    if(!pdtahelper(sf, IBAG_FCC, SF_BAG_SIZE, &chunk, &size))
+    if(phdr->count == 1)
     {
-        return FALSE;
+        /* at least one preset + term record */
+        FLUID_LOG(FLUID_WARN, "File contains no presets");
+        return TRUE;
     }
 
-    if(!load_ibag(sf, chunk.size))
+    if((sf->preset = FLUID_ARRAY(SFPreset, phdr->count - 1)) == NULL)
     {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
         return FALSE;
     }
 
-    if(!pdtahelper(sf, IMOD_FCC, SF_MOD_SIZE, &chunk, &size))
-    {
-        return FALSE;
-    }
+    FLUID_MEMSET(sf->preset, 0, (phdr->count - 1) * sizeof(SFPreset));
+    sf->preset_count = phdr->count - 1;
 
-    if(!load_imod(sf, chunk.size))
+    /* the terminal record only provides the end of the last preset's bag range */
+    for(i = 0, p = phdr->data; i < phdr->count; i++, p += SF_PHDR_SIZE)
     {
-        return FALSE;
-    }
+        pbag_idx = GETW(p + 24);
 
-    if(!pdtahelper(sf, IGEN_FCC, SF_GEN_SIZE, &chunk, &size))
-    {
-        return FALSE;
-    }
+        if(i == 0)
+        {
+            if(pbag_idx > 0)  /* 1st preset, warn if ofs >0 */
+            {
+                FLUID_LOG(FLUID_WARN, "%d preset zones not referenced, discarding", pbag_idx);
+            }
+        }
+        else if(pbag_idx < prev_pbag_idx)
+        {
+            FLUID_LOG(FLUID_ERR, "Preset header indices not monotonic");
+            return FALSE;
+        }
 
-    if(!load_igen(sf, chunk.size))
-    {
-        return FALSE;
-    }
+        prev_pbag_idx = pbag_idx;
 
-    if(!pdtahelper(sf, SHDR_FCC, SF_SHDR_SIZE, &chunk, &size))
-    {
-        return FALSE;
-    }
+        if(i == sf->preset_count)
+        {
+            break;
+        }
 
-    if(!load_shdr(sf, chunk.size))
-    {
-        return FALSE;
+        preset = &sf->preset[i];
+        FLUID_MEMCPY(preset->name, p, 20);
+        preset->name[20] = '\0';
+        preset->prenum = GETW(p + 20);
+        preset->bank = GETW(p + 22);
+        preset->libr = GETD(p + 26);
+        preset->genre = GETD(p + 30);
+        preset->morph = GETD(p + 34);
     }
 
     return TRUE;
 }
 
-/* preset header loader */
-static int load_phdr(SFData *sf, int size)
+/* instrument header loader */
+static int load_ihdr(SFData *sf, const SFRecords *ihdr)
 {
-    int i, i2;
-    SFPreset *preset, *prev_preset = NULL;
-    unsigned short pbag_idx, prev_pbag_idx = 0;
+    int i;
+    const unsigned char *p;
+    SFInst *inst;
+    unsigned short zndx, pzndx = 0;
 
-    if(size % SF_PHDR_SIZE || size == 0)
+    if(ihdr->count == 0)  /* chunk size is valid? */
     {
-        FLUID_LOG(FLUID_ERR, "Preset header chunk size is invalid");
+        FLUID_LOG(FLUID_ERR, "Instrument header has invalid size");
         return FALSE;
     }
 
-    i = size / SF_PHDR_SIZE - 1;
-
-    if(i == 0)
+    if(ihdr->count == 1)
     {
         /* at least one preset + term record */
-        FLUID_LOG(FLUID_WARN, "File contains no presets");
-        FSKIP(sf, SF_PHDR_SIZE);
+        FLUID_LOG(FLUID_WARN, "File contains no instruments");
         return TRUE;
     }
 
-    for(; i > 0; i--)
+    if((sf->inst = FLUID_ARRAY(SFInst, ihdr->count - 1)) == NULL)
     {
-        /* load all preset headers */
-        if((preset = FLUID_NEW(SFPreset)) == NULL)
-        {
-            FLUID_LOG(FLUID_ERR, "Out of memory");
-            return FALSE;
-        }
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return FALSE;
+    }
 
-        sf->preset = fluid_list_append(sf->preset, preset);
-        preset->zone = NULL; /* In case of failure, fluid_sffile_close can cleanup */
-        READSTR(sf, &preset->name); /* possible read failure ^ */
-        READW(sf, preset->prenum);
-        READW(sf, preset->bank);
-        READW(sf, pbag_idx);
-        READD(sf, preset->libr);
-        READD(sf, preset->genre);
-        READD(sf, preset->morph);
-
-        if(prev_preset)
-        {
-            /* not first preset? */
-            if(pbag_idx < prev_pbag_idx)
-            {
-                FLUID_LOG(FLUID_ERR, "Preset header indices not monotonic");
-                return FALSE;
-            }
+    FLUID_MEMSET(sf->inst, 0, (ihdr->count - 1) * sizeof(SFInst));
+    sf->inst_count = ihdr->count - 1;
 
-            i2 = pbag_idx - prev_pbag_idx;
+    for(i = 0, p = ihdr->data; i < ihdr->count; i++, p += SF_IHDR_SIZE)
+    {
+        zndx = GETW(p + 20);
 
-            while(i2--)
+        if(i == 0)
+        {
+            if(zndx > 0)  /* 1st inst, warn if ofs >0 */
             {
-                prev_preset->zone = fluid_list_prepend(prev_preset->zone, NULL);
+                FLUID_LOG(FLUID_WARN, "%d instrument zones not referenced, discarding", zndx);
             }
         }
-        else if(pbag_idx > 0)  /* 1st preset, warn if ofs >0 */
+        else if(zndx < pzndx)
         {
-            FLUID_LOG(FLUID_WARN, "%d preset zones not referenced, discarding", pbag_idx);
+            FLUID_LOG(FLUID_ERR, "Instrument header indices not monotonic");
+            return FALSE;
         }
 
-        prev_preset = preset; /* update preset ptr */
-        prev_pbag_idx = pbag_idx;
-    }
-
-    FSKIP(sf, 24);
-    READW(sf, pbag_idx); /* Read terminal generator index */
-    FSKIP(sf, 12);
-
-    if(pbag_idx < prev_pbag_idx)
-    {
-        FLUID_LOG(FLUID_ERR, "Preset header indices not monotonic");
-        return FALSE;
-    }
+        pzndx = zndx;
 
-    i2 = pbag_idx - prev_pbag_idx;
+        if(i == sf->inst_count)
+        {
+            break;
+        }
 
-    while(i2--)
-    {
-        prev_preset->zone = fluid_list_prepend(prev_preset->zone, NULL);
+        inst = &sf->inst[i];
+        FLUID_MEMCPY(inst->name, p, 20);
+        inst->name[20] = '\0';
+        inst->idx = i;
     }
 
     return TRUE;
 }
 
-/* preset bag loader */
-static int load_pbag(SFData *sf, int size)
+/* -------------------------------------------------------------------
+ * preset and instrument zone loader
+ *
+ * Bags, generators and modulators are addressed by the indices stored in
+ * the header and bag records. All zones, generators and modulators of the
+ * presets (or instruments) are stored in one array each, every preset
+ * (instrument) and zone points into them.
+ *
+ * zone loading rules:
+ * Global zone must be 1st zone, discard additional ones (zones
+ * without instrument/sample)
+ *
+ * generator (per zone) loading rules (in order of decreasing precedence):
+ * KeyRange is 1st in list (if exists), else discard
+ * if a VelRange exists only preceded by a KeyRange, else discard
+ * if a generator follows an instrument/sample discard it
+ * if a duplicate generator exists replace previous one
+ * ------------------------------------------------------------------- */
+static int load_zones(SFData *sf, int preset, const SFRecords *hdr, const SFRecords *bag,
+                      const SFRecords *mod, const SFRecords *gen)
 {
-    fluid_list_t *p, *p2;
-    SFZone *z, *pz = NULL;
-    unsigned short genndx, modndx;
-    unsigned short pgenndx = 0, pmodndx = 0;
-    unsigned short i;
+    const char *type = preset ? "Preset" : "Instrument";
+    const int hdr_size = preset ? SF_PHDR_SIZE : SF_IHDR_SIZE;
+    const int hdr_bag_ofs = preset ? 24 : 20;
+    const unsigned short term_genid = preset ? Gen_Instrument : Gen_SampleId;
+    int count = preset ? sf->preset_count : sf->inst_count;
+    int first_bag, last_bag, first_gen, last_gen, first_mod, last_mod;
+    int i, j, k, g, level, discarded, global_zone, zone_count, gen_count;
+    const unsigned char *p;
+    unsigned short genid, genndx, modndx, pgenndx = 0, pmodndx = 0;
+    SFZone *zones = NULL, *z, save;
+    SFGen *gens = NULL, *dup;
+    SFMod *mods = NULL, *m;
+    SFGenAmount genval;
+    char *name;
 
-    if(size % SF_BAG_SIZE || size == 0)  /* size is multiple of SF_BAG_SIZE? */
+    if(bag->count == 0)  /* size is multiple of SF_BAG_SIZE? */
     {
-        FLUID_LOG(FLUID_ERR, "Preset bag chunk size is invalid");
+        FLUID_LOG(FLUID_ERR, "%s bag chunk size is invalid", type);
         return FALSE;
     }
 
-    p = sf->preset;
+    /* bag index range used by all headers, the terminal header marks the end */
+    first_bag = count ? GETW(hdr->data + hdr_bag_ofs) : 0;
+    last_bag = count ? GETW(hdr->data + count * hdr_size + hdr_bag_ofs) : 0;
+
+    if(bag->count != last_bag + 1)
+    {
+        FLUID_LOG(FLUID_ERR, "%s bag chunk size mismatch", type);
+        return FALSE;
+    }
 
-    while(p)
+    /* check generator and modulator indices of all used bags plus terminal bag */
+    for(j = first_bag, p = bag->data + first_bag * SF_BAG_SIZE; j <= last_bag; j++, p += SF_BAG_SIZE)
     {
-        /* traverse through presets */
-        p2 = ((SFPreset *)(p->data))->zone;
+        genndx = GETW(p);
+        modndx = GETW(p + 2);
 
-        while(p2)
+        if(j > first_bag)
         {
-            /* traverse preset's zones */
-            if((size -= SF_BAG_SIZE) < 0)
+            if(genndx < pgenndx)
             {
-                FLUID_LOG(FLUID_ERR, "Preset bag chunk size mismatch");
+                FLUID_LOG(FLUID_ERR, "%s bag generator indices not monotonic", type);
                 return FALSE;
             }
 
-            if((z = FLUID_NEW(SFZone)) == NULL)
+            if(modndx < pmodndx)
             {
-                FLUID_LOG(FLUID_ERR, "Out of memory");
+                FLUID_LOG(FLUID_ERR, "%s bag modulator indices not monotonic", type);
                 return FALSE;
             }
-
-            p2->data = z;
-            z->gen = NULL; /* Init gen and mod before possible failure, */
-            z->mod = NULL; /* to ensure proper cleanup (fluid_sffile_close) */
-            READW(sf, genndx); /* possible read failure ^ */
-            READW(sf, modndx);
-            z->instsamp = NULL;
-
-            if(pz)
-            {
-                /* if not first zone */
-                if(genndx < pgenndx)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset bag generator indices not monotonic");
-                    return FALSE;
-                }
-
-                if(modndx < pmodndx)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset bag modulator indices not monotonic");
-                    return FALSE;
-                }
-
-                i = genndx - pgenndx;
-
-                while(i--)
-                {
-                    pz->gen = fluid_list_prepend(pz->gen, NULL);
-                }
-
-                i = modndx - pmodndx;
-
-                while(i--)
-                {
-                    pz->mod = fluid_list_prepend(pz->mod, NULL);
-                }
-            }
-
-            pz = z; /* update previous zone ptr */
-            pgenndx = genndx; /* update previous zone gen index */
-            pmodndx = modndx; /* update previous zone mod index */
-            p2 = fluid_list_next(p2);
         }
 
-        p = fluid_list_next(p);
+        pgenndx = genndx;
+        pmodndx = modndx;
     }
 
-    size -= SF_BAG_SIZE;
-
-    if(size != 0)
-    {
-        FLUID_LOG(FLUID_ERR, "Preset bag chunk size mismatch");
-        return FALSE;
-    }
-
-    READW(sf, genndx);
-    READW(sf, modndx);
-
-    if(!pz)
+    if(first_bag == last_bag)
     {
-        if(genndx > 0)
+        /* in case that all are no zoners */
+        if(pgenndx > 0)
         {
-            FLUID_LOG(FLUID_WARN, "No preset generators and terminal index not 0");
+            FLUID_LOG(FLUID_WARN, "No %s generators and terminal index not 0", type);
         }
 
-        if(modndx > 0)
+        if(pmodndx > 0)
         {
-            FLUID_LOG(FLUID_WARN, "No preset modulators and terminal index not 0");
+            FLUID_LOG(FLUID_WARN, "No %s modulators and terminal index not 0", type);
         }
 
-        return TRUE;
+        first_gen = last_gen = first_mod = last_mod = 0;
     }
-
-    if(genndx < pgenndx)
+    else
     {
-        FLUID_LOG(FLUID_ERR, "Preset bag generator indices not monotonic");
-        return FALSE;
+        p = bag->data + first_bag * SF_BAG_SIZE;
+        first_gen = GETW(p);
+        first_mod = GETW(p + 2);
+        last_gen = pgenndx;
+        last_mod = pmodndx;
     }
 
-    if(modndx < pmodndx)
+    /* the terminal generator and modulator records are optional */
+    if(gen->count != last_gen && gen->count != last_gen + 1)
     {
-        FLUID_LOG(FLUID_ERR, "Preset bag modulator indices not monotonic");
+        FLUID_LOG(FLUID_ERR, "%s generator chunk size mismatch", type);
         return FALSE;
     }
 
-    i = genndx - pgenndx;
-
-    while(i--)
-    {
-        pz->gen = fluid_list_prepend(pz->gen, NULL);
-    }
-
-    i = modndx - pmodndx;
-
-    while(i--)
+    if(mod->count != last_mod && mod->count != last_mod + 1)
     {
-        pz->mod = fluid_list_prepend(pz->mod, NULL);
+        FLUID_LOG(FLUID_ERR, "%s modulator chunk size mismatch", type);
+        return FALSE;
     }
 
-    return TRUE;
-}
-
-/* preset modulator loader */
-static int load_pmod(SFData *sf, int size)
-{
-    fluid_list_t *p, *p2, *p3;
-    SFMod *m;
-
-    p = sf->preset;
-
-    while(p)
+    if(last_bag > first_bag)
     {
-        /* traverse through all presets */
-        p2 = ((SFPreset *)(p->data))->zone;
+        zones = FLUID_ARRAY(SFZone, last_bag - first_bag);
 
-        while(p2)
+        if(zones == NULL)
         {
-            /* traverse this preset's zones */
-            p3 = ((SFZone *)(p2->data))->mod;
-
-            while(p3)
-            {
-                /* load zone's modulators */
-                if((size -= SF_MOD_SIZE) < 0)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset modulator chunk size mismatch");
-                    return FALSE;
-                }
-
-                if((m = FLUID_NEW(SFMod)) == NULL)
-                {
-                    FLUID_LOG(FLUID_ERR, "Out of memory");
-                    return FALSE;
-                }
-
-                p3->data = m;
-                READW(sf, m->src);
-                READW(sf, m->dest);
-                READW(sf, m->amount);
-                READW(sf, m->amtsrc);
-                READW(sf, m->trans);
-                p3 = fluid_list_next(p3);
-            }
-
-            p2 = fluid_list_next(p2);
+            goto error_oom;
         }
 
-        p = fluid_list_next(p);
+        FLUID_MEMSET(zones, 0, (last_bag - first_bag) * sizeof(SFZone));
     }
 
-    /*
-       If there isn't even a terminal record
-       Hmmm, the specs say there should be one, but..
-     */
-    if(size == 0)
+    if(last_gen > first_gen && (gens = FLUID_ARRAY(SFGen, last_gen - first_gen)) == NULL)
     {
-        return TRUE;
+        goto error_oom;
     }
 
-    size -= SF_MOD_SIZE;
-
-    if(size != 0)
+    if(last_mod > first_mod && (mods = FLUID_ARRAY(SFMod, last_mod - first_mod)) == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "Preset modulator chunk size mismatch");
-        return FALSE;
+        goto error_oom;
     }
 
-    FSKIP(sf, SF_MOD_SIZE); /* terminal mod */
-
-    return TRUE;
-}
+    /* hand the arrays over to SFData, fluid_sffile_close will cleanup if FAIL occurs */
+    if(preset)
+    {
+        sf->pzone = zones;
+        sf->pgen = gens;
+        sf->pmod = mods;
+    }
+    else
+    {
+        sf->izone = zones;
+        sf->igen = gens;
+        sf->imod = mods;
+    }
 
-/* -------------------------------------------------------------------
- * preset generator loader
- * generator (per preset) loading rules:
- * Zones with no generators or modulators shall be annihilated
- * Global zone must be 1st zone, discard additional ones (instrumentless zones)
- *
- * generator (per zone) loading rules (in order of decreasing precedence):
- * KeyRange is 1st in list (if exists), else discard
- * if a VelRange exists only preceded by a KeyRange, else discard
- * if a generator follows an instrument discard it
- * if a duplicate generator exists replace previous one
- * ------------------------------------------------------------------- */
-static int load_pgen(SFData *sf, int size)
-{
-    fluid_list_t *p, *p2, *p3, *dup, **hz = NULL;
-    SFZone *z;
-    SFGen *g;
-    SFGenAmount genval;
-    unsigned short genid;
-    int level, skip, drop, gzone, discarded;
+    /* modulators are taken over as they are */
+    for(j = 0, m = mods, p = mod->data + first_mod * SF_MOD_SIZE; j < last_mod - first_mod; j++, m++, p += SF_MOD_SIZE)
+    {
+        m->src = GETW(p);
+        m->dest = GETW(p + 2);
+        m->amount = (signed short)GETW(p + 4);
+        m->amtsrc = GETW(p + 6);
+        m->trans = GETW(p + 8);
+    }
 
-    p = sf->preset;
+    z = zones;
+    g = 0;
 
-    while(p)
+    for(i = 0; i < count; i++)
     {
-        /* traverse through all presets */
-        gzone = FALSE;
-        discarded = FALSE;
-        p2 = ((SFPreset *)(p->data))->zone;
+        int zone_start = GETW(hdr->data + i * hdr_size + hdr_bag_ofs);
+        int zone_end = GETW(hdr->data + (i + 1) * hdr_size + hdr_bag_ofs);
 
-        if(p2)
+        if(preset)
+        {
+            name = sf->preset[i].name;
+            sf->preset[i].zone = z;
+        }
+        else
         {
-            hz = &p2;
+            name = sf->inst[i].name;
+            sf->inst[i].zone = z;
         }
 
-        while(p2)
+        zone_count = 0;
+        discarded = FALSE;
+        global_zone = FALSE;
+
+        for(j = zone_start, p = bag->data + zone_start * SF_BAG_SIZE; j < zone_end; j++, p += SF_BAG_SIZE)
         {
-            /* traverse preset's zones */
+            const unsigned char *pg;
+            int gen_start = GETW(p);
+            int gen_end = GETW(p + SF_BAG_SIZE);
+            int ref = -1;
+
+            z->gen = gens ? &gens[g] : NULL;
+            z->mod_count = GETW(p + SF_BAG_SIZE + 2) - GETW(p + 2);
+            z->mod = z->mod_count ? &mods[GETW(p + 2) - first_mod] : NULL;
+            z->inst = NULL;
+            z->sample = NULL;
+            gen_count = 0;
             level = 0;
-            z = (SFZone *)(p2->data);
-            p3 = z->gen;
 
-            while(p3)
+            for(k = gen_start, pg = gen->data + gen_start * SF_GEN_SIZE; k < gen_end; k++, pg += SF_GEN_SIZE)
             {
                 /* load zone's generators */
+                genid = GETW(pg);
                 dup = NULL;
-                skip = FALSE;
-                drop = FALSE;
-
-                if((size -= SF_GEN_SIZE) < 0)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset generator chunk size mismatch");
-                    return FALSE;
-                }
-
-                READW(sf, genid);
 
                 if(genid == Gen_KeyRange)
                 {
                     /* nothing precedes */
-                    if(level == 0)
-                    {
-                        level = 1;
-                        READB(sf, genval.range.lo);
-                        READB(sf, genval.range.hi);
-                    }
-                    else
+                    if(level != 0)
                     {
-                        skip = TRUE;
+                        discarded = TRUE;
+                        continue;
                     }
+
+                    level = 1;
+                    genval.range.lo = pg[2];
+                    genval.range.hi = pg[3];
                 }
                 else if(genid == Gen_VelRange)
                 {
                     /* only KeyRange precedes */
-                    if(level <= 1)
-                    {
-                        level = 2;
-                        READB(sf, genval.range.lo);
-                        READB(sf, genval.range.hi);
-                    }
-                    else
+                    if(level > 1)
                     {
-                        skip = TRUE;
+                        discarded = TRUE;
+                        continue;
                     }
+
+                    level = 2;
+                    genval.range.lo = pg[2];
+                    genval.range.hi = pg[3];
                 }
-                else if(genid == Gen_Instrument)
+                else if(genid == term_genid)
                 {
-                    /* inst is last gen */
+                    /* inst/sample is last gen */
                     level = 3;
-                    READW(sf, genval.uword);
-                    ((SFZone *)(p2->data))->instsamp = FLUID_INT_TO_POINTER(genval.uword + 1);
-                    break; /* break out of generator loop */
+                    ref = GETW(pg + 2);
+                    break;
                 }
                 else
                 {
                     level = 2;
 
-                    if(valid_preset_genid(genid))
-                    {
-                        /* generator valid? */
-                        READW(sf, genval.sword);
-                        dup = find_gen_by_id(genid, z->gen);
-                    }
-                    else
+                    if(preset ? !valid_preset_genid(genid) : !valid_inst_genid(genid))
                     {
-                        skip = TRUE;
+                        discarded = TRUE;
+                        continue;
                     }
+
+                    genval.sword = (signed short)GETW(pg + 2);
+                    dup = find_gen_by_id(genid, z->gen, gen_count);
                 }
 
-                if(!skip)
+                if(dup)
                 {
-                    if(!dup)
-                    {
-                        /* if gen ! dup alloc new */
-                        if((g = FLUID_NEW(SFGen)) == NULL)
-                        {
-                            FLUID_LOG(FLUID_ERR, "Out of memory");
-                            return FALSE;
-                        }
-
-                        p3->data = g;
-                        g->id = genid;
-                    }
-                    else
-                    {
-                        g = (SFGen *)(dup->data); /* ptr to orig gen */
-                        drop = TRUE;
-                    }
-
-                    g->amount = genval;
-                }
-                else
-                {
-                    /* Skip this generator */
-                    discarded = TRUE;
-                    drop = TRUE;
-                    FSKIPW(sf);
-                }
-
-                if(!drop)
-                {
-                    p3 = fluid_list_next(p3);    /* next gen */
-                }
-                else
-                {
-                    SLADVREM(z->gen, p3);    /* drop place holder */
-                }
-
-            } /* generator loop */
-
-            if(level == 3)
-            {
-                SLADVREM(z->gen, p3);    /* zone has inst? */
-            }
-            else
-            {
-                /* congratulations its a global zone */
-                if(!gzone)
-                {
-                    /* Prior global zones? */
-                    gzone = TRUE;
-
-                    /* if global zone is not 1st zone, relocate */
-                    if(*hz != p2)
-                    {
-                        void *save = p2->data;
-                        FLUID_LOG(FLUID_WARN, "Preset '%s': Global zone is not first zone",
-                                  ((SFPreset *)(p->data))->name);
-                        SLADVREM(*hz, p2);
-                        *hz = fluid_list_prepend(*hz, save);
-                        continue;
-                    }
+                    /* if a duplicate generator exists replace previous one */
+                    dup->amount = genval;
                 }
                 else
                 {
-                    /* previous global zone exists, discard */
-                    FLUID_LOG(FLUID_WARN, "Preset '%s': Discarding invalid global zone",
-                              ((SFPreset *)(p->data))->name);
-                    *hz = fluid_list_remove(*hz, p2->data);
-                    delete_zone((SFZone *)fluid_list_get(p2));
+                    z->gen[gen_count].id = genid;
+                    z->gen[gen_count].amount = genval;
+                    gen_count++;
                 }
             }
 
-            while(p3)
-            {
-                /* Kill any zones following an instrument */
-                discarded = TRUE;
-
-                if((size -= SF_GEN_SIZE) < 0)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset generator chunk size mismatch");
-                    return FALSE;
-                }
-
-                FSKIP(sf, SF_GEN_SIZE);
-                SLADVREM(z->gen, p3);
-            }
-
-            p2 = fluid_list_next(p2); /* next zone */
-        }
-
-        if(discarded)
-        {
-            FLUID_LOG(FLUID_WARN,
-                      "Preset '%s': Some invalid generators were discarded",
-                      ((SFPreset *)(p->data))->name);
-        }
-
-        p = fluid_list_next(p);
-    }
-
-    /* in case there isn't a terminal record */
-    if(size == 0)
-    {
-        return TRUE;
-    }
-
-    size -= SF_GEN_SIZE;
-
-    if(size != 0)
-    {
-        FLUID_LOG(FLUID_ERR, "Preset generator chunk size mismatch");
-        return FALSE;
-    }
-
-    FSKIP(sf, SF_GEN_SIZE); /* terminal gen */
-
-    return TRUE;
-}
-
-/* instrument header loader */
-static int load_ihdr(SFData *sf, int size)
-{
-    int i, i2;
-    SFInst *p, *pr = NULL; /* ptr to current & previous instrument */
-    unsigned short zndx, pzndx = 0;
-
-    if(size % SF_IHDR_SIZE || size == 0)  /* chunk size is valid? */
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument header has invalid size");
-        return FALSE;
-    }
-
-    size = size / SF_IHDR_SIZE - 1;
-
-    if(size == 0)
-    {
-        /* at least one preset + term record */
-        FLUID_LOG(FLUID_WARN, "File contains no instruments");
-        FSKIP(sf, SF_IHDR_SIZE);
-        return TRUE;
-    }
-
-    for(i = 0; i < size; i++)
-    {
-        /* load all instrument headers */
-        if((p = FLUID_NEW(SFInst)) == NULL)
-        {
-            FLUID_LOG(FLUID_ERR, "Out of memory");
-            return FALSE;
-        }
-
-        sf->inst = fluid_list_append(sf->inst, p);
-        p->zone = NULL; /* For proper cleanup if fail (fluid_sffile_close) */
-        p->idx = i;
-        READSTR(sf, &p->name); /* Possible read failure ^ */
-        READW(sf, zndx);
-
-        if(pr)
-        {
-            /* not first instrument? */
-            if(zndx < pzndx)
-            {
-                FLUID_LOG(FLUID_ERR, "Instrument header indices not monotonic");
-                return FALSE;
-            }
-
-            i2 = zndx - pzndx;
-
-            while(i2--)
-            {
-                pr->zone = fluid_list_prepend(pr->zone, NULL);
-            }
-        }
-        else if(zndx > 0)  /* 1st inst, warn if ofs >0 */
-        {
-            FLUID_LOG(FLUID_WARN, "%d instrument zones not referenced, discarding", zndx);
-        }
-
-        pzndx = zndx;
-        pr = p; /* update instrument ptr */
-    }
-
-    FSKIP(sf, 20);
-    READW(sf, zndx);
-
-    if(zndx < pzndx)
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument header indices not monotonic");
-        return FALSE;
-    }
-
-    i2 = zndx - pzndx;
-
-    while(i2--)
-    {
-        pr->zone = fluid_list_prepend(pr->zone, NULL);
-    }
-
-    return TRUE;
-}
-
-/* instrument bag loader */
-static int load_ibag(SFData *sf, int size)
-{
-    fluid_list_t *p, *p2;
-    SFZone *z, *pz = NULL;
-    unsigned short genndx, modndx, pgenndx = 0, pmodndx = 0;
-    int i;
-
-    if(size % SF_BAG_SIZE || size == 0)  /* size is multiple of SF_BAG_SIZE? */
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument bag chunk size is invalid");
-        return FALSE;
-    }
-
-    p = sf->inst;
-
-    while(p)
-    {
-        /* traverse through inst */
-        p2 = ((SFInst *)(p->data))->zone;
-
-        while(p2)
-        {
-            /* load this inst's zones */
-            if((size -= SF_BAG_SIZE) < 0)
-            {
-                FLUID_LOG(FLUID_ERR, "Instrument bag chunk size mismatch");
-                return FALSE;
-            }
-
-            if((z = FLUID_NEW(SFZone)) == NULL)
-            {
-                FLUID_LOG(FLUID_ERR, "Out of memory");
-                return FALSE;
-            }
-
-            p2->data = z;
-            z->gen = NULL; /* In case of failure, */
-            z->mod = NULL; /* fluid_sffile_close can clean up */
-            READW(sf, genndx); /* READW = possible read failure */
-            READW(sf, modndx);
-            z->instsamp = NULL;
-
-            if(pz)
-            {
-                /* if not first zone */
-                if(genndx < pgenndx)
-                {
-                    FLUID_LOG(FLUID_ERR, "Instrument generator indices not monotonic");
-                    return FALSE;
-                }
-
-                if(modndx < pmodndx)
-                {
-                    FLUID_LOG(FLUID_ERR, "Instrument modulator indices not monotonic");
-                    return FALSE;
-                }
-
-                i = genndx - pgenndx;
-
-                while(i--)
-                {
-                    pz->gen = fluid_list_prepend(pz->gen, NULL);
-                }
-
-                i = modndx - pmodndx;
-
-                while(i--)
-                {
-                    pz->mod = fluid_list_prepend(pz->mod, NULL);
-                }
-            }
-
-            pz = z; /* update previous zone ptr */
-            pgenndx = genndx;
-            pmodndx = modndx;
-            p2 = fluid_list_next(p2);
-        }
-
-        p = fluid_list_next(p);
-    }
-
-    size -= SF_BAG_SIZE;
-
-    if(size != 0)
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument chunk size mismatch");
-        return FALSE;
-    }
-
-    READW(sf, genndx);
-    READW(sf, modndx);
-
-    if(!pz)
-    {
-        /* in case that all are no zoners */
-        if(genndx > 0)
-        {
-            FLUID_LOG(FLUID_WARN, "No instrument generators and terminal index not 0");
-        }
-
-        if(modndx > 0)
-        {
-            FLUID_LOG(FLUID_WARN, "No instrument modulators and terminal index not 0");
-        }
-
-        return TRUE;
-    }
-
-    if(genndx < pgenndx)
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument generator indices not monotonic");
-        return FALSE;
-    }
-
-    if(modndx < pmodndx)
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument modulator indices not monotonic");
-        return FALSE;
-    }
-
-    i = genndx - pgenndx;
-
-    while(i--)
-    {
-        pz->gen = fluid_list_prepend(pz->gen, NULL);
-    }
-
-    i = modndx - pmodndx;
-
-    while(i--)
-    {
-        pz->mod = fluid_list_prepend(pz->mod, NULL);
-    }
-
-    return TRUE;
-}
-
-/* instrument modulator loader */
-static int load_imod(SFData *sf, int size)
-{
-    fluid_list_t *p, *p2, *p3;
-    SFMod *m;
-
-    p = sf->inst;
-
-    while(p)
-    {
-        /* traverse through all inst */
-        p2 = ((SFInst *)(p->data))->zone;
-
-        while(p2)
-        {
-            /* traverse this inst's zones */
-            p3 = ((SFZone *)(p2->data))->mod;
-
-            while(p3)
-            {
-                /* load zone's modulators */
-                if((size -= SF_MOD_SIZE) < 0)
-                {
-                    FLUID_LOG(FLUID_ERR, "Instrument modulator chunk size mismatch");
-                    return FALSE;
-                }
-
-                if((m = FLUID_NEW(SFMod)) == NULL)
-                {
-                    FLUID_LOG(FLUID_ERR, "Out of memory");
-                    return FALSE;
-                }
-
-                p3->data = m;
-                READW(sf, m->src);
-                READW(sf, m->dest);
-                READW(sf, m->amount);
-                READW(sf, m->amtsrc);
-                READW(sf, m->trans);
-                p3 = fluid_list_next(p3);
-            }
-
-            p2 = fluid_list_next(p2);
-        }
-
-        p = fluid_list_next(p);
-    }
-
-    /*
-       If there isn't even a terminal record
-       Hmmm, the specs say there should be one, but..
-     */
-    if(size == 0)
-    {
-        return TRUE;
-    }
-
-    size -= SF_MOD_SIZE;
-
-    if(size != 0)
-    {
-        FLUID_LOG(FLUID_ERR, "Instrument modulator chunk size mismatch");
-        return FALSE;
-    }
-
-    FSKIP(sf, SF_MOD_SIZE); /* terminal mod */
-
-    return TRUE;
-}
-
-/* load instrument generators (see load_pgen for loading rules) */
-static int load_igen(SFData *sf, int size)
-{
-    fluid_list_t *p, *p2, *p3, *dup, **hz = NULL;
-    SFZone *z;
-    SFGen *g;
-    SFGenAmount genval;
-    unsigned short genid;
-    int level, skip, drop, gzone, discarded;
-
-    p = sf->inst;
-
-    while(p)
-    {
-        /* traverse through all instruments */
-        gzone = FALSE;
-        discarded = FALSE;
-        p2 = ((SFInst *)(p->data))->zone;
-
-        if(p2)
-        {
-            hz = &p2;
-        }
-
-        while(p2)
-        {
-            /* traverse this instrument's zones */
-            level = 0;
-            z = (SFZone *)(p2->data);
-            p3 = z->gen;
+            z->gen_count = gen_count;
 
-            while(p3)
+            if(level == 3)
             {
-                /* load zone's generators */
-                dup = NULL;
-                skip = FALSE;
-                drop = FALSE;
-
-                if((size -= SF_GEN_SIZE) < 0)
+                /* Kill any generators following an instrument/sample */
+                if(k + 1 < gen_end)
                 {
-                    FLUID_LOG(FLUID_ERR, "IGEN chunk size mismatch");
-                    return FALSE;
+                    discarded = TRUE;
                 }
 
-                READW(sf, genid);
-
-                if(genid == Gen_KeyRange)
-                {
-                    /* nothing precedes */
-                    if(level == 0)
-                    {
-                        level = 1;
-                        READB(sf, genval.range.lo);
-                        READB(sf, genval.range.hi);
-                    }
-                    else
-                    {
-                        skip = TRUE;
-                    }
-                }
-                else if(genid == Gen_VelRange)
+                if(preset)
                 {
-                    /* only KeyRange precedes */
-                    if(level <= 1)
-                    {
-                        level = 2;
-                        READB(sf, genval.range.lo);
-                        READB(sf, genval.range.hi);
-                    }
-                    else
+                    if(ref >= sf->inst_count)
                     {
-                        skip = TRUE;
+                        FLUID_LOG(FLUID_ERR, "Preset %03d %03d: Invalid instrument reference",
+                                  sf->preset[i].bank, sf->preset[i].prenum);
+                        return FALSE;
                     }
-                }
-                else if(genid == Gen_SampleId)
-                {
-                    /* sample is last gen */
-                    level = 3;
-                    READW(sf, genval.uword);
-                    ((SFZone *)(p2->data))->instsamp = FLUID_INT_TO_POINTER(genval.uword + 1);
-                    break; /* break out of generator loop */
+
+                    z->inst = &sf->inst[ref];
                 }
                 else
                 {
-                    level = 2;
-
-                    if(valid_inst_genid(genid))
-                    {
-                        /* gen valid? */
-                        READW(sf, genval.sword);
-                        dup = find_gen_by_id(genid, z->gen);
-                    }
-                    else
+                    if(ref >= sf->sample_count)
                     {
-                        skip = TRUE;
+                        FLUID_LOG(FLUID_ERR, "Instrument '%s': Invalid sample reference", name);
+                        return FALSE;
                     }
-                }
 
-                if(!skip)
-                {
-                    if(!dup)
-                    {
-                        /* if gen ! dup alloc new */
-                        if((g = FLUID_NEW(SFGen)) == NULL)
-                        {
-                            FLUID_LOG(FLUID_ERR, "Out of memory");
-                            return FALSE;
-                        }
-
-                        p3->data = g;
-                        g->id = genid;
-                    }
-                    else
-                    {
-                        g = (SFGen *)(dup->data);
-                        drop = TRUE;
-                    }
-
-                    g->amount = genval;
+                    z->sample = &sf->sample[ref];
                 }
-                else
-                {
-                    /* skip this generator */
-                    discarded = TRUE;
-                    drop = TRUE;
-                    FSKIPW(sf);
-                }
-
-                if(!drop)
-                {
-                    p3 = fluid_list_next(p3);    /* next gen */
-                }
-                else
-                {
-                    SLADVREM(z->gen, p3);
-                }
-
-            } /* generator loop */
-
-            if(level == 3)
+            }
+            else if(global_zone)
             {
-                SLADVREM(z->gen, p3);    /* zone has sample? */
+                /* previous global zone exists, discard */
+                FLUID_LOG(FLUID_WARN, "%s '%s': Discarding invalid global zone", type, name);
+                continue;
             }
             else
             {
-                /* its a global zone */
-                if(!gzone)
-                {
-                    gzone = TRUE;
+                global_zone = TRUE;
 
-                    /* if global zone is not 1st zone, relocate */
-                    if(*hz != p2)
-                    {
-                        void *save = p2->data;
-                        FLUID_LOG(FLUID_WARN, "Instrument '%s': Global zone is not first zone",
-                                  ((SFPreset *)(p->data))->name);
-                        SLADVREM(*hz, p2);
-                        *hz = fluid_list_prepend(*hz, save);
-                        continue;
-                    }
-                }
-                else
+                /* if global zone is not 1st zone, relocate */
+                if(zone_count > 0)
                 {
-                    /* previous global zone exists, discard */
-                    FLUID_LOG(FLUID_WARN, "Instrument '%s': Discarding invalid global zone",
-                              ((SFInst *)(p->data))->name);
-                    *hz = fluid_list_remove(*hz, p2->data);
-                    delete_zone((SFZone *)fluid_list_get(p2));
+                    FLUID_LOG(FLUID_WARN, "%s '%s': Global zone is not first zone", type, name);
+                    save = *z;
+                    FLUID_MEMMOVE(z - zone_count + 1, z - zone_count, zone_count * sizeof(SFZone));
+                    *(z - zone_count) = save;
                 }
             }
 
-            while(p3)
-            {
-                /* Kill any zones following a sample */
-                discarded = TRUE;
-
-                if((size -= SF_GEN_SIZE) < 0)
-                {
-                    FLUID_LOG(FLUID_ERR, "Instrument generator chunk size mismatch");
-                    return FALSE;
-                }
-
-                FSKIP(sf, SF_GEN_SIZE);
-                SLADVREM(z->gen, p3);
-            }
+            g += gen_count;
+            z++;
+            zone_count++;
+        }
 
-            p2 = fluid_list_next(p2); /* next zone */
+        if(preset)
+        {
+            sf->preset[i].zone_count = zone_count;
+        }
+        else
+        {
+            sf->inst[i].zone_count = zone_count;
         }
 
         if(discarded)
         {
-            FLUID_LOG(FLUID_WARN,
-                      "Instrument '%s': Some invalid generators were discarded",
-                      ((SFInst *)(p->data))->name);
+            FLUID_LOG(FLUID_WARN, "%s '%s': Some invalid generators were discarded", type, name);
         }
-
-        p = fluid_list_next(p);
-    }
-
-    /* for those non-terminal record cases, grr! */
-    if(size == 0)
-    {
-        return TRUE;
     }
 
-    size -= SF_GEN_SIZE;
-
-    if(size != 0)
-    {
-        FLUID_LOG(FLUID_ERR, "IGEN chunk size mismatch");
-        return FALSE;
-    }
-
-    FSKIP(sf, SF_GEN_SIZE); /* terminal gen */
-
     return TRUE;
+
+error_oom:
+    FLUID_FREE(zones);
+    FLUID_FREE(gens);
+    FLUID_FREE(mods);
+    FLUID_LOG(FLUID_ERR, "Out of memory");
+    return FALSE;
 }
 
 /* sample header loader */
-static int load_shdr(SFData *sf, unsigned int size)
+static int load_shdr(SFData *sf, const SFRecords *shdr)
 {
-    unsigned int i;
-    SFSample *p;
+    int i;
+    const unsigned char *p;
+    SFSample *sample;
 
-    if(size % SF_SHDR_SIZE || size == 0)  /* size is multiple of SHDR size? */
+    if(shdr->count == 0)  /* size is multiple of SHDR size? */
     {
         FLUID_LOG(FLUID_ERR, "Sample header has invalid size");
         return FALSE;
     }
 
-    size = size / SF_SHDR_SIZE - 1;
-
-    if(size == 0)
+    if(shdr->count == 1)
     {
         /* at least one sample + term record? */
         FLUID_LOG(FLUID_WARN, "File contains no samples");
-        FSKIP(sf, SF_SHDR_SIZE);
         return TRUE;
     }
 
-    /* load all sample headers */
-    for(i = 0; i < size; i++)
+    if((sf->sample = FLUID_ARRAY(SFSample, shdr->count - 1)) == NULL)
     {
-        if((p = FLUID_NEW(SFSample)) == NULL)
-        {
-            FLUID_LOG(FLUID_ERR, "Out of memory");
-            return FALSE;
-        }
-
-        sf->sample = fluid_list_append(sf->sample, p);
-        READSTR(sf, &p->name);
-        READD(sf, p->start);
-        READD(sf, p->end);
-        READD(sf, p->loopstart);
-        READD(sf, p->loopend);
-        READD(sf, p->samplerate);
-        READB(sf, p->origpitch);
-        READB(sf, p->pitchadj);
-        FSKIPW(sf); /* skip sample link */
-        READW(sf, p->sampletype);
-        p->samfile = 0;
-    }
-
-    FSKIP(sf, SF_SHDR_SIZE); /* skip terminal shdr */
-
-    return TRUE;
-}
-
-/* "fixup" (inst # -> inst ptr) instrument references in preset list */
-static int fixup_pgen(SFData *sf)
-{
-    fluid_list_t *p, *p2, *p3;
-    SFZone *z;
-    int i;
-
-    p = sf->preset;
-
-    while(p)
-    {
-        p2 = ((SFPreset *)(p->data))->zone;
-
-        while(p2)
-        {
-            /* traverse this preset's zones */
-            z = (SFZone *)(p2->data);
-
-            if((i = FLUID_POINTER_TO_INT(z->instsamp)))
-            {
-                /* load instrument # */
-                p3 = fluid_list_nth(sf->inst, i - 1);
-
-                if(!p3)
-                {
-                    FLUID_LOG(FLUID_ERR, "Preset %03d %03d: Invalid instrument reference",
-                              ((SFPreset *)(p->data))->bank, ((SFPreset *)(p->data))->prenum);
-                    return FALSE;
-                }
-
-                z->instsamp = p3;
-            }
-            else
-            {
-                z->instsamp = NULL;
-            }
-
-            p2 = fluid_list_next(p2);
-        }
-
-        p = fluid_list_next(p);
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return FALSE;
     }
 
-    return TRUE;
-}
-
-/* "fixup" (sample # -> sample ptr) sample references in instrument list */
-static int fixup_igen(SFData *sf)
-{
-    fluid_list_t *p, *p2, *p3;
-    SFZone *z;
-    int i;
+    FLUID_MEMSET(sf->sample, 0, (shdr->count - 1) * sizeof(SFSample));
+    sf->sample_count = shdr->count - 1;
 
-    p = sf->inst;
-
-    while(p)
+    /* load all sample headers, skip terminal shdr */
+    for(i = 0, p = shdr->data; i < sf->sample_count; i++, p += SF_SHDR_SIZE)
     {
-        p2 = ((SFInst *)(p->data))->zone;
-
-        while(p2)
-        {
-            /* traverse instrument's zones */
-            z = (SFZone *)(p2->data);
-
-            if((i = FLUID_POINTER_TO_INT(z->instsamp)))
-            {
-                /* load sample # */
-                p3 = fluid_list_nth(sf->sample, i - 1);
-
-                if(!p3)
-                {
-                    FLUID_LOG(FLUID_ERR, "Instrument '%s': Invalid sample reference",
-                              ((SFInst *)(p->data))->name);
-                    return FALSE;
-                }
-
-                z->instsamp = p3;
-            }
-
-            p2 = fluid_list_next(p2);
-        }
-
-        p = fluid_list_next(p);
+        sample = &sf->sample[i];
+        FLUID_MEMCPY(sample->name, p, 20);
+        sample->name[20] = '\0';
+        sample->start = GETD(p + 20);
+        sample->end = GETD(p + 24);
+        sample->loopstart = GETD(p + 28);
+        sample->loopend = GETD(p + 32);
+        sample->samplerate = GETD(p + 36);
+        sample->origpitch = p[40];
+        sample->pitchadj = (signed char)p[41];
+        /* skip sample link */
+        sample->sampletype = GETW(p + 44);
+        sample->samfile = 0;
     }
 
     return TRUE;
 }
 
-static void delete_preset(SFPreset *preset)
+/* preset sort function, first by bank, then by preset #.
+ * Zones are stored in file order, so comparing them keeps duplicate presets in file order. */
+static int preset_compare_func(const void *a, const void *b)
 {
-    fluid_list_t *entry;
-    SFZone *zone;
-
-    if(!preset)
-    {
-        return;
-    }
-
-    entry = preset->zone;
-
-    while(entry)
-    {
-        zone = (SFZone *)fluid_list_get(entry);
-        delete_zone(zone);
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(preset->zone);
-
-    FLUID_FREE(preset);
-}
-
-static void delete_inst(SFInst *inst)
-{
-    fluid_list_t *entry;
-    SFZone *zone;
-
-    if(!inst)
-    {
-        return;
-    }
-
-    entry = inst->zone;
-
-    while(entry)
-    {
-        zone = (SFZone *)fluid_list_get(entry);
-        delete_zone(zone);
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(inst->zone);
-
-    FLUID_FREE(inst);
-}
-
-
-/* Free all elements of a zone (Preset or Instrument) */
-static void delete_zone(SFZone *zone)
-{
-    fluid_list_t *entry;
-
-    if(!zone)
-    {
-        return;
-    }
-
-    entry = zone->gen;
-
-    while(entry)
-    {
-        FLUID_FREE(fluid_list_get(entry));
-        entry = fluid_list_next(entry);
-    }
-
-    delete_fluid_list(zone->gen);
+    const SFPreset *pa = a, *pb = b;
+    int aval, bval;
 
-    entry = zone->mod;
+    aval = (int)(pa->bank) << 16 | pa->prenum;
+    bval = (int)(pb->bank) << 16 | pb->prenum;
 
-    while(entry)
+    if(aval != bval)
     {
-        FLUID_FREE(fluid_list_get(entry));
-        entry = fluid_list_next(entry);
+        return (aval - bval);
     }
 
-    delete_fluid_list(zone->mod);
-
-    FLUID_FREE(zone);
-}
-
-/* preset sort function, first by bank, then by preset # */
-static int preset_compare_func(void *a, void *b)
-{
-    int aval, bval;
-
-    aval = (int)(((SFPreset *)a)->bank) << 16 | ((SFPreset *)a)->prenum;
-    bval = (int)(((SFPreset *)b)->bank) << 16 | ((SFPreset *)b)->prenum;
-
-    return (aval - bval);
+    return (pa->zone < pb->zone) ? -1 : (pa->zone > pb->zone);
 }
 
-/* Find a generator by its id in the passed in list.
+/* Find a generator by its id in the passed in generator array.
  *
  * @return pointer to SFGen if found, otherwise NULL
  */
-static fluid_list_t *find_gen_by_id(int gen, fluid_list_t *genlist)
+static SFGen *find_gen_by_id(int gen, SFGen *gens, int count)
 {
-    /* is generator in gen list? */
-    fluid_list_t *p;
-
-    p = genlist;
+    int i;
 
-    while(p)
+    for(i = 0; i < count; i++)
     {
-        if(p->data == NULL)
-        {
-            return NULL;
-        }
-
-        if(gen == ((SFGen *)p->data)->id)
+        if(gen == gens[i].id)
         {
-            break;
+            return &gens[i];
         }
-
-        p = fluid_list_next(p);
     }
 
-    return p;
+    return NULL;
 }
 
 /* check validity of instrument generator */
@@ -2361,8 +1545,11 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
     char *loaded_data24 = NULL;
 
     int num_samples = (end + 1) - start;
+    fluid_long_long_t total_bytes;
     fluid_return_val_if_fail(num_samples > 0, -1);
 
+    total_bytes = (fluid_long_long_t)num_samples * sizeof(short) + (sf->sample24pos ? num_samples : 0);
+
     if((start * sizeof(short) > sf->samplesize) || (end * sizeof(short) > sf->samplesize))
     {
         FLUID_LOG(FLUID_ERR, "Sample offsets exceed sample data chunk");
@@ -2370,13 +1557,13 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
     }
 
     /* Load 16-bit sample data */
-    if(sf->fcbs->fseek(sf->sffd, sf->samplepos + (start * sizeof(short)), SEEK_SET) == FLUID_FAILED)
+    if(fluid_file_seek(sf->fcbs, sf->sffd, sf->samplepos + (start * sizeof(short)), SEEK_SET) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Failed to seek to sample position");
         goto error_exit;
     }
 
-    loaded_data = FLUID_ARRAY(short, num_samples);
+    loaded_data = fluid_huge_alloc(num_samples * sizeof(short), FLUID_SAMPLE_HUGE_MIN_SIZE, sf->huge_pages);
 
     if(loaded_data == NULL)
     {
@@ -2384,7 +1571,7 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
         goto error_exit;
     }
 
-    if(sf->fcbs->fread(loaded_data, num_samples * sizeof(short), sf->sffd) == FLUID_FAILED)
+    if(fluid_sffile_read_chunked(sf, loaded_data, num_samples * sizeof(short), 0, total_bytes) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Failed to read sample data");
         goto error_exit;
@@ -2414,13 +1601,13 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
             goto error24_exit;
         }
 
-        if(sf->fcbs->fseek(sf->sffd, sf->sample24pos + start, SEEK_SET) == FLUID_FAILED)
+        if(fluid_file_seek(sf->fcbs, sf->sffd, sf->sample24pos + start, SEEK_SET) == FLUID_FAILED)
         {
             FLUID_LOG(FLUID_ERR, "Failed to seek position for 24-bit sample data in data file");
             goto error24_exit;
         }
 
-        loaded_data24 = FLUID_ARRAY(char, num_samples);
+        loaded_data24 = fluid_huge_alloc(num_samples, FLUID_SAMPLE_HUGE_MIN_SIZE, sf->huge_pages);
 
         if(loaded_data24 == NULL)
         {
@@ -2428,7 +1615,8 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
             goto error24_exit;
         }
 
-        if(sf->fcbs->fread(loaded_data24, num_samples, sf->sffd) == FLUID_FAILED)
+        if(fluid_sffile_read_chunked(sf, loaded_data24, num_samples,
+                                     num_samples * sizeof(short), total_bytes) == FLUID_FAILED)
         {
             FLUID_LOG(FLUID_ERR, "Failed to read 24-bit sample data");
             goto error24_exit;
@@ -2441,17 +1629,50 @@ static int fluid_sffile_read_wav(SFData *sf, unsigned int start, unsigned int en
 
 error24_exit:
     FLUID_LOG(FLUID_WARN, "Ignoring 24-bit sample data, sound quality might suffer");
-    FLUID_FREE(loaded_data24);
+    fluid_huge_free(loaded_data24);
     *data24 = NULL;
     return num_samples;
 
 error_exit:
-    FLUID_FREE(loaded_data);
-    FLUID_FREE(loaded_data24);
+    fluid_huge_free(loaded_data);
+    fluid_huge_free(loaded_data24);
     return -1;
 }
 
 
+/* Read count bytes of sample data in pieces of SAMPLE_READ_CHUNK_SIZE, reporting the
+ * progress to the loader after each piece. done and total are the number of bytes
+ * already loaded before this call and the total amount of bytes to load respectively.
+ * Returns FLUID_FAILED on read errors or if the load was cancelled. */
+static int fluid_sffile_read_chunked(SFData *sf, void *buf, unsigned int count,
+                                     fluid_long_long_t done, fluid_long_long_t total)
+{
+    char *p = buf;
+    unsigned int n;
+
+    while(count > 0)
+    {
+        n = (count > SAMPLE_READ_CHUNK_SIZE) ? SAMPLE_READ_CHUNK_SIZE : count;
+
+        if(sf->fcbs->fread(p, n, sf->sffd) == FLUID_FAILED)
+        {
+            return FLUID_FAILED;
+        }
+
+        p += n;
+        count -= n;
+        done += n;
+
+        if(fluid_sfloader_progress(done, total) == FLUID_FAILED)
+        {
+            FLUID_LOG(FLUID_DBG, "Sample data loading cancelled");
+            return FLUID_FAILED;
+        }
+    }
+
+    return FLUID_OK;
+}
+
 /* Ogg Vorbis loading and decompression */
 #if LIBSNDFILE_SUPPORT
 
@@ -2498,7 +1719,7 @@ static sf_count_t sfvio_seek(sf_count_t offset, int whence, void *user_data)
         goto fail; /* proper error handling not possible?? */
     }
 
-    if(sf->fcbs->fseek(sf->sffd, sf->samplepos + data->start + new_offset, SEEK_SET) != FLUID_FAILED)
+    if(fluid_file_seek(sf->fcbs, sf->sffd, sf->samplepos + data->start + new_offset, SEEK_SET) != FLUID_FAILED)
     {
         data->offset = new_offset;
     }
@@ -2583,7 +1804,7 @@ static int fluid_sffile_read_vorbis(SFData *sf, unsigned int start_byte, unsigne
     memset(&sfinfo, 0, sizeof(sfinfo));
 
     /* Seek to beginning of Ogg Vorbis data in Soundfont */
-    if(sf->fcbs->fseek(sf->sffd, sf->samplepos + start_byte, SEEK_SET) == FLUID_FAILED)
+    if(fluid_file_seek(sf->fcbs, sf->sffd, sf->samplepos + start_byte, SEEK_SET) == FLUID_FAILED)
     {
         FLUID_LOG(FLUID_ERR, "Failed to seek to compressd sample position");
         return -1;
@@ -2609,7 +1830,7 @@ static int fluid_sffile_read_vorbis(SFData *sf, unsigned int start_byte, unsigne
 
     /* FIXME: ensure that the decompressed WAV data is 16-bit mono? */
 
-    wav_data = FLUID_ARRAY(short, sfinfo.frames * sfinfo.channels);
+    wav_data = fluid_huge_alloc(sfinfo.frames * sfinfo.channels * sizeof(short), FLUID_SAMPLE_HUGE_MIN_SIZE, sf->huge_pages);
 
     if(!wav_data)
     {
@@ -2632,7 +1853,7 @@ static int fluid_sffile_read_vorbis(SFData *sf, unsigned int start_byte, unsigne
     return sfinfo.frames;
 
 error_exit:
-    FLUID_FREE(wav_data);
+    fluid_huge_free(wav_data);
     sf_close(sndfile);
     return -1;
 }
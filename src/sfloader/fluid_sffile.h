@@ -89,9 +89,12 @@ struct _SFGen
 struct _SFZone
 {
     /* Sample/instrument zone structure */
-    fluid_list_t *instsamp; /* instrument/sample pointer for zone */
-    fluid_list_t *gen; /* list of generators */
-    fluid_list_t *mod; /* list of modulators */
+    SFInst *inst; /* instrument of a preset zone, NULL for global zones */
+    SFSample *sample; /* sample of an instrument zone, NULL for global zones */
+    SFGen *gen; /* array of generators */
+    int gen_count; /* number of generators */
+    SFMod *mod; /* array of modulators */
+    int mod_count; /* number of modulators */
 };
 
 struct _SFSample
@@ -122,7 +125,8 @@ struct _SFInst
     /* Instrument structure */
     char name[21]; /* Name of instrument */
     int idx; /* Index of this instrument in the Soundfont */
-    fluid_list_t *zone; /* list of instrument zones */
+    SFZone *zone; /* array of instrument zones, global zone first */
+    int zone_count; /* number of instrument zones */
 };
 
 struct _SFPreset
@@ -134,7 +138,8 @@ struct _SFPreset
     unsigned int libr; /* Not used (preserved) */
     unsigned int genre; /* Not used (preserved) */
     unsigned int morph; /* Not used (preserved) */
-    fluid_list_t *zone; /* list of preset zones */
+    SFZone *zone; /* array of preset zones, global zone first */
+    int zone_count; /* number of preset zones */
 };
 
 /* NOTE: sffd is also used to determine if sound font is new (NULL) */
@@ -144,26 +149,40 @@ struct _SFData
     SFVersion version; /* sound font version */
     SFVersion romver; /* ROM version */
 
-    unsigned int filesize;
+    /* File positions are 64 bit, as RIFF chunks may be up to 4 GiB large. Chunk sizes
+     * are limited to 32 bit by the file format. */
+    fluid_long_long_t filesize;
 
-    unsigned int samplepos; /* position within sffd of the sample chunk */
+    fluid_long_long_t samplepos; /* position within sffd of the sample chunk */
     unsigned int samplesize; /* length within sffd of the sample chunk */
 
-    unsigned int sample24pos; /* position within sffd of the sm24 chunk, set to zero if no 24 bit
+    fluid_long_long_t sample24pos; /* position within sffd of the sm24 chunk, set to zero if no 24 bit
                                  sample support */
     unsigned int sample24size; /* length within sffd of the sm24 chunk */
 
-    unsigned int hydrapos;
+    fluid_long_long_t hydrapos;
     unsigned int hydrasize;
 
     char *fname; /* file name */
     FILE *sffd; /* loaded sfont file descriptor */
     const fluid_file_callbacks_t *fcbs; /* file callbacks used to read this file */
+    int huge_pages; /* TRUE to allocate sample data from huge pages, see synth.huge-pages */
 
     fluid_list_t *info; /* linked list of info strings (1st byte is ID) */
-    fluid_list_t *preset; /* linked list of preset info */
-    fluid_list_t *inst; /* linked list of instrument info */
-    fluid_list_t *sample; /* linked list of sample info */
+    SFPreset *preset; /* array of presets, sorted by bank and preset number */
+    int preset_count;
+    SFInst *inst; /* array of instruments */
+    int inst_count;
+    SFSample *sample; /* array of samples */
+    int sample_count;
+
+    /* storage of all preset and instrument zones, generators and modulators */
+    SFZone *pzone;
+    SFGen *pgen;
+    SFMod *pmod;
+    SFZone *izone;
+    SFGen *igen;
+    SFMod *imod;
 };
 
 /* functions */
@@ -0,0 +1,1124 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+
+#include "fluid_sfindex.h"
+#include "fluid_sfont.h"
+#include "fluid_sys.h"
+
+/* The index is stored next to the soundfont, using this suffix */
+#define FLUID_SFINDEX_SUFFIX ".fsidx"
+
+#define FLUID_SFINDEX_MAGIC "FLSFIDX"
+#define FLUID_SFINDEX_VERSION 2
+#define FLUID_SFINDEX_BYTE_ORDER 0x01020304
+
+/* SoundFont names have at most 20 characters */
+#define FLUID_SFINDEX_NAME_MAX 20
+
+/* Upper bound for any record count, keeps size computations in range */
+#define FLUID_SFINDEX_MAX_COUNT (1 << 26)
+
+/*
+ * The index consists of the header followed by the sample, instrument,
+ * preset, zone, generator and modulator tables, in that order. All records
+ * have a fixed size which is a multiple of 8 bytes, so every table is
+ * naturally aligned and the file can be used in place once it has been read
+ * (or mapped) into memory. Records refer to each other by table index.
+ *
+ * The layout uses the host byte order and is tied to the version number
+ * below. Any mismatch simply makes the index stale, it is then rewritten
+ * from the parsed soundfont.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+
+    /* the soundfont file this index was compiled from */
+    int64_t file_size;
+    int64_t file_mtime;
+    int64_t samplepos;
+    int64_t sample24pos;
+    int64_t hydrapos;
+    uint32_t samplesize;
+    uint32_t sample24size;
+    uint32_t hydrasize;
+
+    uint32_t sample_count;
+    uint32_t inst_slots;    /* number of instruments in the soundfont */
+    uint32_t inst_count;    /* number of imported instruments stored in the index */
+    uint32_t preset_count;
+    uint32_t zone_count;
+    uint32_t gen_count;
+    uint32_t mod_count;
+} fluid_sfindex_header_t;
+
+typedef struct
+{
+    char name[24];
+    uint32_t start;
+    uint32_t end;
+    uint32_t loopstart;
+    uint32_t loopend;
+    uint32_t samplerate;
+    uint16_t sampletype;
+    uint8_t origpitch;
+    int8_t pitchadj;
+    uint32_t imported;      /* TRUE if the sample passed validation */
+    uint32_t reserved;
+} fluid_sfindex_sample_t;
+
+typedef struct
+{
+    char name[24];
+    int32_t source_idx;
+    uint32_t has_global;    /* TRUE if the first zone is the global zone */
+    uint32_t first_zone;
+    uint32_t zone_count;    /* number of zones, including the global zone */
+} fluid_sfindex_inst_t;
+
+typedef struct
+{
+    char name[24];
+    uint32_t bank;
+    uint32_t num;
+    uint32_t has_global;    /* TRUE if the first zone is the global zone */
+    uint32_t first_zone;
+    uint32_t zone_count;    /* number of zones, including the global zone */
+    uint32_t reserved;
+} fluid_sfindex_preset_t;
+
+typedef struct
+{
+    int32_t ref;            /* instrument (preset zone) or sample (instrument zone) index, -1 if none */
+    int16_t keylo;
+    int16_t keyhi;
+    int16_t vello;
+    int16_t velhi;
+    uint32_t first_gen;
+    uint32_t gen_count;
+    uint32_t first_mod;
+    uint32_t mod_count;
+    uint32_t reserved;
+} fluid_sfindex_zone_t;
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t reserved;
+    double val;
+} fluid_sfindex_gen_t;
+
+typedef struct
+{
+    double amount;
+    uint8_t dest;
+    uint8_t src1;
+    uint8_t flags1;
+    uint8_t src2;
+    uint8_t flags2;
+    uint8_t reserved[3];
+} fluid_sfindex_mod_t;
+
+struct _fluid_sfindex_t
+{
+    char *data;             /* the whole index file */
+    fluid_sfindex_header_t *header;
+    fluid_sfindex_sample_t *sample;
+    fluid_sfindex_inst_t *inst;
+    fluid_sfindex_preset_t *preset;
+    fluid_sfindex_zone_t *zone;
+    fluid_sfindex_gen_t *gen;
+    fluid_sfindex_mod_t *mod;
+};
+
+/* Maps an imported sample back to its position in the sample table */
+typedef struct
+{
+    fluid_sample_t *sample;
+    int idx;
+} fluid_sfindex_sample_ref_t;
+
+static char *fluid_sfindex_get_path(const char *filename)
+{
+    size_t len = FLUID_STRLEN(filename) + sizeof(FLUID_SFINDEX_SUFFIX);
+    char *path = FLUID_MALLOC(len);
+
+    if(path == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_SNPRINTF(path, len, "%s%s", filename, FLUID_SFINDEX_SUFFIX);
+    return path;
+}
+
+static int fluid_sfindex_stat(const char *filename, int64_t *size, int64_t *mtime)
+{
+    fluid_stat_buf_t buf;
+
+    if(fluid_stat(filename, &buf))
+    {
+        return FLUID_FAILED;
+    }
+
+    *size = buf.st_size;
+    *mtime = buf.st_mtime;
+    return FLUID_OK;
+}
+
+/* Size in bytes of an index with the record counts given in header */
+static uint64_t fluid_sfindex_get_size(const fluid_sfindex_header_t *header)
+{
+    return sizeof(fluid_sfindex_header_t)
+           + (uint64_t)header->sample_count * sizeof(fluid_sfindex_sample_t)
+           + (uint64_t)header->inst_count * sizeof(fluid_sfindex_inst_t)
+           + (uint64_t)header->preset_count * sizeof(fluid_sfindex_preset_t)
+           + (uint64_t)header->zone_count * sizeof(fluid_sfindex_zone_t)
+           + (uint64_t)header->gen_count * sizeof(fluid_sfindex_gen_t)
+           + (uint64_t)header->mod_count * sizeof(fluid_sfindex_mod_t);
+}
+
+/* Point the table pointers of sfindex into its data block */
+static void fluid_sfindex_set_tables(fluid_sfindex_t *sfindex)
+{
+    char *p = sfindex->data;
+
+    sfindex->header = (fluid_sfindex_header_t *)p;
+    p += sizeof(fluid_sfindex_header_t);
+    sfindex->sample = (fluid_sfindex_sample_t *)p;
+    p += sfindex->header->sample_count * sizeof(fluid_sfindex_sample_t);
+    sfindex->inst = (fluid_sfindex_inst_t *)p;
+    p += sfindex->header->inst_count * sizeof(fluid_sfindex_inst_t);
+    sfindex->preset = (fluid_sfindex_preset_t *)p;
+    p += sfindex->header->preset_count * sizeof(fluid_sfindex_preset_t);
+    sfindex->zone = (fluid_sfindex_zone_t *)p;
+    p += sfindex->header->zone_count * sizeof(fluid_sfindex_zone_t);
+    sfindex->gen = (fluid_sfindex_gen_t *)p;
+    p += sfindex->header->gen_count * sizeof(fluid_sfindex_gen_t);
+    sfindex->mod = (fluid_sfindex_mod_t *)p;
+}
+
+/* Check the generator and modulator ranges and the key/velocity range of a zone */
+static int fluid_sfindex_check_zone(fluid_sfindex_t *sfindex, fluid_sfindex_zone_t *zone)
+{
+    fluid_sfindex_header_t *header = sfindex->header;
+    unsigned int i;
+
+    if(zone->first_gen > header->gen_count || zone->gen_count > header->gen_count - zone->first_gen
+            || zone->first_mod > header->mod_count || zone->mod_count > header->mod_count - zone->first_mod
+            || zone->mod_count > FLUID_NUM_MOD)
+    {
+        return FALSE;
+    }
+
+    if(zone->keylo < 0 || zone->keyhi > 128 || zone->vello < 0 || zone->velhi > 128)
+    {
+        return FALSE;
+    }
+
+    for(i = 0; i < zone->gen_count; i++)
+    {
+        if(sfindex->gen[zone->first_gen + i].id >= GEN_LAST)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Check all cross references of the index, so that importing it cannot fail
+ * half-way because of a corrupt file */
+static int fluid_sfindex_check(fluid_sfindex_t *sfindex)
+{
+    fluid_sfindex_header_t *header = sfindex->header;
+    fluid_sfindex_zone_t *zone;
+    char *inst_seen;
+    unsigned int i, k;
+    int ok = FALSE;
+
+    inst_seen = FLUID_MALLOC(header->inst_slots + 1);
+
+    if(inst_seen == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return FALSE;
+    }
+
+    FLUID_MEMSET(inst_seen, 0, header->inst_slots + 1);
+
+    for(i = 0; i < header->sample_count; i++)
+    {
+        sfindex->sample[i].name[FLUID_SFINDEX_NAME_MAX] = '\0';
+    }
+
+    for(i = 0; i < header->inst_count; i++)
+    {
+        fluid_sfindex_inst_t *inst = &sfindex->inst[i];
+
+        inst->name[FLUID_SFINDEX_NAME_MAX] = '\0';
+
+        if(inst->source_idx < 0 || (uint32_t)inst->source_idx >= header->inst_slots
+                || inst_seen[inst->source_idx]
+                || inst->first_zone > header->zone_count
+                || inst->zone_count > header->zone_count - inst->first_zone
+                || inst->has_global > inst->zone_count)
+        {
+            goto exit;
+        }
+
+        inst_seen[inst->source_idx] = TRUE;
+
+        for(k = 0; k < inst->zone_count; k++)
+        {
+            zone = &sfindex->zone[inst->first_zone + k];
+
+            if(!fluid_sfindex_check_zone(sfindex, zone))
+            {
+                goto exit;
+            }
+
+            if(zone->ref >= 0 && ((uint32_t)zone->ref >= header->sample_count
+                                  || !sfindex->sample[zone->ref].imported))
+            {
+                goto exit;
+            }
+        }
+    }
+
+    for(i = 0; i < header->preset_count; i++)
+    {
+        fluid_sfindex_preset_t *preset = &sfindex->preset[i];
+
+        preset->name[FLUID_SFINDEX_NAME_MAX] = '\0';
+
+        if(preset->first_zone > header->zone_count
+                || preset->zone_count > header->zone_count - preset->first_zone
+                || preset->has_global > preset->zone_count)
+        {
+            goto exit;
+        }
+
+        for(k = 0; k < preset->zone_count; k++)
+        {
+            zone = &sfindex->zone[preset->first_zone + k];
+
+            if(!fluid_sfindex_check_zone(sfindex, zone))
+            {
+                goto exit;
+            }
+
+            /* only the global zone is without instrument */
+            if(k == 0 && preset->has_global)
+            {
+                if(zone->ref != -1)
+                {
+                    goto exit;
+                }
+            }
+            else if(zone->ref < 0 || (uint32_t)zone->ref >= header->inst_slots || !inst_seen[zone->ref])
+            {
+                goto exit;
+            }
+        }
+    }
+
+    ok = TRUE;
+
+exit:
+    FLUID_FREE(inst_seen);
+    return ok;
+}
+
+/**
+ * Open the compiled index of a soundfont.
+ * @param filename the soundfont file name
+ * @param sfdata the opened (but not yet parsed) soundfont
+ * @return the index if it exists and matches the soundfont, NULL otherwise
+ */
+fluid_sfindex_t *fluid_sfindex_open(const char *filename, SFData *sfdata)
+{
+    fluid_sfindex_t *sfindex = NULL;
+    fluid_sfindex_header_t *header;
+    char *path;
+    FILE *file = NULL;
+    long size;
+    int64_t file_size, file_mtime;
+
+    if(fluid_sfindex_stat(filename, &file_size, &file_mtime) != FLUID_OK)
+    {
+        return NULL;
+    }
+
+    path = fluid_sfindex_get_path(filename);
+
+    if(path == NULL)
+    {
+        return NULL;
+    }
+
+    file = FLUID_FOPEN(path, "rb");
+
+    if(file == NULL)
+    {
+        goto error_exit;
+    }
+
+    if(FLUID_FSEEK(file, 0, SEEK_END) != 0 || (size = FLUID_FTELL(file)) < (long)sizeof(fluid_sfindex_header_t)
+            || FLUID_FSEEK(file, 0, SEEK_SET) != 0)
+    {
+        goto stale_exit;
+    }
+
+    sfindex = FLUID_NEW(fluid_sfindex_t);
+
+    if(sfindex == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_exit;
+    }
+
+    FLUID_MEMSET(sfindex, 0, sizeof(*sfindex));
+    sfindex->data = FLUID_MALLOC(size);
+
+    if(sfindex->data == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_exit;
+    }
+
+    if(FLUID_FREAD(sfindex->data, size, 1, file) != 1)
+    {
+        goto stale_exit;
+    }
+
+    header = (fluid_sfindex_header_t *)sfindex->data;
+
+    if(FLUID_STRNCMP(header->magic, FLUID_SFINDEX_MAGIC, sizeof(header->magic)) != 0
+            || header->version != FLUID_SFINDEX_VERSION
+            || header->byte_order != FLUID_SFINDEX_BYTE_ORDER)
+    {
+        goto stale_exit;
+    }
+
+    /* the soundfont must be unchanged since the index has been compiled */
+    if(header->file_size != file_size || header->file_mtime != file_mtime
+            || header->samplepos != sfdata->samplepos || header->samplesize != sfdata->samplesize
+            || header->sample24pos != sfdata->sample24pos || header->sample24size != sfdata->sample24size
+            || header->hydrapos != sfdata->hydrapos || header->hydrasize != sfdata->hydrasize)
+    {
+        goto stale_exit;
+    }
+
+    if(header->sample_count > FLUID_SFINDEX_MAX_COUNT || header->inst_slots > FLUID_SFINDEX_MAX_COUNT
+            || header->inst_count > header->inst_slots || header->preset_count > FLUID_SFINDEX_MAX_COUNT
+            || header->zone_count > FLUID_SFINDEX_MAX_COUNT || header->gen_count > FLUID_SFINDEX_MAX_COUNT
+            || header->mod_count > FLUID_SFINDEX_MAX_COUNT
+            || fluid_sfindex_get_size(header) != (uint64_t)size)
+    {
+        goto stale_exit;
+    }
+
+    fluid_sfindex_set_tables(sfindex);
+
+    if(!fluid_sfindex_check(sfindex))
+    {
+        goto stale_exit;
+    }
+
+    FLUID_FCLOSE(file);
+    FLUID_LOG(FLUID_DBG, "Using compiled soundfont index '%s'", path);
+    FLUID_FREE(path);
+    return sfindex;
+
+stale_exit:
+    FLUID_LOG(FLUID_DBG, "Ignoring stale or invalid soundfont index '%s'", path);
+
+error_exit:
+    if(file != NULL)
+    {
+        FLUID_FCLOSE(file);
+    }
+
+    delete_fluid_sfindex(sfindex);
+    FLUID_FREE(path);
+    return NULL;
+}
+
+/**
+ * Free a compiled index returned by fluid_sfindex_open().
+ * @param sfindex the index
+ */
+void delete_fluid_sfindex(fluid_sfindex_t *sfindex)
+{
+    fluid_return_if_fail(sfindex != NULL);
+
+    FLUID_FREE(sfindex->data);
+    FLUID_FREE(sfindex);
+}
+
+/* Restore a zone's range, generators and modulators */
+static int fluid_sfindex_import_zone(fluid_sfindex_t *sfindex, fluid_sfindex_zone_t *src,
+                                     fluid_zone_range_t *range, fluid_gen_t *gen, fluid_mod_t **mod,
+                                     fluid_defsfont_t *defsfont)
+{
+    fluid_sfindex_gen_t *sfgen;
+    fluid_sfindex_mod_t *sfmod;
+    fluid_mod_t *mods;
+    unsigned int i;
+
+    range->keylo = src->keylo;
+    range->keyhi = src->keyhi;
+    range->vello = src->vello;
+    range->velhi = src->velhi;
+
+    for(i = 0; i < src->gen_count; i++)
+    {
+        sfgen = &sfindex->gen[src->first_gen + i];
+        gen[sfgen->id].val = sfgen->val;
+        gen[sfgen->id].flags = GEN_SET;
+    }
+
+    if(src->mod_count == 0)
+    {
+        return FLUID_OK;
+    }
+
+    mods = FLUID_ARENA_ARRAY(defsfont->arena, fluid_mod_t, src->mod_count);
+
+    if(mods == NULL)
+    {
+        return FLUID_FAILED;
+    }
+
+    for(i = 0; i < src->mod_count; i++)
+    {
+        sfmod = &sfindex->mod[src->first_mod + i];
+
+        mods[i].dest = sfmod->dest;
+        mods[i].src1 = sfmod->src1;
+        mods[i].flags1 = sfmod->flags1;
+        mods[i].src2 = sfmod->src2;
+        mods[i].flags2 = sfmod->flags2;
+        mods[i].amount = sfmod->amount;
+        mods[i].next = (i + 1 < src->mod_count) ? &mods[i + 1] : NULL;
+    }
+
+    *mod = mods;
+    return FLUID_OK;
+}
+
+static fluid_inst_t *fluid_sfindex_import_inst(fluid_sfindex_t *sfindex, fluid_sfindex_inst_t *src,
+        fluid_sample_t **samples, fluid_defsfont_t *defsfont)
+{
+    fluid_inst_t *inst;
+    fluid_inst_zone_t *inst_zone;
+    fluid_sfindex_zone_t *zone;
+    char zone_name[256];
+    unsigned int count;
+
+    inst = FLUID_ARENA_NEW(defsfont->arena, fluid_inst_t);
+
+    if(inst == NULL)
+    {
+        return NULL;
+    }
+
+    FLUID_STRCPY(inst->name, src->name);
+    inst->source_idx = src->source_idx;
+
+    if(src->has_global)
+    {
+        inst->global_zone = FLUID_ARENA_NEW(defsfont->arena, fluid_inst_zone_t);
+
+        if(inst->global_zone == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    inst->zone_count = src->zone_count - src->has_global;
+
+    if(inst->zone_count > 0)
+    {
+        inst->zone = FLUID_ARENA_ARRAY(defsfont->arena, fluid_inst_zone_t, inst->zone_count);
+
+        if(inst->zone == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    /* zones are stored in soundfont order, arrange them like fluid_inst_import_sfont() */
+    for(count = 0; count < src->zone_count; count++)
+    {
+        zone = &sfindex->zone[src->first_zone + count];
+        inst_zone = (count == 0 && src->has_global) ? inst->global_zone : &inst->zone[src->zone_count - 1 - count];
+
+        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "iz:%s/%d", inst->name, count);
+
+        if(fluid_inst_zone_init(inst_zone, zone_name, defsfont) != FLUID_OK)
+        {
+            return NULL;
+        }
+
+        if(fluid_sfindex_import_zone(sfindex, zone, &inst_zone->range, inst_zone->gen, &inst_zone->mod, defsfont) != FLUID_OK)
+        {
+            return NULL;
+        }
+
+        inst_zone->sample = (zone->ref >= 0) ? samples[zone->ref] : NULL;
+    }
+
+    return inst;
+}
+
+static int fluid_sfindex_import_preset(fluid_sfindex_t *sfindex, fluid_sfindex_preset_t *src,
+                                       fluid_defsfont_t *defsfont)
+{
+    fluid_defpreset_t *defpreset;
+    fluid_preset_zone_t *preset_zone;
+    fluid_sfindex_zone_t *zone;
+    char zone_name[256];
+    unsigned int count;
+
+    defpreset = new_fluid_defpreset(defsfont);
+
+    if(defpreset == NULL)
+    {
+        return FLUID_FAILED;
+    }
+
+    FLUID_STRCPY(defpreset->name, src->name);
+    defpreset->bank = src->bank;
+    defpreset->num = src->num;
+
+    if(src->has_global)
+    {
+        defpreset->global_zone = FLUID_ARENA_NEW(defsfont->arena, fluid_preset_zone_t);
+
+        if(defpreset->global_zone == NULL)
+        {
+            return FLUID_FAILED;
+        }
+    }
+
+    defpreset->zone_count = src->zone_count - src->has_global;
+
+    if(defpreset->zone_count > 0)
+    {
+        defpreset->zone = FLUID_ARENA_ARRAY(defsfont->arena, fluid_preset_zone_t, defpreset->zone_count);
+
+        if(defpreset->zone == NULL)
+        {
+            return FLUID_FAILED;
+        }
+    }
+
+    /* zones are stored in soundfont order, arrange them like fluid_defpreset_import_sfont() */
+    for(count = 0; count < src->zone_count; count++)
+    {
+        zone = &sfindex->zone[src->first_zone + count];
+        preset_zone = (count == 0 && src->has_global) ? defpreset->global_zone : &defpreset->zone[src->zone_count - 1 - count];
+
+        FLUID_SNPRINTF(zone_name, sizeof(zone_name), "pz:%s/%d", defpreset->name, count);
+
+        if(fluid_preset_zone_init(preset_zone, zone_name, defsfont) != FLUID_OK)
+        {
+            return FLUID_FAILED;
+        }
+
+        if(fluid_sfindex_import_zone(sfindex, zone, &preset_zone->range, preset_zone->gen, &preset_zone->mod, defsfont) != FLUID_OK)
+        {
+            return FLUID_FAILED;
+        }
+
+        if(zone->ref >= 0)
+        {
+            preset_zone->inst = defsfont->inst[zone->ref];
+
+            if(fluid_preset_zone_create_voice_zones(preset_zone, defsfont) != FLUID_OK)
+            {
+                return FLUID_FAILED;
+            }
+        }
+    }
+
+    return fluid_defsfont_add_preset(defsfont, defpreset);
+}
+
+/**
+ * Create the samples, instruments and presets of a soundfont from its compiled index.
+ * @param sfindex the index, as returned by fluid_sfindex_open()
+ * @param defsfont the soundfont to populate
+ * @return FLUID_OK on success, FLUID_FAILED otherwise
+ */
+int fluid_sfindex_import(fluid_sfindex_t *sfindex, fluid_defsfont_t *defsfont)
+{
+    fluid_sfindex_header_t *header = sfindex->header;
+    fluid_sample_t **samples = NULL;
+    fluid_sample_t *sample;
+    SFSample sfsample;
+    fluid_inst_t *inst;
+    unsigned int i;
+    int ret = FLUID_FAILED;
+
+    if(header->sample_count > 0)
+    {
+        samples = FLUID_ARRAY(fluid_sample_t *, header->sample_count);
+
+        if(samples == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            return FLUID_FAILED;
+        }
+    }
+
+    for(i = 0; i < header->sample_count; i++)
+    {
+        fluid_sfindex_sample_t *src = &sfindex->sample[i];
+
+        samples[i] = NULL;
+
+        if(!src->imported)
+        {
+            continue;
+        }
+
+        sample = FLUID_ARENA_NEW(defsfont->arena, fluid_sample_t);
+
+        if(sample == NULL)
+        {
+            goto exit;
+        }
+
+        FLUID_MEMSET(&sfsample, 0, sizeof(sfsample));
+        FLUID_STRCPY(sfsample.name, src->name);
+        sfsample.start = src->start;
+        sfsample.end = src->end;
+        sfsample.loopstart = src->loopstart;
+        sfsample.loopend = src->loopend;
+        sfsample.samplerate = src->samplerate;
+        sfsample.origpitch = src->origpitch;
+        sfsample.pitchadj = src->pitchadj;
+        sfsample.sampletype = src->sampletype;
+
+        if(fluid_sample_import_sfont(sample, &sfsample, defsfont) == FLUID_OK)
+        {
+            fluid_defsfont_add_sample(defsfont, sample);
+            samples[i] = sample;
+        }
+    }
+
+    if(header->inst_slots > 0)
+    {
+        defsfont->inst = FLUID_ARENA_ARRAY(defsfont->arena, fluid_inst_t *, header->inst_slots);
+
+        if(defsfont->inst == NULL)
+        {
+            goto exit;
+        }
+
+        defsfont->inst_count = header->inst_slots;
+    }
+
+    for(i = 0; i < header->inst_count; i++)
+    {
+        inst = fluid_sfindex_import_inst(sfindex, &sfindex->inst[i], samples, defsfont);
+
+        if(inst == NULL)
+        {
+            goto exit;
+        }
+
+        defsfont->inst[inst->source_idx] = inst;
+    }
+
+    for(i = 0; i < header->preset_count; i++)
+    {
+        if(fluid_sfindex_import_preset(sfindex, &sfindex->preset[i], defsfont) != FLUID_OK)
+        {
+            goto exit;
+        }
+    }
+
+    ret = FLUID_OK;
+
+exit:
+    FLUID_FREE(samples);
+    return ret;
+}
+
+static int fluid_sfindex_compare_sample_ref(const void *a, const void *b)
+{
+    const fluid_sample_t *sa = ((const fluid_sfindex_sample_ref_t *)a)->sample;
+    const fluid_sample_t *sb = ((const fluid_sfindex_sample_ref_t *)b)->sample;
+
+    return (sa > sb) - (sa < sb);
+}
+
+static void fluid_sfindex_count_zone(fluid_gen_t *gen, fluid_mod_t *mod, fluid_sfindex_header_t *header)
+{
+    int i;
+
+    for(i = 0; i < GEN_LAST; i++)
+    {
+        if(gen[i].flags == GEN_SET)
+        {
+            header->gen_count++;
+        }
+    }
+
+    for(; mod != NULL; mod = mod->next)
+    {
+        header->mod_count++;
+    }
+
+    header->zone_count++;
+}
+
+/* Append a zone with its generators and modulators to the tables of sfindex.
+ * The header counts are used as fill positions. */
+static void fluid_sfindex_put_zone(fluid_sfindex_t *sfindex, int ref, fluid_zone_range_t *range,
+                                   fluid_gen_t *gen, fluid_mod_t *mod)
+{
+    fluid_sfindex_header_t *header = sfindex->header;
+    fluid_sfindex_zone_t *zone = &sfindex->zone[header->zone_count++];
+    int i;
+
+    zone->ref = ref;
+    zone->keylo = range->keylo;
+    zone->keyhi = range->keyhi;
+    zone->vello = range->vello;
+    zone->velhi = range->velhi;
+
+    zone->first_gen = header->gen_count;
+
+    for(i = 0; i < GEN_LAST; i++)
+    {
+        if(gen[i].flags == GEN_SET)
+        {
+            sfindex->gen[header->gen_count].id = i;
+            sfindex->gen[header->gen_count].val = gen[i].val;
+            header->gen_count++;
+        }
+    }
+
+    zone->gen_count = header->gen_count - zone->first_gen;
+    zone->first_mod = header->mod_count;
+
+    for(; mod != NULL; mod = mod->next)
+    {
+        fluid_sfindex_mod_t *dest = &sfindex->mod[header->mod_count++];
+
+        dest->amount = mod->amount;
+        dest->dest = mod->dest;
+        dest->src1 = mod->src1;
+        dest->flags1 = mod->flags1;
+        dest->src2 = mod->src2;
+        dest->flags2 = mod->flags2;
+    }
+
+    zone->mod_count = header->mod_count - zone->first_mod;
+}
+
+static int fluid_sfindex_find_sample(fluid_sfindex_sample_ref_t *refs, int count, fluid_sample_t *sample)
+{
+    fluid_sfindex_sample_ref_t key, *ref;
+
+    if(sample == NULL)
+    {
+        return -1;
+    }
+
+    key.sample = sample;
+    ref = bsearch(&key, refs, count, sizeof(*refs), fluid_sfindex_compare_sample_ref);
+
+    return (ref != NULL) ? ref->idx : -1;
+}
+
+/**
+ * Write the compiled index of a freshly loaded soundfont.
+ * @param defsfont the loaded soundfont
+ * @param sfdata the parsed soundfont file it has been imported from
+ * @return FLUID_OK on success, FLUID_FAILED otherwise
+ */
+int fluid_sfindex_write(fluid_defsfont_t *defsfont, SFData *sfdata)
+{
+    fluid_sfindex_t sfindex;
+    fluid_sfindex_header_t counts;
+    fluid_sfindex_sample_ref_t *refs = NULL;
+    fluid_defpreset_t *defpreset;
+    fluid_list_t *list;
+    fluid_inst_t *inst;
+    fluid_preset_zone_t *preset_zone;
+    fluid_inst_zone_t *inst_zone;
+    char *path = NULL, *tmp_path = NULL;
+    FILE *file = NULL;
+    int64_t file_size, file_mtime;
+    uint64_t size;
+    int i, count, total, ref_count = 0;
+    int ret = FLUID_FAILED;
+
+    FLUID_MEMSET(&sfindex, 0, sizeof(sfindex));
+
+    if(fluid_sfindex_stat(defsfont->filename, &file_size, &file_mtime) != FLUID_OK)
+    {
+        return FLUID_FAILED;
+    }
+
+    /* count the records */
+    FLUID_MEMSET(&counts, 0, sizeof(counts));
+    counts.sample_count = sfdata->sample_count;
+    counts.inst_slots = defsfont->inst_count;
+
+    for(i = 0; i < defsfont->inst_count; i++)
+    {
+        inst = defsfont->inst[i];
+
+        if(inst == NULL)
+        {
+            continue;
+        }
+
+        counts.inst_count++;
+
+        if(inst->global_zone != NULL)
+        {
+            fluid_sfindex_count_zone(inst->global_zone->gen, inst->global_zone->mod, &counts);
+        }
+
+        for(count = 0; count < inst->zone_count; count++)
+        {
+            fluid_sfindex_count_zone(inst->zone[count].gen, inst->zone[count].mod, &counts);
+        }
+    }
+
+    for(list = defsfont->preset; list; list = fluid_list_next(list))
+    {
+        defpreset = fluid_preset_get_data((fluid_preset_t *)fluid_list_get(list));
+        counts.preset_count++;
+
+        if(defpreset->global_zone != NULL)
+        {
+            fluid_sfindex_count_zone(defpreset->global_zone->gen, defpreset->global_zone->mod, &counts);
+        }
+
+        for(count = 0; count < defpreset->zone_count; count++)
+        {
+            fluid_sfindex_count_zone(defpreset->zone[count].gen, defpreset->zone[count].mod, &counts);
+        }
+    }
+
+    size = fluid_sfindex_get_size(&counts);
+    sfindex.data = FLUID_MALLOC(size);
+
+    if(sfindex.data == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto exit;
+    }
+
+    FLUID_MEMSET(sfindex.data, 0, size);
+    FLUID_MEMCPY(sfindex.data, &counts, sizeof(counts));
+    fluid_sfindex_set_tables(&sfindex);
+
+    /* the counts of the header are reused as fill positions below */
+    sfindex.header->zone_count = sfindex.header->gen_count = sfindex.header->mod_count = 0;
+
+    /* sample table, and a sorted lookup of the imported samples */
+    if(sfdata->sample_count > 0)
+    {
+        refs = FLUID_ARRAY(fluid_sfindex_sample_ref_t, sfdata->sample_count);
+
+        if(refs == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            goto exit;
+        }
+    }
+
+    for(i = 0; i < sfdata->sample_count; i++)
+    {
+        SFSample *sfsample = &sfdata->sample[i];
+        fluid_sfindex_sample_t *dest = &sfindex.sample[i];
+
+        FLUID_STRNCPY(dest->name, sfsample->name, sizeof(dest->name));
+        dest->start = sfsample->start;
+        dest->end = sfsample->end;
+        dest->loopstart = sfsample->loopstart;
+        dest->loopend = sfsample->loopend;
+        dest->samplerate = sfsample->samplerate;
+        dest->origpitch = sfsample->origpitch;
+        dest->pitchadj = sfsample->pitchadj;
+        dest->sampletype = sfsample->sampletype;
+        dest->imported = (sfsample->fluid_sample != NULL);
+
+        if(sfsample->fluid_sample != NULL)
+        {
+            refs[ref_count].sample = sfsample->fluid_sample;
+            refs[ref_count].idx = i;
+            ref_count++;
+        }
+    }
+
+    if(ref_count > 0)
+    {
+        qsort(refs, ref_count, sizeof(*refs), fluid_sfindex_compare_sample_ref);
+    }
+
+    /* instruments and their zones, in soundfont zone order */
+    for(i = 0, count = 0; i < defsfont->inst_count; i++)
+    {
+        fluid_sfindex_inst_t *dest;
+        int z;
+
+        inst = defsfont->inst[i];
+
+        if(inst == NULL)
+        {
+            continue;
+        }
+
+        dest = &sfindex.inst[count++];
+        FLUID_STRNCPY(dest->name, inst->name, sizeof(dest->name));
+        dest->source_idx = inst->source_idx;
+        dest->has_global = (inst->global_zone != NULL);
+        dest->first_zone = sfindex.header->zone_count;
+        dest->zone_count = inst->zone_count + dest->has_global;
+
+        if(inst->global_zone != NULL)
+        {
+            inst_zone = inst->global_zone;
+            fluid_sfindex_put_zone(&sfindex, fluid_sfindex_find_sample(refs, ref_count, inst_zone->sample),
+                                   &inst_zone->range, inst_zone->gen, inst_zone->mod);
+        }
+
+        for(z = inst->zone_count - 1; z >= 0; z--)
+        {
+            inst_zone = &inst->zone[z];
+            fluid_sfindex_put_zone(&sfindex, fluid_sfindex_find_sample(refs, ref_count, inst_zone->sample),
+                                   &inst_zone->range, inst_zone->gen, inst_zone->mod);
+        }
+    }
+
+    /* presets and their zones, in soundfont zone order */
+    for(list = defsfont->preset, count = 0; list; list = fluid_list_next(list))
+    {
+        fluid_sfindex_preset_t *dest = &sfindex.preset[count++];
+        int z;
+
+        defpreset = fluid_preset_get_data((fluid_preset_t *)fluid_list_get(list));
+
+        FLUID_STRNCPY(dest->name, defpreset->name, sizeof(dest->name));
+        dest->bank = defpreset->bank;
+        dest->num = defpreset->num;
+        dest->has_global = (defpreset->global_zone != NULL);
+        dest->first_zone = sfindex.header->zone_count;
+        dest->zone_count = defpreset->zone_count + dest->has_global;
+
+        if(defpreset->global_zone != NULL)
+        {
+            preset_zone = defpreset->global_zone;
+            fluid_sfindex_put_zone(&sfindex, -1, &preset_zone->range, preset_zone->gen, preset_zone->mod);
+        }
+
+        for(z = defpreset->zone_count - 1; z >= 0; z--)
+        {
+            preset_zone = &defpreset->zone[z];
+            fluid_sfindex_put_zone(&sfindex, (preset_zone->inst != NULL) ? preset_zone->inst->source_idx : -1,
+                                   &preset_zone->range, preset_zone->gen, preset_zone->mod);
+        }
+    }
+
+    FLUID_MEMCPY(sfindex.header->magic, FLUID_SFINDEX_MAGIC, sizeof(sfindex.header->magic));
+    sfindex.header->version = FLUID_SFINDEX_VERSION;
+    sfindex.header->byte_order = FLUID_SFINDEX_BYTE_ORDER;
+    sfindex.header->file_size = file_size;
+    sfindex.header->file_mtime = file_mtime;
+    sfindex.header->samplepos = sfdata->samplepos;
+    sfindex.header->samplesize = sfdata->samplesize;
+    sfindex.header->sample24pos = sfdata->sample24pos;
+    sfindex.header->sample24size = sfdata->sample24size;
+    sfindex.header->hydrapos = sfdata->hydrapos;
+    sfindex.header->hydrasize = sfdata->hydrasize;
+
+    /* write to a temporary file first, so that a concurrent load never sees a partial index */
+    path = fluid_sfindex_get_path(defsfont->filename);
+
+    if(path == NULL)
+    {
+        goto exit;
+    }
+
+    total = FLUID_STRLEN(path) + 5;
+    tmp_path = FLUID_MALLOC(total);
+
+    if(tmp_path == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto exit;
+    }
+
+    FLUID_SNPRINTF(tmp_path, total, "%s.tmp", path);
+    file = FLUID_FOPEN(tmp_path, "wb");
+
+    if(file == NULL)
+    {
+        FLUID_LOG(FLUID_DBG, "Unable to create soundfont index '%s'", path);
+        goto exit;
+    }
+
+    if(FLUID_FWRITE(sfindex.data, size, 1, file) != 1)
+    {
+        FLUID_FCLOSE(file);
+        remove(tmp_path);
+        FLUID_LOG(FLUID_DBG, "Unable to write soundfont index '%s'", path);
+        goto exit;
+    }
+
+    FLUID_FCLOSE(file);
+
+#ifdef WIN32
+    /* rename() doesn't replace existing files on Windows */
+    remove(path);
+#endif
+
+    if(rename(tmp_path, path) != 0)
+    {
+        remove(tmp_path);
+        FLUID_LOG(FLUID_DBG, "Unable to write soundfont index '%s'", path);
+        goto exit;
+    }
+
+    FLUID_LOG(FLUID_DBG, "Wrote compiled soundfont index '%s'", path);
+    ret = FLUID_OK;
+
+exit:
+    FLUID_FREE(tmp_path);
+    FLUID_FREE(path);
+    FLUID_FREE(refs);
+    FLUID_FREE(sfindex.data);
+    return ret;
+}
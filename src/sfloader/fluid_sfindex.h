@@ -0,0 +1,43 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+
+/*
+ * Compiled soundfont index
+ *
+ * A sidecar file next to a soundfont that holds its fully imported presets,
+ * instruments, zones, generators and modulators in a flat, versioned layout.
+ * It is written after the first successful load and lets later loads of the
+ * unmodified soundfont skip parsing and validating the pdta chunk.
+ */
+
+#ifndef _FLUID_SFINDEX_H
+#define _FLUID_SFINDEX_H
+
+#include "fluid_defsfont.h"
+
+typedef struct _fluid_sfindex_t fluid_sfindex_t;
+
+fluid_sfindex_t *fluid_sfindex_open(const char *filename, SFData *sfdata);
+void delete_fluid_sfindex(fluid_sfindex_t *sfindex);
+int fluid_sfindex_import(fluid_sfindex_t *sfindex, fluid_defsfont_t *defsfont);
+int fluid_sfindex_write(fluid_defsfont_t *defsfont, SFData *sfdata);
+
+#endif /* _FLUID_SFINDEX_H */
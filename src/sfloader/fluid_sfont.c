@@ -22,6 +22,9 @@
 #include "fluid_sys.h"
 
 
+/* Progress hook of the load running on the current thread, if any */
+static fluid_private_t sfloader_progress;
+
 void *default_fopen(const char *path)
 {
     return FLUID_FOPEN(path, "rb");
@@ -32,7 +35,7 @@ int default_fclose(void *handle)
     return FLUID_FCLOSE((FILE *)handle) == 0 ? FLUID_OK : FLUID_FAILED;
 }
 
-long default_ftell(void *handle)
+fluid_long_long_t default_ftell(void *handle)
 {
     return FLUID_FTELL((FILE *)handle);
 }
@@ -56,17 +59,41 @@ int safe_fread(void *buf, int count, void *fd)
     return FLUID_OK;
 }
 
-int safe_fseek(void *fd, long ofs, int whence)
+int safe_fseek(void *fd, fluid_long_long_t ofs, int whence)
 {
     if(FLUID_FSEEK((FILE *)fd, ofs, whence) != 0)
     {
-        FLUID_LOG(FLUID_ERR, "File seek failed with offset = %ld and whence = %d", ofs, whence);
+        FLUID_LOG(FLUID_ERR, "File seek failed with offset = %lld and whence = %d", (long long)ofs, whence);
         return FLUID_FAILED;
     }
 
     return FLUID_OK;
 }
 
+/*
+ * Install (or with NULL, remove) a progress hook for SoundFont loads running on the calling thread.
+ */
+void fluid_sfloader_set_progress(fluid_sfloader_progress_t *progress)
+{
+    fluid_private_set(sfloader_progress, progress);
+}
+
+/*
+ * Report loading progress to the hook of the calling thread.
+ * Returns FLUID_FAILED if the running load should be cancelled, FLUID_OK otherwise.
+ */
+int fluid_sfloader_progress(fluid_long_long_t done, fluid_long_long_t total)
+{
+    fluid_sfloader_progress_t *progress = fluid_private_get(sfloader_progress);
+
+    if(progress == NULL || progress->func == NULL)
+    {
+        return FLUID_OK;
+    }
+
+    return progress->func(progress->data, done, total);
+}
+
 /**
  * Creates a new SoundFont loader.
  *
@@ -95,12 +122,12 @@ fluid_sfloader_t *new_fluid_sfloader(fluid_sfloader_load_t load, fluid_sfloader_
 
     loader->load = load;
     loader->free = free;
-    fluid_sfloader_set_callbacks(loader,
-                                 default_fopen,
-                                 safe_fread,
-                                 safe_fseek,
-                                 default_ftell,
-                                 default_fclose);
+    fluid_sfloader_set_callbacks64(loader,
+                                   default_fopen,
+                                   safe_fread,
+                                   safe_fseek,
+                                   default_ftell,
+                                   default_fclose);
 
     return loader;
 }
@@ -181,10 +208,90 @@ int fluid_sfloader_set_callbacks(fluid_sfloader_t *loader,
     cb->fseek = seek;
     cb->ftell = tell;
     cb->fclose = close;
+    cb->fseek64 = NULL;
+    cb->ftell64 = NULL;
 
     return FLUID_OK;
 }
 
+/**
+ * Set custom callbacks to be used upon soundfont loading, with 64 bit file offsets.
+ *
+ * Same as fluid_sfloader_set_callbacks(), except for the seek and tell callbacks, which
+ * support files larger than 2 GiB on all platforms. The default callbacks use them.
+ *
+ * @param loader The SoundFont loader instance.
+ * @param open A function implementing #fluid_sfloader_callback_open_t.
+ * @param read A function implementing #fluid_sfloader_callback_read_t.
+ * @param seek A function implementing #fluid_sfloader_callback_seek64_t.
+ * @param tell A function implementing #fluid_sfloader_callback_tell64_t.
+ * @param close A function implementing #fluid_sfloader_callback_close_t.
+ * @return #FLUID_OK if the callbacks have been successfully set, #FLUID_FAILED otherwise.
+ * @since 2.1.0
+ */
+int fluid_sfloader_set_callbacks64(fluid_sfloader_t *loader,
+                                   fluid_sfloader_callback_open_t open,
+                                   fluid_sfloader_callback_read_t read,
+                                   fluid_sfloader_callback_seek64_t seek,
+                                   fluid_sfloader_callback_tell64_t tell,
+                                   fluid_sfloader_callback_close_t close)
+{
+    fluid_file_callbacks_t *cb;
+
+    fluid_return_val_if_fail(loader != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(open != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(read != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(seek != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(tell != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(close != NULL, FLUID_FAILED);
+
+    cb = &loader->file_callbacks;
+
+    cb->fopen = open;
+    cb->fread = read;
+    cb->fseek = NULL;
+    cb->ftell = NULL;
+    cb->fclose = close;
+    cb->fseek64 = seek;
+    cb->ftell64 = tell;
+
+    return FLUID_OK;
+}
+
+/*
+ * Seek with the 64 bit callback if there is one. Offsets that don't fit the
+ * long of the other one fail.
+ */
+int fluid_file_seek(const fluid_file_callbacks_t *fcbs, void *handle, fluid_long_long_t offset, int origin)
+{
+    if(fcbs->fseek64 != NULL)
+    {
+        return fcbs->fseek64(handle, offset, origin);
+    }
+
+    if(offset > LONG_MAX || offset < LONG_MIN)
+    {
+        FLUID_LOG(FLUID_ERR, "File offset %lld is too large for the seek callback, "
+                  "use fluid_sfloader_set_callbacks64()", (long long)offset);
+        return FLUID_FAILED;
+    }
+
+    return fcbs->fseek(handle, (long)offset, origin);
+}
+
+/*
+ * Tell with the 64 bit callback if there is one.
+ */
+fluid_long_long_t fluid_file_tell(const fluid_file_callbacks_t *fcbs, void *handle)
+{
+    if(fcbs->ftell64 != NULL)
+    {
+        return fcbs->ftell64(handle);
+    }
+
+    return fcbs->ftell(handle);
+}
+
 /**
  * Creates a new virtual SoundFont instance structure.
  * @param get_name A function implementing #fluid_sfont_get_name_t.
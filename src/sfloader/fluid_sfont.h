@@ -23,6 +23,7 @@
 #define _PRIV_FLUID_SFONT_H
 
 #include "fluidsynth.h"
+#include "fluid_samplecodec.h"
 
 int fluid_sample_validate(fluid_sample_t *sample, unsigned int max_end);
 int fluid_sample_sanitize_loop(fluid_sample_t *sample, unsigned int max_end);
@@ -48,11 +49,30 @@ int fluid_sample_sanitize_loop(fluid_sample_t *sample, unsigned int max_end);
   { if ((_preset) && (_preset)->notify) { (*(_preset)->notify)(_preset,_reason,_chan); }}
 
 
-#define fluid_sample_incr_ref(_sample) { (_sample)->refcount++; }
+/*
+ * Progress reporting of SoundFont loads, used by fluid_synth_sfload_async().
+ * The hook is installed per thread, so only loads running on the thread that
+ * installed it will report to it.
+ */
+typedef struct _fluid_sfloader_progress_t fluid_sfloader_progress_t;
+
+struct _fluid_sfloader_progress_t
+{
+    /* Called with the number of bytes of sample data loaded so far. Returns
+     * FLUID_FAILED if the load should be cancelled, FLUID_OK otherwise. */
+    int (*func)(void *data, fluid_long_long_t done, fluid_long_long_t total);
+    void *data;
+};
+
+void fluid_sfloader_set_progress(fluid_sfloader_progress_t *progress);
+int fluid_sfloader_progress(fluid_long_long_t done, fluid_long_long_t total);
+
+
+/* Sample reference counts are atomic, as the voices of several synths may share a sample */
+#define fluid_sample_incr_ref(_sample) { fluid_atomic_int_inc(&(_sample)->refcount); }
 
 #define fluid_sample_decr_ref(_sample) \
-  (_sample)->refcount--; \
-  if (((_sample)->refcount == 0) && ((_sample)->notify)) \
+  if (fluid_atomic_int_dec_and_test(&(_sample)->refcount) && ((_sample)->notify)) \
     (*(_sample)->notify)(_sample, FLUID_SAMPLE_DONE);
 
 
@@ -67,8 +87,15 @@ struct _fluid_file_callbacks_t
     fluid_sfloader_callback_seek_t  fseek;
     fluid_sfloader_callback_close_t fclose;
     fluid_sfloader_callback_tell_t  ftell;
+
+    /* 64 bit offset versions, used instead of fseek and ftell if set */
+    fluid_sfloader_callback_seek64_t fseek64;
+    fluid_sfloader_callback_tell64_t ftell64;
 };
 
+int fluid_file_seek(const fluid_file_callbacks_t *fcbs, void *handle, fluid_long_long_t offset, int origin);
+fluid_long_long_t fluid_file_tell(const fluid_file_callbacks_t *fcbs, void *handle);
+
 /**
  * SoundFont loader structure.
  */
@@ -169,11 +196,16 @@ struct _fluid_sample_t
     int auto_free;                /**< TRUE if _fluid_sample_t::data and _fluid_sample_t::data24 should be freed upon sample destruction */
     short *data;                  /**< Pointer to the sample's 16 bit PCM data */
     char *data24;                 /**< If not NULL, pointer to the least significant byte counterparts of each sample data point in order to create 24 bit audio samples */
+    fluid_compressed_sample_t *compressed; /**< If not NULL, the sample data is kept compressed in here instead of in \a data */
+    short *loop_data;             /**< If not NULL, copy of the loop in \a data repeated for another \a loop_expansion points, index 0 is \a loopstart, see fluid_rvoice_write() */
+    char *loop_data24;            /**< If not NULL, copy of the loop in \a data24, expanded like \a loop_data */
+    unsigned int loop_expansion;  /**< Number of sample points by which the loop in \a loop_data is longer than in \a data */
+    size_t loop_data_size;        /**< Number of bytes allocated for \a loop_data and \a loop_data24 */
 
     int amplitude_that_reaches_noise_floor_is_valid;      /**< Indicates if \a amplitude_that_reaches_noise_floor is valid (TRUE), set to FALSE initially to calculate. */
     double amplitude_that_reaches_noise_floor;            /**< The amplitude at which the sample's loop will be below the noise floor.  For voice off optimization, calculated automatically. */
 
-    unsigned int refcount;        /**< Count of voices using this sample */
+    int refcount;                 /**< Count of voices using this sample */
     int preset_count;             /**< Count of selected presets using this sample (used for dynamic sample loading) */
 
     /**
@@ -183,6 +215,7 @@ struct _fluid_sample_t
      * @return Should return #FLUID_OK
      */
     int (*notify)(fluid_sample_t *sample, int reason);
+    void *notify_data;            /**< Private data of the loader for \a notify */
 };
 
 
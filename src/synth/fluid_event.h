@@ -61,6 +61,7 @@ struct _fluid_evt_entry
 {
     fluid_evt_entry *next;
     short entryType;
+    short prefetch;     /* TRUE if the destination still has to prepare for the event once it is near */
     fluid_event_t evt;
 };
 
@@ -84,4 +85,8 @@ void _fluid_evt_heap_free(fluid_evt_heap_t *heap);
 fluid_evt_entry *_fluid_seq_heap_get_free(fluid_evt_heap_t *heap);
 void _fluid_seq_heap_set_free(fluid_evt_heap_t *heap, fluid_evt_entry *evt);
 
+/* sequencer binding */
+int fluid_seqbind_prefetch(fluid_event_callback_t callback, void *data,
+                           fluid_event_t *evt, unsigned int msec);
+
 #endif /* _FLUID_EVENT_PRIV_H */
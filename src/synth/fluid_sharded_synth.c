@@ -0,0 +1,547 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include "fluid_synth.h"
+#include "fluid_sys.h"
+#include "fluid_settings.h"
+#include "fluid_midi.h"
+
+/*
+ * A sharded synth splits the MIDI channels of one logical synth across several
+ * fluid_synth_t instances, MIDI channel chan being played by shard
+ * chan % shards. Every shard has its own mixer, voice pool and API mutex, so
+ * rendering and control scale with the number of shards.
+ *
+ * Shard 0 renders on the calling thread, all other shards on a thread of their
+ * own. Each period is forked to the shard threads and joined before returning,
+ * so the shards stay sample accurate without adding latency. Since all shards
+ * share the same audio-group and effects-group routing, their outputs are
+ * simply added up.
+ */
+
+/* Maximum number of frames rendered by the shards in one go */
+#define FLUID_SHARD_MAX_FRAMES 4096
+
+typedef struct
+{
+    fluid_sharded_synth_t *ss;
+    fluid_synth_t *synth;
+    fluid_thread_t *thread;
+    unsigned int generation;    /* last generation of work rendered */
+
+    float **buf;                /* planar buffers of FLUID_SHARD_MAX_FRAMES, NULL for shard 0 */
+    float **out;                /* nout + nfx buffers passed to fluid_synth_process() */
+    int result;
+} fluid_shard_t;
+
+struct _fluid_sharded_synth_t
+{
+    int shard_count;
+    fluid_shard_t *shards;
+    int buf_count;              /* planar buffers allocated per shard */
+
+    fluid_cond_mutex_t *mutex;  /* protects everything below */
+    fluid_cond_t *work_cond;    /* signalled when a new generation of work is posted */
+    fluid_cond_t *done_cond;    /* signalled when the last shard finished its work */
+    unsigned int generation;
+    int pending;                /* shard threads still rendering the current generation */
+    int quit;
+
+    /* current work, only written by the caller while no shard thread renders */
+    int len;
+    int nfx;
+    int nout;
+};
+
+static fluid_thread_return_t fluid_sharded_synth_thread(void *data);
+
+
+/**
+ * Create a synth whose MIDI channels are rendered by several synth instances in parallel.
+ *
+ * Each of the \c shards synths is created from \c settings and plays the MIDI
+ * channels \c chan with <code>chan % shards == shard</code>. Use
+ * fluid_sharded_synth_handle_midi_event() to route MIDI events to the right shard and
+ * fluid_sharded_synth_process() to render the sum of all shards. Anything else, like
+ * reverb and chorus parameters, has to be configured on every shard as returned by
+ * fluid_sharded_synth_get_shard().
+ *
+ * @param settings Configuration parameters to use for all shards
+ * @param shards Number of synth instances, one thread is created for every shard but the first
+ * @return New sharded synth or NULL on error
+ * @since 2.1.0
+ */
+fluid_sharded_synth_t *
+new_fluid_sharded_synth(fluid_settings_t *settings, int shards)
+{
+    fluid_sharded_synth_t *ss;
+    fluid_shard_t *shard;
+    int audio_channels, effects_channels, effects_groups;
+    int prio_level = 0;
+    char name[16];
+    int i, k;
+
+    fluid_return_val_if_fail(settings != NULL, NULL);
+    fluid_return_val_if_fail(shards > 0, NULL);
+
+    ss = FLUID_NEW(fluid_sharded_synth_t);
+
+    if(ss == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    FLUID_MEMSET(ss, 0, sizeof(*ss));
+
+    fluid_settings_getint(settings, "synth.audio-channels", &audio_channels);
+    fluid_settings_getint(settings, "synth.effects-channels", &effects_channels);
+    fluid_settings_getint(settings, "synth.effects-groups", &effects_groups);
+    fluid_settings_getint(settings, "audio.realtime-prio", &prio_level);
+    ss->buf_count = 2 * audio_channels + 2 * effects_channels * effects_groups;
+
+    ss->mutex = new_fluid_cond_mutex();
+    ss->work_cond = new_fluid_cond();
+    ss->done_cond = new_fluid_cond();
+    ss->shards = FLUID_ARRAY(fluid_shard_t, shards);
+
+    if(ss->mutex == NULL || ss->work_cond == NULL || ss->done_cond == NULL
+            || ss->shards == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        goto error_recovery;
+    }
+
+    FLUID_MEMSET(ss->shards, 0, shards * sizeof(*ss->shards));
+
+    for(i = 0; i < shards; i++)
+    {
+        shard = &ss->shards[i];
+        shard->ss = ss;
+        shard->synth = new_fluid_synth(settings);
+
+        if(shard->synth == NULL)
+        {
+            goto error_recovery;
+        }
+
+        ss->shard_count++;
+        shard->out = FLUID_ARRAY(float *, ss->buf_count);
+
+        if(shard->out == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            goto error_recovery;
+        }
+
+        /* shard 0 renders straight into the caller's buffers */
+        if(i == 0)
+        {
+            continue;
+        }
+
+        shard->buf = FLUID_ARRAY(float *, ss->buf_count);
+
+        if(shard->buf == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            goto error_recovery;
+        }
+
+        FLUID_MEMSET(shard->buf, 0, ss->buf_count * sizeof(*shard->buf));
+
+        for(k = 0; k < ss->buf_count; k++)
+        {
+            shard->buf[k] = FLUID_ARRAY(float, FLUID_SHARD_MAX_FRAMES);
+
+            if(shard->buf[k] == NULL)
+            {
+                FLUID_LOG(FLUID_ERR, "Out of memory");
+                goto error_recovery;
+            }
+        }
+
+        FLUID_SNPRINTF(name, sizeof(name), "shard%d", i);
+        shard->thread = new_fluid_thread(name, fluid_sharded_synth_thread, shard, prio_level, 0);
+
+        if(shard->thread == NULL)
+        {
+            goto error_recovery;
+        }
+    }
+
+    return ss;
+
+error_recovery:
+    delete_fluid_sharded_synth(ss);
+    return NULL;
+}
+
+/**
+ * Delete a sharded synth and all of its shards.
+ * @param ss Sharded synth instance
+ * @since 2.1.0
+ */
+void
+delete_fluid_sharded_synth(fluid_sharded_synth_t *ss)
+{
+    fluid_shard_t *shard;
+    int i, k;
+
+    fluid_return_if_fail(ss != NULL);
+
+    if(ss->mutex != NULL)
+    {
+        fluid_cond_mutex_lock(ss->mutex);
+        ss->quit = TRUE;
+        fluid_cond_broadcast(ss->work_cond);
+        fluid_cond_mutex_unlock(ss->mutex);
+    }
+
+    for(i = 0; i < ss->shard_count; i++)
+    {
+        shard = &ss->shards[i];
+
+        if(shard->thread != NULL)
+        {
+            fluid_thread_join(shard->thread);
+            delete_fluid_thread(shard->thread);
+        }
+
+        if(shard->buf != NULL)
+        {
+            for(k = 0; k < ss->buf_count; k++)
+            {
+                FLUID_FREE(shard->buf[k]);
+            }
+        }
+
+        FLUID_FREE(shard->buf);
+        FLUID_FREE(shard->out);
+        delete_fluid_synth(shard->synth);
+    }
+
+    if(ss->mutex != NULL)
+    {
+        delete_fluid_cond_mutex(ss->mutex);
+    }
+
+    if(ss->work_cond != NULL)
+    {
+        delete_fluid_cond(ss->work_cond);
+    }
+
+    if(ss->done_cond != NULL)
+    {
+        delete_fluid_cond(ss->done_cond);
+    }
+
+    FLUID_FREE(ss->shards);
+    FLUID_FREE(ss);
+}
+
+/**
+ * Get the number of shards of a sharded synth.
+ * @param ss Sharded synth instance
+ * @return Number of shards
+ * @since 2.1.0
+ */
+int
+fluid_sharded_synth_count_shards(fluid_sharded_synth_t *ss)
+{
+    fluid_return_val_if_fail(ss != NULL, FLUID_FAILED);
+
+    return ss->shard_count;
+}
+
+/**
+ * Get one of the synth instances of a sharded synth.
+ *
+ * The shard can be controlled like any other synth, e.g. to change its reverb
+ * parameters. Don't call any of its rendering functions though.
+ *
+ * @param ss Sharded synth instance
+ * @param shard Zero-based shard index
+ * @return The synth instance of the shard or NULL if \c shard is out of range
+ * @since 2.1.0
+ */
+fluid_synth_t *
+fluid_sharded_synth_get_shard(fluid_sharded_synth_t *ss, int shard)
+{
+    fluid_return_val_if_fail(ss != NULL, NULL);
+    fluid_return_val_if_fail(shard >= 0 && shard < ss->shard_count, NULL);
+
+    return ss->shards[shard].synth;
+}
+
+/**
+ * Get the synth instance playing a MIDI channel.
+ * @param ss Sharded synth instance
+ * @param chan MIDI channel number (0 to MIDI channel count - 1)
+ * @return The synth instance of the shard playing \c chan or NULL on error
+ * @since 2.1.0
+ */
+fluid_synth_t *
+fluid_sharded_synth_get_channel_shard(fluid_sharded_synth_t *ss, int chan)
+{
+    fluid_return_val_if_fail(ss != NULL, NULL);
+    fluid_return_val_if_fail(chan >= 0, NULL);
+
+    return ss->shards[chan % ss->shard_count].synth;
+}
+
+/**
+ * Load a SoundFont into all shards of a sharded synth.
+ *
+ * The SoundFont is loaded by the first shard and shared by reference with all
+ * others (see fluid_synth_sfload_shared()), falling back to loading it once per
+ * shard if it can't be shared.
+ *
+ * @param ss Sharded synth instance
+ * @param filename File to load
+ * @param reset_presets TRUE to re-assign presets for all MIDI channels
+ * @return SoundFont ID of the first shard on success, #FLUID_FAILED on error
+ * @since 2.1.0
+ */
+int
+fluid_sharded_synth_sfload(fluid_sharded_synth_t *ss, const char *filename, int reset_presets)
+{
+    fluid_sfont_t *sfont;
+    int sfont_id, i;
+
+    fluid_return_val_if_fail(ss != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(filename != NULL, FLUID_FAILED);
+
+    sfont_id = fluid_synth_sfload(ss->shards[0].synth, filename, reset_presets);
+
+    if(sfont_id == FLUID_FAILED)
+    {
+        return FLUID_FAILED;
+    }
+
+    sfont = fluid_synth_get_sfont_by_id(ss->shards[0].synth, sfont_id);
+
+    for(i = 1; i < ss->shard_count; i++)
+    {
+        if(fluid_synth_sfload_shared(ss->shards[i].synth, sfont, reset_presets) == FLUID_FAILED
+                && fluid_synth_sfload(ss->shards[i].synth, filename, reset_presets) == FLUID_FAILED)
+        {
+            return FLUID_FAILED;
+        }
+    }
+
+    return sfont_id;
+}
+
+/**
+ * Handle MIDI event from MIDI router, used as a callback function.
+ *
+ * Channel messages are passed to the shard playing the channel, all other
+ * messages (e.g. SYSEX and system reset) are passed to every shard.
+ *
+ * @param data Sharded synth instance
+ * @param event MIDI event to handle
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ * @since 2.1.0
+ */
+int
+fluid_sharded_synth_handle_midi_event(void *data, fluid_midi_event_t *event)
+{
+    fluid_sharded_synth_t *ss = (fluid_sharded_synth_t *) data;
+    int result = FLUID_OK;
+    int i;
+
+    fluid_return_val_if_fail(ss != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(event != NULL, FLUID_FAILED);
+
+    switch(fluid_midi_event_get_type(event))
+    {
+    case NOTE_ON:
+    case NOTE_OFF:
+    case CONTROL_CHANGE:
+    case PROGRAM_CHANGE:
+    case CHANNEL_PRESSURE:
+    case KEY_PRESSURE:
+    case PITCH_BEND:
+        return fluid_synth_handle_midi_event(
+                   fluid_sharded_synth_get_channel_shard(ss, fluid_midi_event_get_channel(event)),
+                   event);
+
+    default:
+        for(i = 0; i < ss->shard_count; i++)
+        {
+            if(fluid_synth_handle_midi_event(ss->shards[i].synth, event) == FLUID_FAILED)
+            {
+                result = FLUID_FAILED;
+            }
+        }
+
+        return result;
+    }
+}
+
+/**
+ * Synthesize floating point audio of all shards of a sharded synth.
+ *
+ * Takes the same arguments and mixes audio into the buffers the same way as
+ * fluid_synth_process(). The shards are rendered in parallel and their audio
+ * added up before returning.
+ *
+ * @param ss Sharded synth instance
+ * @param len Count of audio frames to synthesize
+ * @param nfx Count of arrays in \c fx
+ * @param fx Array of buffers to store effects audio to
+ * @param nout Count of arrays in \c out
+ * @param out Array of buffers to store (dry) audio to
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ * @since 2.1.0
+ */
+int
+fluid_sharded_synth_process(fluid_sharded_synth_t *ss, int len, int nfx, float *fx[],
+                            int nout, float *out[])
+{
+    fluid_shard_t *shard;
+    int result = FLUID_OK;
+    int offset, count, i, k, j;
+
+    fluid_return_val_if_fail(ss != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(nfx >= 0 && nout >= 0, FLUID_FAILED);
+    fluid_return_val_if_fail(nfx + nout <= ss->buf_count, FLUID_FAILED);
+
+    for(offset = 0; offset < len; offset += count)
+    {
+        count = (len - offset > FLUID_SHARD_MAX_FRAMES) ? FLUID_SHARD_MAX_FRAMES : len - offset;
+
+        /* fork: no shard thread is rendering, so the work can be set up unlocked */
+        for(k = 0; k < nout + nfx; k++)
+        {
+            float *buf = (k < nout) ? out[k] : fx[k - nout];
+
+            ss->shards[0].out[k] = (buf != NULL) ? buf + offset : NULL;
+
+            for(i = 1; i < ss->shard_count; i++)
+            {
+                ss->shards[i].out[k] = (buf != NULL) ? ss->shards[i].buf[k] : NULL;
+            }
+        }
+
+        fluid_cond_mutex_lock(ss->mutex);
+        ss->len = count;
+        ss->nfx = nfx;
+        ss->nout = nout;
+        ss->pending = ss->shard_count - 1;
+        ss->generation++;
+        fluid_cond_broadcast(ss->work_cond);
+        fluid_cond_mutex_unlock(ss->mutex);
+
+        shard = &ss->shards[0];
+
+        if(fluid_synth_process(shard->synth, count, nfx, &shard->out[nout], nout, shard->out) != FLUID_OK)
+        {
+            result = FLUID_FAILED;
+        }
+
+        /* join */
+        fluid_cond_mutex_lock(ss->mutex);
+
+        while(ss->pending > 0)
+        {
+            fluid_cond_wait(ss->done_cond, ss->mutex);
+        }
+
+        fluid_cond_mutex_unlock(ss->mutex);
+
+        for(i = 1; i < ss->shard_count; i++)
+        {
+            shard = &ss->shards[i];
+
+            if(shard->result != FLUID_OK)
+            {
+                result = FLUID_FAILED;
+            }
+
+            for(k = 0; k < nout + nfx; k++)
+            {
+                float *buf = ss->shards[0].out[k];
+
+                if(buf == NULL)
+                {
+                    continue;
+                }
+
+                for(j = 0; j < count; j++)
+                {
+                    buf[j] += shard->buf[k][j];
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+/* Private functions */
+
+static fluid_thread_return_t fluid_sharded_synth_thread(void *data)
+{
+    fluid_shard_t *shard = data;
+    fluid_sharded_synth_t *ss = shard->ss;
+    int len, nfx, nout, k;
+
+    fluid_cond_mutex_lock(ss->mutex);
+
+    while(!ss->quit)
+    {
+        if(shard->generation == ss->generation)
+        {
+            fluid_cond_wait(ss->work_cond, ss->mutex);
+            continue;
+        }
+
+        shard->generation = ss->generation;
+        len = ss->len;
+        nfx = ss->nfx;
+        nout = ss->nout;
+        fluid_cond_mutex_unlock(ss->mutex);
+
+        for(k = 0; k < nout + nfx; k++)
+        {
+            if(shard->out[k] != NULL)
+            {
+                FLUID_MEMSET(shard->out[k], 0, len * sizeof(float));
+            }
+        }
+
+        shard->result = fluid_synth_process(shard->synth, len,
+                                            nfx, &shard->out[nout], nout, shard->out);
+
+        fluid_cond_mutex_lock(ss->mutex);
+
+        if(--ss->pending == 0)
+        {
+            fluid_cond_broadcast(ss->done_cond);
+        }
+    }
+
+    fluid_cond_mutex_unlock(ss->mutex);
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
@@ -56,6 +56,7 @@ extern int feenableexcept(int excepts);
 static void fluid_synth_init(void);
 static void fluid_synth_api_enter(fluid_synth_t *synth);
 static void fluid_synth_api_exit(fluid_synth_t *synth);
+static int fluid_synth_api_tryenter(fluid_synth_t *synth);
 
 static int fluid_synth_noteon_LOCAL(fluid_synth_t *synth, int chan, int key,
                                     int vel);
@@ -87,6 +88,9 @@ fluid_synth_get_preset_by_sfont_name(fluid_synth_t *synth, const char *sfontname
 static void fluid_synth_update_presets(fluid_synth_t *synth);
 static void fluid_synth_update_gain_LOCAL(fluid_synth_t *synth);
 static int fluid_synth_update_polyphony_LOCAL(fluid_synth_t *synth, int new_polyphony);
+static int fluid_synth_resize_voice_pool_LOCAL(fluid_synth_t *synth, int new_polyphony);
+static void fluid_synth_enable_sample_decoding_LOCAL(fluid_synth_t *synth, fluid_sfont_t *sfont);
+static void fluid_synth_alloc_fx_LOCAL(fluid_synth_t *synth);
 static void init_dither(void);
 static FLUID_INLINE int16_t round_clip_to_i16(float x);
 static int fluid_synth_render_blocks(fluid_synth_t *synth, int blockcount);
@@ -95,6 +99,10 @@ static fluid_voice_t *fluid_synth_free_voice_by_kill_LOCAL(fluid_synth_t *synth)
 static void fluid_synth_kill_by_exclusive_class_LOCAL(fluid_synth_t *synth,
         fluid_voice_t *new_voice);
 static int fluid_synth_sfunload_callback(void *data, unsigned int msec);
+static fluid_thread_return_t fluid_synth_sfload_thread(void *data);
+static int fluid_synth_queue_prefetch(fluid_synth_t *synth, fluid_preset_t *preset);
+static fluid_thread_return_t fluid_synth_prefetch_thread(void *data);
+static int fluid_synth_sfload_progress(void *data, fluid_long_long_t done, fluid_long_long_t total);
 static fluid_tuning_t *fluid_synth_get_tuning(fluid_synth_t *synth,
         int bank, int prog);
 static int fluid_synth_replace_tuning_LOCK(fluid_synth_t *synth,
@@ -111,6 +119,7 @@ static int fluid_synth_set_tuning_LOCAL(fluid_synth_t *synth, int chan,
 static void fluid_synth_set_gen_LOCAL(fluid_synth_t *synth, int chan,
                                       int param, float value, int absolute);
 static void fluid_synth_stop_LOCAL(fluid_synth_t *synth, unsigned int id);
+static void fluid_synth_update_cpu_load(fluid_synth_t *synth, double time, int len);
 
 
 static int fluid_synth_set_important_channels(fluid_synth_t *synth, const char *channels);
@@ -142,6 +151,21 @@ static int fluid_synth_set_chorus_full_LOCAL(fluid_synth_t *synth, int set, int
  *                         GLOBAL
  */
 
+/* State of a SoundFont load running on its own thread, see fluid_synth_sfload_async() */
+typedef struct _fluid_sfload_job_t
+{
+    fluid_synth_t *synth;
+    char *filename;
+    int reset_presets;
+    int id;                                 /* SoundFont ID reserved for this load */
+    fluid_synth_sfload_progress_t progress;
+    void *data;
+    fluid_sfloader_progress_t hook;         /* installed on the loader thread */
+    fluid_atomic_int_t cancel;              /* set to request cancellation */
+    int result;                             /* SoundFont ID on success, FLUID_FAILED otherwise */
+    fluid_thread_t *thread;
+} fluid_sfload_job_t;
+
 /* has the synth module been initialized? */
 /* fluid_atomic_int_t may be anything, so init with {0} to catch most cases */
 static fluid_atomic_int_t fluid_synth_initialized = {0};
@@ -198,6 +222,9 @@ void fluid_synth_settings(fluid_settings_t *settings)
     fluid_settings_register_num(settings, "synth.reverb.damp", FLUID_REVERB_DEFAULT_DAMP, 0.0f, 1.0f, 0);
     fluid_settings_register_num(settings, "synth.reverb.width", FLUID_REVERB_DEFAULT_WIDTH, 0.0f, 100.0f, 0);
     fluid_settings_register_num(settings, "synth.reverb.level", FLUID_REVERB_DEFAULT_LEVEL, 0.0f, 1.0f, 0);
+    fluid_settings_register_str(settings, "synth.reverb.engine", "fdn", 0);
+    fluid_settings_add_option(settings, "synth.reverb.engine", "fdn");
+    fluid_settings_add_option(settings, "synth.reverb.engine", "lite");
 
     fluid_settings_register_int(settings, "synth.chorus.active", 1, 0, 1, FLUID_HINT_TOGGLED);
     fluid_settings_register_int(settings, "synth.chorus.nr", FLUID_CHORUS_DEFAULT_N, 0, 99, 0);
@@ -207,6 +234,9 @@ void fluid_synth_settings(fluid_settings_t *settings)
 
     fluid_settings_register_int(settings, "synth.ladspa.active", 0, 0, 1, FLUID_HINT_TOGGLED);
     fluid_settings_register_int(settings, "synth.lock-memory", 1, 0, 1, FLUID_HINT_TOGGLED);
+    fluid_settings_register_int(settings, "synth.huge-pages", 0, 0, 1, FLUID_HINT_TOGGLED);
+    fluid_settings_register_int(settings, "synth.lightweight", 0, 0, 1, FLUID_HINT_TOGGLED);
+    fluid_settings_register_int(settings, "synth.render-pool", 0, 0, 1, FLUID_HINT_TOGGLED);
     fluid_settings_register_str(settings, "midi.portname", "", 0);
 
 #ifdef DEFAULT_SOUNDFONT
@@ -239,6 +269,7 @@ void fluid_synth_settings(fluid_settings_t *settings)
     fluid_settings_register_num(settings, "synth.overflow.volume", 500, -10000, 10000, 0);
     fluid_settings_register_num(settings, "synth.overflow.important", 5000, -50000, 50000, 0);
     fluid_settings_register_str(settings, "synth.overflow.important-channels", "", 0);
+    fluid_settings_register_num(settings, "synth.overflow.cpu-load", 0, 0, 100, 0);
 
     fluid_settings_register_str(settings, "synth.midi-bank-select", "gs", 0);
     fluid_settings_add_option(settings, "synth.midi-bank-select", "gm");
@@ -247,6 +278,15 @@ void fluid_synth_settings(fluid_settings_t *settings)
     fluid_settings_add_option(settings, "synth.midi-bank-select", "mma");
 
     fluid_settings_register_int(settings, "synth.dynamic-sample-loading", 0, 0, 1, FLUID_HINT_TOGGLED);
+    fluid_settings_register_int(settings, "synth.dynamic-sample-retention", 0, 0, 1048576, 0);
+    fluid_settings_register_int(settings, "synth.prefetch-window", 0, 0, 60000, 0);
+    fluid_settings_register_int(settings, "synth.sample-cache-size", 0, 0, 1048576, 0);
+    fluid_settings_register_int(settings, "synth.sample-cache-dedup", 0, 0, 1, FLUID_HINT_TOGGLED);
+    fluid_settings_register_int(settings, "synth.soundfont-index", 0, 0, 1, FLUID_HINT_TOGGLED);
+
+    fluid_settings_register_str(settings, "synth.sample-storage", "plain", 0);
+    fluid_settings_add_option(settings, "synth.sample-storage", "plain");
+    fluid_settings_add_option(settings, "synth.sample-storage", "compressed");
 }
 
 /**
@@ -597,8 +637,11 @@ new_fluid_synth(fluid_settings_t *settings)
     fluid_synth_t *synth;
     fluid_sfloader_t *loader;
     char *important_channels;
-    int i, nbuf, prio_level = 0;
+    int i, nbuf, prio_level = 0, render_pool = 0;
     int with_ladspa = 0;
+    int retention, cache_size, huge_pages;
+    int period_size = FLUID_BUFSIZE, buf_blocks = FLUID_MIXER_MAX_BUFFERS_DEFAULT;
+    int reverb_engine;
 
     /* initialize all the conversion tables and other stuff */
     if(fluid_atomic_int_compare_and_exchange(&fluid_synth_initialized, 0, 1))
@@ -625,9 +668,12 @@ new_fluid_synth(fluid_settings_t *settings)
 
     fluid_settings_getint(settings, "synth.reverb.active", &synth->with_reverb);
     fluid_settings_getint(settings, "synth.chorus.active", &synth->with_chorus);
+    reverb_engine = fluid_settings_str_equal(settings, "synth.reverb.engine", "lite")
+                    ? FLUID_REVMODEL_LITE : FLUID_REVMODEL_FDN;
     fluid_settings_getint(settings, "synth.verbose", &synth->verbose);
 
     fluid_settings_getint(settings, "synth.polyphony", &synth->polyphony);
+    fluid_settings_getint(settings, "synth.lightweight", &synth->lightweight);
     fluid_settings_getnum(settings, "synth.sample-rate", &synth->sample_rate);
     fluid_settings_getint(settings, "synth.midi-channels", &synth->midi_channels);
     fluid_settings_getint(settings, "synth.audio-channels", &synth->audio_channels);
@@ -637,6 +683,10 @@ new_fluid_synth(fluid_settings_t *settings)
     fluid_settings_getnum_float(settings, "synth.gain", &synth->gain);
     fluid_settings_getint(settings, "synth.device-id", &synth->device_id);
     fluid_settings_getint(settings, "synth.cpu-cores", &synth->cores);
+    fluid_settings_getint(settings, "synth.prefetch-window", &synth->prefetch_window);
+    synth->sample_decoding = fluid_settings_str_equal(settings, "synth.sample-storage", "compressed");
+
+    fluid_settings_getint(settings, "synth.huge-pages", &huge_pages);
 
     fluid_settings_getnum_float(settings, "synth.overflow.percussion", &synth->overflow.percussion);
     fluid_settings_getnum_float(settings, "synth.overflow.released", &synth->overflow.released);
@@ -644,6 +694,7 @@ new_fluid_synth(fluid_settings_t *settings)
     fluid_settings_getnum_float(settings, "synth.overflow.volume", &synth->overflow.volume);
     fluid_settings_getnum_float(settings, "synth.overflow.age", &synth->overflow.age);
     fluid_settings_getnum_float(settings, "synth.overflow.important", &synth->overflow.important);
+    fluid_settings_getnum_float(settings, "synth.overflow.cpu-load", &synth->cpu_load_target);
 
     /* register the callbacks */
     fluid_settings_callback_num(settings, "synth.sample-rate",
@@ -668,6 +719,8 @@ new_fluid_synth(fluid_settings_t *settings)
                                 fluid_synth_handle_overflow, synth);
     fluid_settings_callback_str(settings, "synth.overflow.important-channels",
                                 fluid_synth_handle_important_channels, synth);
+    fluid_settings_callback_num(settings, "synth.overflow.cpu-load",
+                                fluid_synth_handle_overflow, synth);
     fluid_settings_callback_num(settings, "synth.reverb.room-size",
                                 fluid_synth_handle_reverb_chorus_num, synth);
     fluid_settings_callback_num(settings, "synth.reverb.damp",
@@ -767,12 +820,37 @@ new_fluid_synth(fluid_settings_t *settings)
     if(synth->cores > 1)
     {
         fluid_settings_getint(synth->settings, "audio.realtime-prio", &prio_level);
+        fluid_settings_getint(synth->settings, "synth.render-pool", &render_pool);
+    }
+
+    /* A lightweight synth starts with a small voice pool, its mixer buffers only
+     * hold one audio period and the effects units are created once the first
+     * voice gets started. */
+    synth->polyphony_limit = synth->polyphony;
+    synth->fx_allocated = !synth->lightweight;
+
+    if(synth->lightweight)
+    {
+        fluid_settings_getint(settings, "audio.period-size", &period_size);
+        buf_blocks = (period_size + FLUID_BUFSIZE - 1) / FLUID_BUFSIZE;
+
+        if(buf_blocks > FLUID_MIXER_MAX_BUFFERS_DEFAULT)
+        {
+            buf_blocks = FLUID_MIXER_MAX_BUFFERS_DEFAULT;
+        }
+
+        if(synth->polyphony > FLUID_LIGHTWEIGHT_POLYPHONY)
+        {
+            synth->polyphony = FLUID_LIGHTWEIGHT_POLYPHONY;
+        }
     }
 
     /* Allocate event queue for rvoice mixer */
     /* In an overflow situation, a new voice takes about 50 spaces in the queue! */
-    synth->eventhandler = new_fluid_rvoice_eventhandler(synth->polyphony * 64,
-                          synth->polyphony, nbuf, synth->effects_channels, synth->effects_groups, synth->sample_rate, synth->cores - 1, prio_level);
+    synth->eventhandler = new_fluid_rvoice_eventhandler(synth->polyphony_limit * 64,
+                          synth->polyphony_limit, nbuf, synth->effects_channels, synth->effects_groups,
+                          buf_blocks, synth->lightweight, reverb_engine, synth->sample_rate, synth->cores - 1, prio_level,
+                          render_pool, huge_pages);
 
     if(synth->eventhandler == NULL)
     {
@@ -800,8 +878,7 @@ new_fluid_synth(fluid_settings_t *settings)
     if(with_ladspa)
     {
 #ifdef LADSPA
-        synth->ladspa_fx = new_fluid_ladspa_fx(synth->sample_rate,
-                                               FLUID_MIXER_MAX_BUFFERS_DEFAULT * FLUID_BUFSIZE);
+        synth->ladspa_fx = new_fluid_ladspa_fx(synth->sample_rate, buf_blocks * FLUID_BUFSIZE);
 
         if(synth->ladspa_fx == NULL)
         {
@@ -858,7 +935,7 @@ new_fluid_synth(fluid_settings_t *settings)
 
     for(i = 0; i < synth->nvoice; i++)
     {
-        synth->voice[i] = new_fluid_voice(synth->eventhandler, synth->sample_rate);
+        synth->voice[i] = new_fluid_voice(synth->eventhandler, synth->sample_rate, synth->sample_decoding);
 
         if(synth->voice[i] == NULL)
         {
@@ -938,6 +1015,36 @@ new_fluid_synth(fluid_settings_t *settings)
         synth->bank_select = FLUID_BANK_STYLE_MMA;
     }
 
+    if(synth->prefetch_window > 0)
+    {
+        synth->prefetch_mutex = new_fluid_cond_mutex();
+        synth->prefetch_cond = new_fluid_cond();
+
+        if(synth->prefetch_mutex == NULL || synth->prefetch_cond == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            goto error_recovery;
+        }
+
+        synth->prefetch_thread = new_fluid_thread("prefetch", fluid_synth_prefetch_thread, synth, 0, FALSE);
+
+        if(synth->prefetch_thread == NULL)
+        {
+            FLUID_LOG(FLUID_WARN, "Failed to create the prefetch thread, disabling sample prefetching");
+            synth->prefetch_window = 0;
+        }
+
+        fluid_settings_getint(settings, "synth.dynamic-sample-loading", &i);
+        fluid_settings_getint(settings, "synth.dynamic-sample-retention", &retention);
+        fluid_settings_getint(settings, "synth.sample-cache-size", &cache_size);
+
+        if(i && retention == 0 && cache_size == 0)
+        {
+            FLUID_LOG(FLUID_WARN, "Prefetched samples are unloaded right away, "
+                      "set synth.dynamic-sample-retention or synth.sample-cache-size to keep them");
+        }
+    }
+
     fluid_synth_process_event_queue(synth);
 
     /* FIXME */
@@ -972,6 +1079,47 @@ delete_fluid_synth(fluid_synth_t *synth)
 
     fluid_profiling_print();
 
+    /* cancel and finish asynchronous SoundFont loads, before anything they use is freed */
+    for(list = synth->sfload_jobs; list; list = fluid_list_next(list))
+    {
+        fluid_sfload_job_t *job = fluid_list_get(list);
+        fluid_atomic_int_set(&job->cancel, TRUE);
+    }
+
+    for(list = synth->sfload_jobs; list; list = fluid_list_next(list))
+    {
+        fluid_sfload_job_t *job = fluid_list_get(list);
+
+        fluid_thread_join(job->thread);
+        delete_fluid_thread(job->thread);
+        FLUID_FREE(job->filename);
+        FLUID_FREE(job);
+    }
+
+    delete_fluid_list(synth->sfload_jobs);
+
+    /* stop prefetching and drop the SoundFont references of pending requests */
+    if(synth->prefetch_thread != NULL)
+    {
+        fluid_cond_mutex_lock(synth->prefetch_mutex);
+        synth->prefetch_quit = TRUE;
+        fluid_cond_signal(synth->prefetch_cond);
+        fluid_cond_mutex_unlock(synth->prefetch_mutex);
+
+        fluid_thread_join(synth->prefetch_thread);
+        delete_fluid_thread(synth->prefetch_thread);
+    }
+
+    for(list = synth->prefetch_queue; list; list = fluid_list_next(list))
+    {
+        fluid_preset_t *preset = fluid_list_get(list);
+        fluid_synth_sfont_unref(synth, preset->sfont);
+    }
+
+    delete_fluid_list(synth->prefetch_queue);
+    delete_fluid_cond(synth->prefetch_cond);
+    delete_fluid_cond_mutex(synth->prefetch_mutex);
+
     /* turn off all voices, needed to unload SoundFont data */
     if(synth->voice != NULL)
     {
@@ -3174,6 +3322,45 @@ fluid_synth_set_polyphony(fluid_synth_t *synth, int polyphony)
 /* Called by synthesis thread to update the polyphony value */
 static int
 fluid_synth_update_polyphony_LOCAL(fluid_synth_t *synth, int new_polyphony)
+{
+    synth->polyphony_limit = new_polyphony;
+
+    /* a lightweight synth only grows its voice pool when running out of voices */
+    if(synth->lightweight && new_polyphony > synth->polyphony)
+    {
+        return FLUID_OK;
+    }
+
+    return fluid_synth_resize_voice_pool_LOCAL(synth, new_polyphony);
+}
+
+/* Give all voices a decode cache once a SoundFont with compressed sample data is added,
+ * synth.sample-storage may have been changed after the synth was created */
+static void
+fluid_synth_enable_sample_decoding_LOCAL(fluid_synth_t *synth, fluid_sfont_t *sfont)
+{
+    int i;
+
+    if(synth->sample_decoding || !fluid_defsfont_is_compressed(sfont))
+    {
+        return;
+    }
+
+    for(i = 0; i < synth->nvoice; i++)
+    {
+        if(fluid_voice_enable_sample_decoding(synth->voice[i], TRUE) != FLUID_OK)
+        {
+            FLUID_LOG(FLUID_WARN, "Failed to set up sample decoding, voices may play compressed samples silently");
+            return;
+        }
+    }
+
+    synth->sample_decoding = TRUE;
+}
+
+/* Make the first new_polyphony voices available for playing, creating any missing ones */
+static int
+fluid_synth_resize_voice_pool_LOCAL(fluid_synth_t *synth, int new_polyphony)
 {
     fluid_voice_t *voice;
     int i;
@@ -3193,7 +3380,7 @@ fluid_synth_update_polyphony_LOCAL(fluid_synth_t *synth, int new_polyphony)
 
         for(i = synth->nvoice; i < new_polyphony; i++)
         {
-            synth->voice[i] = new_fluid_voice(synth->eventhandler, synth->sample_rate);
+            synth->voice[i] = new_fluid_voice(synth->eventhandler, synth->sample_rate, synth->sample_decoding);
 
             if(synth->voice[i] == NULL)
             {
@@ -3238,7 +3425,7 @@ fluid_synth_get_polyphony(fluid_synth_t *synth)
     fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
     fluid_synth_api_enter(synth);
 
-    result = synth->polyphony;
+    result = synth->polyphony_limit;
     FLUID_API_RETURN(result);
 }
 
@@ -3368,10 +3555,10 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
     fluid_real_t *right_in, *fx_right_in;
     double time = fluid_utime();
     int i, num, available, count;
+    const int buf_size = fluid_rvoice_mixer_get_bufcount(synth->eventhandler->mixer) * FLUID_BUFSIZE;
 #ifdef WITH_FLOAT
     int bytes;
 #endif
-    float cpu_load;
 
     fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
     fluid_return_val_if_fail(left != NULL, FLUID_FAILED);
@@ -3395,15 +3582,15 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
         for(i = 0; i < synth->audio_channels; i++)
         {
 #ifdef WITH_FLOAT
-            FLUID_MEMCPY(left[i], &left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + synth->cur], bytes);
-            FLUID_MEMCPY(right[i], &right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + synth->cur], bytes);
+            FLUID_MEMCPY(left[i], &left_in[i * buf_size + synth->cur], bytes);
+            FLUID_MEMCPY(right[i], &right_in[i * buf_size + synth->cur], bytes);
 #else //WITH_FLOAT
             int j;
 
             for(j = 0; j < num; j++)
             {
-                left[i][j] = (float) left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j + synth->cur];
-                right[i][j] = (float) right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j + synth->cur];
+                left[i][j] = (float) left_in[i * buf_size + j + synth->cur];
+                right[i][j] = (float) right_in[i * buf_size + j + synth->cur];
             }
 
 #endif //WITH_FLOAT
@@ -3415,12 +3602,12 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
 
             if(fx_left != NULL)
             {
-                FLUID_MEMCPY(fx_left[i], &fx_left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + synth->cur], bytes);
+                FLUID_MEMCPY(fx_left[i], &fx_left_in[i * buf_size + synth->cur], bytes);
             }
 
             if(fx_right != NULL)
             {
-                FLUID_MEMCPY(fx_right[i], &fx_right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + synth->cur], bytes);
+                FLUID_MEMCPY(fx_right[i], &fx_right_in[i * buf_size + synth->cur], bytes);
             }
 
 #else //WITH_FLOAT
@@ -3430,7 +3617,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
             {
                 for(j = 0; j < num; j++)
                 {
-                    fx_left[i][j] = (float) fx_left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j + synth->cur];
+                    fx_left[i][j] = (float) fx_left_in[i * buf_size + j + synth->cur];
                 }
             }
 
@@ -3438,7 +3625,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
             {
                 for(j = 0; j < num; j++)
                 {
-                    fx_right[i][j] = (float) fx_right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j + synth->cur];
+                    fx_right[i][j] = (float) fx_right_in[i * buf_size + j + synth->cur];
                 }
             }
 
@@ -3465,15 +3652,15 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
         for(i = 0; i < synth->audio_channels; i++)
         {
 #ifdef WITH_FLOAT
-            FLUID_MEMCPY(left[i] + count, &left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT], bytes);
-            FLUID_MEMCPY(right[i] + count, &right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT], bytes);
+            FLUID_MEMCPY(left[i] + count, &left_in[i * buf_size], bytes);
+            FLUID_MEMCPY(right[i] + count, &right_in[i * buf_size], bytes);
 #else //WITH_FLOAT
             int j;
 
             for(j = 0; j < num; j++)
             {
-                left[i][j + count] = (float) left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j];
-                right[i][j + count] = (float) right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j];
+                left[i][j + count] = (float) left_in[i * buf_size + j];
+                right[i][j + count] = (float) right_in[i * buf_size + j];
             }
 
 #endif //WITH_FLOAT
@@ -3485,12 +3672,12 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
 
             if(fx_left != NULL)
             {
-                FLUID_MEMCPY(fx_left[i] + count, &fx_left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT], bytes);
+                FLUID_MEMCPY(fx_left[i] + count, &fx_left_in[i * buf_size], bytes);
             }
 
             if(fx_right != NULL)
             {
-                FLUID_MEMCPY(fx_right[i] + count, &fx_right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT], bytes);
+                FLUID_MEMCPY(fx_right[i] + count, &fx_right_in[i * buf_size], bytes);
             }
 
 #else //WITH_FLOAT
@@ -3500,7 +3687,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
             {
                 for(j = 0; j < num; j++)
                 {
-                    fx_left[i][j + count] = (float) fx_left_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j];
+                    fx_left[i][j + count] = (float) fx_left_in[i * buf_size + j];
                 }
             }
 
@@ -3508,7 +3695,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
             {
                 for(j = 0; j < num; j++)
                 {
-                    fx_right[i][j + count] = (float) fx_right_in[i * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j];
+                    fx_right[i][j + count] = (float) fx_right_in[i * buf_size + j];
                 }
             }
 
@@ -3521,8 +3708,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
     synth->cur = num;
 
     time = fluid_utime() - time;
-    cpu_load = 0.5 * (fluid_atomic_float_get(&synth->cpu_load) + time * synth->sample_rate / len / 10000.0);
-    fluid_atomic_float_set(&synth->cpu_load, cpu_load);
+    fluid_synth_update_cpu_load(synth, time, len);
 
     return FLUID_OK;
 }
@@ -3535,6 +3721,7 @@ fluid_synth_nwrite_float(fluid_synth_t *synth, int len,
  * @param in the rvoice_mixer input sample buffer to mix from
  * @param ioff sample offset in \p in
  * @param buf_idx the sample buffer index of \p in to mix from
+ * @param buf_size number of samples in each sample buffer of \p in
  * @param num number of samples to mix
  */
 static FLUID_INLINE void fluid_synth_mix_single_buffer(float *FLUID_RESTRICT out,
@@ -3542,6 +3729,7 @@ static FLUID_INLINE void fluid_synth_mix_single_buffer(float *FLUID_RESTRICT out
                                                        const fluid_real_t *FLUID_RESTRICT in,
                                                        int ioff,
                                                        int buf_idx,
+                                                       int buf_size,
                                                        int num)
 {
     if(out != NULL)
@@ -3550,7 +3738,7 @@ static FLUID_INLINE void fluid_synth_mix_single_buffer(float *FLUID_RESTRICT out
 
         for(j = 0; j < num; j++)
         {
-            out[j + ooff] += (float) in[buf_idx * FLUID_BUFSIZE * FLUID_MIXER_MAX_BUFFERS_DEFAULT + j + ioff];
+            out[j + ooff] += (float) in[buf_idx * buf_size + j + ioff];
         }
     }
 }
@@ -3644,12 +3832,11 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
     fluid_real_t *left_in, *fx_left_in;
     fluid_real_t *right_in, *fx_right_in;
     int nfxchan, nfxunits, naudchan;
+    const int buf_size = fluid_rvoice_mixer_get_bufcount(synth->eventhandler->mixer) * FLUID_BUFSIZE;
 
     double time = fluid_utime();
     int i, f, num, count;
 
-    float cpu_load;
-
     fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
     fluid_return_val_if_fail(nfx % 2 == 0, FLUID_FAILED);
     fluid_return_val_if_fail(nout % 2 == 0, FLUID_FAILED);
@@ -3680,10 +3867,10 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
             for(i = 0; i < naudchan; i++)
             {
                 float *out_buf = out[(i * 2) % nout];
-                fluid_synth_mix_single_buffer(out_buf, 0, left_in, synth->cur, i, num);
+                fluid_synth_mix_single_buffer(out_buf, 0, left_in, synth->cur, i, buf_size, num);
 
                 out_buf = out[(i * 2 + 1) % nout];
-                fluid_synth_mix_single_buffer(out_buf, 0, right_in, synth->cur, i, num);
+                fluid_synth_mix_single_buffer(out_buf, 0, right_in, synth->cur, i, buf_size, num);
             }
         }
 
@@ -3698,10 +3885,10 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
                     int buf_idx = f * nfxchan + i;
 
                     float *out_buf = fx[(buf_idx * 2) % nfx];
-                    fluid_synth_mix_single_buffer(out_buf, 0, fx_left_in, synth->cur, buf_idx, num);
+                    fluid_synth_mix_single_buffer(out_buf, 0, fx_left_in, synth->cur, buf_idx, buf_size, num);
 
                     out_buf = fx[(buf_idx * 2 + 1) % nfx];
-                    fluid_synth_mix_single_buffer(out_buf, 0, fx_right_in, synth->cur, buf_idx, num);
+                    fluid_synth_mix_single_buffer(out_buf, 0, fx_right_in, synth->cur, buf_idx, buf_size, num);
                 }
             }
         }
@@ -3723,10 +3910,10 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
             for(i = 0; i < naudchan; i++)
             {
                 float *out_buf = out[(i * 2) % nout];
-                fluid_synth_mix_single_buffer(out_buf, count, left_in, 0, i, num);
+                fluid_synth_mix_single_buffer(out_buf, count, left_in, 0, i, buf_size, num);
 
                 out_buf = out[(i * 2 + 1) % nout];
-                fluid_synth_mix_single_buffer(out_buf, count, right_in, 0, i, num);
+                fluid_synth_mix_single_buffer(out_buf, count, right_in, 0, i, buf_size, num);
             }
         }
 
@@ -3741,10 +3928,10 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
                     int buf_idx = f * nfxchan + i;
 
                     float *out_buf = fx[(buf_idx * 2) % nfx];
-                    fluid_synth_mix_single_buffer(out_buf, count, fx_left_in, 0, buf_idx, num);
+                    fluid_synth_mix_single_buffer(out_buf, count, fx_left_in, 0, buf_idx, buf_size, num);
 
                     out_buf = fx[(buf_idx * 2 + 1) % nfx];
-                    fluid_synth_mix_single_buffer(out_buf, count, fx_right_in, 0, buf_idx, num);
+                    fluid_synth_mix_single_buffer(out_buf, count, fx_right_in, 0, buf_idx, buf_size, num);
                 }
             }
         }
@@ -3755,8 +3942,7 @@ fluid_synth_process(fluid_synth_t *synth, int len, int nfx, float *fx[],
     synth->cur = num;
 
     time = fluid_utime() - time;
-    cpu_load = 0.5 * (fluid_atomic_float_get(&synth->cpu_load) + time * synth->sample_rate / len / 10000.0);
-    fluid_atomic_float_set(&synth->cpu_load, cpu_load);
+    fluid_synth_update_cpu_load(synth, time, len);
 
     return FLUID_OK;
 }
@@ -3790,7 +3976,6 @@ fluid_synth_write_float(fluid_synth_t *synth, int len,
     fluid_real_t *left_in;
     fluid_real_t *right_in;
     double time = fluid_utime();
-    float cpu_load;
 
     fluid_profile_ref_var(prof_ref);
 
@@ -3821,8 +4006,7 @@ fluid_synth_write_float(fluid_synth_t *synth, int len,
     synth->cur = l;
 
     time = fluid_utime() - time;
-    cpu_load = 0.5 * (fluid_atomic_float_get(&synth->cpu_load) + time * synth->sample_rate / len / 10000.0);
-    fluid_atomic_float_set(&synth->cpu_load, cpu_load);
+    fluid_synth_update_cpu_load(synth, time, len);
 
     fluid_profile_write(FLUID_PROF_WRITE, prof_ref,
                         fluid_rvoice_mixer_get_active_voices(synth->eventhandler->mixer),
@@ -3917,7 +4101,6 @@ fluid_synth_write_s16(fluid_synth_t *synth, int len,
     fluid_real_t *right_in;
     double time = fluid_utime();
     int di;
-    float cpu_load;
 
     fluid_profile_ref_var(prof_ref);
 
@@ -3952,8 +4135,7 @@ fluid_synth_write_s16(fluid_synth_t *synth, int len,
     synth->dither_index = di;	/* keep dither buffer continous */
 
     time = fluid_utime() - time;
-    cpu_load = 0.5 * (fluid_atomic_float_get(&synth->cpu_load) + time * synth->sample_rate / len / 10000.0);
-    fluid_atomic_float_set(&synth->cpu_load, cpu_load);
+    fluid_synth_update_cpu_load(synth, time, len);
 
     fluid_profile_write(FLUID_PROF_WRITE, prof_ref,
                         fluid_rvoice_mixer_get_active_voices(synth->eventhandler->mixer),
@@ -4005,6 +4187,21 @@ fluid_synth_dither_s16(int *dither_index, int len, const float *lin, const float
     fluid_profile(FLUID_PROF_WRITE, prof_ref, 0, len);
 }
 
+/* Add the decoding work of a finished voice to the synth's totals */
+static void
+fluid_synth_collect_decode_stats(fluid_synth_t *synth, fluid_sample_decoder_t *decoder)
+{
+    if(decoder->sample != NULL)
+    {
+        synth->decoded_voices++;
+        synth->decoded_blocks += decoder->decoded_blocks;
+        synth->decode_usec += decoder->decode_usec;
+    }
+
+    decoder->decoded_blocks = 0;
+    decoder->decode_usec = 0;
+}
+
 static void
 fluid_synth_check_finished_voices(fluid_synth_t *synth)
 {
@@ -4013,6 +4210,11 @@ fluid_synth_check_finished_voices(fluid_synth_t *synth)
 
     while(NULL != (fv = fluid_rvoice_eventhandler_get_finished_voice(synth->eventhandler)))
     {
+        if(fv->dsp.decoder != NULL)
+        {
+            fluid_synth_collect_decode_stats(synth, fv->dsp.decoder);
+        }
+
         for(j = 0; j < synth->polyphony; j++)
         {
             if(synth->voice[j]->rvoice == fv)
@@ -4199,6 +4401,16 @@ static void fluid_synth_handle_overflow(void *data, const char *name, double val
     {
         synth->overflow.important = value;
     }
+    else if(FLUID_STRCMP(name, "synth.overflow.cpu-load") == 0)
+    {
+        synth->cpu_load_target = value;
+
+        if(value <= 0)
+        {
+            /* the governor is off, lift its limit */
+            synth->governor_limit = 0;
+        }
+    }
 
     fluid_synth_api_exit(synth);
 }
@@ -4249,6 +4461,158 @@ fluid_synth_free_voice_by_kill_LOCAL(fluid_synth_t *synth)
     return voice;
 }
 
+/* Count the playing voices, except those faded out by the polyphony governor already */
+static int
+fluid_synth_count_governed_voices_LOCAL(fluid_synth_t *synth)
+{
+    int i, count = 0;
+
+    for(i = 0; i < synth->polyphony; i++)
+    {
+        if(fluid_voice_is_playing(synth->voice[i]) && !synth->voice[i]->fading)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* Fade out the count voices of lowest overflow priority, which aren't fading already */
+static void
+fluid_synth_fade_voices_by_prio_LOCAL(fluid_synth_t *synth, int count)
+{
+    int i;
+    float best_prio, this_voice_prio;
+    fluid_voice_t *voice, *best_voice;
+    unsigned int ticks = fluid_synth_get_ticks(synth);
+
+    for(; count > 0; count--)
+    {
+        best_prio = OVERFLOW_PRIO_CANNOT_KILL - 1;
+        best_voice = NULL;
+
+        for(i = 0; i < synth->polyphony; i++)
+        {
+            voice = synth->voice[i];
+
+            if(!fluid_voice_is_playing(voice) || voice->fading)
+            {
+                continue;
+            }
+
+            this_voice_prio = fluid_voice_get_overflow_prio(voice, &synth->overflow, ticks);
+
+            if(this_voice_prio < best_prio)
+            {
+                best_voice = voice;
+                best_prio = this_voice_prio;
+            }
+        }
+
+        if(best_voice == NULL)
+        {
+            return;
+        }
+
+        FLUID_LOG(FLUID_DBG, "Fading out voice %d, chan %d, key %d to lower the CPU load",
+                  fluid_voice_get_id(best_voice), fluid_voice_get_channel(best_voice),
+                  fluid_voice_get_key(best_voice));
+        fluid_voice_fade_out(best_voice);
+        synth->governor_stolen++;
+    }
+}
+
+/* Make room for a new voice below the voice limit of the polyphony governor */
+static void
+fluid_synth_govern_noteon_LOCAL(fluid_synth_t *synth)
+{
+    int count = fluid_synth_count_governed_voices_LOCAL(synth);
+
+    if(count >= synth->governor_limit)
+    {
+        fluid_synth_fade_voices_by_prio_LOCAL(synth, count - synth->governor_limit + 1);
+    }
+}
+
+/*
+ * The polyphony governor: called by the rendering thread with the CPU load of the
+ * audio just rendered. If it exceeds synth.overflow.cpu-load, the voice limit is
+ * lowered in proportion and the voices above it are faded out. Once the load has
+ * receded, the limit is raised again step by step.
+ *
+ * The rendering thread must not wait for the API lock, so this period is skipped
+ * if another thread holds it. The voices are faded out through the rvoice event
+ * queue, like any other voice change made by the API.
+ */
+void
+fluid_synth_govern_polyphony(fluid_synth_t *synth, float cpu_load)
+{
+    int count, limit, new_limit;
+
+    if(!fluid_synth_api_tryenter(synth))
+    {
+        return;
+    }
+
+    if(synth->cpu_load_target <= 0)
+    {
+        fluid_synth_api_exit(synth);
+        return;
+    }
+
+    limit = synth->governor_limit ? synth->governor_limit : synth->polyphony_limit;
+
+    if(cpu_load > synth->cpu_load_target)
+    {
+        /* voices still fading out were part of the load, so count them as well */
+        count = synth->active_voice_count;
+        new_limit = (int)(count * synth->cpu_load_target / cpu_load);
+
+        if(new_limit < GOVERNOR_MIN_VOICES)
+        {
+            new_limit = GOVERNOR_MIN_VOICES;
+        }
+
+        if(new_limit < limit)
+        {
+            FLUID_LOG(FLUID_DBG, "CPU load %.1f%%, lowering the voice limit to %d", cpu_load, new_limit);
+            synth->governor_limit = limit = new_limit;
+            synth->governor_lowered++;
+        }
+
+        count = fluid_synth_count_governed_voices_LOCAL(synth);
+
+        if(count > limit)
+        {
+            fluid_synth_fade_voices_by_prio_LOCAL(synth, count - limit);
+        }
+    }
+    else if(synth->governor_limit && cpu_load < synth->cpu_load_target * GOVERNOR_RAISE_LOAD)
+    {
+        limit += limit / 8 + 1;
+        synth->governor_limit = (limit < synth->polyphony_limit) ? limit : 0;
+        synth->governor_raised++;
+    }
+
+    fluid_synth_api_exit(synth);
+}
+
+/* Update the CPU load with the time it took to render len audio frames */
+static void
+fluid_synth_update_cpu_load(fluid_synth_t *synth, double time, int len)
+{
+    float load = time * synth->sample_rate / len / 10000.0;
+
+    fluid_atomic_float_set(&synth->cpu_load, 0.5 * (fluid_atomic_float_get(&synth->cpu_load) + load));
+
+    /* the governor reacts to the load of this very period rather than the average */
+    if(synth->cpu_load_target > 0)
+    {
+        fluid_synth_govern_polyphony(synth, load);
+    }
+}
+
 
 /**
  * Allocate a synthesis voice.
@@ -4284,6 +4648,12 @@ fluid_synth_alloc_voice_LOCAL(fluid_synth_t *synth, fluid_sample_t *sample, int
     fluid_channel_t *channel = NULL;
     unsigned int ticks;
 
+    /* the polyphony governor may hold the number of voices below the polyphony */
+    if(synth->governor_limit > 0)
+    {
+        fluid_synth_govern_noteon_LOCAL(synth);
+    }
+
     /* check if there's an available synthesis process */
     for(i = 0; i < synth->polyphony; i++)
     {
@@ -4294,6 +4664,24 @@ fluid_synth_alloc_voice_LOCAL(fluid_synth_t *synth, fluid_sample_t *sample, int
         }
     }
 
+    /* A lightweight synth rather grows its voice pool, doubling it each time */
+    if(voice == NULL && synth->polyphony < synth->polyphony_limit)
+    {
+        int new_polyphony = 2 * synth->polyphony;
+
+        if(new_polyphony > synth->polyphony_limit)
+        {
+            new_polyphony = synth->polyphony_limit;
+        }
+
+        i = synth->polyphony;
+
+        if(fluid_synth_resize_voice_pool_LOCAL(synth, new_polyphony) == FLUID_OK)
+        {
+            voice = synth->voice[i];
+        }
+    }
+
     /* No success yet? Then stop a running voice. */
     if(voice == NULL)
     {
@@ -4433,12 +4821,35 @@ fluid_synth_start_voice(fluid_synth_t *synth, fluid_voice_t *voice)
      * voice process created by this noteon event. */
     fluid_synth_kill_by_exclusive_class_LOCAL(synth, voice);
 
+    if(!synth->fx_allocated)
+    {
+        fluid_synth_alloc_fx_LOCAL(synth);
+    }
+
     fluid_voice_start(voice);     /* Start the new voice */
     fluid_voice_lock_rvoice(voice);
     fluid_rvoice_eventhandler_add_rvoice(synth->eventhandler, voice->rvoice);
     fluid_synth_api_exit(synth);
 }
 
+/* Have the mixer of a lightweight synth create its effects units, before the
+ * first voice gets added to it */
+static void
+fluid_synth_alloc_fx_LOCAL(fluid_synth_t *synth)
+{
+    fluid_synth_update_mixer(synth, fluid_rvoice_mixer_alloc_fx, 0, 0.0f);
+
+    /* the units have been created with default parameters */
+    fluid_synth_set_reverb_full_LOCAL(synth, FLUID_REVMODEL_SET_ALL, synth->reverb_roomsize,
+                                      synth->reverb_damping, synth->reverb_width,
+                                      synth->reverb_level);
+    fluid_synth_set_chorus_full_LOCAL(synth, FLUID_CHORUS_SET_ALL, synth->chorus_nr,
+                                      synth->chorus_level, synth->chorus_speed,
+                                      synth->chorus_depth, synth->chorus_type);
+
+    synth->fx_allocated = TRUE;
+}
+
 /**
  * Add a SoundFont loader to the synth. This function takes ownership of \c loader
  * and frees it automatically upon \c synth destruction.
@@ -4510,6 +4921,7 @@ fluid_synth_sfload(fluid_synth_t *synth, const char *filename, int reset_presets
                 synth->sfont_id = sfont->id = sfont_id;
 
                 synth->sfont = fluid_list_prepend(synth->sfont, sfont);   /* prepend to list */
+                fluid_synth_enable_sample_decoding_LOCAL(synth, sfont);
 
                 /* reset the presets for all channels if requested */
                 if(reset_presets)
@@ -4527,60 +4939,595 @@ fluid_synth_sfload(fluid_synth_t *synth, const char *filename, int reset_presets
 }
 
 /**
- * Unload a SoundFont.
+ * Load a SoundFont that has already been loaded by another synth instance, by reference.
+ *
+ * The SoundFont added to \c synth shares the presets, instruments and sample data with
+ * \c sfont, so hosting many synths using the same SoundFont only costs its parse time and
+ * memory once. The shared data is immutable and freed once the last synth using it
+ * unloaded the SoundFont, no matter which synth originally loaded it. Bank offsets are
+ * not shared, see fluid_synth_set_bank_offset().
+ *
+ * Only SoundFonts loaded by the default SoundFont loader with
+ * <a href="fluidsettings.xml#synth.dynamic-sample-loading">synth.dynamic-sample-loading</a>
+ * disabled can be shared. The sample storage of the SoundFont is kept, a synth sharing
+ * a SoundFont with compressed sample data sets up its voices for decoding it, whatever
+ * its own <a href="fluidsettings.xml#synth.sample-storage">synth.sample-storage</a> is.
+ *
  * @param synth FluidSynth instance
- * @param id ID of SoundFont to unload
- * @param reset_presets TRUE to re-assign presets for all MIDI channels
- * @return #FLUID_OK on success, #FLUID_FAILED on error
+ * @param sfont SoundFont loaded by another synth, see fluid_synth_get_sfont_by_id()
+ * @param reset_presets TRUE to re-assign presets for all MIDI channels (equivalent to calling fluid_synth_program_reset())
+ * @return SoundFont ID on success, #FLUID_FAILED on error
+ * @since 2.1.0
  */
 int
-fluid_synth_sfunload(fluid_synth_t *synth, int id, int reset_presets)
+fluid_synth_sfload_shared(fluid_synth_t *synth, fluid_sfont_t *sfont, int reset_presets)
 {
-    fluid_sfont_t *sfont = NULL;
-    fluid_list_t *list;
+    fluid_sfont_t *shared;
+    int sfont_id;
 
     fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(sfont != NULL, FLUID_FAILED);
     fluid_synth_api_enter(synth);
 
-    /* remove the SoundFont from the list */
-    for(list = synth->sfont; list; list = fluid_list_next(list))
-    {
-        sfont = fluid_list_get(list);
+    sfont_id = synth->sfont_id;
 
-        if(fluid_sfont_get_id(sfont) == id)
-        {
-            synth->sfont = fluid_list_remove(synth->sfont, sfont);
-            break;
-        }
+    if(++sfont_id == FLUID_FAILED)
+    {
+        FLUID_API_RETURN(FLUID_FAILED);
     }
 
-    if(!list)
+    shared = fluid_defsfont_share(sfont);
+
+    if(shared == NULL)
     {
-        FLUID_LOG(FLUID_ERR, "No SoundFont with id = %d", id);
         FLUID_API_RETURN(FLUID_FAILED);
     }
 
-    /* reset the presets for all channels (SoundFont will be freed when there are no more references) */
+    shared->refcount++;
+    synth->sfont_id = shared->id = sfont_id;
+
+    synth->sfont = fluid_list_prepend(synth->sfont, shared);   /* prepend to list */
+
+    /* the SoundFont may keep its samples compressed, even if this synth doesn't */
+    fluid_synth_enable_sample_decoding_LOCAL(synth, shared);
+
     if(reset_presets)
     {
         fluid_synth_program_reset(synth);
     }
-    else
-    {
-        fluid_synth_update_presets(synth);
-    }
-
-    /* -- Remove synth->sfont list's reference to SoundFont */
-    fluid_synth_sfont_unref(synth, sfont);
 
-    FLUID_API_RETURN(FLUID_OK);
+    FLUID_API_RETURN(sfont_id);
 }
 
-/* Unref a SoundFont and destroy if no more references */
-void
-fluid_synth_sfont_unref(fluid_synth_t *synth, fluid_sfont_t *sfont)
+/**
+ * Load a SoundFont file in the background.
+ *
+ * Parsing the file and loading its sample data is done on a separate thread, this
+ * function returns immediately. Once loaded, the SoundFont is put on top of the
+ * SoundFont stack, just like fluid_synth_sfload() would do. The synth API is only
+ * locked for this final step, so the synth can be used as usual while loading.
+ *
+ * The result of the load must be collected with fluid_synth_sfload_wait(), which
+ * also releases the resources of the loader thread. Loads that were never waited
+ * for are cancelled and cleaned up when the synth is deleted.
+ *
+ * @param synth FluidSynth instance
+ * @param filename File to load
+ * @param reset_presets TRUE to re-assign presets for all MIDI channels once loaded
+ * @param progress Optional callback to report the loading progress to, may be NULL
+ * @param data User data pointer passed to \c progress
+ * @return The SoundFont ID the SoundFont will have once loaded, #FLUID_FAILED on error
+ *
+ * @note Requires <a href="fluidsettings.xml#synth.threadsafe-api">synth.threadsafe-api</a> to be enabled.
+ * @since 2.1.0
+ */
+int
+fluid_synth_sfload_async(fluid_synth_t *synth, const char *filename, int reset_presets,
+                         fluid_synth_sfload_progress_t progress, void *data)
 {
-    fluid_return_if_fail(sfont != NULL);     /* Shouldn't happen, programming error if so */
+    fluid_sfload_job_t *job;
+    int sfont_id;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(filename != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    if(!synth->use_mutex)
+    {
+        FLUID_LOG(FLUID_ERR, "Asynchronous SoundFont loading requires synth.threadsafe-api");
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    sfont_id = synth->sfont_id;
+
+    if(++sfont_id == FLUID_FAILED)
+    {
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    job = FLUID_NEW(fluid_sfload_job_t);
+
+    if(job == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    FLUID_MEMSET(job, 0, sizeof(*job));
+
+    job->filename = FLUID_STRDUP(filename);
+
+    if(job->filename == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        FLUID_FREE(job);
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    job->synth = synth;
+    job->reset_presets = reset_presets;
+    job->id = sfont_id;
+    job->progress = progress;
+    job->data = data;
+    job->hook.func = fluid_synth_sfload_progress;
+    job->hook.data = job;
+    job->result = FLUID_FAILED;
+
+    job->thread = new_fluid_thread("sfload", fluid_synth_sfload_thread, job, 0, FALSE);
+
+    if(job->thread == NULL)
+    {
+        FLUID_FREE(job->filename);
+        FLUID_FREE(job);
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    /* the ID is used up, even if the load fails later on */
+    synth->sfont_id = sfont_id;
+    synth->sfload_jobs = fluid_list_prepend(synth->sfload_jobs, job);
+
+    FLUID_API_RETURN(sfont_id);
+}
+
+/**
+ * Request cancellation of a SoundFont load started by fluid_synth_sfload_async().
+ *
+ * The load stops as soon as possible, the SoundFont will not be added to the synth.
+ * Use fluid_synth_sfload_wait() to wait for the loader thread to finish.
+ *
+ * @param synth FluidSynth instance
+ * @param id SoundFont ID returned by fluid_synth_sfload_async()
+ * @return #FLUID_OK if cancellation was requested, #FLUID_FAILED if there is no such load
+ * or the SoundFont has already been added to the synth
+ * @since 2.1.0
+ */
+int
+fluid_synth_sfload_cancel(fluid_synth_t *synth, int id)
+{
+    fluid_list_t *list;
+    fluid_sfload_job_t *job;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    for(list = synth->sfload_jobs; list; list = fluid_list_next(list))
+    {
+        job = fluid_list_get(list);
+
+        if(job->id == id)
+        {
+            /* too late if the SoundFont has already been added */
+            if(job->result != FLUID_FAILED)
+            {
+                break;
+            }
+
+            fluid_atomic_int_set(&job->cancel, TRUE);
+            FLUID_API_RETURN(FLUID_OK);
+        }
+    }
+
+    FLUID_API_RETURN(FLUID_FAILED);
+}
+
+/**
+ * Wait for a SoundFont load started by fluid_synth_sfload_async() to finish.
+ *
+ * @param synth FluidSynth instance
+ * @param id SoundFont ID returned by fluid_synth_sfload_async()
+ * @return \c id if the SoundFont was loaded and added to the synth, #FLUID_FAILED if
+ * loading failed, was cancelled or there is no such load
+ *
+ * @note Must not be called from within the progress callback.
+ * @since 2.1.0
+ */
+int
+fluid_synth_sfload_wait(fluid_synth_t *synth, int id)
+{
+    fluid_list_t *list;
+    fluid_sfload_job_t *job = NULL;
+    int result;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    for(list = synth->sfload_jobs; list; list = fluid_list_next(list))
+    {
+        job = fluid_list_get(list);
+
+        if(job->id == id)
+        {
+            synth->sfload_jobs = fluid_list_remove(synth->sfload_jobs, job);
+            break;
+        }
+    }
+
+    fluid_synth_api_exit(synth);
+
+    if(list == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "No asynchronous SoundFont load with id = %d", id);
+        return FLUID_FAILED;
+    }
+
+    /* The loader thread needs the API lock to publish the SoundFont, so don't hold it here */
+    fluid_thread_join(job->thread);
+    delete_fluid_thread(job->thread);
+
+    result = job->result;
+    FLUID_FREE(job->filename);
+    FLUID_FREE(job);
+
+    return result;
+}
+
+/* Progress hook of the loader thread, forwards to the user callback */
+static int
+fluid_synth_sfload_progress(void *data, fluid_long_long_t done, fluid_long_long_t total)
+{
+    fluid_sfload_job_t *job = data;
+
+    if(fluid_atomic_int_get(&job->cancel))
+    {
+        return FLUID_FAILED;
+    }
+
+    if(job->progress != NULL && job->progress(job->data, job->id, done, total) == FLUID_FAILED)
+    {
+        fluid_atomic_int_set(&job->cancel, TRUE);
+        return FLUID_FAILED;
+    }
+
+    return FLUID_OK;
+}
+
+/* Loader thread of fluid_synth_sfload_async() */
+static fluid_thread_return_t
+fluid_synth_sfload_thread(void *data)
+{
+    fluid_sfload_job_t *job = data;
+    fluid_synth_t *synth = job->synth;
+    fluid_sfont_t *sfont = NULL;
+    fluid_list_t *list;
+
+    fluid_sfloader_set_progress(&job->hook);
+
+    /* MT NOTE: Loaders list should not change. */
+    for(list = synth->loaders; list && !fluid_atomic_int_get(&job->cancel); list = fluid_list_next(list))
+    {
+        sfont = fluid_sfloader_load((fluid_sfloader_t *) fluid_list_get(list), job->filename);
+
+        if(sfont != NULL)
+        {
+            break;
+        }
+    }
+
+    fluid_sfloader_set_progress(NULL);
+
+    if(sfont != NULL)
+    {
+        /* Publish the SoundFont. Checking for cancellation with the API lock held makes
+         * sure a load cancelled by fluid_synth_sfload_cancel() is never added. */
+        fluid_synth_api_enter(synth);
+
+        if(!fluid_atomic_int_get(&job->cancel))
+        {
+            sfont->refcount++;
+            sfont->id = job->id;
+            synth->sfont = fluid_list_prepend(synth->sfont, sfont);
+            fluid_synth_enable_sample_decoding_LOCAL(synth, sfont);
+
+            if(job->reset_presets)
+            {
+                fluid_synth_program_reset(synth);
+            }
+
+            job->result = job->id;
+        }
+
+        fluid_synth_api_exit(synth);
+
+        if(job->result == FLUID_FAILED)
+        {
+            fluid_sfont_delete_internal(sfont);
+        }
+    }
+
+    if(job->result != FLUID_FAILED)
+    {
+        FLUID_LOG(FLUID_DBG, "Loaded SoundFont \"%s\" with id = %d", job->filename, job->id);
+    }
+    else if(fluid_atomic_int_get(&job->cancel))
+    {
+        FLUID_LOG(FLUID_INFO, "Loading SoundFont \"%s\" was cancelled", job->filename);
+    }
+    else
+    {
+        FLUID_LOG(FLUID_ERR, "Failed to load SoundFont \"%s\"", job->filename);
+    }
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
+
+/*
+ * Sample prefetching.
+ *
+ * The MIDI player and the sequencer look ahead synth.prefetch-window msec
+ * for program changes and request the presets they are about to select.
+ * The prefetch thread then sends FLUID_PRESET_PRELOAD to the SoundFont
+ * loader, so that samples are loaded before the program change reaches the
+ * synthesis thread. Each queued preset holds a reference to its SoundFont.
+ */
+
+/* Bank that a program change on the channel would use, after bank select
+ * messages with the given MSB and LSB (-1 if not sent). */
+static int
+fluid_synth_get_prefetch_bank(fluid_synth_t *synth, fluid_channel_t *channel,
+                              int bank_msb, int bank_lsb)
+{
+    int banknum;
+    int drum = (channel->channel_type == CHANNEL_TYPE_DRUM);
+
+    fluid_channel_get_sfont_bank_prog(channel, NULL, &banknum, NULL);
+
+    switch(synth->bank_select)
+    {
+    case FLUID_BANK_STYLE_GS:
+        if(bank_msb >= 0)
+        {
+            banknum = bank_msb;
+        }
+
+        break;
+
+    case FLUID_BANK_STYLE_XG:
+        if(bank_msb >= 0)
+        {
+            drum = (120 <= bank_msb);
+        }
+
+        if(bank_lsb >= 0)
+        {
+            banknum = bank_lsb;
+        }
+
+        break;
+
+    case FLUID_BANK_STYLE_MMA:
+        if(bank_msb >= 0)
+        {
+            banknum = (banknum & 0x7F) | (bank_msb << 7);
+        }
+
+        if(bank_lsb >= 0)
+        {
+            banknum = (banknum & ~0x7F) | bank_lsb;
+        }
+
+        break;
+
+    default:
+        break;
+    }
+
+    return drum ? DRUM_INST_BANK : banknum;
+}
+
+/**
+ * Request the samples of the preset that a program change on a MIDI channel
+ * would select to be loaded in the background.
+ * @param synth FluidSynth instance
+ * @param chan MIDI channel number
+ * @param bank_msb Bank select MSB sent before the program change or -1
+ * @param bank_lsb Bank select LSB sent before the program change or -1
+ * @param prognum MIDI program number
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ */
+int
+fluid_synth_prefetch_program(fluid_synth_t *synth, int chan, int bank_msb, int bank_lsb, int prognum)
+{
+    fluid_preset_t *preset;
+    int result = FLUID_FAILED;
+
+    fluid_return_val_if_fail(prognum >= 0 && prognum < 128, FLUID_FAILED);
+    FLUID_API_ENTRY_CHAN(FLUID_FAILED);
+
+    if(synth->prefetch_window > 0)
+    {
+        int banknum = fluid_synth_get_prefetch_bank(synth, synth->channel[chan], bank_msb, bank_lsb);
+
+        preset = fluid_synth_find_preset(synth, banknum, prognum);
+        result = fluid_synth_queue_prefetch(synth, preset);
+    }
+
+    FLUID_API_RETURN(result);
+}
+
+/**
+ * Request the samples of a preset to be loaded in the background.
+ * @param synth FluidSynth instance
+ * @param sfont_id ID of a loaded SoundFont
+ * @param bank_num MIDI bank number
+ * @param preset_num MIDI program number
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ */
+int
+fluid_synth_prefetch_preset(fluid_synth_t *synth, int sfont_id, int bank_num, int preset_num)
+{
+    int result = FLUID_FAILED;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    if(synth->prefetch_window > 0)
+    {
+        result = fluid_synth_queue_prefetch(synth, fluid_synth_get_preset(synth, sfont_id, bank_num, preset_num));
+    }
+
+    FLUID_API_RETURN(result);
+}
+
+/* Hand a preset to the prefetch thread, called with the API lock held */
+static int
+fluid_synth_queue_prefetch(fluid_synth_t *synth, fluid_preset_t *preset)
+{
+    fluid_list_t *list;
+    int chan;
+
+    if(preset == NULL)
+    {
+        return FLUID_FAILED;
+    }
+
+    /* only loaders which care about preset selection can make use of it */
+    if(preset->notify == NULL)
+    {
+        return FLUID_OK;
+    }
+
+    /* nothing to do if the preset is already in use */
+    for(chan = 0; chan < synth->midi_channels; chan++)
+    {
+        if(synth->channel[chan]->preset == preset)
+        {
+            return FLUID_OK;
+        }
+    }
+
+    fluid_cond_mutex_lock(synth->prefetch_mutex);
+
+    for(list = synth->prefetch_queue; list; list = fluid_list_next(list))
+    {
+        if(fluid_list_get(list) == preset)
+        {
+            break;
+        }
+    }
+
+    if(list == NULL)
+    {
+        preset->sfont->refcount++;
+        synth->prefetch_queue = fluid_list_append(synth->prefetch_queue, preset);
+        fluid_cond_signal(synth->prefetch_cond);
+    }
+
+    fluid_cond_mutex_unlock(synth->prefetch_mutex);
+
+    return FLUID_OK;
+}
+
+/* Prefetch thread, preloads queued presets without holding the API lock */
+static fluid_thread_return_t
+fluid_synth_prefetch_thread(void *data)
+{
+    fluid_synth_t *synth = data;
+    fluid_preset_t *preset;
+
+    fluid_cond_mutex_lock(synth->prefetch_mutex);
+
+    while(!synth->prefetch_quit)
+    {
+        if(synth->prefetch_queue == NULL)
+        {
+            fluid_cond_wait(synth->prefetch_cond, synth->prefetch_mutex);
+            continue;
+        }
+
+        preset = fluid_list_get(synth->prefetch_queue);
+        synth->prefetch_queue = fluid_list_remove(synth->prefetch_queue, preset);
+        fluid_cond_mutex_unlock(synth->prefetch_mutex);
+
+        FLUID_LOG(FLUID_DBG, "Prefetching preset '%s'", fluid_preset_get_name(preset));
+        fluid_preset_notify(preset, FLUID_PRESET_PRELOAD, -1);
+
+        fluid_synth_api_enter(synth);
+        fluid_synth_sfont_unref(synth, preset->sfont);
+        fluid_synth_api_exit(synth);
+
+        fluid_cond_mutex_lock(synth->prefetch_mutex);
+    }
+
+    fluid_cond_mutex_unlock(synth->prefetch_mutex);
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
+
+/**
+ * Unload a SoundFont.
+ * @param synth FluidSynth instance
+ * @param id ID of SoundFont to unload
+ * @param reset_presets TRUE to re-assign presets for all MIDI channels
+ * @return #FLUID_OK on success, #FLUID_FAILED on error
+ */
+int
+fluid_synth_sfunload(fluid_synth_t *synth, int id, int reset_presets)
+{
+    fluid_sfont_t *sfont = NULL;
+    fluid_list_t *list;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    /* remove the SoundFont from the list */
+    for(list = synth->sfont; list; list = fluid_list_next(list))
+    {
+        sfont = fluid_list_get(list);
+
+        if(fluid_sfont_get_id(sfont) == id)
+        {
+            synth->sfont = fluid_list_remove(synth->sfont, sfont);
+            break;
+        }
+    }
+
+    if(!list)
+    {
+        FLUID_LOG(FLUID_ERR, "No SoundFont with id = %d", id);
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    /* reset the presets for all channels (SoundFont will be freed when there are no more references) */
+    if(reset_presets)
+    {
+        fluid_synth_program_reset(synth);
+    }
+    else
+    {
+        fluid_synth_update_presets(synth);
+    }
+
+    /* -- Remove synth->sfont list's reference to SoundFont */
+    fluid_synth_sfont_unref(synth, sfont);
+
+    FLUID_API_RETURN(FLUID_OK);
+}
+
+/* Unref a SoundFont and destroy if no more references */
+void
+fluid_synth_sfont_unref(fluid_synth_t *synth, fluid_sfont_t *sfont)
+{
+    fluid_return_if_fail(sfont != NULL);     /* Shouldn't happen, programming error if so */
 
     sfont->refcount--;             /* -- Remove the sfont list's reference */
 
@@ -4708,6 +5655,7 @@ fluid_synth_add_sfont(fluid_synth_t *synth, fluid_sfont_t *sfont)
     {
         synth->sfont_id = sfont->id = sfont_id;
         synth->sfont = fluid_list_prepend(synth->sfont, sfont);        /* prepend to list */
+        fluid_synth_enable_sample_decoding_LOCAL(synth, sfont);
 
         /* reset the presets for all channels */
         fluid_synth_program_reset(synth);
@@ -4865,6 +5813,46 @@ fluid_synth_get_sfont_by_name(fluid_synth_t *synth, const char *name)
     FLUID_API_RETURN(list ? sfont : NULL);
 }
 
+/**
+ * Hint that a preset is about to be selected.
+ * @param synth FluidSynth instance
+ * @param sfont_id ID of a loaded SoundFont
+ * @param bank_num MIDI bank number
+ * @param preset_num MIDI program number
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ * @since 2.1.0
+ *
+ * The SoundFont loader is notified with #FLUID_PRESET_PRELOAD. With
+ * synth.dynamic-sample-loading enabled, the samples of the preset are loaded
+ * now, so that a later program change does not have to read them from disk.
+ * They are kept in memory like those of an unselected preset, see
+ * synth.dynamic-sample-retention.
+ */
+int
+fluid_synth_preload_preset(fluid_synth_t *synth, int sfont_id, int bank_num, int preset_num)
+{
+    fluid_preset_t *preset;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_return_val_if_fail(bank_num >= 0, FLUID_FAILED);
+    fluid_return_val_if_fail(preset_num >= 0, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    preset = fluid_synth_get_preset(synth, sfont_id, bank_num, preset_num);
+
+    if(preset == NULL)
+    {
+        FLUID_LOG(FLUID_ERR,
+                  "There is no preset with bank number %d and preset number %d in SoundFont %d",
+                  bank_num, preset_num, sfont_id);
+        FLUID_API_RETURN(FLUID_FAILED);
+    }
+
+    fluid_preset_notify(preset, FLUID_PRESET_PRELOAD, -1);
+
+    FLUID_API_RETURN(FLUID_OK);
+}
+
 /**
  * Get active preset on a MIDI channel.
  * @param synth FluidSynth instance
@@ -5573,6 +6561,93 @@ fluid_synth_get_cpu_load(fluid_synth_t *synth)
     return fluid_atomic_float_get(&synth->cpu_load);
 }
 
+/**
+ * Get the cost of decoding compressed sample data per voice.
+ * @param synth FluidSynth instance
+ * @param voices Location to store the number of finished voices that played
+ *   compressed samples (can be NULL)
+ * @param blocks_per_voice Location to store the average number of sample blocks
+ *   decoded by each of these voices (can be NULL)
+ * @param usec_per_voice Location to store the average time in microseconds each of
+ *   these voices spent decoding (can be NULL)
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ * @since 2.1.0
+ *
+ * Only voices of synths with <a href="fluidsettings.xml#synth.sample-storage">synth.sample-storage</a>
+ * set to "compressed" decode sample data. Voices are accounted for once they
+ * finished playing. See fluid_get_sample_compression_stats() for the memory saved.
+ */
+int
+fluid_synth_get_sample_decode_stats(fluid_synth_t *synth, unsigned int *voices,
+                                    double *blocks_per_voice, double *usec_per_voice)
+{
+    unsigned int count;
+
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    count = synth->decoded_voices;
+
+    if(voices != NULL)
+    {
+        *voices = count;
+    }
+
+    if(blocks_per_voice != NULL)
+    {
+        *blocks_per_voice = count ? (double)synth->decoded_blocks / count : 0.0;
+    }
+
+    if(usec_per_voice != NULL)
+    {
+        *usec_per_voice = count ? synth->decode_usec / count : 0.0;
+    }
+
+    FLUID_API_RETURN(FLUID_OK);
+}
+
+/**
+ * Get what the polyphony governor has done to keep the CPU load below
+ * <a href="fluidsettings.xml#synth.overflow.cpu-load">synth.overflow.cpu-load</a>.
+ * @param synth FluidSynth instance
+ * @param voice_limit Location to store the current voice limit, which equals the
+ *   polyphony unless the governor is limiting voices (can be NULL)
+ * @param lowered Location to store how often the voice limit has been lowered (can be NULL)
+ * @param raised Location to store how often it has been raised again (can be NULL)
+ * @param stolen Location to store the number of voices faded out (can be NULL)
+ * @return #FLUID_OK on success, #FLUID_FAILED otherwise
+ * @since 2.1.0
+ */
+int
+fluid_synth_get_polyphony_governor_stats(fluid_synth_t *synth, int *voice_limit,
+        unsigned int *lowered, unsigned int *raised, unsigned int *stolen)
+{
+    fluid_return_val_if_fail(synth != NULL, FLUID_FAILED);
+    fluid_synth_api_enter(synth);
+
+    if(voice_limit != NULL)
+    {
+        *voice_limit = synth->governor_limit ? synth->governor_limit : synth->polyphony_limit;
+    }
+
+    if(lowered != NULL)
+    {
+        *lowered = synth->governor_lowered;
+    }
+
+    if(raised != NULL)
+    {
+        *raised = synth->governor_raised;
+    }
+
+    if(stolen != NULL)
+    {
+        *stolen = synth->governor_stolen;
+    }
+
+    FLUID_API_RETURN(FLUID_OK);
+}
+
 /* Get tuning for a given bank:program */
 static fluid_tuning_t *
 fluid_synth_get_tuning(fluid_synth_t *synth, int bank, int prog)
@@ -6408,6 +7483,24 @@ fluid_synth_api_enter(fluid_synth_t *synth)
     synth->public_api_count++;
 }
 
+/* Like fluid_synth_api_enter(), but returns FALSE instead of waiting if another thread holds the lock */
+static int
+fluid_synth_api_tryenter(fluid_synth_t *synth)
+{
+    if(synth->use_mutex && !fluid_rec_mutex_trylock(synth->mutex))
+    {
+        return FALSE;
+    }
+
+    if(!synth->public_api_count)
+    {
+        fluid_synth_check_finished_voices(synth);
+    }
+
+    synth->public_api_count++;
+    return TRUE;
+}
+
 void fluid_synth_api_exit(fluid_synth_t *synth)
 {
     synth->public_api_count--;
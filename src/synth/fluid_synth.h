@@ -57,6 +57,11 @@
 #define FLUID_CHORUS_DEFAULT_DEPTH 8.0f                         /**< Default chorus depth */
 #define FLUID_CHORUS_DEFAULT_TYPE FLUID_CHORUS_MOD_SINE         /**< Default chorus waveform type */
 
+#define FLUID_LIGHTWEIGHT_POLYPHONY 16  /**< Initial size of the voice pool of a lightweight synth */
+
+#define GOVERNOR_MIN_VOICES 8           /**< The polyphony governor never lowers its voice limit below this */
+#define GOVERNOR_RAISE_LOAD 0.75f       /**< Fraction of synth.overflow.cpu-load below which the voice limit is raised again */
+
 /***************************************************************
  *
  *                         ENUM
@@ -107,7 +112,10 @@ struct _fluid_synth_t
 
     fluid_settings_t *settings;        /**< the synthesizer settings */
     int device_id;                     /**< Device ID used for SYSEX messages */
-    int polyphony;                     /**< Maximum polyphony */
+    int polyphony;                     /**< Maximum polyphony, i.e. the size of the voice pool */
+    int polyphony_limit;               /**< Configured polyphony, a lightweight synth grows its voice pool up to it */
+    int lightweight;                   /**< Allocate voices and effects units on demand (synth.lightweight) */
+    int fx_allocated;                  /**< The effects units of the mixer have been requested */
     int with_reverb;                   /**< Should the synth use the built-in reverb unit? */
     int with_chorus;                   /**< Should the synth use the built-in chorus unit? */
     int verbose;                       /**< Turn verbose mode on? */
@@ -123,10 +131,28 @@ struct _fluid_synth_t
     fluid_atomic_uint_t ticks_since_start;    /**< the number of audio samples since the start */
     unsigned int start;                /**< the start in msec, as returned by system clock */
     fluid_overflow_prio_t overflow;    /**< parameters for overflow priority (aka voice-stealing) */
+    float cpu_load_target;             /**< CPU load in percent the polyphony governor aims for, 0 if disabled */
+    int governor_limit;                /**< Voice limit set by the polyphony governor, 0 while it doesn't limit */
+    unsigned int governor_lowered;     /**< Times the polyphony governor lowered its voice limit */
+    unsigned int governor_raised;      /**< Times it raised its voice limit again */
+    unsigned int governor_stolen;      /**< Voices faded out by the polyphony governor */
 
     fluid_list_t *loaders;             /**< the SoundFont loaders */
     fluid_list_t *sfont;          /**< List of fluid_sfont_info_t for each loaded SoundFont (remains until SoundFont is unloaded) */
     int sfont_id;             /**< Incrementing ID assigned to each loaded SoundFont */
+    fluid_list_t *sfload_jobs;         /**< Running or unjoined asynchronous SoundFont loads */
+
+    int prefetch_window;               /**< Lookahead in msec for sample prefetching, 0 if disabled */
+    fluid_thread_t *prefetch_thread;   /**< Thread preloading the presets in prefetch_queue */
+    fluid_cond_mutex_t *prefetch_mutex; /**< Protects prefetch_queue and prefetch_quit */
+    fluid_cond_t *prefetch_cond;
+    fluid_list_t *prefetch_queue;      /**< Presets to preload, each holding a reference to its SoundFont */
+    int prefetch_quit;
+
+    int sample_decoding;               /**< Voices can play compressed samples (synth.sample-storage, or a compressed SoundFont was added) */
+    unsigned int decoded_voices;       /**< Count of finished voices that played compressed samples */
+    unsigned int decoded_blocks;       /**< Sample blocks decoded by these voices */
+    double decode_usec;                /**< Time spent by these voices decoding sample data */
 
     float gain;                        /**< master gain */
     fluid_channel_t **channel;         /**< the channels */
@@ -190,6 +216,9 @@ fluid_preset_t *fluid_synth_find_preset(fluid_synth_t *synth,
                                         int prognum);
 void fluid_synth_sfont_unref(fluid_synth_t *synth, fluid_sfont_t *sfont);
 
+int fluid_synth_prefetch_program(fluid_synth_t *synth, int chan, int bank_msb, int bank_lsb, int prognum);
+int fluid_synth_prefetch_preset(fluid_synth_t *synth, int sfont_id, int bank_num, int preset_num);
+
 void fluid_synth_dither_s16(int *dither_index, int len, const float *lin, const float *rin,
                             void *lout, int loff, int lincr,
                             void *rout, int roff, int rincr);
@@ -209,6 +238,8 @@ void delete_fluid_sample_timer(fluid_synth_t *synth, fluid_sample_timer_t *timer
 
 void fluid_synth_process_event_queue(fluid_synth_t *synth);
 
+void fluid_synth_govern_polyphony(fluid_synth_t *synth, float cpu_load);
+
 int fluid_synth_set_gen2(fluid_synth_t *synth, int chan,
                          int param, float value,
                          int absolute, int normalized);
@@ -211,7 +211,7 @@ static void fluid_voice_initialize_rvoice(fluid_voice_t *voice, fluid_real_t out
  * new_fluid_voice
  */
 fluid_voice_t *
-new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate)
+new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate, int sample_decoding)
 {
     fluid_voice_t *voice;
     voice = FLUID_NEW(fluid_voice_t);
@@ -231,7 +231,9 @@ new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate)
     if(voice->rvoice == NULL || voice->overflow_rvoice == NULL)
     {
         FLUID_LOG(FLUID_ERR, "Out of memory");
-        delete_fluid_voice(voice);
+        FLUID_FREE(voice->overflow_rvoice);
+        FLUID_FREE(voice->rvoice);
+        FLUID_FREE(voice);
         return NULL;
     }
 
@@ -243,15 +245,70 @@ new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate)
     voice->channel = NULL;
     voice->sample = NULL;
     voice->output_rate = output_rate;
+    voice->decoders[0] = voice->decoders[1] = NULL;
 
     /* Initialize both the rvoice and overflow_rvoice */
     fluid_voice_initialize_rvoice(voice, output_rate);
     fluid_voice_swap_rvoice(voice);
     fluid_voice_initialize_rvoice(voice, output_rate);
 
+    if(sample_decoding && fluid_voice_enable_sample_decoding(voice, FALSE) != FLUID_OK)
+    {
+        delete_fluid_voice(voice);
+        return NULL;
+    }
+
     return voice;
 }
 
+/*
+ * fluid_voice_enable_sample_decoding
+ *
+ * Gives both rvoices a decode cache, which they need to play compressed samples.
+ * A voice that already has them is left alone. With enqueue set, the caches are
+ * handed over by the rvoice event queue, as the rvoices may be rendered right now.
+ */
+int
+fluid_voice_enable_sample_decoding(fluid_voice_t *voice, int enqueue)
+{
+    fluid_rvoice_param_t param[MAX_EVENT_PARAMS];
+    int i, status = FLUID_OK;
+
+    if(voice->decoders[0] != NULL)
+    {
+        return FLUID_OK;
+    }
+
+    voice->decoders[0] = new_fluid_sample_decoder();
+    voice->decoders[1] = new_fluid_sample_decoder();
+
+    if(voice->decoders[0] == NULL || voice->decoders[1] == NULL)
+    {
+        delete_fluid_sample_decoder(voice->decoders[0]);
+        delete_fluid_sample_decoder(voice->decoders[1]);
+        voice->decoders[0] = voice->decoders[1] = NULL;
+        return FLUID_FAILED;
+    }
+
+    for(i = 0; i < 2; i++)
+    {
+        fluid_rvoice_t *rvoice = (i == 0) ? voice->rvoice : voice->overflow_rvoice;
+
+        param[0].ptr = voice->decoders[i];
+
+        if(enqueue)
+        {
+            status |= fluid_rvoice_eventhandler_push(voice->eventhandler, fluid_rvoice_set_decoder, rvoice, param);
+        }
+        else
+        {
+            fluid_rvoice_set_decoder(rvoice, param);
+        }
+    }
+
+    return (status == FLUID_OK) ? FLUID_OK : FLUID_FAILED;
+}
+
 /*
  * delete_fluid_voice
  */
@@ -265,6 +322,9 @@ delete_fluid_voice(fluid_voice_t *voice)
         FLUID_LOG(FLUID_WARN, "Deleting voice %u which has locked rvoices!", voice->id);
     }
 
+    delete_fluid_sample_decoder(voice->decoders[0]);
+    delete_fluid_sample_decoder(voice->decoders[1]);
+
     FLUID_FREE(voice->overflow_rvoice);
     FLUID_FREE(voice->rvoice);
     FLUID_FREE(voice);
@@ -319,6 +379,7 @@ fluid_voice_init(fluid_voice_t *voice, fluid_sample_t *sample,
     voice->mod_count = 0;
     voice->start_time = start_time;
     voice->has_noteoff = 0;
+    voice->fading = 0;
     UPDATE_RVOICE0(fluid_rvoice_reset);
 
     /* Increment the reference count of the sample to prevent the
@@ -1415,6 +1476,38 @@ fluid_voice_kill_excl(fluid_voice_t *voice)
     return FLUID_OK;
 }
 
+/*
+ * fluid_voice_fade_out
+ *
+ * Release a voice as fast as its volume envelope allows, regardless of the
+ * pedals and the minimum note length. Used by the polyphony governor of the
+ * synth to get rid of voices without the click of fluid_voice_off().
+ */
+int
+fluid_voice_fade_out(fluid_voice_t *voice)
+{
+    if(!fluid_voice_is_playing(voice) || voice->fading)
+    {
+        return FLUID_OK;
+    }
+
+    voice->fading = 1;
+
+    fluid_voice_gen_set(voice, GEN_VOLENVRELEASE, FLUID_MIN_VOLENVRELEASE);
+    fluid_voice_update_param(voice, GEN_VOLENVRELEASE);
+
+    fluid_voice_gen_set(voice, GEN_MODENVRELEASE, FLUID_MIN_VOLENVRELEASE);
+    fluid_voice_update_param(voice, GEN_MODENVRELEASE);
+
+    UPDATE_RVOICE_I1(fluid_rvoice_noteoff, 0);
+    voice->has_noteoff = 1;
+
+    /* the voice is released now, even if a pedal held it */
+    voice->status = FLUID_VOICE_ON;
+
+    return FLUID_OK;
+}
+
 /*
  * Called by fluid_synth when the overflow rvoice can be reclaimed.
  */
@@ -1925,6 +2018,13 @@ fluid_voice_get_overflow_prio(fluid_voice_t *voice,
         return OVERFLOW_PRIO_CANNOT_KILL;
     }
 
+    /* A voice faded out by the polyphony governor is about to finish anyway,
+     * so it is the first one to make room for a new voice */
+    if(voice->fading)
+    {
+        return -OVERFLOW_PRIO_CANNOT_KILL;
+    }
+
     /* Is this voice on the drum channel?
      * Then it is very important.
      * Also skip the released and sustained scores.
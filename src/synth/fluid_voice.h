@@ -108,6 +108,8 @@ struct _fluid_voice_t
     char can_access_rvoice; /* False if rvoice is being rendered in separate thread */
     char can_access_overflow_rvoice; /* False if overflow_rvoice is being rendered in separate thread */
     char has_noteoff; /* Flag set when noteoff has been sent */
+    char fading; /* Flag set when the voice is being faded out by the polyphony governor */
+    fluid_sample_decoder_t *decoders[2]; /* decode caches handed to rvoice and overflow_rvoice, owned by the voice */
 
 #ifdef WITH_PROFILING
     /* for debugging */
@@ -116,7 +118,7 @@ struct _fluid_voice_t
 };
 
 
-fluid_voice_t *new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate);
+fluid_voice_t *new_fluid_voice(fluid_rvoice_eventhandler_t *handler, fluid_real_t output_rate, int sample_decoding);
 void delete_fluid_voice(fluid_voice_t *voice);
 
 void fluid_voice_start(fluid_voice_t *voice);
@@ -138,6 +140,7 @@ int fluid_voice_set_param(fluid_voice_t *voice, int gen, fluid_real_t value, int
 int fluid_voice_set_gain(fluid_voice_t *voice, fluid_real_t gain);
 
 void fluid_voice_set_output_rate(fluid_voice_t *voice, fluid_real_t value);
+int fluid_voice_enable_sample_decoding(fluid_voice_t *voice, int enqueue);
 
 
 /** Update all the synthesis parameters, which depend on generator
@@ -161,6 +164,7 @@ void fluid_voice_add_mod_local(fluid_voice_t *voice, fluid_mod_t *mod, int mode,
 void fluid_voice_overflow_rvoice_finished(fluid_voice_t *voice);
 
 int fluid_voice_kill_excl(fluid_voice_t *voice);
+int fluid_voice_fade_out(fluid_voice_t *voice);
 float fluid_voice_get_overflow_prio(fluid_voice_t *voice,
                                     fluid_overflow_prio_t *score,
                                     unsigned int cur_time);
@@ -0,0 +1,163 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include "fluid_arena.h"
+#include "fluid_sys.h"
+
+/* All allocations are aligned to this many bytes */
+#define FLUID_ARENA_ALIGN 16
+
+typedef struct _fluid_arena_block_t fluid_arena_block_t;
+
+struct _fluid_arena_block_t
+{
+    fluid_arena_block_t *next;  /* previously filled block */
+    size_t size;                /* usable size of this block in bytes */
+    size_t used;                /* bytes handed out from this block */
+};
+
+/* Block header size, rounded up to keep the payload aligned */
+#define FLUID_ARENA_HEADER_SIZE \
+    ((sizeof(fluid_arena_block_t) + FLUID_ARENA_ALIGN - 1) & ~(size_t)(FLUID_ARENA_ALIGN - 1))
+
+struct _fluid_arena_t
+{
+    fluid_arena_block_t *block; /* block currently allocated from */
+    size_t block_size;          /* default size of new blocks */
+};
+
+/**
+ * Create a new arena.
+ * @param block_size Size of the memory blocks to allocate objects from
+ * @return New arena or NULL if out of memory (error message logged)
+ */
+fluid_arena_t *
+new_fluid_arena(size_t block_size)
+{
+    fluid_arena_t *arena;
+
+    fluid_return_val_if_fail(block_size > 0, NULL);
+
+    arena = FLUID_NEW(fluid_arena_t);
+
+    if(arena == NULL)
+    {
+        FLUID_LOG(FLUID_ERR, "Out of memory");
+        return NULL;
+    }
+
+    arena->block = NULL;
+    arena->block_size = block_size;
+
+    return arena;
+}
+
+/**
+ * Free an arena and all memory that has been allocated from it.
+ * @param arena The arena to free
+ */
+void
+delete_fluid_arena(fluid_arena_t *arena)
+{
+    fluid_arena_block_t *block;
+
+    fluid_return_if_fail(arena != NULL);
+
+    while(arena->block)
+    {
+        block = arena->block;
+        arena->block = block->next;
+        FLUID_FREE(block);
+    }
+
+    FLUID_FREE(arena);
+}
+
+/**
+ * Allocate zero-initialized memory from an arena.
+ * @param arena The arena to allocate from
+ * @param size Number of bytes to allocate
+ * @return Pointer to the memory or NULL if out of memory (error message logged)
+ *
+ * The memory stays valid until the arena is deleted and must not be freed individually.
+ */
+void *
+fluid_arena_alloc(fluid_arena_t *arena, size_t size)
+{
+    fluid_arena_block_t *block = arena->block;
+    void *ptr;
+
+    size = (size + FLUID_ARENA_ALIGN - 1) & ~(size_t)(FLUID_ARENA_ALIGN - 1);
+
+    if(block == NULL || block->size - block->used < size)
+    {
+        size_t block_size = (size > arena->block_size) ? size : arena->block_size;
+
+        block = FLUID_MALLOC(FLUID_ARENA_HEADER_SIZE + block_size);
+
+        if(block == NULL)
+        {
+            FLUID_LOG(FLUID_ERR, "Out of memory");
+            return NULL;
+        }
+
+        block->size = block_size;
+        block->used = 0;
+
+        /* Oversized allocations get a block of their own, keep filling the current one */
+        if(arena->block != NULL && block_size > arena->block_size)
+        {
+            block->next = arena->block->next;
+            arena->block->next = block;
+        }
+        else
+        {
+            block->next = arena->block;
+            arena->block = block;
+        }
+    }
+
+    ptr = (char *)block + FLUID_ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+
+    FLUID_MEMSET(ptr, 0, size);
+
+    return ptr;
+}
+
+/**
+ * Duplicate a string into memory allocated from an arena.
+ * @param arena The arena to allocate from
+ * @param str The string to copy
+ * @return Pointer to the copy or NULL if out of memory (error message logged)
+ */
+char *
+fluid_arena_strdup(fluid_arena_t *arena, const char *str)
+{
+    size_t len = FLUID_STRLEN(str) + 1;
+    char *dup = fluid_arena_alloc(arena, len);
+
+    if(dup != NULL)
+    {
+        FLUID_MEMCPY(dup, str, len);
+    }
+
+    return dup;
+}
@@ -0,0 +1,41 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _FLUID_ARENA_H
+#define _FLUID_ARENA_H
+
+#include "fluidsynth_priv.h"
+
+/*
+ * Bump allocator for objects sharing the same lifetime. Memory is taken from
+ * large blocks and can only be released all at once by deleting the arena.
+ */
+typedef struct _fluid_arena_t fluid_arena_t;
+
+fluid_arena_t *new_fluid_arena(size_t block_size);
+void delete_fluid_arena(fluid_arena_t *arena);
+
+void *fluid_arena_alloc(fluid_arena_t *arena, size_t size);
+char *fluid_arena_strdup(fluid_arena_t *arena, const char *str);
+
+#define FLUID_ARENA_NEW(_arena, _t)        (_t*)fluid_arena_alloc(_arena, sizeof(_t))
+#define FLUID_ARENA_ARRAY(_arena, _t, _n)  (_t*)fluid_arena_alloc(_arena, (_n)*sizeof(_t))
+
+#endif /* _FLUID_ARENA_H */
@@ -0,0 +1,370 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include "fluid_hugemem.h"
+#include "fluid_sys.h"
+
+#if HAVE_SYS_MMAN_H && defined(MAP_ANONYMOUS) && (defined(MAP_HUGETLB) || defined(MADV_HUGEPAGE))
+#define FLUID_HUGEMEM_SUPPORTED 1
+#endif
+
+/* How the memory of an allocation has been obtained */
+enum
+{
+    FLUID_HUGEMEM_MALLOC,   /* plain malloc() */
+    FLUID_HUGEMEM_HUGETLB,  /* mmap() of explicit huge pages */
+    FLUID_HUGEMEM_THP       /* huge page aligned mmap() advised for transparent huge pages */
+};
+
+typedef struct _fluid_hugemem_header_t fluid_hugemem_header_t;
+
+struct _fluid_hugemem_header_t
+{
+    int kind;
+    void *base;     /* start of the malloc()ed or mapped region */
+    size_t size;    /* size of the mapped region, or the requested size for malloc() */
+
+    /* links into the list of regions advised for transparent huge pages */
+    fluid_hugemem_header_t *prev;
+    fluid_hugemem_header_t *next;
+};
+
+/* The header is stored right before the returned pointer, which is kept aligned */
+#define FLUID_HUGEMEM_HEADER_SIZE \
+    ((sizeof(fluid_hugemem_header_t) + FLUID_DEFAULT_ALIGNMENT - 1) & ~(size_t)(FLUID_DEFAULT_ALIGNMENT - 1))
+
+/* Set once madvise() failed, it will not succeed later on */
+static int hugemem_thp_unavailable = FALSE;
+
+/* Protects the statistics below */
+static fluid_mutex_t hugemem_mutex = FLUID_MUTEX_INIT;
+static size_t hugemem_hugetlb_bytes = 0;
+static size_t hugemem_thp_bytes = 0;
+static fluid_hugemem_header_t *hugemem_thp_regions = NULL;
+
+static void *fluid_hugemem_init_header(void *base, int kind, size_t size);
+static fluid_hugemem_header_t *fluid_hugemem_get_header(void *ptr);
+static void fluid_hugemem_account(fluid_hugemem_header_t *header, int add);
+static size_t fluid_hugemem_get_thp_bytes(void);
+
+#ifdef FLUID_HUGEMEM_SUPPORTED
+static void *fluid_hugemem_map(size_t size, int *kind);
+#endif
+
+
+/**
+ * Allocate memory, preferably backed by huge pages.
+ *
+ * Huge pages are only used when requested and when the buffer is large enough
+ * to not waste most of the rounded up 2 MiB pages.
+ *
+ * @param size Number of bytes to allocate
+ * @param min_size Minimum \c size to use huge pages for
+ * @param huge_pages TRUE to allocate from huge pages when possible (see synth.huge-pages)
+ * @return Pointer to memory aligned to FLUID_DEFAULT_ALIGNMENT or NULL if out of memory
+ */
+void *fluid_huge_alloc(size_t size, size_t min_size, int huge_pages)
+{
+    void *base;
+
+#ifdef FLUID_HUGEMEM_SUPPORTED
+
+    if(huge_pages && size >= min_size)
+    {
+        int kind;
+        size_t map_size = (size + FLUID_HUGEMEM_HEADER_SIZE + FLUID_HUGE_PAGE_SIZE - 1)
+                          & ~(size_t)(FLUID_HUGE_PAGE_SIZE - 1);
+
+        base = fluid_hugemem_map(map_size, &kind);
+
+        if(base != NULL)
+        {
+            void *ptr = fluid_hugemem_init_header(base, kind, map_size);
+            fluid_hugemem_account(fluid_hugemem_get_header(ptr), TRUE);
+            return ptr;
+        }
+    }
+
+#endif
+
+    base = FLUID_MALLOC(size + FLUID_HUGEMEM_HEADER_SIZE + FLUID_DEFAULT_ALIGNMENT - 1);
+
+    if(base == NULL)
+    {
+        return NULL;
+    }
+
+    return fluid_hugemem_init_header(base, FLUID_HUGEMEM_MALLOC, size);
+}
+
+/**
+ * Free memory allocated with fluid_huge_alloc().
+ * @param ptr Pointer returned by fluid_huge_alloc() or NULL
+ */
+void fluid_huge_free(void *ptr)
+{
+    fluid_hugemem_header_t *header;
+
+    if(ptr == NULL)
+    {
+        return;
+    }
+
+    header = fluid_hugemem_get_header(ptr);
+
+    if(header->kind == FLUID_HUGEMEM_MALLOC)
+    {
+        FLUID_FREE(header->base);
+        return;
+    }
+
+#ifdef FLUID_HUGEMEM_SUPPORTED
+    fluid_hugemem_account(header, FALSE);
+    munmap(header->base, header->size);
+#endif
+}
+
+/**
+ * Get the amount of memory currently backed by huge pages.
+ *
+ * Huge pages are used for sample data and mixer buffers when
+ * <a href="fluidsettings.xml#synth.huge-pages">synth.huge-pages</a> is enabled.
+ * Explicit huge pages are only available if the system administrator reserved some
+ * (e.g. with /proc/sys/vm/nr_hugepages), otherwise memory is advised to be backed by
+ * transparent huge pages, which the kernel may or may not honour.
+ *
+ * @param hugetlb_bytes Location to store the number of bytes allocated from explicit
+ *   huge pages (can be NULL)
+ * @param thp_bytes Location to store the number of bytes the kernel actually backs with
+ *   transparent huge pages, as reported by /proc/self/smaps. Where that isn't available,
+ *   the number of bytes advised for transparent huge pages. (can be NULL)
+ * @return #FLUID_OK
+ * @since 2.1.0
+ */
+int fluid_get_huge_page_stats(size_t *hugetlb_bytes, size_t *thp_bytes)
+{
+    fluid_mutex_lock(hugemem_mutex);
+
+    if(hugetlb_bytes != NULL)
+    {
+        *hugetlb_bytes = hugemem_hugetlb_bytes;
+    }
+
+    if(thp_bytes != NULL)
+    {
+        *thp_bytes = fluid_hugemem_get_thp_bytes();
+    }
+
+    fluid_mutex_unlock(hugemem_mutex);
+    return FLUID_OK;
+}
+
+
+/* Private functions */
+static void *fluid_hugemem_init_header(void *base, int kind, size_t size)
+{
+    char *ptr = fluid_align_ptr((char *)base + FLUID_HUGEMEM_HEADER_SIZE, FLUID_DEFAULT_ALIGNMENT);
+    fluid_hugemem_header_t *header = fluid_hugemem_get_header(ptr);
+
+    header->kind = kind;
+    header->base = base;
+    header->size = size;
+
+    return ptr;
+}
+
+static fluid_hugemem_header_t *fluid_hugemem_get_header(void *ptr)
+{
+    return (fluid_hugemem_header_t *)((char *)ptr - FLUID_HUGEMEM_HEADER_SIZE);
+}
+
+static void fluid_hugemem_account(fluid_hugemem_header_t *header, int add)
+{
+    size_t *bytes = (header->kind == FLUID_HUGEMEM_HUGETLB) ? &hugemem_hugetlb_bytes : &hugemem_thp_bytes;
+
+    fluid_mutex_lock(hugemem_mutex);
+
+    if(add)
+    {
+        *bytes += header->size;
+    }
+    else
+    {
+        *bytes -= header->size;
+    }
+
+    if(header->kind == FLUID_HUGEMEM_THP)
+    {
+        if(add)
+        {
+            header->prev = NULL;
+            header->next = hugemem_thp_regions;
+
+            if(hugemem_thp_regions != NULL)
+            {
+                hugemem_thp_regions->prev = header;
+            }
+
+            hugemem_thp_regions = header;
+        }
+        else
+        {
+            if(header->prev != NULL)
+            {
+                header->prev->next = header->next;
+            }
+            else
+            {
+                hugemem_thp_regions = header->next;
+            }
+
+            if(header->next != NULL)
+            {
+                header->next->prev = header->prev;
+            }
+        }
+    }
+
+    fluid_mutex_unlock(hugemem_mutex);
+}
+
+/* Get the number of bytes of the regions advised for transparent huge pages the kernel
+ * actually backs with huge pages, as reported by the AnonHugePages lines of /proc/self/smaps.
+ * Falls back to the number of advised bytes if that isn't available.
+ * Must be called with hugemem_mutex held. */
+static size_t fluid_hugemem_get_thp_bytes(void)
+{
+#if defined(FLUID_HUGEMEM_SUPPORTED) && defined(__linux__)
+    char line[256];
+    unsigned long start = 0, end = 0, kb;
+    size_t bytes = 0, overlap;
+    fluid_hugemem_header_t *header;
+    FILE *file;
+
+    if(hugemem_thp_regions == NULL)
+    {
+        return 0;
+    }
+
+    file = FLUID_FOPEN("/proc/self/smaps", "r");
+
+    if(file == NULL)
+    {
+        return hugemem_thp_bytes;
+    }
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        /* each mapping starts with its address range, followed by its statistics */
+        if(sscanf(line, "%lx-%lx", &start, &end) == 2)
+        {
+            continue;
+        }
+
+        if(sscanf(line, "AnonHugePages: %lu kB", &kb) != 1 || kb == 0)
+        {
+            continue;
+        }
+
+        /* adjacent regions may have been merged into one mapping, which may also
+         * include memory not allocated by fluid_huge_alloc() */
+        overlap = 0;
+
+        for(header = hugemem_thp_regions; header != NULL; header = header->next)
+        {
+            unsigned long region_start = (unsigned long)header->base;
+            unsigned long region_end = region_start + header->size;
+
+            if(region_start < end && region_end > start)
+            {
+                overlap += (region_end < end ? region_end : end)
+                           - (region_start > start ? region_start : start);
+            }
+        }
+
+        bytes += ((size_t)kb * 1024 < overlap) ? (size_t)kb * 1024 : overlap;
+    }
+
+    fclose(file);
+    return bytes;
+#else
+    return hugemem_thp_bytes;
+#endif
+}
+
+#ifdef FLUID_HUGEMEM_SUPPORTED
+/* Map size bytes (a multiple of the huge page size) of anonymous memory, either from
+ * explicit huge pages or aligned to the huge page size for transparent huge pages */
+static void *fluid_hugemem_map(size_t size, int *kind)
+{
+    void *base;
+
+#ifdef MAP_HUGETLB
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if(base != MAP_FAILED)
+    {
+        *kind = FLUID_HUGEMEM_HUGETLB;
+        return base;
+    }
+
+#endif
+
+#ifdef MADV_HUGEPAGE
+
+    if(!hugemem_thp_unavailable)
+    {
+        /* over-allocate and trim, the kernel only uses huge pages for aligned ranges */
+        char *region = mmap(NULL, size + FLUID_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        char *aligned;
+        size_t head;
+
+        if(region == MAP_FAILED)
+        {
+            return NULL;
+        }
+
+        aligned = fluid_align_ptr(region, FLUID_HUGE_PAGE_SIZE);
+        head = aligned - region;
+
+        if(head > 0)
+        {
+            munmap(region, head);
+        }
+
+        munmap(aligned + size, FLUID_HUGE_PAGE_SIZE - head);
+
+        if(madvise(aligned, size, MADV_HUGEPAGE) != 0)
+        {
+            FLUID_LOG(FLUID_INFO, "Transparent huge pages not available, using regular pages");
+            hugemem_thp_unavailable = TRUE;
+            munmap(aligned, size);
+            return NULL;
+        }
+
+        *kind = FLUID_HUGEMEM_THP;
+        return aligned;
+    }
+
+#endif
+    return NULL;
+}
+#endif
@@ -0,0 +1,42 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _FLUID_HUGEMEM_H
+#define _FLUID_HUGEMEM_H
+
+#include "fluidsynth_priv.h"
+
+/*
+ * Allocator for large, long-lived buffers (sample data, mixer buffers) that
+ * are accessed randomly from the audio thread. If requested, buffers are backed
+ * by 2 MiB huge pages to reduce TLB misses: explicit huge pages (MAP_HUGETLB)
+ * if the system has some reserved, otherwise transparent huge pages requested
+ * with madvise(). Without huge page support, plain malloc() is used.
+ *
+ * Memory returned by fluid_huge_alloc() is aligned to FLUID_DEFAULT_ALIGNMENT
+ * and must be released with fluid_huge_free().
+ */
+
+#define FLUID_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *fluid_huge_alloc(size_t size, size_t min_size, int huge_pages);
+void fluid_huge_free(void *ptr);
+
+#endif /* _FLUID_HUGEMEM_H */
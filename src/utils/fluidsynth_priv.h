@@ -254,9 +254,17 @@ typedef FILE  *fluid_file;
 #define FLUID_FOPEN(_f,_m)           fopen(_f,_m)
 #define FLUID_FCLOSE(_f)             fclose(_f)
 #define FLUID_FREAD(_p,_s,_n,_f)     fread(_p,_s,_n,_f)
-#define FLUID_FSEEK(_f,_n,_set)      fseek(_f,_n,_set)
-#define FLUID_FTELL(_f)              ftell(_f)
+#define FLUID_FWRITE(_p,_s,_n,_f)    fwrite(_p,_s,_n,_f)
+#ifdef WIN32
+#define FLUID_FSEEK(_f,_n,_set)      _fseeki64(_f,_n,_set)
+#define FLUID_FTELL(_f)              _ftelli64(_f)
+#else
+#define FLUID_FSEEK(_f,_n,_set)      fseeko(_f,_n,_set)
+#define FLUID_FTELL(_f)              ftello(_f)
+#endif
 #define FLUID_MEMCPY(_dst,_src,_n)   memcpy(_dst,_src,_n)
+#define FLUID_MEMMOVE(_dst,_src,_n)  memmove(_dst,_src,_n)
+#define FLUID_MEMCMP(_s1,_s2,_n)     memcmp(_s1,_s2,_n)
 #define FLUID_MEMSET(_s,_c,_n)       memset(_s,_c,_n)
 #define FLUID_STRLEN(_s)             strlen(_s)
 #define FLUID_STRCMP(_s,_t)          strcmp(_s,_t)
@@ -0,0 +1,258 @@
+#include <math.h>
+
+#include "test.h"
+#include "test_sfont_builder.h"
+#include "fluidsynth.h"
+#include "utils/fluid_sys.h"
+#include "utils/fluidsynth_priv.h"
+
+#define SFONT_16BIT "bench_voice_render_16bit.sf2"
+#define SFONT_24BIT "bench_voice_render_24bit.sf2"
+
+/* Long enough for the highest note to not reach the end of the sample */
+#define SAMPLE_LEN 1200000
+#define SAMPLE_PAD 46
+#define LOOP_START 1000
+#define ROOT_KEY 70
+
+#define NOTES 60
+#define FIRST_NOTE 40
+#define BLOCKS 2000
+#define RUNS 5
+
+/* Write a SoundFont with two presets playing the same long sample, preset 0 looping
+ * over most of it and preset 1 playing it once. With bits24 set, the sample has
+ * 24 bit data. */
+static void write_sfont(const char *filename, int bits24)
+{
+    sfont_buf_t buf = { NULL, 0, 0 };
+    int riff, list, chunk, i;
+
+    riff = begin_chunk(&buf, "RIFF", "sfbk");
+
+    list = begin_chunk(&buf, "LIST", "INFO");
+    chunk = begin_chunk(&buf, "ifil", NULL);
+    put16(&buf, 2);
+    put16(&buf, 4);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "isng", NULL);
+    put_name(&buf, "EMU8000", 8);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "INAM", NULL);
+    put_name(&buf, "bench", 8);
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "sdta");
+    chunk = begin_chunk(&buf, "smpl", NULL);
+
+    for(i = 0; i < SAMPLE_LEN + SAMPLE_PAD; i++)
+    {
+        put16(&buf, i < SAMPLE_LEN ? (int)(12000 * sin(i * 0.05) + 3000 * sin(i * 0.31)) : 0);
+    }
+
+    end_chunk(&buf, chunk);
+
+    if(bits24)
+    {
+        chunk = begin_chunk(&buf, "sm24", NULL);
+
+        for(i = 0; i < SAMPLE_LEN + SAMPLE_PAD; i++)
+        {
+            put8(&buf, i < SAMPLE_LEN ? (i * 37) & 0xff : 0);
+        }
+
+        if(buf.size % 2)
+        {
+            put8(&buf, 0);
+        }
+
+        end_chunk(&buf, chunk);
+    }
+
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "pdta");
+
+    chunk = begin_chunk(&buf, "phdr", NULL);
+
+    for(i = 0; i < 2; i++)
+    {
+        put_name(&buf, i == 0 ? "loop" : "once", 20);
+        put16(&buf, i);
+        put16(&buf, 0);
+        put16(&buf, i);
+        put32(&buf, 0);
+        put32(&buf, 0);
+        put32(&buf, 0);
+    }
+
+    put_name(&buf, "EOP", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 2);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pbag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put16(&buf, 0);
+    put16(&buf, 2);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pmod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pgen", NULL);
+    put_gen(&buf, GEN_INSTRUMENT, 0);
+    put_gen(&buf, GEN_INSTRUMENT, 1);
+    put_gen(&buf, 0, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "inst", NULL);
+    put_name(&buf, "loop", 20);
+    put16(&buf, 0);
+    put_name(&buf, "once", 20);
+    put16(&buf, 1);
+    put_name(&buf, "EOI", 20);
+    put16(&buf, 2);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "ibag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 2);
+    put16(&buf, 0);
+    put16(&buf, 3);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "imod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "igen", NULL);
+    put_gen(&buf, GEN_SAMPLEMODE, 1);
+    put_gen(&buf, GEN_SAMPLEID, 0);
+    put_gen(&buf, GEN_SAMPLEID, 0);
+    put_gen(&buf, 0, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "shdr", NULL);
+    put_name(&buf, "sample", 20);
+    put32(&buf, 0);
+    put32(&buf, SAMPLE_LEN);
+    put32(&buf, LOOP_START);
+    put32(&buf, SAMPLE_LEN - LOOP_START);
+    put32(&buf, 44100);
+    put8(&buf, ROOT_KEY);
+    put8(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, FLUID_SAMPLETYPE_MONO);
+    put_name(&buf, "EOS", 46);
+    end_chunk(&buf, chunk);
+
+    end_chunk(&buf, list);
+    end_chunk(&buf, riff);
+
+    save_sfont(&buf, filename);
+}
+
+/* Render NOTES notes of one preset for BLOCKS blocks, returns the best time of RUNS runs in ms */
+static double render(const char *filename, const char *storage, int interp, int prog)
+{
+    static float out[2 * FLUID_BUFSIZE];
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    double start, best = 0;
+    int run, i;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.polyphony", 256));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.reverb.active", 0));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.chorus.active", 0));
+    TEST_SUCCESS(fluid_settings_setstr(settings, "synth.sample-storage", storage));
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, filename, 1));
+    TEST_SUCCESS(fluid_synth_set_interp_method(synth, -1, interp));
+
+    for(run = 0; run < RUNS; run++)
+    {
+        TEST_SUCCESS(fluid_synth_program_change(synth, 0, prog));
+
+        for(i = 0; i < NOTES; i++)
+        {
+            TEST_SUCCESS(fluid_synth_noteon(synth, 0, FIRST_NOTE + i, 100));
+        }
+
+        start = fluid_utime();
+
+        for(i = 0; i < BLOCKS; i++)
+        {
+            TEST_SUCCESS(fluid_synth_write_float(synth, FLUID_BUFSIZE, out, 0, 2, out, 1, 2));
+        }
+
+        start = (fluid_utime() - start) / 1000;
+        best = (run == 0 || start < best) ? start : best;
+
+        // every note keeps playing until the end of the run
+        TEST_ASSERT(fluid_synth_get_active_voice_count(synth) == NOTES);
+        TEST_SUCCESS(fluid_synth_system_reset(synth));
+    }
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return best;
+}
+
+// this measures how long rendering voices takes for every interpolation method with
+// 16 bit, 24 bit and compressed sample data, with looped and unlooped samples
+int main(void)
+{
+    static const int interp[] =
+    {
+        FLUID_INTERP_NONE, FLUID_INTERP_LINEAR, FLUID_INTERP_4THORDER, FLUID_INTERP_7THORDER
+    };
+    static const char *const formats[] = { "16 bit", "24 bit", "compr." };
+    int format, prog, i;
+
+    // there are no drums to be found for channel 10
+    fluid_set_log_function(FLUID_WARN, NULL, NULL);
+
+    write_sfont(SFONT_16BIT, FALSE);
+    write_sfont(SFONT_24BIT, TRUE);
+
+    printf("%d notes for %d blocks, best of %d runs\n\n", NOTES, BLOCKS, RUNS);
+    printf("                none      linear    4th       7th\n");
+
+    for(format = 0; format < 3; format++)
+    {
+        for(prog = 0; prog < 2; prog++)
+        {
+            printf("%-7s %-6s", formats[format], prog == 0 ? "loop" : "once");
+
+            for(i = 0; i < (int)(sizeof(interp) / sizeof(interp[0])); i++)
+            {
+                printf("  %5.1f ms", render(format == 1 ? SFONT_24BIT : SFONT_16BIT,
+                                            format == 2 ? "compressed" : "plain", interp[i], prog));
+                fflush(stdout);
+            }
+
+            printf("\n");
+        }
+    }
+
+    remove(SFONT_16BIT);
+    remove(SFONT_24BIT);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+/* Build the chorus into the test to get at its static waveform functions */
+#define new_fluid_chorus test_new_fluid_chorus
+#define delete_fluid_chorus test_delete_fluid_chorus
+#define fluid_chorus_init test_fluid_chorus_init
+#define fluid_chorus_reset test_fluid_chorus_reset
+#define fluid_chorus_set test_fluid_chorus_set
+#define fluid_chorus_processmix test_fluid_chorus_processmix
+#define fluid_chorus_processreplace test_fluid_chorus_processreplace
+#include "rvoice/fluid_chorus.c"
+
+#define MAX_LEN 4096
+
+/* The triangle waveform as calculated for the original delay line of 2048 samples,
+ * relative to the start of its period */
+static int reference_triangle(int i, int len, int depth)
+{
+    double val = 0. - 3. * 2048 * INTERPOLATION_SUBSAMPLES;
+    double incr = 2.0 / len * (double)depth * (double) INTERPOLATION_SUBSAMPLES;
+    int k;
+
+    if(i >= len / 2)
+    {
+        i = len - 1 - i;
+    }
+
+    for(k = 0; k < i; k++)
+    {
+        val += incr;
+    }
+
+    return (int)(val - 0.5) + 3 * 2048 * INTERPOLATION_SUBSAMPLES;
+}
+
+// this tests that the triangle modulation waveform of the chorus rounds exactly like the
+// waveform of the original 2048 samples delay line, whatever length the delay line has now
+int main(void)
+{
+    static int buf[MAX_LEN];
+    static const int lens[] = { 1536, 1537, 3072, 4000 };
+    static const int depths[] = { 1, 203, 607, 1000, MAX_DEPTH_SAMPLES };
+    unsigned int l, d;
+    int i;
+
+    for(l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+    {
+        for(d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+        {
+            fluid_chorus_triangle(buf, lens[l], depths[d]);
+
+            for(i = 0; i < lens[l]; i++)
+            {
+                TEST_ASSERT(buf[i] + LOOKUP_OFFSET == reference_triangle(i, lens[l], depths[d]));
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
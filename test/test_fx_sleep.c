@@ -0,0 +1,65 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <math.h>
+#include <string.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 400
+
+static float render(fluid_synth_t *synth)
+{
+    static float out[6][BUFSIZE];
+    float *dry[2] = { out[0], out[1] }, *fx[4] = { out[2], out[3], out[4], out[5] };
+    float peak = 0;
+    int i, k;
+
+    // fluid_synth_process() mixes into the buffers
+    memset(out, 0, sizeof(out));
+    TEST_SUCCESS(fluid_synth_process(synth, BUFSIZE, 4, fx, 2, dry));
+
+    for(k = 2; k < 6; k++)
+    {
+        for(i = 0; i < BUFSIZE; i++)
+        {
+            peak = (fabs(out[k][i]) > peak) ? fabs(out[k][i]) : peak;
+        }
+    }
+
+    return peak;
+}
+
+// this tests that reverb and chorus fall silent once their tail decayed and wake up on new input
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    int i;
+
+    TEST_ASSERT(settings != NULL);
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    TEST_SUCCESS(fluid_synth_cc(synth, 0, 93, 127));
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 127));
+    TEST_ASSERT(render(synth) > 0);
+    TEST_SUCCESS(fluid_synth_noteoff(synth, 0, 60));
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        render(synth);
+    }
+
+    // without sleeping, the reverb keeps on emitting its DC offset residue
+    TEST_ASSERT(render(synth) == 0);
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 127));
+    TEST_ASSERT(render(synth) > 0);
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
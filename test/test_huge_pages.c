@@ -0,0 +1,208 @@
+#include "test.h"
+#include "test_sfont_builder.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#define BUFSIZE 1024
+
+#define SFONT_HUGE "test_huge_pages_huge.sf2"
+#define SFONT_PLAIN "test_huge_pages_plain.sf2"
+
+/* Large enough for the sample data to be allocated from huge pages */
+#define SAMPLE_LEN (1024 * 1024)
+#define SAMPLE_PAD 46
+
+/* Write a SoundFont with a single preset playing a single long sample */
+static void write_sfont(const char *filename)
+{
+    sfont_buf_t buf = { NULL, 0, 0 };
+    int riff, list, chunk, i;
+
+    riff = begin_chunk(&buf, "RIFF", "sfbk");
+
+    list = begin_chunk(&buf, "LIST", "INFO");
+    chunk = begin_chunk(&buf, "ifil", NULL);
+    put16(&buf, 2);
+    put16(&buf, 1);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "isng", NULL);
+    put_name(&buf, "EMU8000", 8);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "INAM", NULL);
+    put_name(&buf, "huge", 8);
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "sdta");
+    chunk = begin_chunk(&buf, "smpl", NULL);
+
+    for(i = 0; i < SAMPLE_LEN + SAMPLE_PAD; i++)
+    {
+        put16(&buf, i < SAMPLE_LEN ? ((i % 40) - 20) * 1000 : 0);
+    }
+
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "pdta");
+
+    chunk = begin_chunk(&buf, "phdr", NULL);
+    put_name(&buf, "huge", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put_name(&buf, "EOP", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pbag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pmod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pgen", NULL);
+    put16(&buf, GEN_INSTRUMENT);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "inst", NULL);
+    put_name(&buf, "huge", 20);
+    put16(&buf, 0);
+    put_name(&buf, "EOI", 20);
+    put16(&buf, 1);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "ibag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "imod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "igen", NULL);
+    put16(&buf, GEN_SAMPLEID);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "shdr", NULL);
+    put_name(&buf, "huge", 20);
+    put32(&buf, 0);
+    put32(&buf, SAMPLE_LEN);
+    put32(&buf, 100);
+    put32(&buf, SAMPLE_LEN - 100);
+    put32(&buf, 44100);
+    put8(&buf, 60);
+    put8(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, FLUID_SAMPLETYPE_MONO);
+    put_name(&buf, "EOS", 46);
+    end_chunk(&buf, chunk);
+
+    end_chunk(&buf, list);
+    end_chunk(&buf, riff);
+
+    save_sfont(&buf, filename);
+}
+
+static size_t get_huge_bytes(void)
+{
+    size_t hugetlb_bytes, thp_bytes;
+
+    TEST_SUCCESS(fluid_get_huge_page_stats(&hugetlb_bytes, &thp_bytes));
+
+    // huge pages are not available everywhere, but if they are, they come in whole pages
+    TEST_ASSERT(hugetlb_bytes % (2 * 1024 * 1024) == 0);
+    TEST_ASSERT(thp_bytes % (2 * 1024 * 1024) == 0);
+
+    return hugetlb_bytes + thp_bytes;
+}
+
+// this tests that a synth using huge pages renders and releases them again, and that
+// synth.huge-pages only applies to the synth created with it and the SoundFonts it loads
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_settings_t *plain_settings = new_fluid_settings();
+    fluid_synth_t *synth, *plain_synth;
+    float out[2 * BUFSIZE];
+    size_t mixer_bytes;
+    int id;
+
+    TEST_ASSERT(settings != NULL && plain_settings != NULL);
+    TEST_ASSERT(get_huge_bytes() == 0);
+
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.huge-pages", 1));
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    mixer_bytes = get_huge_bytes();
+
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 100));
+    TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+
+    TEST_SUCCESS(fluid_synth_all_sounds_off(synth, -1));
+    TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+    TEST_SUCCESS(fluid_synth_sfunload(synth, id, 0));
+
+    // a synth without huge pages created later on doesn't affect the first one
+    write_sfont(SFONT_HUGE);
+    write_sfont(SFONT_PLAIN);
+
+    // only memory actually backed by huge pages is reported, which the mixer buffers
+    // of the first synth may or may not be by now
+    mixer_bytes = get_huge_bytes();
+
+    plain_synth = new_fluid_synth(plain_settings);
+    TEST_ASSERT(plain_synth != NULL);
+    TEST_ASSERT(get_huge_bytes() == mixer_bytes);
+
+    // the sample data is written right away, so it is backed by huge pages
+    // as soon as the kernel provides any
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, SFONT_HUGE, 1));
+
+    if(mixer_bytes > 0)
+    {
+        TEST_ASSERT(get_huge_bytes() > mixer_bytes);
+    }
+
+    TEST_SUCCESS(fluid_synth_sfunload(synth, id, 0));
+    TEST_ASSERT(get_huge_bytes() == mixer_bytes);
+
+    TEST_SUCCESS(id = fluid_synth_sfload(plain_synth, SFONT_PLAIN, 1));
+    TEST_ASSERT(get_huge_bytes() == mixer_bytes);
+    TEST_SUCCESS(fluid_synth_sfunload(plain_synth, id, 0));
+
+    remove(SFONT_HUGE);
+    remove(SFONT_PLAIN);
+
+    delete_fluid_synth(plain_synth);
+    delete_fluid_synth(synth);
+
+    TEST_ASSERT(get_huge_bytes() == 0);
+
+    delete_fluid_settings(plain_settings);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+#include "utils/fluid_sys.h"
+#include "utils/fluid_conv.h"
+#include "rvoice/fluid_iir_filter.h"
+#include "rvoice/fluid_iir_filter_tables.h"
+
+/* 1200 * log2(0.45), the highest cutoff relative to the sample rate */
+#define CENTS_LIMIT (-1382.40371213406)
+
+static void set_param(fluid_iir_filter_t *filter, void (*func)(void *, const fluid_rvoice_param_t *),
+                      int i, fluid_real_t real)
+{
+    fluid_rvoice_param_t param[MAX_EVENT_PARAMS];
+
+    param[0].i = i;
+    param[0].real = real;
+    param[1].i = 0;
+    func(filter, param);
+}
+
+// check the lowpass coefficients of a filter against the ones calculated with exact sin() and cos()
+static void check_coefficients(fluid_real_t output_rate, fluid_real_t cents, fluid_real_t q_dB)
+{
+    fluid_iir_filter_t filter;
+    fluid_rvoice_param_t param[MAX_EVENT_PARAMS];
+    double fres, omega, q, gain, alpha, a0_inv, b1;
+
+    FLUID_MEMSET(&filter, 0, sizeof(filter));
+
+    param[0].i = FLUID_IIR_LOWPASS;
+    param[1].i = 0;
+    fluid_iir_filter_init(&filter, param);
+    set_param(&filter, fluid_iir_filter_set_fres, 0, cents);
+    set_param(&filter, fluid_iir_filter_set_q, 0, q_dB);
+    fluid_iir_filter_calc(&filter, output_rate, 0);
+
+    // the cutoff as the filter defines it, see fluid_iir_filter_calc()
+    fres = fluid_ct2hz(cents);
+
+    if(fres > 0.45 * output_rate)
+    {
+        fres = 0.45 * output_rate;
+    }
+
+    omega = 2.0 * M_PI * fres / output_rate;
+    q = pow(10.0, (q_dB / 10.0 - 3.01) / 20.0);
+    gain = 1.0 / sqrt(q);
+    alpha = sin(omega) / (2.0 * q);
+    a0_inv = 1.0 / (1.0 + alpha);
+    b1 = (1.0 - cos(omega)) * a0_inv * gain;
+
+    TEST_ASSERT(fabs(filter.a1 - -2.0 * cos(omega) * a0_inv) < 1e-9);
+    TEST_ASSERT(fabs(filter.a2 - (1.0 - alpha) * a0_inv) < 1e-9);
+
+    // b1 is tiny for low cutoffs, its error has to be small relative to it
+    TEST_ASSERT(fabs(filter.b1 - b1) <= 1e-6 * b1);
+    TEST_ASSERT(fabs(filter.b02 - b1 * 0.5) <= 1e-6 * b1 * 0.5);
+}
+
+// this tests that the sine and cosine of the IIR filter cutoff interpolated from
+// fluid_iir_sincos_tab match the exact values across the whole range of the table,
+// and that the filter coefficients calculated from them match the exact ones
+int main(void)
+{
+    static const fluid_real_t rates[] = { 8000, 22050, 44100, 48000, 96000, 192000 };
+    double cents, omega, max_err = 0;
+    fluid_real_t s, c;
+    unsigned int i;
+
+    // single precision builds lack the precision checked for here
+    if(sizeof(fluid_real_t) < sizeof(double))
+    {
+        return EXIT_SUCCESS;
+    }
+
+    for(cents = FLUID_IIR_CENTS_MIN; cents <= CENTS_LIMIT; cents += 0.37)
+    {
+        omega = 2.0 * M_PI * pow(2.0, cents / 1200.0);
+        fluid_iir_filter_sincos(cents, &s, &c);
+
+        max_err = fmax(max_err, fabs(s - sin(omega)));
+        max_err = fmax(max_err, fabs(c - cos(omega)));
+
+        // lowpass filters depend on 1 - cos(omega), which is tiny for low cutoffs
+        TEST_ASSERT(fabs((1.0 - c) - (1.0 - cos(omega))) <= 1e-6 * (1.0 - cos(omega)));
+    }
+
+    fluid_iir_filter_sincos(CENTS_LIMIT, &s, &c);
+    TEST_ASSERT(fabs(s - sin(2.0 * M_PI * 0.45)) < 1e-10);
+    TEST_ASSERT(fabs(c - cos(2.0 * M_PI * 0.45)) < 1e-10);
+
+    TEST_ASSERT(max_err < 1e-10);
+
+    for(i = 0; i < FLUID_N_ELEMENTS(rates); i++)
+    {
+        // cutoffs from 20 Hz to 20 kHz, including fractions of cents
+        for(cents = 1500; cents <= 13500; cents += 13.3)
+        {
+            check_coefficients(rates[i], cents, 0);
+            check_coefficients(rates[i], cents, 200);
+        }
+
+        check_coefficients(rates[i], 13500, 100);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "synth/fluid_synth.h"
+#include "synth/fluid_voice.h"
+#include "utils/fluidsynth_priv.h"
+#include "utils/fluid_sys.h"
+
+#define BUFSIZE 1024
+#define NOTES 16
+#define POLYPHONY 64
+
+// count the voices playing, except those being faded out
+static int count_playing_voices(fluid_synth_t *synth)
+{
+    int i, count = 0;
+
+    for(i = 0; i < synth->polyphony; i++)
+    {
+        if(fluid_voice_is_playing(synth->voice[i]) && !synth->voice[i]->fading)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static fluid_thread_return_t render_block(void *data)
+{
+    static float out[2 * BUFSIZE];
+
+    TEST_SUCCESS(fluid_synth_write_float((fluid_synth_t *)data, BUFSIZE, out, 0, 2, out, 1, 2));
+
+    return FLUID_THREAD_RETURN_VALUE;
+}
+
+// render blocks and pass the given CPU load to the governor after each of them. The blocks
+// are rendered by another thread while this one holds the API lock, so the governor skips
+// the load actually measured, just like it does when the API is busy.
+static void render_blocks(fluid_synth_t *synth, int blocks, float cpu_load)
+{
+    fluid_thread_t *thread;
+    int i;
+
+    for(i = 0; i < blocks; i++)
+    {
+        fluid_rec_mutex_lock(synth->mutex);
+        thread = new_fluid_thread("render", render_block, synth, 0, FALSE);
+        TEST_ASSERT(thread != NULL);
+        TEST_SUCCESS(fluid_thread_join(thread));
+        delete_fluid_thread(thread);
+        fluid_rec_mutex_unlock(synth->mutex);
+
+        fluid_synth_govern_polyphony(synth, cpu_load);
+    }
+}
+
+// check that the voices faded out by the governor are released and the first ones to be killed
+static void check_faded_voices(fluid_synth_t *synth)
+{
+    int i;
+    fluid_voice_t *voice;
+
+    for(i = 0; i < synth->polyphony; i++)
+    {
+        voice = synth->voice[i];
+
+        if(fluid_voice_is_playing(voice) && voice->fading)
+        {
+            TEST_ASSERT(!fluid_voice_is_sustained(voice));
+            TEST_ASSERT(fluid_voice_get_overflow_prio(voice, &synth->overflow, 0)
+                        == -OVERFLOW_PRIO_CANNOT_KILL);
+        }
+    }
+}
+
+// this tests that the polyphony governor lowers the voice limit while rendering is too slow,
+// fades out the voices above it and raises the limit again once the load has receded.
+// The CPU load is passed to the governor directly, so that the test doesn't depend on the speed
+// of the machine.
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    int i, limit, voices;
+    unsigned int lowered, raised, stolen;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.polyphony", POLYPHONY));
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+
+    // half of the notes are held by the sustain pedal
+    TEST_SUCCESS(fluid_synth_cc(synth, 0, SUSTAIN_SWITCH, 127));
+
+    for(i = 0; i < NOTES; i++)
+    {
+        TEST_SUCCESS(fluid_synth_noteon(synth, 0, 30 + i, 100));
+
+        if(i % 2)
+        {
+            TEST_SUCCESS(fluid_synth_noteoff(synth, 0, 30 + i));
+        }
+    }
+
+    // the governor is off by default, even under load
+    render_blocks(synth, 4, 1000);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, &lowered, &raised, &stolen));
+    TEST_ASSERT(limit == POLYPHONY);
+    TEST_ASSERT(lowered == 0 && raised == 0 && stolen == 0);
+    voices = count_playing_voices(synth);
+    TEST_ASSERT(voices >= NOTES);
+
+    // twice the target load: the limit is halved right away, and lowered further
+    // while the voices faded out still add to the load
+    TEST_SUCCESS(fluid_settings_setnum(settings, "synth.overflow.cpu-load", 50));
+    render_blocks(synth, 1, 100);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, &lowered, NULL, &stolen));
+    TEST_ASSERT(lowered == 1);
+    TEST_ASSERT(limit == (voices / 2 > GOVERNOR_MIN_VOICES ? voices / 2 : GOVERNOR_MIN_VOICES));
+    TEST_ASSERT(stolen == (unsigned int)(voices - limit));
+    TEST_ASSERT(count_playing_voices(synth) == limit);
+    check_faded_voices(synth);
+
+    render_blocks(synth, 8, 100);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, &lowered, &raised, &stolen));
+    TEST_ASSERT(limit == GOVERNOR_MIN_VOICES);
+    TEST_ASSERT(raised == 0);
+    TEST_ASSERT(stolen == (unsigned int)(voices - GOVERNOR_MIN_VOICES));
+    TEST_ASSERT(fluid_synth_get_active_voice_count(synth) == GOVERNOR_MIN_VOICES);
+    check_faded_voices(synth);
+
+    // releasing the pedal doesn't affect the faded voices
+    TEST_SUCCESS(fluid_synth_cc(synth, 0, SUSTAIN_SWITCH, 0));
+
+    // new notes take the place of the voices of least priority, voices which have
+    // just been started are protected like in any other overflow situation
+    for(i = 0; i < NOTES; i++)
+    {
+        TEST_SUCCESS(fluid_synth_noteon(synth, 1, 30 + i, 100));
+        TEST_ASSERT(count_playing_voices(synth) <= GOVERNOR_MIN_VOICES);
+        check_faded_voices(synth);
+        render_blocks(synth, 1, 100);
+    }
+
+    render_blocks(synth, 4, 100);
+    TEST_ASSERT(fluid_synth_get_active_voice_count(synth) <= GOVERNOR_MIN_VOICES);
+
+    // a load just below the target doesn't raise the limit yet
+    render_blocks(synth, 4, 40);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, NULL, &raised, NULL));
+    TEST_ASSERT(raised == 0);
+    TEST_ASSERT(limit == GOVERNOR_MIN_VOICES);
+
+    // a low load raises the limit by one eighth every period, until it is lifted
+    render_blocks(synth, 1, 10);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, NULL, &raised, NULL));
+    TEST_ASSERT(raised == 1);
+    TEST_ASSERT(limit == GOVERNOR_MIN_VOICES + GOVERNOR_MIN_VOICES / 8 + 1);
+
+    render_blocks(synth, 64, 10);
+
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, NULL, &raised, NULL));
+    TEST_ASSERT(limit == POLYPHONY);
+
+    // disabling the governor lifts its limit
+    render_blocks(synth, 1, 100);
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, NULL, NULL, NULL));
+    TEST_ASSERT(limit < POLYPHONY);
+
+    TEST_SUCCESS(fluid_settings_setnum(settings, "synth.overflow.cpu-load", 0));
+    TEST_SUCCESS(fluid_synth_get_polyphony_governor_stats(synth, &limit, NULL, NULL, NULL));
+    TEST_ASSERT(limit == POLYPHONY);
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "sfloader/fluid_sfont.h"
+#include "sfloader/fluid_defsfont.h"
+#include "utils/fluidsynth_priv.h"
+#include "utils/fluid_sys.h"
+
+static fluid_preset_t *get_preset(fluid_sfont_t *sfont, int index)
+{
+    fluid_preset_t *preset;
+
+    fluid_sfont_iteration_start(sfont);
+
+    while((preset = fluid_sfont_iteration_next(sfont)) != NULL && index-- > 0)
+    {
+    }
+
+    TEST_ASSERT(preset != NULL);
+    return preset;
+}
+
+static int is_loaded(fluid_preset_t *preset)
+{
+    return ((fluid_defpreset_t *)fluid_preset_get_data(preset))->loaded;
+}
+
+static int is_retained(fluid_preset_t *preset)
+{
+    return ((fluid_defpreset_t *)fluid_preset_get_data(preset))->retained;
+}
+
+static void select_preset(fluid_synth_t *synth, int id, fluid_preset_t *preset)
+{
+    TEST_SUCCESS(fluid_synth_program_select(synth, 0, id, fluid_preset_get_banknum(preset), fluid_preset_get_num(preset)));
+}
+
+// this tests that deselected presets keep their samples within the retention budget
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    fluid_sfont_t *sfont;
+    fluid_defsfont_t *defsfont;
+    fluid_preset_t *first, *second, *third;
+    float out[2 * 64];
+    int id, i;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 1));
+
+    // without retention, samples are unloaded as soon as the preset is deselected
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, TEST_SOUNDFONT, 0));
+    sfont = fluid_synth_get_sfont_by_id(synth, id);
+    first = get_preset(sfont, 0);
+    second = get_preset(sfont, 1);
+
+    select_preset(synth, id, first);
+    TEST_ASSERT(is_loaded(first));
+    select_preset(synth, id, second);
+    TEST_ASSERT(!is_loaded(first));
+    TEST_ASSERT(is_loaded(second));
+
+    // samples still played by a voice keep their data until the voice is done, then
+    // they are unloaded in the background, the synthesis thread doesn't unload them
+    defsfont = fluid_sfont_get_data(sfont);
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 100));
+    select_preset(synth, id, first);
+    TEST_ASSERT(!is_loaded(second));
+    TEST_ASSERT(defsfont->orphans != NULL);
+
+    TEST_SUCCESS(fluid_synth_all_sounds_off(synth, 0));
+
+    for(i = 0; i < 10 && fluid_synth_get_active_voice_count(synth) > 0; i++)
+    {
+        TEST_SUCCESS(fluid_synth_write_float(synth, 64, out, 0, 2, out, 1, 2));
+    }
+
+    TEST_ASSERT(fluid_synth_get_active_voice_count(synth) == 0);
+
+    for(i = 0; i < 100 && defsfont->orphans != NULL; i++)
+    {
+        fluid_msleep(10);
+    }
+
+    TEST_ASSERT(defsfont->orphans == NULL);
+
+    delete_fluid_synth(synth);
+
+    // with retention, they stay loaded until the budget is exceeded
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-retention", 64));
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, TEST_SOUNDFONT, 0));
+    sfont = fluid_synth_get_sfont_by_id(synth, id);
+    defsfont = fluid_sfont_get_data(sfont);
+    first = get_preset(sfont, 0);
+    second = get_preset(sfont, 1);
+    third = get_preset(sfont, 2);
+
+    select_preset(synth, id, first);
+    select_preset(synth, id, second);
+    TEST_ASSERT(is_loaded(first));
+    TEST_ASSERT(is_retained(first));
+    TEST_ASSERT(!is_retained(second));
+
+    // selecting a retained preset again takes it off the retained list
+    select_preset(synth, id, first);
+    TEST_ASSERT(!is_retained(first));
+    TEST_ASSERT(is_retained(second));
+
+    // preloading loads the samples without selecting the preset
+    TEST_ASSERT(!is_loaded(third));
+    TEST_SUCCESS(fluid_synth_preload_preset(synth, id, fluid_preset_get_banknum(third), fluid_preset_get_num(third)));
+    TEST_ASSERT(is_loaded(third));
+    TEST_ASSERT(is_retained(third));
+    TEST_ASSERT(fluid_synth_preload_preset(synth, id, 127, 127) == FLUID_FAILED);
+
+    // shrink the budget so that the next deselect exceeds it, eviction happens in the background
+    defsfont->retention_budget = 1;
+    select_preset(synth, id, third);
+
+    for(i = 0; i < 100 && (is_loaded(first) || is_loaded(second)); i++)
+    {
+        fluid_msleep(10);
+    }
+
+    TEST_ASSERT(!is_loaded(first));
+    TEST_ASSERT(!is_loaded(second));
+    TEST_ASSERT(is_loaded(third));
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
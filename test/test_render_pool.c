@@ -0,0 +1,151 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+#include "utils/fluid_sys.h"
+#include "rvoice/fluid_render_pool.h"
+
+#include <math.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 8
+#define NOTES 40
+#define SYNTHS 3
+
+static fluid_synth_t *create_synth(fluid_settings_t *settings)
+{
+    fluid_synth_t *synth = new_fluid_synth(settings);
+    int i;
+
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+
+    for(i = 0; i < NOTES; i++)
+    {
+        TEST_SUCCESS(fluid_synth_noteon(synth, 0, 40 + i, 100));
+    }
+
+    return synth;
+}
+
+static void render_block(fluid_synth_t *synth, float *out)
+{
+    TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+}
+
+typedef struct
+{
+    int helpers;
+    int done;
+} help_count_t;
+
+// keeps every pool thread helping with the job until the test is done counting them
+static void count_helper(void *data)
+{
+    help_count_t *count = data;
+
+    fluid_atomic_int_inc(&count->helpers);
+
+    while(!fluid_atomic_int_get(&count->done))
+    {
+        fluid_msleep(1);
+    }
+}
+
+// count how many pool threads help with a single job at once, waiting for up to
+// expected of them and giving one more the chance to join
+static int count_pool_threads(fluid_render_pool_t *pool, int expected)
+{
+    help_count_t count;
+    fluid_render_job_t job;
+    int i;
+
+    fluid_atomic_int_set(&count.helpers, 0);
+    fluid_atomic_int_set(&count.done, FALSE);
+
+    job.func = count_helper;
+    job.data = &count;
+    job.deadline = fluid_utime();
+    job.helpers = expected + 1;
+
+    fluid_render_pool_submit(pool, &job);
+
+    for(i = 0; i < 2000 && fluid_atomic_int_get(&count.helpers) < expected; i++)
+    {
+        fluid_msleep(1);
+    }
+
+    fluid_msleep(50);
+
+    fluid_atomic_int_set(&count.done, TRUE);
+    fluid_render_pool_withdraw(pool, &job);
+
+    return fluid_atomic_int_get(&count.helpers);
+}
+
+// this tests that synths sharing the process-wide render pool render the same as a single threaded synth
+int main(void)
+{
+    static float expected[2 * BUFSIZE], actual[2 * BUFSIZE];
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *reference, *synth[SYNTHS];
+    fluid_render_pool_t *pool;
+    int i, k, j;
+
+    TEST_ASSERT(settings != NULL);
+
+    reference = create_synth(settings);
+
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.cpu-cores", 3));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.render-pool", 1));
+
+    for(k = 0; k < SYNTHS; k++)
+    {
+        synth[k] = create_synth(settings);
+    }
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        render_block(reference, expected);
+
+        for(k = 0; k < SYNTHS; k++)
+        {
+            render_block(synth[k], actual);
+
+            // voices are summed in a different order
+            for(j = 0; j < 2 * BUFSIZE; j++)
+            {
+                TEST_ASSERT(fabs(expected[j] - actual[j]) < 1e-5);
+            }
+        }
+    }
+
+    // the pool survives synths going away
+    delete_fluid_synth(synth[0]);
+    synth[0] = create_synth(settings);
+
+    for(k = 0; k < SYNTHS; k++)
+    {
+        render_block(synth[k], actual);
+        delete_fluid_synth(synth[k]);
+    }
+
+    delete_fluid_synth(reference);
+    delete_fluid_settings(settings);
+
+    // the pool grows when a later user wants more threads than the first one
+    pool = fluid_render_pool_acquire(1, 0);
+    TEST_ASSERT(pool != NULL);
+    TEST_ASSERT(count_pool_threads(pool, 1) == 1);
+
+    TEST_ASSERT(fluid_render_pool_acquire(3, 0) == pool);
+    TEST_ASSERT(count_pool_threads(pool, 3) == 3);
+
+    TEST_ASSERT(fluid_render_pool_acquire(2, 0) == pool);
+    TEST_ASSERT(count_pool_threads(pool, 3) == 3);
+
+    fluid_render_pool_release(pool);
+    fluid_render_pool_release(pool);
+    fluid_render_pool_release(pool);
+
+    return EXIT_SUCCESS;
+}
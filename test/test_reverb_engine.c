@@ -0,0 +1,88 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <math.h>
+#include <string.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 400
+
+/* renders one block and returns the peak of the reverb output */
+static float render(fluid_synth_t *synth)
+{
+    static float out[6][BUFSIZE];
+    float *dry[2] = { out[0], out[1] }, *fx[4] = { out[2], out[3], out[4], out[5] };
+    float peak = 0;
+    int i, k;
+
+    memset(out, 0, sizeof(out));
+    TEST_SUCCESS(fluid_synth_process(synth, BUFSIZE, 4, fx, 2, dry));
+
+    for(k = 2; k < 4; k++)
+    {
+        for(i = 0; i < BUFSIZE; i++)
+        {
+            TEST_ASSERT(isfinite(out[k][i]));
+            peak = (fabs(out[k][i]) > peak) ? fabs(out[k][i]) : peak;
+        }
+    }
+
+    return peak;
+}
+
+static float render_tail(fluid_settings_t *settings, const char *engine)
+{
+    fluid_synth_t *synth;
+    float peak = 0;
+    int i;
+
+    TEST_SUCCESS(fluid_settings_setstr(settings, "synth.reverb.engine", engine));
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    TEST_SUCCESS(fluid_synth_set_reverb(synth, 0.4, 0.2, 0.5, 0.9));
+    TEST_SUCCESS(fluid_synth_cc(synth, 0, 91, 127));
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 127));
+    render(synth);
+    TEST_SUCCESS(fluid_synth_noteoff(synth, 0, 60));
+
+    for(i = 0; i < 8; i++)
+    {
+        float p = render(synth);
+        peak = (p > peak) ? p : peak;
+    }
+
+    // the tail decays until the reverb falls asleep
+    for(i = 0; i < BLOCKS; i++)
+    {
+        render(synth);
+    }
+
+    TEST_ASSERT(render(synth) == 0);
+
+    delete_fluid_synth(synth);
+
+    return peak;
+}
+
+// this tests that the lite reverb engine works with the regular reverb parameters
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    float fdn, lite;
+
+    TEST_ASSERT(settings != NULL);
+
+    fdn = render_tail(settings, "fdn");
+    lite = render_tail(settings, "lite");
+
+    // both reverbs are audible at a comparable level
+    TEST_ASSERT(fdn > 0 && lite > 0);
+    TEST_ASSERT(lite > fdn / 4 && lite < fdn * 4);
+
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
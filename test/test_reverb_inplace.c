@@ -0,0 +1,105 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+/* Build the scalar reference implementation of the reverb next to the one of the library,
+ * its public functions get their own names */
+#define FDN_SCALAR_REFERENCE
+#define new_fluid_revmodel ref_new_fluid_revmodel
+#define delete_fluid_revmodel ref_delete_fluid_revmodel
+#define fluid_revmodel_processmix ref_fluid_revmodel_processmix
+#define fluid_revmodel_processreplace ref_fluid_revmodel_processreplace
+#define fluid_revmodel_reset ref_fluid_revmodel_reset
+#define fluid_revmodel_set ref_fluid_revmodel_set
+#define fluid_revmodel_samplerate_change ref_fluid_revmodel_samplerate_change
+#include "rvoice/fluid_rev.c"
+#undef new_fluid_revmodel
+#undef delete_fluid_revmodel
+#undef fluid_revmodel_processmix
+#undef fluid_revmodel_processreplace
+#undef fluid_revmodel_reset
+#undef fluid_revmodel_set
+#undef fluid_revmodel_samplerate_change
+
+fluid_revmodel_t *new_fluid_revmodel(fluid_real_t sample_rate, int engine);
+void delete_fluid_revmodel(fluid_revmodel_t *rev);
+void fluid_revmodel_processmix(fluid_revmodel_t *rev, const fluid_real_t *in,
+                               fluid_real_t *left_out, fluid_real_t *right_out, int count);
+void fluid_revmodel_processreplace(fluid_revmodel_t *rev, const fluid_real_t *in,
+                                   fluid_real_t *left_out, fluid_real_t *right_out, int count);
+void fluid_revmodel_set(fluid_revmodel_t *rev, int set, fluid_real_t roomsize,
+                        fluid_real_t damping, fluid_real_t width, fluid_real_t level);
+
+#define BLOCK 64
+#define BLOCKS 200
+
+static fluid_real_t input(int i)
+{
+    /* a few short bursts, followed by silence */
+    if(i < BLOCK * BLOCKS / 2 && (i / 500) % 4 == 0)
+    {
+        return (fluid_real_t)(((i * 7919) % 2001) - 1000) / 2000.0;
+    }
+
+    return 0;
+}
+
+// this tests that the reverb gives the same output as its scalar reference implementation,
+// when it writes the left output to the buffer it reads its input from (like fluid_synth_process()
+// does with fx buffers in replace mode), and when it adds to it (mix mode)
+int main(void)
+{
+    static fluid_real_t expected_l[BLOCK], expected_r[BLOCK], ref_in[BLOCK];
+    static fluid_real_t actual_l[BLOCK], actual_r[BLOCK];
+    fluid_revmodel_t *rev, *ref;
+    int mix, i, k;
+
+    for(mix = 0; mix < 2; mix++)
+    {
+        rev = new_fluid_revmodel(44100, FLUID_REVMODEL_FDN);
+        ref = ref_new_fluid_revmodel(44100, FLUID_REVMODEL_FDN);
+        TEST_ASSERT(rev != NULL && ref != NULL);
+
+        fluid_revmodel_set(rev, FLUID_REVMODEL_SET_ALL, 0.8, 0.6, 0.5, 0.9);
+        ref_fluid_revmodel_set(ref, FLUID_REVMODEL_SET_ALL, 0.8, 0.6, 0.5, 0.9);
+
+        for(k = 0; k < BLOCKS; k++)
+        {
+            for(i = 0; i < BLOCK; i++)
+            {
+                ref_in[i] = input(k * BLOCK + i);
+                expected_l[i] = expected_r[i] = mix ? 0.25 : 0;
+                actual_l[i] = ref_in[i];
+                actual_r[i] = mix ? 0.25 : 0;
+            }
+
+            if(mix)
+            {
+                ref_fluid_revmodel_processmix(ref, ref_in, expected_l, expected_r, BLOCK);
+
+                for(i = 0; i < BLOCK; i++)
+                {
+                    expected_l[i] += ref_in[i] - 0.25;
+                }
+
+                fluid_revmodel_processmix(rev, actual_l, actual_l, actual_r, BLOCK);
+            }
+            else
+            {
+                ref_fluid_revmodel_processreplace(ref, ref_in, expected_l, expected_r, BLOCK);
+                fluid_revmodel_processreplace(rev, actual_l, actual_l, actual_r, BLOCK);
+            }
+
+            for(i = 0; i < BLOCK; i++)
+            {
+                TEST_ASSERT(fabs(actual_l[i] - expected_l[i]) < 1e-12);
+                TEST_ASSERT(fabs(actual_r[i] - expected_r[i]) < 1e-12);
+            }
+        }
+
+        delete_fluid_revmodel(rev);
+        ref_delete_fluid_revmodel(ref);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,8 +1,163 @@
 
 #include "test.h"
+#include "test_sfont_builder.h"
 #include "fluidsynth.h" // use local fluidsynth header
 #include "utils/fluidsynth_priv.h"
 
+#define SFONT_COPY "test_sample_cache.sf2"
+#define SFONT_FIRST "test_sample_cache_first.sf2"
+#define SFONT_SECOND "test_sample_cache_second.sf2"
+
+#define SAMPLE_LEN 1000
+#define SAMPLE_PAD 46
+
+static void copy_file(const char *src, const char *dest)
+{
+    char buf[4096];
+    size_t n;
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dest, "wb");
+
+    TEST_ASSERT(in != NULL);
+    TEST_ASSERT(out != NULL);
+
+    while((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        TEST_ASSERT(fwrite(buf, 1, n, out) == n);
+    }
+
+    fclose(in);
+    fclose(out);
+}
+
+static void put_sample_header(sfont_buf_t *buf, const char *name, unsigned int start)
+{
+    put_name(buf, name, 20);
+    put32(buf, start);
+    put32(buf, start + SAMPLE_LEN);
+    put32(buf, start + 100);
+    put32(buf, start + SAMPLE_LEN - 100);
+    put32(buf, 44100);
+    put8(buf, 60);
+    put8(buf, 0);
+    put16(buf, 0);
+    put16(buf, FLUID_SAMPLETYPE_MONO);
+}
+
+/* Write a SoundFont with a single preset playing the same sample data in both files.
+ * With other_first set, the sample chunk starts with a different sample, so that the
+ * shared data is found at another offset. */
+static void write_sfont(const char *filename, int other_first)
+{
+    sfont_buf_t buf = { NULL, 0, 0 };
+    int riff, list, chunk, i, k;
+
+    riff = begin_chunk(&buf, "RIFF", "sfbk");
+
+    list = begin_chunk(&buf, "LIST", "INFO");
+    chunk = begin_chunk(&buf, "ifil", NULL);
+    put16(&buf, 2);
+    put16(&buf, 1);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "isng", NULL);
+    put_name(&buf, "EMU8000", 8);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "INAM", NULL);
+    put_name(&buf, "dedup", 8);
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "sdta");
+    chunk = begin_chunk(&buf, "smpl", NULL);
+
+    for(k = other_first ? 0 : 1; k < 2; k++)
+    {
+        for(i = 0; i < SAMPLE_LEN + SAMPLE_PAD; i++)
+        {
+            put16(&buf, i >= SAMPLE_LEN ? 0 : k == 0 ? (i % 7) * 3000 : ((i % 40) - 20) * 1000);
+        }
+    }
+
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "pdta");
+
+    chunk = begin_chunk(&buf, "phdr", NULL);
+    put_name(&buf, "shared", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put_name(&buf, "EOP", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pbag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pmod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pgen", NULL);
+    put16(&buf, GEN_INSTRUMENT);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "inst", NULL);
+    put_name(&buf, "shared", 20);
+    put16(&buf, 0);
+    put_name(&buf, "EOI", 20);
+    put16(&buf, 1);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "ibag", NULL);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 1);
+    put16(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "imod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    // the shared sample is always the last one
+    chunk = begin_chunk(&buf, "igen", NULL);
+    put16(&buf, GEN_SAMPLEID);
+    put16(&buf, other_first ? 1 : 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "shdr", NULL);
+
+    if(other_first)
+    {
+        put_sample_header(&buf, "other", 0);
+    }
+
+    put_sample_header(&buf, "shared", other_first ? SAMPLE_LEN + SAMPLE_PAD : 0);
+    put_name(&buf, "EOS", 46);
+    end_chunk(&buf, chunk);
+
+    end_chunk(&buf, list);
+    end_chunk(&buf, riff);
+
+    save_sfont(&buf, filename);
+}
 
 // this test aims to make sure that sample data used by multiple synths is not freed
 // once unloaded by its parent synth
@@ -36,6 +191,169 @@ int main(void)
     TEST_SUCCESS(fluid_synth_write_float(synth2, FRAMES, buf, 0, 2, buf, 1, 2));
 
     delete_fluid_synth(synth2);
+
+    // with a cache budget, unused sample data must stay resident and be reused on reload
+    {
+        unsigned int hits, misses, evictions, misses_before;
+        size_t resident, unused;
+        int id;
+
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.sample-cache-size", 64));
+        synth1 = new_fluid_synth(settings);
+        TEST_ASSERT(synth1 != NULL);
+
+        id = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1);
+        TEST_SUCCESS(id);
+        TEST_SUCCESS(fluid_synth_sfunload(synth1, id, 1));
+
+        TEST_SUCCESS(fluid_samplecache_get_stats(&hits, &misses, &evictions, &resident, &unused));
+        TEST_ASSERT(resident > 0);
+        TEST_ASSERT(unused == resident);
+        misses_before = misses;
+
+        TEST_SUCCESS(fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1));
+
+        TEST_SUCCESS(fluid_samplecache_get_stats(&hits, &misses, &evictions, &resident, &unused));
+        TEST_ASSERT(misses == misses_before);
+        TEST_ASSERT(hits > 0);
+        TEST_ASSERT(unused == 0);
+
+        delete_fluid_synth(synth1);
+
+        // the budget is process-wide, a synth with default settings leaves it alone
+        {
+            fluid_settings_t *defaults = new_fluid_settings();
+
+            TEST_ASSERT(defaults != NULL);
+            synth2 = new_fluid_synth(defaults);
+            TEST_ASSERT(synth2 != NULL);
+            TEST_SUCCESS(fluid_synth_sfload(synth2, TEST_SOUNDFONT, 1));
+            delete_fluid_synth(synth2);
+            delete_fluid_settings(defaults);
+
+            TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, &unused));
+            TEST_ASSERT(resident > 0);
+            TEST_ASSERT(unused == resident);
+        }
+
+        // shrinking the budget evicts everything that is unused
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.sample-cache-size", 0));
+        synth1 = new_fluid_synth(settings);
+        id = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1);
+        TEST_SUCCESS(id);
+        TEST_SUCCESS(fluid_synth_sfunload(synth1, id, 1));
+
+        TEST_SUCCESS(fluid_samplecache_get_stats(&hits, &misses, &evictions, &resident, &unused));
+        TEST_ASSERT(resident == 0);
+        TEST_ASSERT(evictions > 0);
+
+        delete_fluid_synth(synth1);
+    }
+
+    // with deduplication, a copy of a soundfont does not need any additional sample memory
+    {
+        unsigned int shared;
+        size_t saved, resident, resident_single;
+        int id, id_orig;
+
+        copy_file(TEST_SOUNDFONT, SFONT_COPY);
+
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.sample-cache-dedup", 1));
+        synth1 = new_fluid_synth(settings);
+        TEST_ASSERT(synth1 != NULL);
+
+        TEST_SUCCESS(id_orig = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1));
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident_single, NULL));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(shared == 0);
+        TEST_ASSERT(saved == 0);
+
+        TEST_SUCCESS(id = fluid_synth_sfload(synth1, SFONT_COPY, 1));
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, NULL));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(resident == resident_single);
+        TEST_ASSERT(shared == 1);
+        TEST_ASSERT(saved == resident);
+
+        // the copy plays from the shared data
+        TEST_SUCCESS(fluid_synth_noteon(synth1, 0, 60, 127));
+        TEST_SUCCESS(fluid_synth_write_float(synth1, FRAMES, buf, 0, 2, buf, 1, 2));
+        TEST_SUCCESS(fluid_synth_all_sounds_off(synth1, -1));
+        TEST_SUCCESS(fluid_synth_write_float(synth1, FRAMES, buf, 0, 2, buf, 1, 2));
+
+        // the data stays resident as long as any soundfont uses it
+        TEST_SUCCESS(fluid_synth_sfunload(synth1, id, 1));
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, NULL));
+        TEST_ASSERT(resident == resident_single);
+
+        TEST_SUCCESS(fluid_synth_sfunload(synth1, id_orig, 1));
+        delete_fluid_synth(synth1);
+
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, NULL));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(resident == 0);
+        TEST_ASSERT(shared == 0);
+        TEST_ASSERT(saved == 0);
+
+        remove(SFONT_COPY);
+    }
+
+    // with dynamic sample loading, samples are cached one by one, so identical samples are
+    // shared even when they are found at different offsets of different soundfonts
+    {
+        unsigned int shared;
+        size_t saved, resident, resident_single;
+        int id_first, id_second;
+
+        write_sfont(SFONT_FIRST, FALSE);
+        write_sfont(SFONT_SECOND, TRUE);
+
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 1));
+        synth1 = new_fluid_synth(settings);
+        TEST_ASSERT(synth1 != NULL);
+
+        TEST_SUCCESS(id_first = fluid_synth_sfload(synth1, SFONT_FIRST, 0));
+        TEST_SUCCESS(id_second = fluid_synth_sfload(synth1, SFONT_SECOND, 0));
+
+        TEST_SUCCESS(fluid_synth_program_select(synth1, 0, id_first, 0, 0));
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident_single, NULL));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(resident_single >= SAMPLE_LEN * sizeof(short));
+        TEST_ASSERT(shared == 0);
+
+        TEST_SUCCESS(fluid_synth_program_select(synth1, 1, id_second, 0, 0));
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, NULL));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(resident == resident_single);
+        TEST_ASSERT(shared == 1);
+        TEST_ASSERT(saved == resident_single);
+
+        TEST_SUCCESS(fluid_synth_noteon(synth1, 1, 60, 127));
+        TEST_SUCCESS(fluid_synth_write_float(synth1, FRAMES, buf, 0, 2, buf, 1, 2));
+        TEST_SUCCESS(fluid_synth_all_sounds_off(synth1, -1));
+        TEST_SUCCESS(fluid_synth_write_float(synth1, FRAMES, buf, 0, 2, buf, 1, 2));
+
+        delete_fluid_synth(synth1);
+
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(shared == 0);
+
+        // without it, each soundfont's sample chunk is cached as a whole and the chunks differ
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 0));
+        synth1 = new_fluid_synth(settings);
+        TEST_ASSERT(synth1 != NULL);
+
+        TEST_SUCCESS(fluid_synth_sfload(synth1, SFONT_FIRST, 1));
+        TEST_SUCCESS(fluid_synth_sfload(synth1, SFONT_SECOND, 1));
+        TEST_SUCCESS(fluid_samplecache_get_dedup_stats(&shared, &saved));
+        TEST_ASSERT(shared == 0);
+
+        delete_fluid_synth(synth1);
+
+        remove(SFONT_FIRST);
+        remove(SFONT_SECOND);
+    }
+
     delete_fluid_settings(settings);
 
     return EXIT_SUCCESS;
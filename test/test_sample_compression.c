@@ -0,0 +1,120 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#define BUFSIZE 1024
+#define BLOCKS 64
+
+/* Render some notes, with late set the sample storage is only selected after creating the synth */
+static void render(const char *storage, int late, int interp_method, float *out)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    size_t plain_bytes, compressed_bytes;
+    unsigned int voices;
+    int i, id;
+
+    TEST_ASSERT(settings != NULL);
+
+    if(!late)
+    {
+        TEST_SUCCESS(fluid_settings_setstr(settings, "synth.sample-storage", storage));
+    }
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+
+    if(late)
+    {
+        TEST_SUCCESS(fluid_settings_setstr(settings, "synth.sample-storage", storage));
+    }
+
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    TEST_SUCCESS(fluid_synth_set_interp_method(synth, -1, interp_method));
+
+    TEST_SUCCESS(fluid_get_sample_compression_stats(&plain_bytes, &compressed_bytes));
+
+    if(FLUID_STRCMP(storage, "compressed") == 0)
+    {
+        TEST_ASSERT(compressed_bytes > 0 && compressed_bytes < plain_bytes);
+    }
+    else
+    {
+        TEST_ASSERT(plain_bytes == 0 && compressed_bytes == 0);
+    }
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 48, 100));
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 67, 90));
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 96, 110));
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, &out[2 * BUFSIZE * i], 0, 2,
+                                             &out[2 * BUFSIZE * i], 1, 2));
+    }
+
+    TEST_SUCCESS(fluid_synth_all_sounds_off(synth, -1));
+    TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+    TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+
+    TEST_SUCCESS(fluid_synth_get_sample_decode_stats(synth, &voices, NULL, NULL));
+    TEST_ASSERT((voices > 0) == (FLUID_STRCMP(storage, "compressed") == 0));
+
+    TEST_SUCCESS(fluid_synth_sfunload(synth, id, 0));
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    // compressed sample data is released along with the soundfont
+    TEST_SUCCESS(fluid_get_sample_compression_stats(&plain_bytes, &compressed_bytes));
+    TEST_ASSERT(plain_bytes == 0 && compressed_bytes == 0);
+}
+
+// this tests that compressed sample storage renders exactly like plain sample storage
+int main(void)
+{
+    static float plain[2 * BUFSIZE * BLOCKS], compressed[2 * BUFSIZE * BLOCKS];
+    static const int interp_methods[] =
+    {
+        FLUID_INTERP_NONE, FLUID_INTERP_LINEAR, FLUID_INTERP_4THORDER, FLUID_INTERP_7THORDER
+    };
+    unsigned int i;
+
+    // each interpolation method has its own routines for plain and compressed sample data
+    for(i = 0; i < sizeof(interp_methods) / sizeof(interp_methods[0]); i++)
+    {
+        render("plain", FALSE, interp_methods[i], plain);
+        render("compressed", FALSE, interp_methods[i], compressed);
+
+        // the first buffer is overwritten when releasing the voices
+        TEST_ASSERT(FLUID_MEMCMP(&plain[2 * BUFSIZE], &compressed[2 * BUFSIZE],
+                                 sizeof(plain) - 2 * BUFSIZE * sizeof(float)) == 0);
+
+        // switching to compressed storage after creating the synth works just as well
+        render("compressed", TRUE, interp_methods[i], compressed);
+        TEST_ASSERT(FLUID_MEMCMP(&plain[2 * BUFSIZE], &compressed[2 * BUFSIZE],
+                                 sizeof(plain) - 2 * BUFSIZE * sizeof(float)) == 0);
+    }
+
+    // with a sample cache budget, the uncompressed data is not retained in the cache
+    {
+        fluid_settings_t *settings = new_fluid_settings();
+        fluid_synth_t *synth;
+        size_t resident, unused;
+
+        TEST_ASSERT(settings != NULL);
+        TEST_SUCCESS(fluid_settings_setint(settings, "synth.sample-cache-size", 64));
+        TEST_SUCCESS(fluid_settings_setstr(settings, "synth.sample-storage", "compressed"));
+
+        synth = new_fluid_synth(settings);
+        TEST_ASSERT(synth != NULL);
+        TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+
+        TEST_SUCCESS(fluid_samplecache_get_stats(NULL, NULL, NULL, &resident, &unused));
+        TEST_ASSERT(resident == 0 && unused == 0);
+
+        delete_fluid_synth(synth);
+        delete_fluid_settings(settings);
+    }
+
+    return EXIT_SUCCESS;
+}
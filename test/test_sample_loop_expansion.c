@@ -0,0 +1,102 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "synth/fluid_synth.h"
+#include "synth/fluid_voice.h"
+#include "rvoice/fluid_rvoice.h"
+#include "utils/fluidsynth_priv.h"
+
+#define BUFSIZE 1024
+#define BLOCKS 48
+#define CHANNELS 16
+
+/* see fluid_defsfont.c */
+#define SHORT_LOOP_MIN_LENGTH (8 * FLUID_BUFSIZE)
+
+static int count_expanded_loops(fluid_synth_t *synth)
+{
+    int i, count = 0;
+
+    for(i = 0; i < synth->polyphony; i++)
+    {
+        if(fluid_voice_is_playing(synth->voice[i]) && synth->voice[i]->rvoice->dsp.expanded_loop)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void render(int dynamic_samples, float *out, int *expanded)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    unsigned int samples;
+    size_t bytes;
+    int i, chan;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", dynamic_samples));
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+
+    // each copy holds just the loop, repeated to less than twice the minimum length
+    TEST_SUCCESS(fluid_get_sample_loop_expansion_stats(&samples, &bytes));
+    TEST_ASSERT(dynamic_samples ? samples == 0 : samples > 0);
+    TEST_ASSERT(bytes <= samples * 2 * SHORT_LOOP_MIN_LENGTH * sizeof(short));
+
+    for(chan = 0; chan < CHANNELS; chan++)
+    {
+        TEST_SUCCESS(fluid_synth_program_change(synth, chan, chan));
+        TEST_SUCCESS(fluid_synth_noteon(synth, chan, 60 + 2 * chan, 100));
+    }
+
+    *expanded = 0;
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        // move the loop of a playing voice, release all voices later on
+        if(i == BLOCKS / 4)
+        {
+            TEST_SUCCESS(fluid_synth_set_gen(synth, 1, GEN_ENDLOOPADDROFS, -2));
+        }
+        else if(i == BLOCKS / 2)
+        {
+            // voices of unlooped samples may have finished already
+            for(chan = 0; chan < CHANNELS; chan++)
+            {
+                fluid_synth_noteoff(synth, chan, 60 + 2 * chan);
+            }
+        }
+
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, &out[2 * BUFSIZE * i], 0, 2,
+                                             &out[2 * BUFSIZE * i], 1, 2));
+
+        *expanded += count_expanded_loops(synth);
+    }
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    TEST_SUCCESS(fluid_get_sample_loop_expansion_stats(&samples, &bytes));
+    TEST_ASSERT(samples == 0 && bytes == 0);
+}
+
+// this tests that voices playing the expanded copy of short sample loops render exactly like the original loops
+int main(void)
+{
+    static float expected[2 * BUFSIZE * BLOCKS], actual[2 * BUFSIZE * BLOCKS];
+    int expected_expanded, actual_expanded;
+
+    // samples loaded on demand keep their loops as they are
+    render(TRUE, expected, &expected_expanded);
+    render(FALSE, actual, &actual_expanded);
+
+    TEST_ASSERT(expected_expanded == 0);
+    TEST_ASSERT(actual_expanded > 0);
+    TEST_ASSERT(FLUID_MEMCMP(expected, actual, sizeof(expected)) == 0);
+
+    return EXIT_SUCCESS;
+}
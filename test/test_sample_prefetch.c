@@ -0,0 +1,136 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "sfloader/fluid_sfont.h"
+#include "sfloader/fluid_defsfont.h"
+#include "midi/fluid_midi.h"
+#include "utils/fluidsynth_priv.h"
+#include "utils/fluid_sys.h"
+
+#define BUFSIZE 1024
+
+/* A format 0 MIDI file with 480 ticks per quarter note at the default tempo (about 1 msec
+ * per tick), selecting bank 1 on channel 0 at tick 2000 and program 1 at tick 2100 */
+static const unsigned char midi_file[] =
+{
+    'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0x01, 0xe0,
+    'M', 'T', 'r', 'k', 0, 0, 0, 15,
+    0x00, 0xc0, 0x00,
+    0x8f, 0x50, 0xb0, 0x00, 0x01,
+    0x64, 0xc0, 0x01,
+    0x00, 0xff, 0x2f, 0x00
+};
+
+static int is_loaded(fluid_preset_t *preset)
+{
+    return ((fluid_defpreset_t *)fluid_preset_get_data(preset))->loaded;
+}
+
+static void render_msec(fluid_synth_t *synth, int msec)
+{
+    static float out[2 * BUFSIZE];
+    int i;
+
+    for(i = 0; i < msec * 44100 / 1000 / BUFSIZE; i++)
+    {
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, out, 0, 2, out, 1, 2));
+    }
+}
+
+// this tests that program changes scheduled on the sequencer load their samples ahead of time
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    fluid_sequencer_t *seq;
+    fluid_player_t *player;
+    fluid_seq_id_t seqid;
+    fluid_event_t *evt;
+    fluid_sfont_t *sfont;
+    fluid_preset_t *near, *far;
+    int id, i;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 1));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-retention", 64));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.prefetch-window", 1000));
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, TEST_SOUNDFONT, 0));
+    sfont = fluid_synth_get_sfont_by_id(synth, id);
+
+    fluid_sfont_iteration_start(sfont);
+    near = fluid_sfont_iteration_next(sfont);
+    far = fluid_sfont_iteration_next(sfont);
+    TEST_ASSERT(near != NULL && far != NULL);
+    TEST_ASSERT(!is_loaded(near));
+    TEST_ASSERT(!is_loaded(far));
+
+    seq = new_fluid_sequencer2(FALSE);
+    TEST_ASSERT(seq != NULL);
+    TEST_SUCCESS(seqid = fluid_sequencer_register_fluidsynth(seq, synth));
+
+    evt = new_fluid_event();
+    fluid_event_set_source(evt, -1);
+    fluid_event_set_dest(evt, seqid);
+
+    // only the program change within the window is prefetched
+    fluid_event_program_select(evt, 0, id, fluid_preset_get_banknum(near), fluid_preset_get_num(near));
+    TEST_SUCCESS(fluid_sequencer_send_at(seq, evt, 500, FALSE));
+    fluid_event_program_select(evt, 1, id, fluid_preset_get_banknum(far), fluid_preset_get_num(far));
+    TEST_SUCCESS(fluid_sequencer_send_at(seq, evt, 5000, FALSE));
+
+    for(i = 0; i < 100 && !is_loaded(near); i++)
+    {
+        fluid_msleep(10);
+    }
+
+    TEST_ASSERT(is_loaded(near));
+    TEST_ASSERT(!is_loaded(far));
+
+    // the far one is prefetched as soon as it enters the window while time advances
+    render_msec(synth, 3900);
+    fluid_msleep(50);
+    TEST_ASSERT(fluid_sequencer_get_tick(seq) < 4000);
+    TEST_ASSERT(!is_loaded(far));
+
+    render_msec(synth, 300);
+
+    for(i = 0; i < 100 && !is_loaded(far); i++)
+    {
+        fluid_msleep(10);
+    }
+
+    TEST_ASSERT(fluid_sequencer_get_tick(seq) < 5000);
+    TEST_ASSERT(is_loaded(far));
+
+    fluid_event_unregistering(evt);
+    fluid_sequencer_send_now(seq, evt);
+    delete_fluid_event(evt);
+    delete_fluid_sequencer(seq);
+
+    // the lookahead of the MIDI player starts over when seeking, without the bank
+    // selects it has seen ahead of the previous playback position
+    TEST_SUCCESS(fluid_settings_setstr(settings, "player.timing-source", "sample"));
+    player = new_fluid_player(synth);
+    TEST_ASSERT(player != NULL);
+    TEST_SUCCESS(fluid_player_add_mem(player, midi_file, sizeof(midi_file)));
+    TEST_SUCCESS(fluid_player_play(player));
+
+    render_msec(synth, 1500);
+    TEST_ASSERT(player->prefetch_bank_msb[0] == 1);
+    TEST_ASSERT(player->track[0]->prefetch_cur != player->track[0]->cur);
+
+    TEST_SUCCESS(fluid_player_seek(player, 0));
+    render_msec(synth, 50);
+    TEST_ASSERT(player->prefetch_bank_msb[0] == -1);
+    TEST_ASSERT(player->track[0]->prefetch_ticks < 2000);
+
+    TEST_SUCCESS(fluid_player_stop(player));
+    delete_fluid_player(player);
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
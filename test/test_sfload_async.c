@@ -0,0 +1,97 @@
+
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+#include "synth/fluid_synth.h"
+
+static int progress_calls;
+static unsigned int last_done, last_total;
+
+static int count_progress(void *data, int sfont_id, fluid_long_long_t done, fluid_long_long_t total)
+{
+    progress_calls++;
+    last_done = done;
+    last_total = total;
+    return FLUID_OK;
+}
+
+static int cancel_progress(void *data, int sfont_id, fluid_long_long_t done, fluid_long_long_t total)
+{
+    return FLUID_FAILED;
+}
+
+// this tests loading soundfonts on a background thread with fluid_synth_sfload_async()
+int main(void)
+{
+    int id, count;
+    fluid_cmd_handler_t *handler;
+
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth = new_fluid_synth(settings);
+
+    TEST_ASSERT(settings != NULL);
+    TEST_ASSERT(synth != NULL);
+
+    // load a sfont in the background and wait for it
+    TEST_SUCCESS(id = fluid_synth_sfload_async(synth, TEST_SOUNDFONT, 1, count_progress, NULL));
+    TEST_ASSERT(fluid_synth_sfload_wait(synth, id) == id);
+    TEST_ASSERT(fluid_synth_sfcount(synth) == 1);
+    TEST_ASSERT(fluid_synth_get_sfont_by_id(synth, id) != NULL);
+
+    // the sample data has been reported completely
+    TEST_ASSERT(progress_calls > 0);
+    TEST_ASSERT(last_total > 0);
+    TEST_ASSERT(last_done == last_total);
+
+    // the job is gone after waiting for it
+    TEST_ASSERT(fluid_synth_sfload_wait(synth, id) == FLUID_FAILED);
+    TEST_ASSERT(fluid_synth_sfload_cancel(synth, id) == FLUID_FAILED);
+
+    // a load cancelled by the progress callback never shows up in the synth
+    TEST_SUCCESS(id = fluid_synth_sfload_async(synth, TEST_SOUNDFONT, 1, cancel_progress, NULL));
+    TEST_ASSERT(fluid_synth_sfload_wait(synth, id) == FLUID_FAILED);
+    TEST_ASSERT(fluid_synth_sfcount(synth) == 1);
+    TEST_ASSERT(fluid_synth_get_sfont_by_id(synth, id) == NULL);
+
+    // explicitly cancelled loads don't either, unless they have been added already
+    TEST_SUCCESS(id = fluid_synth_sfload_async(synth, TEST_SOUNDFONT, 1, NULL, NULL));
+
+    if(fluid_synth_sfload_cancel(synth, id) == FLUID_OK)
+    {
+        TEST_ASSERT(fluid_synth_sfload_wait(synth, id) == FLUID_FAILED);
+        TEST_ASSERT(fluid_synth_get_sfont_by_id(synth, id) == NULL);
+    }
+    else
+    {
+        TEST_ASSERT(fluid_synth_sfload_wait(synth, id) == id);
+        TEST_ASSERT(fluid_synth_get_sfont_by_id(synth, id) != NULL);
+    }
+
+    // the shell loads in the background as well, and waits for the result
+    handler = new_fluid_cmd_handler(synth, NULL);
+    TEST_ASSERT(handler != NULL);
+    count = fluid_synth_sfcount(synth);
+    TEST_SUCCESS(fluid_command(handler, "load " TEST_SOUNDFONT, 1));
+    TEST_ASSERT(fluid_synth_sfcount(synth) == count + 1);
+    TEST_ASSERT(synth->sfload_jobs == NULL);
+    delete_fluid_cmd_handler(handler);
+
+    // loads still running on deletion are cleaned up
+    TEST_SUCCESS(fluid_synth_sfload_async(synth, TEST_SOUNDFONT, 1, NULL, NULL));
+
+    delete_fluid_synth(synth);
+
+    // without a thread safe API, the shell falls back to loading synchronously
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.threadsafe-api", 0));
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+    handler = new_fluid_cmd_handler(synth, NULL);
+    TEST_ASSERT(handler != NULL);
+    TEST_SUCCESS(fluid_command(handler, "load " TEST_SOUNDFONT, 1));
+    TEST_ASSERT(fluid_synth_sfcount(synth) == 1);
+    delete_fluid_cmd_handler(handler);
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
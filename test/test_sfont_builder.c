@@ -0,0 +1,105 @@
+#include "test.h"
+#include "test_sfont_builder.h"
+#include "utils/fluidsynth_priv.h"
+
+static void reserve(sfont_buf_t *buf, int len)
+{
+    unsigned char *data;
+    int capacity = buf->capacity > 0 ? buf->capacity : 4096;
+
+    if(buf->size + len <= buf->capacity)
+    {
+        return;
+    }
+
+    while(capacity < buf->size + len)
+    {
+        capacity *= 2;
+    }
+
+    data = realloc(buf->data, capacity);
+    TEST_ASSERT(data != NULL);
+
+    buf->data = data;
+    buf->capacity = capacity;
+}
+
+void put8(sfont_buf_t *buf, int value)
+{
+    reserve(buf, 1);
+    buf->data[buf->size++] = value & 0xff;
+}
+
+void put16(sfont_buf_t *buf, int value)
+{
+    put8(buf, value);
+    put8(buf, value >> 8);
+}
+
+void put32(sfont_buf_t *buf, unsigned int value)
+{
+    put16(buf, value & 0xffff);
+    put16(buf, value >> 16);
+}
+
+/* Write id as a zero padded field of len bytes */
+void put_name(sfont_buf_t *buf, const char *id, int len)
+{
+    int i, end = FALSE;
+
+    reserve(buf, len);
+
+    for(i = 0; i < len; i++)
+    {
+        end = end || id[i] == '\0';
+        buf->data[buf->size++] = end ? 0 : id[i];
+    }
+}
+
+void put_gen(sfont_buf_t *buf, int gen, int amount)
+{
+    put16(buf, gen);
+    put16(buf, amount);
+}
+
+/* Start a chunk, returns the position of its size field to be passed to end_chunk() */
+int begin_chunk(sfont_buf_t *buf, const char *id, const char *list_id)
+{
+    int pos;
+
+    put_name(buf, id, 4);
+    pos = buf->size;
+    put32(buf, 0);
+
+    if(list_id != NULL)
+    {
+        put_name(buf, list_id, 4);
+    }
+
+    return pos;
+}
+
+void end_chunk(sfont_buf_t *buf, int pos)
+{
+    int size = buf->size;
+    unsigned int len = size - pos - 4;
+
+    buf->size = pos;
+    put32(buf, len);
+    buf->size = size;
+}
+
+/* Write the buffer to filename and free it, so that it can be used for the next SoundFont */
+void save_sfont(sfont_buf_t *buf, const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+
+    TEST_ASSERT(file != NULL);
+    TEST_ASSERT(fwrite(buf->data, 1, buf->size, file) == (size_t)buf->size);
+    fclose(file);
+
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
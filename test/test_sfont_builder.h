@@ -0,0 +1,21 @@
+#pragma once
+
+/* Helpers to write small SoundFont files for the tests, chunk by chunk into a growing buffer */
+
+typedef struct
+{
+    unsigned char *data;
+    int size;
+    int capacity;
+} sfont_buf_t;
+
+void put8(sfont_buf_t *buf, int value);
+void put16(sfont_buf_t *buf, int value);
+void put32(sfont_buf_t *buf, unsigned int value);
+void put_name(sfont_buf_t *buf, const char *id, int len);
+void put_gen(sfont_buf_t *buf, int gen, int amount);
+
+int begin_chunk(sfont_buf_t *buf, const char *id, const char *list_id);
+void end_chunk(sfont_buf_t *buf, int pos);
+
+void save_sfont(sfont_buf_t *buf, const char *filename);
@@ -0,0 +1,184 @@
+#include "test.h"
+#include "test_sfont_builder.h"
+#include "fluidsynth.h"
+#include "sfloader/fluid_sfont.h"
+#include "sfloader/fluid_sffile.h"
+#include "utils/fluidsynth_priv.h"
+
+#define SFONT "test_sfont_global_zone.sf2"
+
+#define SAMPLE_LEN 1000
+#define SAMPLE_PAD 46
+
+static void put_bag(sfont_buf_t *buf, int gen_index)
+{
+    put16(buf, gen_index);
+    put16(buf, 0);
+}
+
+/* Write a SoundFont whose preset and instrument have a global zone which is not their first zone.
+ * The instrument has a second global zone following it. */
+static void write_sfont(const char *filename)
+{
+    sfont_buf_t buf = { NULL, 0, 0 };
+    int riff, list, chunk, i;
+
+    riff = begin_chunk(&buf, "RIFF", "sfbk");
+
+    list = begin_chunk(&buf, "LIST", "INFO");
+    chunk = begin_chunk(&buf, "ifil", NULL);
+    put16(&buf, 2);
+    put16(&buf, 1);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "isng", NULL);
+    put_name(&buf, "EMU8000", 8);
+    end_chunk(&buf, chunk);
+    chunk = begin_chunk(&buf, "INAM", NULL);
+    put_name(&buf, "global", 8);
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "sdta");
+    chunk = begin_chunk(&buf, "smpl", NULL);
+
+    for(i = 0; i < SAMPLE_LEN + SAMPLE_PAD; i++)
+    {
+        put16(&buf, i < SAMPLE_LEN ? ((i % 40) - 20) * 1000 : 0);
+    }
+
+    end_chunk(&buf, chunk);
+    end_chunk(&buf, list);
+
+    list = begin_chunk(&buf, "LIST", "pdta");
+
+    chunk = begin_chunk(&buf, "phdr", NULL);
+    put_name(&buf, "preset", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put_name(&buf, "EOP", 20);
+    put16(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, 3);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    put32(&buf, 0);
+    end_chunk(&buf, chunk);
+
+    /* instrument zone, global zone, instrument zone */
+    chunk = begin_chunk(&buf, "pbag", NULL);
+    put_bag(&buf, 0);
+    put_bag(&buf, 1);
+    put_bag(&buf, 2);
+    put_bag(&buf, 3);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pmod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "pgen", NULL);
+    put_gen(&buf, GEN_INSTRUMENT, 0);
+    put_gen(&buf, GEN_PAN, -100);
+    put_gen(&buf, GEN_INSTRUMENT, 0);
+    put_gen(&buf, 0, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "inst", NULL);
+    put_name(&buf, "inst", 20);
+    put16(&buf, 0);
+    put_name(&buf, "EOI", 20);
+    put16(&buf, 4);
+    end_chunk(&buf, chunk);
+
+    /* sample zone, global zone, second global zone, sample zone */
+    chunk = begin_chunk(&buf, "ibag", NULL);
+    put_bag(&buf, 0);
+    put_bag(&buf, 2);
+    put_bag(&buf, 3);
+    put_bag(&buf, 4);
+    put_bag(&buf, 6);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "imod", NULL);
+    put_name(&buf, "", 10);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "igen", NULL);
+    put_gen(&buf, GEN_PAN, -500);
+    put_gen(&buf, GEN_SAMPLEID, 0);
+    put_gen(&buf, GEN_VOLENVRELEASE, -2400);
+    put_gen(&buf, GEN_PAN, 100);
+    put_gen(&buf, GEN_PAN, 500);
+    put_gen(&buf, GEN_SAMPLEID, 0);
+    put_gen(&buf, 0, 0);
+    end_chunk(&buf, chunk);
+
+    chunk = begin_chunk(&buf, "shdr", NULL);
+    put_name(&buf, "sample", 20);
+    put32(&buf, 0);
+    put32(&buf, SAMPLE_LEN);
+    put32(&buf, 100);
+    put32(&buf, SAMPLE_LEN - 100);
+    put32(&buf, 44100);
+    put8(&buf, 60);
+    put8(&buf, 0);
+    put16(&buf, 0);
+    put16(&buf, FLUID_SAMPLETYPE_MONO);
+    put_name(&buf, "EOS", 46);
+    end_chunk(&buf, chunk);
+
+    end_chunk(&buf, list);
+    end_chunk(&buf, riff);
+
+    save_sfont(&buf, filename);
+}
+
+// this tests that a global zone which is not the first zone of a preset or instrument is moved
+// to the front, and that any further global zone is discarded
+int main(void)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_sfloader_t *loader;
+    SFData *sf;
+    SFZone *zone;
+
+    TEST_ASSERT(settings != NULL);
+    loader = new_fluid_defsfloader(settings);
+    TEST_ASSERT(loader != NULL);
+
+    write_sfont(SFONT);
+
+    sf = fluid_sffile_open(SFONT, &loader->file_callbacks);
+    TEST_ASSERT(sf != NULL);
+    TEST_SUCCESS(fluid_sffile_parse_presets(sf));
+
+    TEST_ASSERT(sf->preset_count == 1);
+    TEST_ASSERT(sf->preset[0].zone_count == 3);
+    zone = sf->preset[0].zone;
+    TEST_ASSERT(zone[0].inst == NULL);
+    TEST_ASSERT(zone[0].gen_count == 1 && zone[0].gen[0].id == GEN_PAN && zone[0].gen[0].amount.sword == -100);
+    TEST_ASSERT(zone[1].inst == &sf->inst[0]);
+    TEST_ASSERT(zone[2].inst == &sf->inst[0]);
+
+    TEST_ASSERT(sf->inst_count == 1);
+    TEST_ASSERT(sf->inst[0].zone_count == 3);
+    zone = sf->inst[0].zone;
+    TEST_ASSERT(zone[0].sample == NULL);
+    TEST_ASSERT(zone[0].gen_count == 1 && zone[0].gen[0].id == GEN_VOLENVRELEASE);
+    TEST_ASSERT(zone[1].sample == &sf->sample[0]);
+    TEST_ASSERT(zone[1].gen_count == 1 && zone[1].gen[0].id == GEN_PAN && zone[1].gen[0].amount.sword == -500);
+    TEST_ASSERT(zone[2].sample == &sf->sample[0]);
+    TEST_ASSERT(zone[2].gen_count == 1 && zone[2].gen[0].id == GEN_PAN && zone[2].gen[0].amount.sword == 500);
+
+    fluid_sffile_close(sf);
+    remove(SFONT);
+
+    delete_fluid_sfloader(loader);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
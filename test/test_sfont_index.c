@@ -0,0 +1,203 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <string.h>
+
+#define SFONT_COPY "test_sfont_index.sf2"
+#define SFONT_INDEX SFONT_COPY ".fsidx"
+#define BUFSIZE 1024
+
+// the index is written next to the soundfont, so work on a copy of it
+static void copy_file(const char *src, const char *dest)
+{
+    char buf[4096];
+    size_t n;
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dest, "wb");
+
+    TEST_ASSERT(in != NULL);
+    TEST_ASSERT(out != NULL);
+
+    while((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        TEST_ASSERT(fwrite(buf, 1, n, out) == n);
+    }
+
+    fclose(in);
+    fclose(out);
+}
+
+/* Start and end of the pdta chunk data within the soundfont */
+static long pdta_start, pdta_end;
+
+/* Number of reads of the pdta chunk, i.e. of presets parsed from the soundfont */
+static int pdta_reads;
+
+static void find_pdta(const char *filename)
+{
+    static char data[1024 * 1024];
+    FILE *file = fopen(filename, "rb");
+    size_t size, i;
+
+    TEST_ASSERT(file != NULL);
+    size = fread(data, 1, sizeof(data), file);
+    TEST_ASSERT(feof(file));
+    fclose(file);
+
+    for(i = 8; i + 4 <= size; i++)
+    {
+        if(memcmp(&data[i], "pdta", 4) == 0 && memcmp(&data[i - 8], "LIST", 4) == 0)
+        {
+            pdta_start = i + 4;
+            pdta_end = i - 4 + ((unsigned char)data[i - 4] | ((unsigned char)data[i - 3] << 8)
+                                | ((unsigned char)data[i - 2] << 16) | ((long)(unsigned char)data[i - 1] << 24)) + 4;
+            return;
+        }
+    }
+
+    TEST_ASSERT(!"no pdta chunk");
+}
+
+static void *counting_open(const char *filename)
+{
+    return fopen(filename, "rb");
+}
+
+static int counting_read(void *buf, int count, void *handle)
+{
+    long pos = ftell((FILE *)handle);
+
+    if(pos < pdta_end && pos + count > pdta_start)
+    {
+        pdta_reads++;
+    }
+
+    return (fread(buf, count, 1, (FILE *)handle) == 1) ? FLUID_OK : FLUID_FAILED;
+}
+
+static int counting_seek(void *handle, long offset, int origin)
+{
+    return (fseek((FILE *)handle, offset, origin) == 0) ? FLUID_OK : FLUID_FAILED;
+}
+
+static long counting_tell(void *handle)
+{
+    return ftell((FILE *)handle);
+}
+
+static int counting_close(void *handle)
+{
+    return (fclose((FILE *)handle) == 0) ? FLUID_OK : FLUID_FAILED;
+}
+
+// loads the soundfont, plays a note on every preset and returns the rendered audio of all presets
+static float *render_sfont(int *preset_count)
+{
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    fluid_sfloader_t *loader;
+    fluid_sfont_t *sfont;
+    fluid_preset_t *preset;
+    float *out = NULL;
+    int id, count = 0;
+
+    TEST_ASSERT(settings != NULL);
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.soundfont-index", 1));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.reverb.active", 0));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.chorus.active", 0));
+
+    synth = new_fluid_synth(settings);
+    TEST_ASSERT(synth != NULL);
+
+    loader = new_fluid_defsfloader(settings);
+    TEST_ASSERT(loader != NULL);
+    TEST_SUCCESS(fluid_sfloader_set_callbacks(loader, counting_open, counting_read, counting_seek,
+                 counting_tell, counting_close));
+    fluid_synth_add_sfloader(synth, loader);
+
+    TEST_SUCCESS(id = fluid_synth_sfload(synth, SFONT_COPY, 1));
+    sfont = fluid_synth_get_sfont_by_id(synth, id);
+    TEST_ASSERT(sfont != NULL);
+
+    fluid_sfont_iteration_start(sfont);
+
+    while((preset = fluid_sfont_iteration_next(sfont)) != NULL)
+    {
+        float *block;
+
+        out = realloc(out, (count + 1) * 2 * BUFSIZE * sizeof(float));
+        TEST_ASSERT(out != NULL);
+        block = &out[count * 2 * BUFSIZE];
+
+        TEST_SUCCESS(fluid_synth_program_select(synth, 0, id, fluid_preset_get_banknum(preset), fluid_preset_get_num(preset)));
+        TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 100));
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, block, 0, 2, block, 1, 2));
+        TEST_SUCCESS(fluid_synth_all_sounds_off(synth, 0));
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, block, 0, 2, block, 1, 2));
+        count++;
+    }
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    *preset_count = count;
+    return out;
+}
+
+// this tests that a soundfont loaded from its compiled index behaves like the parsed one,
+// without parsing the presets of the soundfont again
+int main(void)
+{
+    float *parsed, *indexed;
+    int parsed_count, indexed_count;
+    FILE *file;
+
+    remove(SFONT_INDEX);
+    copy_file(TEST_SOUNDFONT, SFONT_COPY);
+    find_pdta(SFONT_COPY);
+
+    // the first load parses the soundfont and writes the index
+    pdta_reads = 0;
+    parsed = render_sfont(&parsed_count);
+    TEST_ASSERT(parsed_count > 1);
+    TEST_ASSERT(pdta_reads > 0);
+
+    file = fopen(SFONT_INDEX, "rb");
+    TEST_ASSERT(file != NULL);
+    fclose(file);
+
+    // the second load uses the index, every preset sounds the same
+    pdta_reads = 0;
+    indexed = render_sfont(&indexed_count);
+    TEST_ASSERT(pdta_reads == 0);
+    TEST_ASSERT(indexed_count == parsed_count);
+    TEST_ASSERT(memcmp(parsed, indexed, parsed_count * 2 * BUFSIZE * sizeof(float)) == 0);
+    free(indexed);
+
+    // a damaged index is ignored and rewritten
+    file = fopen(SFONT_INDEX, "wb");
+    TEST_ASSERT(file != NULL);
+    fputs("garbage", file);
+    fclose(file);
+
+    pdta_reads = 0;
+    indexed = render_sfont(&indexed_count);
+    TEST_ASSERT(pdta_reads > 0);
+    TEST_ASSERT(indexed_count == parsed_count);
+    TEST_ASSERT(memcmp(parsed, indexed, parsed_count * 2 * BUFSIZE * sizeof(float)) == 0);
+    free(indexed);
+
+    pdta_reads = 0;
+    indexed = render_sfont(&indexed_count);
+    TEST_ASSERT(pdta_reads == 0);
+    TEST_ASSERT(indexed_count == parsed_count);
+    TEST_ASSERT(memcmp(parsed, indexed, parsed_count * 2 * BUFSIZE * sizeof(float)) == 0);
+    free(indexed);
+    free(parsed);
+
+    remove(SFONT_INDEX);
+    remove(SFONT_COPY);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <string.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 16
+
+/* Number of zero bytes inserted in front of the sample data, moves the sample
+ * data and the hydra chunk past the 2 GiB mark */
+#define PADDING ((fluid_long_long_t)0xA0000000)
+
+/* A SoundFont held in memory, presented as a file with PADDING zero bytes
+ * inserted at the start of the smpl chunk data */
+typedef struct
+{
+    unsigned char *data;
+    long size;
+    long split;
+    fluid_long_long_t pos;
+} large_file_t;
+
+static large_file_t large_file;
+
+static unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void set32(unsigned char *p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+/* Find the sub chunk id within the list starting at pos, returns the position of its header */
+static long find_chunk(const unsigned char *data, long pos, long end, const char *id)
+{
+    while(pos + 8 <= end)
+    {
+        if(memcmp(&data[pos], id, 4) == 0)
+        {
+            return pos;
+        }
+
+        pos += 8 + ((get32(&data[pos + 4]) + 1) & ~1u);
+    }
+
+    return -1;
+}
+
+static void load_large_file(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    long sdta, smpl, pdta, shdr;
+    unsigned int i, count, padding = (unsigned int)(PADDING / 2);
+
+    TEST_ASSERT(file != NULL);
+    fseek(file, 0, SEEK_END);
+    large_file.size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    large_file.data = malloc(large_file.size);
+    TEST_ASSERT(large_file.data != NULL);
+    TEST_ASSERT(fread(large_file.data, large_file.size, 1, file) == 1);
+    fclose(file);
+
+    /* RIFF, INFO list, sdta list, pdta list */
+    sdta = find_chunk(large_file.data, 12, large_file.size, "LIST");
+    sdta += 8 + get32(&large_file.data[sdta + 4]);
+    TEST_ASSERT(memcmp(&large_file.data[sdta + 8], "sdta", 4) == 0);
+    smpl = find_chunk(large_file.data, sdta + 12, large_file.size, "smpl");
+    pdta = sdta + 8 + get32(&large_file.data[sdta + 4]);
+    shdr = find_chunk(large_file.data, pdta + 12, large_file.size, "shdr");
+    TEST_ASSERT(smpl > 0 && shdr > 0);
+
+    set32(&large_file.data[4], get32(&large_file.data[4]) + (unsigned int)PADDING);
+    set32(&large_file.data[sdta + 4], get32(&large_file.data[sdta + 4]) + (unsigned int)PADDING);
+    set32(&large_file.data[smpl + 4], get32(&large_file.data[smpl + 4]) + (unsigned int)PADDING);
+    large_file.split = smpl + 8;
+
+    /* move all sample, loop start and end points behind the padding */
+    count = get32(&large_file.data[shdr + 4]) / 46;
+
+    for(i = 0; i < count; i++)
+    {
+        unsigned char *p = &large_file.data[shdr + 8 + i * 46 + 20];
+        int k;
+
+        for(k = 0; k < 4; k++)
+        {
+            set32(&p[k * 4], get32(&p[k * 4]) + padding);
+        }
+    }
+}
+
+static void *large_open(const char *filename)
+{
+    large_file.pos = 0;
+    return &large_file;
+}
+
+static int large_read(void *buf, int count, void *handle)
+{
+    large_file_t *file = handle;
+    unsigned char *out = buf;
+    int i;
+
+    if(file->pos + count > file->size + PADDING)
+    {
+        return FLUID_FAILED;
+    }
+
+    for(i = 0; i < count; i++, file->pos++)
+    {
+        if(file->pos < file->split)
+        {
+            out[i] = file->data[file->pos];
+        }
+        else if(file->pos < file->split + PADDING)
+        {
+            out[i] = 0;
+        }
+        else
+        {
+            out[i] = file->data[file->pos - PADDING];
+        }
+    }
+
+    return FLUID_OK;
+}
+
+static int large_seek(void *handle, fluid_long_long_t offset, int origin)
+{
+    large_file_t *file = handle;
+
+    if(origin == SEEK_CUR)
+    {
+        offset += file->pos;
+    }
+    else if(origin == SEEK_END)
+    {
+        offset += file->size + PADDING;
+    }
+
+    if(offset < 0 || offset > file->size + PADDING)
+    {
+        return FLUID_FAILED;
+    }
+
+    file->pos = offset;
+    return FLUID_OK;
+}
+
+static fluid_long_long_t large_tell(void *handle)
+{
+    return ((large_file_t *)handle)->pos;
+}
+
+static int large_close(void *handle)
+{
+    return FLUID_OK;
+}
+
+static void render(fluid_settings_t *settings, int large, float *out)
+{
+    fluid_synth_t *synth = new_fluid_synth(settings);
+    int i;
+
+    TEST_ASSERT(synth != NULL);
+
+    if(large)
+    {
+        fluid_sfloader_t *loader = new_fluid_defsfloader(settings);
+
+        TEST_ASSERT(loader != NULL);
+        TEST_SUCCESS(fluid_sfloader_set_callbacks64(loader, large_open, large_read, large_seek,
+                     large_tell, large_close));
+        fluid_synth_add_sfloader(synth, loader);
+        TEST_SUCCESS(fluid_synth_sfload(synth, "large.sf2", 1));
+    }
+    else
+    {
+        TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    }
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 100));
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 72, 100));
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, &out[2 * BUFSIZE * i], 0, 2,
+                                             &out[2 * BUFSIZE * i], 1, 2));
+    }
+
+    delete_fluid_synth(synth);
+}
+
+// this tests that SoundFonts with sample data and hydra chunk beyond 2 GiB are loaded correctly
+int main(void)
+{
+    static float expected[2 * BUFSIZE * BLOCKS], actual[2 * BUFSIZE * BLOCKS];
+    fluid_settings_t *settings = new_fluid_settings();
+
+    TEST_ASSERT(settings != NULL);
+
+    // only load the samples of the selected presets, the padding is never read into memory
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 1));
+
+    load_large_file(TEST_SOUNDFONT);
+    render(settings, FALSE, expected);
+    render(settings, TRUE, actual);
+
+    TEST_ASSERT(memcmp(expected, actual, sizeof(expected)) == 0);
+
+    free(large_file.data);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <string.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 8
+
+static void render(fluid_synth_t *synth, float *out)
+{
+    int i;
+
+    TEST_SUCCESS(fluid_synth_noteon(synth, 0, 60, 100));
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        TEST_SUCCESS(fluid_synth_write_float(synth, BUFSIZE, &out[2 * BUFSIZE * i], 0, 2,
+                                             &out[2 * BUFSIZE * i], 1, 2));
+    }
+
+    TEST_SUCCESS(fluid_synth_noteoff(synth, 0, 60));
+}
+
+// this tests that a SoundFont loaded by one synth can be used by another one by reference
+int main(void)
+{
+    static float expected[2 * BUFSIZE * BLOCKS], actual[2 * BUFSIZE * BLOCKS];
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_settings_t *compressed_settings;
+    fluid_synth_t *synth1, *synth2;
+    fluid_sfont_t *sfont1, *sfont2;
+    fluid_preset_t *preset1, *preset2;
+    int id1, id2;
+
+    TEST_ASSERT(settings != NULL);
+
+    synth1 = new_fluid_synth(settings);
+    synth2 = new_fluid_synth(settings);
+    TEST_ASSERT(synth1 != NULL && synth2 != NULL);
+
+    // give the second synth a different SoundFont ID
+    TEST_SUCCESS(fluid_synth_sfload(synth2, TEST_SOUNDFONT, 0));
+    TEST_SUCCESS(fluid_synth_sfunload(synth2, 1, 0));
+
+    TEST_SUCCESS(id1 = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1));
+    sfont1 = fluid_synth_get_sfont_by_id(synth1, id1);
+    TEST_ASSERT(sfont1 != NULL);
+
+    TEST_SUCCESS(id2 = fluid_synth_sfload_shared(synth2, sfont1, 1));
+    TEST_ASSERT(id2 != id1);
+    sfont2 = fluid_synth_get_sfont_by_id(synth2, id2);
+    TEST_ASSERT(sfont2 != NULL && sfont2 != sfont1);
+    TEST_ASSERT(fluid_sfont_get_id(sfont2) == id2);
+    TEST_ASSERT(strcmp(fluid_sfont_get_name(sfont1), fluid_sfont_get_name(sfont2)) == 0);
+
+    // presets are distinct objects referring to their own SoundFont
+    preset1 = fluid_sfont_get_preset(sfont1, 0, 0);
+    preset2 = fluid_sfont_get_preset(sfont2, 0, 0);
+    TEST_ASSERT(preset1 != NULL && preset2 != NULL && preset1 != preset2);
+    TEST_ASSERT(fluid_preset_get_sfont(preset2) == sfont2);
+    TEST_ASSERT(strcmp(fluid_preset_get_name(preset1), fluid_preset_get_name(preset2)) == 0);
+
+    fluid_sfont_iteration_start(sfont2);
+    TEST_ASSERT(fluid_sfont_iteration_next(sfont2) != NULL);
+
+    render(synth1, expected);
+    render(synth2, actual);
+    TEST_ASSERT(memcmp(expected, actual, sizeof(expected)) == 0);
+
+    // the shared data outlives the synth that loaded it
+    TEST_SUCCESS(fluid_synth_sfunload(synth1, id1, 1));
+    delete_fluid_synth(synth1);
+
+    render(synth2, actual);
+    TEST_SUCCESS(fluid_synth_sfunload(synth2, id2, 1));
+
+    // SoundFonts using dynamic sample loading can't be shared
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 1));
+    synth1 = new_fluid_synth(settings);
+    TEST_ASSERT(synth1 != NULL);
+    TEST_SUCCESS(id1 = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1));
+    TEST_ASSERT(fluid_synth_sfload_shared(synth2, fluid_synth_get_sfont_by_id(synth1, id1), 1) == FLUID_FAILED);
+
+    delete_fluid_synth(synth1);
+    delete_fluid_synth(synth2);
+
+    // a SoundFont with compressed sample data plays the same in a synth using plain storage
+    compressed_settings = new_fluid_settings();
+    TEST_ASSERT(compressed_settings != NULL);
+    TEST_SUCCESS(fluid_settings_setstr(compressed_settings, "synth.sample-storage", "compressed"));
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.dynamic-sample-loading", 0));
+
+    synth1 = new_fluid_synth(compressed_settings);
+    synth2 = new_fluid_synth(settings);
+    TEST_ASSERT(synth1 != NULL && synth2 != NULL);
+
+    TEST_SUCCESS(id1 = fluid_synth_sfload(synth1, TEST_SOUNDFONT, 1));
+    TEST_SUCCESS(id2 = fluid_synth_sfload_shared(synth2, fluid_synth_get_sfont_by_id(synth1, id1), 1));
+
+    FLUID_MEMSET(actual, 0, sizeof(actual));
+    render(synth2, actual);
+    TEST_ASSERT(memcmp(expected, actual, sizeof(expected)) == 0);
+
+    delete_fluid_synth(synth1);
+    delete_fluid_synth(synth2);
+    delete_fluid_settings(compressed_settings);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <math.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 8
+#define CHANNELS 6
+#define SHARDS 3
+
+/* dry left, dry right, reverb left, reverb right, chorus left, chorus right */
+#define OUTPUTS 6
+
+static void noteon(void *data, handle_midi_event_func_t handler, int chan, int key)
+{
+    fluid_midi_event_t *event = new_fluid_midi_event();
+
+    TEST_ASSERT(event != NULL);
+    TEST_SUCCESS(fluid_midi_event_set_type(event, 0x90));
+    TEST_SUCCESS(fluid_midi_event_set_channel(event, chan));
+    TEST_SUCCESS(fluid_midi_event_set_key(event, key));
+    TEST_SUCCESS(fluid_midi_event_set_velocity(event, 100));
+    TEST_SUCCESS(handler(data, event));
+
+    delete_fluid_midi_event(event);
+}
+
+static void setup_buffers(float *block, float *dry[2], float *fx[4])
+{
+    int k;
+
+    for(k = 0; k < 2; k++)
+    {
+        dry[k] = &block[k * BUFSIZE];
+    }
+
+    for(k = 0; k < 4; k++)
+    {
+        fx[k] = &block[(2 + k) * BUFSIZE];
+    }
+}
+
+// this tests that a synth sharded across threads renders the same as a single synth
+int main(void)
+{
+    static float expected[OUTPUTS * BUFSIZE], actual[OUTPUTS * BUFSIZE];
+    float *dry[2], *fx[4];
+    fluid_settings_t *settings = new_fluid_settings();
+    fluid_synth_t *synth;
+    fluid_sharded_synth_t *ss;
+    int i, j, chan;
+
+    TEST_ASSERT(settings != NULL);
+
+    synth = new_fluid_synth(settings);
+    ss = new_fluid_sharded_synth(settings, SHARDS);
+    TEST_ASSERT(synth != NULL && ss != NULL);
+    TEST_ASSERT(fluid_sharded_synth_count_shards(ss) == SHARDS);
+    TEST_ASSERT(fluid_sharded_synth_get_shard(ss, SHARDS) == NULL);
+    TEST_ASSERT(fluid_sharded_synth_get_channel_shard(ss, 4) == fluid_sharded_synth_get_shard(ss, 1));
+
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    TEST_SUCCESS(fluid_sharded_synth_sfload(ss, TEST_SOUNDFONT, 1));
+
+    for(chan = 0; chan < CHANNELS; chan++)
+    {
+        for(i = 0; i < 5; i++)
+        {
+            noteon(synth, fluid_synth_handle_midi_event, chan, 40 + 7 * chan + i);
+            noteon(ss, fluid_sharded_synth_handle_midi_event, chan, 40 + 7 * chan + i);
+        }
+    }
+
+    // every shard only plays its own channels
+    TEST_ASSERT(fluid_synth_get_active_voice_count(fluid_sharded_synth_get_shard(ss, 0)) > 0);
+    TEST_ASSERT(fluid_synth_get_active_voice_count(fluid_sharded_synth_get_shard(ss, 0))
+                + fluid_synth_get_active_voice_count(fluid_sharded_synth_get_shard(ss, 1))
+                + fluid_synth_get_active_voice_count(fluid_sharded_synth_get_shard(ss, 2))
+                == fluid_synth_get_active_voice_count(synth));
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        FLUID_MEMSET(expected, 0, sizeof(expected));
+        FLUID_MEMSET(actual, 0, sizeof(actual));
+
+        setup_buffers(expected, dry, fx);
+        TEST_SUCCESS(fluid_synth_process(synth, BUFSIZE, 4, fx, 2, dry));
+
+        setup_buffers(actual, dry, fx);
+        TEST_SUCCESS(fluid_sharded_synth_process(ss, BUFSIZE, 4, fx, 2, dry));
+
+        // shards are summed in a different order
+        for(j = 0; j < OUTPUTS * BUFSIZE; j++)
+        {
+            TEST_ASSERT(fabs(expected[j] - actual[j]) < 1e-5);
+        }
+    }
+
+    delete_fluid_sharded_synth(ss);
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#include "test.h"
+#include "fluidsynth.h"
+#include "utils/fluidsynth_priv.h"
+
+#include <string.h>
+
+#define BUFSIZE 1024
+#define BLOCKS 8
+#define NOTES 40
+
+/* dry left, dry right, reverb left, reverb right, chorus left, chorus right */
+#define OUTPUTS 6
+
+static void render(fluid_settings_t *settings, float *out, int *voices)
+{
+    fluid_synth_t *synth = new_fluid_synth(settings);
+    float *dry[2], *fx[4];
+    int i, k;
+
+    TEST_ASSERT(synth != NULL);
+    TEST_SUCCESS(fluid_synth_sfload(synth, TEST_SOUNDFONT, 1));
+    TEST_ASSERT(fluid_synth_get_polyphony(synth) == 256);
+
+    for(i = 0; i < NOTES; i++)
+    {
+        TEST_SUCCESS(fluid_synth_noteon(synth, 0, 40 + i, 100));
+    }
+
+    *voices = fluid_synth_get_active_voice_count(synth);
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        for(k = 0; k < 2; k++)
+        {
+            dry[k] = &out[(i * OUTPUTS + k) * BUFSIZE];
+        }
+
+        for(k = 0; k < 4; k++)
+        {
+            fx[k] = &out[(i * OUTPUTS + 2 + k) * BUFSIZE];
+        }
+
+        TEST_SUCCESS(fluid_synth_process(synth, BUFSIZE, 4, fx, 2, dry));
+    }
+
+    TEST_SUCCESS(fluid_synth_set_polyphony(synth, 8));
+    TEST_ASSERT(fluid_synth_get_polyphony(synth) == 8);
+
+    delete_fluid_synth(synth);
+}
+
+// this tests that a lightweight synth, which allocates its resources on demand, renders the same as a regular one
+int main(void)
+{
+    static float expected[OUTPUTS * BUFSIZE * BLOCKS], actual[OUTPUTS * BUFSIZE * BLOCKS];
+    fluid_settings_t *settings = new_fluid_settings();
+    int expected_voices, actual_voices;
+
+    TEST_ASSERT(settings != NULL);
+
+    render(settings, expected, &expected_voices);
+
+    TEST_SUCCESS(fluid_settings_setint(settings, "synth.lightweight", 1));
+    render(settings, actual, &actual_voices);
+
+    // the voice pool must have grown beyond its initial size
+    TEST_ASSERT(expected_voices > 16);
+    TEST_ASSERT(actual_voices == expected_voices);
+    TEST_ASSERT(memcmp(expected, actual, sizeof(expected)) == 0);
+
+    delete_fluid_settings(settings);
+
+    return EXIT_SUCCESS;
+}